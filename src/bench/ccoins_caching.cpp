@@ -5,6 +5,7 @@
 #include <bench/bench.h>
 #include <coins.h>
 #include <policy/policy.h>
+#include <random.h>
 #include <script/signingprovider.h>
 #include <test/util/transaction_utils.h>
 
@@ -50,4 +51,44 @@ static void CCoinsCaching(benchmark::Bench& bench)
     ECC_Stop();
 }
 
+// Fill a cache on top of another one like ConnectBlock does during IBD, read every coin back and flush it
+// down, once with pooled cache entries and once with one heap allocation per entry.
+static void CCoinsCacheFillFlush(benchmark::Bench& bench, bool pooled)
+{
+    static constexpr uint32_t NUM_COINS{50000};
+
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::vector<COutPoint> outpoints;
+    outpoints.reserve(NUM_COINS);
+    for (uint32_t i = 0; i < NUM_COINS; ++i) {
+        outpoints.emplace_back(rng.rand256(), i % 4);
+    }
+    CTxOut txout{1 * COIN, CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 1) << OP_EQUALVERIFY << OP_CHECKSIG};
+
+    const bool prev_pooled{g_coins_cache_pool.exchange(pooled)};
+    CCoinsView coinsDummy;
+    CCoinsViewCache base(&coinsDummy);
+    bench.run([&] {
+        CCoinsViewCache cache(&base);
+        for (const COutPoint& outpoint : outpoints) {
+            cache.AddCoin(outpoint, Coin{txout, 1, false}, /*possible_overwrite=*/false);
+        }
+        for (const COutPoint& outpoint : outpoints) {
+            assert(!cache.AccessCoin(outpoint).IsSpent());
+        }
+        assert(cache.DynamicMemoryUsage() > 0);
+        assert(cache.Flush());
+        // Spend everything again so the base doesn't grow between iterations
+        for (const COutPoint& outpoint : outpoints) {
+            base.SpendCoin(outpoint);
+        }
+    });
+    g_coins_cache_pool = prev_pooled;
+}
+
+static void CCoinsCacheFillFlushPooled(benchmark::Bench& bench) { CCoinsCacheFillFlush(bench, /*pooled=*/true); }
+static void CCoinsCacheFillFlushPlain(benchmark::Bench& bench) { CCoinsCacheFillFlush(bench, /*pooled=*/false); }
+
 BENCHMARK(CCoinsCaching);
+BENCHMARK(CCoinsCacheFillFlushPooled);
+BENCHMARK(CCoinsCacheFillFlushPlain);
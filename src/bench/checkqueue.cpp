@@ -17,37 +17,40 @@ static const size_t BATCH_SIZE = 30;
 static const int PREVECTOR_SIZE = 28;
 static const unsigned int QUEUE_BATCH_SIZE = 128;
 
+struct PrevectorJob {
+    prevector<PREVECTOR_SIZE, uint8_t> p;
+    PrevectorJob(){
+    }
+    explicit PrevectorJob(FastRandomContext& insecure_rand){
+        p.resize(insecure_rand.randrange(PREVECTOR_SIZE*2));
+    }
+    bool operator()()
+    {
+        return true;
+    }
+    void swap(PrevectorJob& x) noexcept
+    {
+        p.swap(x.p);
+    };
+};
+
 // This Benchmark tests the CheckQueue with a slightly realistic workload,
 // where checks all contain a prevector that is indirect 50% of the time
 // and there is a little bit of work done between calls to Add.
-static void CCheckQueueSpeedPrevectorJob(benchmark::Bench& bench)
+// threads_num is the number of worker threads, 0 to use all cores.
+template <typename Queue>
+static void CheckQueueSpeedPrevectorJob(benchmark::Bench& bench, int threads_num)
 {
     // We shouldn't ever be running with the checkqueue on a single core machine.
     if (GetNumCores() <= 1) return;
 
     ECC_Start();
 
-    struct PrevectorJob {
-        prevector<PREVECTOR_SIZE, uint8_t> p;
-        PrevectorJob(){
-        }
-        explicit PrevectorJob(FastRandomContext& insecure_rand){
-            p.resize(insecure_rand.randrange(PREVECTOR_SIZE*2));
-        }
-        bool operator()()
-        {
-            return true;
-        }
-        void swap(PrevectorJob& x) noexcept
-        {
-            p.swap(x.p);
-        };
-    };
-    CCheckQueue<PrevectorJob> queue {QUEUE_BATCH_SIZE};
+    Queue queue {QUEUE_BATCH_SIZE};
 
     // The main thread should be counted to prevent thread oversubscription, and
     // to decrease the variance of benchmark results.
-    queue.StartWorkerThreads(GetNumCores() - 1);
+    queue.StartWorkerThreads(threads_num > 0 ? threads_num : GetNumCores() - 1);
 
     // create all the data once, then submit copies in the benchmark.
     FastRandomContext insecure_rand(true);
@@ -60,7 +63,7 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::Bench& bench)
 
     bench.minEpochIterations(10).batch(BATCH_SIZE * BATCHES).unit("job").run([&] {
         // Make insecure_rand here so that each iteration is identical.
-        CCheckQueueControl<PrevectorJob> control(&queue);
+        CCheckQueueControl<PrevectorJob, Queue> control(&queue);
         for (auto vChecks : vBatches) {
             control.Add(vChecks);
         }
@@ -71,4 +74,34 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::Bench& bench)
     queue.StopWorkerThreads();
     ECC_Stop();
 }
+
+static void CCheckQueueSpeedPrevectorJob(benchmark::Bench& bench)
+{
+    CheckQueueSpeedPrevectorJob<CCheckQueue<PrevectorJob>>(bench, 0);
+}
+static void CCheckQueueSpeedPrevectorJob16Threads(benchmark::Bench& bench)
+{
+    CheckQueueSpeedPrevectorJob<CCheckQueue<PrevectorJob>>(bench, 16);
+}
+static void CCheckQueueSpeedPrevectorJob31Threads(benchmark::Bench& bench)
+{
+    CheckQueueSpeedPrevectorJob<CCheckQueue<PrevectorJob>>(bench, 31);
+}
+static void CWorkStealingCheckQueueSpeedPrevectorJob(benchmark::Bench& bench)
+{
+    CheckQueueSpeedPrevectorJob<CWorkStealingCheckQueue<PrevectorJob>>(bench, 0);
+}
+static void CWorkStealingCheckQueueSpeedPrevectorJob16Threads(benchmark::Bench& bench)
+{
+    CheckQueueSpeedPrevectorJob<CWorkStealingCheckQueue<PrevectorJob>>(bench, 16);
+}
+static void CWorkStealingCheckQueueSpeedPrevectorJob31Threads(benchmark::Bench& bench)
+{
+    CheckQueueSpeedPrevectorJob<CWorkStealingCheckQueue<PrevectorJob>>(bench, 31);
+}
 BENCHMARK(CCheckQueueSpeedPrevectorJob);
+BENCHMARK(CCheckQueueSpeedPrevectorJob16Threads);
+BENCHMARK(CCheckQueueSpeedPrevectorJob31Threads);
+BENCHMARK(CWorkStealingCheckQueueSpeedPrevectorJob);
+BENCHMARK(CWorkStealingCheckQueueSpeedPrevectorJob16Threads);
+BENCHMARK(CWorkStealingCheckQueueSpeedPrevectorJob31Threads);
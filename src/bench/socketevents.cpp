@@ -0,0 +1,180 @@
+// Copyright (c) 2024 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <compat.h>
+#include <util/edge.h>
+#include <util/sock.h>
+
+#ifndef WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
+#include <chrono>
+#include <set>
+#include <utility>
+#include <vector>
+
+// Number of connected loopback socket pairs, one end plays the peer and the other end is watched
+static constexpr size_t SOCKET_PAIRS{256};
+// Number of peers sending a message per iteration
+static constexpr size_t ACTIVE_PEERS{16};
+
+namespace {
+struct LoopbackPeers
+{
+    std::vector<std::pair<int, int>> pairs;
+
+    LoopbackPeers()
+    {
+        for (size_t i = 0; i < SOCKET_PAIRS; ++i) {
+            int fds[2];
+            assert(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0);
+            pairs.emplace_back(fds[0], fds[1]);
+        }
+    }
+    ~LoopbackPeers()
+    {
+        for (const auto& [local, remote] : pairs) {
+            close(local);
+            close(remote);
+        }
+    }
+
+    /* Make ACTIVE_PEERS peers, spread over all pairs, send a byte each */
+    void Send(size_t round) const
+    {
+        const uint8_t byte{0};
+        for (size_t i = 0; i < ACTIVE_PEERS; ++i) {
+            const int remote = pairs[(round * ACTIVE_PEERS + i * (SOCKET_PAIRS / ACTIVE_PEERS)) % SOCKET_PAIRS].second;
+            assert(send(remote, &byte, 1, 0) == 1);
+        }
+    }
+
+    /* Drain a socket that was reported readable, returns the number of bytes read */
+    static size_t Drain(int local)
+    {
+        uint8_t buf[64];
+        size_t total{0};
+        ssize_t n;
+        while ((n = recv(local, buf, sizeof(buf), 0)) > 0) total += n;
+        return total;
+    }
+};
+
+/* Send from some peers and wait until all of their bytes were picked up through `wait`,
+ * which fills the set of readable local sockets */
+template <typename WaitFn>
+void RunRounds(benchmark::Bench& bench, const LoopbackPeers& peers, WaitFn&& wait)
+{
+    size_t round{0};
+    std::set<int> readable;
+    bench.run([&] {
+        peers.Send(round++);
+        size_t received{0};
+        while (received < ACTIVE_PEERS) {
+            readable.clear();
+            wait(readable);
+            for (const int local : readable) received += LoopbackPeers::Drain(local);
+        }
+    });
+}
+} // anonymous namespace
+
+static void SocketEventsPoll(benchmark::Bench& bench)
+{
+    LoopbackPeers peers;
+    std::vector<pollfd> pollfds;
+    for (const auto& [local, remote] : peers.pairs) {
+        pollfds.push_back({local, POLLIN, 0});
+    }
+    RunRounds(bench, peers, [&](std::set<int>& readable) {
+        // Level-triggered, the whole set is handed to the kernel on every call
+        assert(poll(pollfds.data(), pollfds.size(), 1000) > 0);
+        for (const auto& entry : pollfds) {
+            if (entry.revents & POLLIN) readable.insert(entry.fd);
+        }
+    });
+}
+
+static void SocketEventsSelect(benchmark::Bench& bench)
+{
+    LoopbackPeers peers;
+    RunRounds(bench, peers, [&](std::set<int>& readable) {
+        fd_set fdset;
+        FD_ZERO(&fdset);
+        int max_fd{0};
+        for (const auto& [local, remote] : peers.pairs) {
+            FD_SET(local, &fdset);
+            max_fd = std::max(max_fd, local);
+        }
+        timeval timeout{1, 0};
+        assert(select(max_fd + 1, &fdset, nullptr, nullptr, &timeout) > 0);
+        for (const auto& [local, remote] : peers.pairs) {
+            if (FD_ISSET(local, &fdset)) readable.insert(local);
+        }
+    });
+}
+
+#ifdef USE_EPOLL
+static void SocketEventsEpoll(benchmark::Bench& bench)
+{
+    LoopbackPeers peers;
+    EdgeTriggeredEvents events{SocketEventsMode::EPoll};
+    assert(events.IsValid());
+    for (const auto& [local, remote] : peers.pairs) {
+        assert(events.RegisterEvents(local));
+    }
+    RunRounds(bench, peers, [&](std::set<int>& readable) {
+        epoll_event ev[64];
+        const int n = epoll_wait(events.GetFileDescriptor(), ev, 64, 1000);
+        assert(n > 0);
+        for (int i = 0; i < n; ++i) {
+            if (ev[i].events & EPOLLIN) readable.insert(ev[i].data.fd);
+        }
+    });
+    for (const auto& [local, remote] : peers.pairs) {
+        events.UnregisterEvents(local);
+    }
+}
+#endif
+
+#ifdef USE_IO_URING
+static void SocketEventsIOUring(benchmark::Bench& bench)
+{
+    LoopbackPeers peers;
+    EdgeTriggeredEvents events{SocketEventsMode::IOUring};
+    // Built with io_uring but not usable on this kernel, nothing to compare
+    if (!events.IsValid()) return;
+    for (const auto& [local, remote] : peers.pairs) {
+        assert(events.RegisterEvents(local));
+    }
+    std::vector<std::pair<SOCKET, uint32_t>> completions;
+    RunRounds(bench, peers, [&](std::set<int>& readable) {
+        completions.clear();
+        assert(events.WaitEvents(completions, std::chrono::milliseconds{1000}));
+        for (const auto& [socket, revents] : completions) {
+            if (revents & POLLIN) readable.insert(socket);
+        }
+    });
+    for (const auto& [local, remote] : peers.pairs) {
+        events.UnregisterEvents(local);
+    }
+}
+#endif
+
+BENCHMARK(SocketEventsSelect);
+BENCHMARK(SocketEventsPoll);
+#ifdef USE_EPOLL
+BENCHMARK(SocketEventsEpoll);
+#endif
+#ifdef USE_IO_URING
+BENCHMARK(SocketEventsIOUring);
+#endif
+#endif // WIN32
@@ -48,7 +48,8 @@ uint64_t CBlockHeaderAndShortTxIDs::GetShortID(const uint256& txhash) const {
 
 
 
-ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& cmpctblock, const std::vector<std::pair<uint256, CTransactionRef>>& extra_txn) {
+ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& cmpctblock, const std::vector<std::pair<uint256, CTransactionRef>>& extra_txn,
+                                              const std::vector<std::pair<uint256, CTransactionRef>>& hint_txn) {
     if (cmpctblock.header.IsNull() || (cmpctblock.shorttxids.empty() && cmpctblock.prefilledtxn.empty()))
         return READ_STATUS_INVALID;
     if (cmpctblock.shorttxids.size() + cmpctblock.prefilledtxn.size() > MaxBlockSize() / MIN_TRANSACTION_SIZE)
@@ -105,7 +106,34 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
         return READ_STATUS_FAILED; // Short ID collision
 
     std::vector<bool> have_txn(txn_available.size());
-    {
+    // Hints go first, they hold the IS-locked transactions which blocks are mostly made of,
+    // including the ones that already left the mempool
+    for (size_t i = 0; i < hint_txn.size(); i++) {
+        if (!hint_txn[i].second) continue;
+        uint64_t shortid = cmpctblock.GetShortID(hint_txn[i].first);
+        std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(shortid);
+        if (idit != shorttxids.end()) {
+            if (!have_txn[idit->second]) {
+                txn_available[idit->second] = hint_txn[i].second;
+                have_txn[idit->second]  = true;
+                mempool_count++;
+                hint_count++;
+            } else {
+                // A tx is hinted again when it got IS-locked and then evicted, only distinct
+                // transactions matching the same short id are a collision
+                if (txn_available[idit->second] &&
+                        txn_available[idit->second]->GetHash() != hint_txn[i].second->GetHash()) {
+                    txn_available[idit->second].reset();
+                    mempool_count--;
+                    hint_count--;
+                }
+            }
+        }
+        if (mempool_count == shorttxids.size())
+            break;
+    }
+
+    if (mempool_count < shorttxids.size()) {
     LOCK(pool->cs);
     for (size_t i = 0; i < pool->vTxHashes.size(); i++) {
         uint64_t shortid = cmpctblock.GetShortID(pool->vTxHashes[i].first);
@@ -119,7 +147,9 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
                 // If we find two mempool txn that match the short id, just request it.
                 // This should be rare enough that the extra bandwidth doesn't matter,
                 // but eating a round-trip due to FillBlock failure would be annoying
-                if (txn_available[idit->second]) {
+                // Note that a mempool tx that was also hinted is not a collision
+                if (txn_available[idit->second] &&
+                        txn_available[idit->second]->GetHash() != pool->vTxHashes[i].first) {
                     txn_available[idit->second].reset();
                     mempool_count--;
                 }
@@ -209,7 +239,7 @@ ReadStatus PartiallyDownloadedBlock::FillBlock(CBlock& block, const std::vector<
         return READ_STATUS_CHECKBLOCK_FAILED;
     }
 
-    LogPrint(BCLog::CMPCTBLOCK, "Successfully reconstructed block %s with %lu txn prefilled, %lu txn from mempool (incl at least %lu from extra pool) and %lu txn requested\n", hash.ToString(), prefilled_count, mempool_count, extra_count, vtx_missing.size());
+    LogPrint(BCLog::CMPCTBLOCK, "Successfully reconstructed block %s with %lu txn prefilled, %lu txn from mempool (incl at least %lu from extra pool and %lu from hints) and %lu txn requested\n", hash.ToString(), prefilled_count, mempool_count, extra_count, hint_count, vtx_missing.size());
     if (vtx_missing.size() < 5) {
         for (const auto& tx : vtx_missing) {
             LogPrint(BCLog::CMPCTBLOCK, "Reconstructed block %s required tx %s\n", hash.ToString(), tx->GetHash().ToString());
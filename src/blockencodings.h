@@ -125,15 +125,20 @@ public:
 class PartiallyDownloadedBlock {
 protected:
     std::vector<CTransactionRef> txn_available;
-    size_t prefilled_count = 0, mempool_count = 0, extra_count = 0;
+    size_t prefilled_count = 0, mempool_count = 0, extra_count = 0, hint_count = 0;
     const CTxMemPool* pool;
 public:
     CBlockHeader header;
     explicit PartiallyDownloadedBlock(CTxMemPool* poolIn) : pool(poolIn) {}
 
     // extra_txn is a list of extra transactions to look at, in <hash, reference> form
-    ReadStatus InitData(const CBlockHeaderAndShortTxIDs& cmpctblock, const std::vector<std::pair<uint256, CTransactionRef>>& extra_txn);
+    // hint_txn are looked at before the mempool, in the same form, they are transactions likely to be mined
+    // that may not be in the mempool anymore (IS-locked or evicted ones)
+    ReadStatus InitData(const CBlockHeaderAndShortTxIDs& cmpctblock, const std::vector<std::pair<uint256, CTransactionRef>>& extra_txn,
+                        const std::vector<std::pair<uint256, CTransactionRef>>& hint_txn = {});
     bool IsTxAvailable(size_t index) const;
+    // Number of transactions that were found in hint_txn
+    size_t GetHintCount() const { return hint_count; }
     ReadStatus FillBlock(CBlock& block, const std::vector<CTransactionRef>& vtx_missing);
 };
 
@@ -48,6 +48,9 @@ struct AssumeutxoData {
     //! We need to hardcode the value here because this is computed cumulatively using block data,
     //! which we do not necessarily have at the time of snapshot load.
     const unsigned int nChainTx;
+
+    //! The expected hash of the EvoDB entries shipped with the snapshot, see SnapshotEvoDBEntry.
+    const uint256 evodb_hash;
 };
 
 using MapAssumeutxo = std::map<int, const AssumeutxoData>;
@@ -10,11 +10,13 @@
 #include <util/threadnames.h>
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <type_traits>
+#include <variant>
 #include <vector>
 
-template <typename T>
-class CCheckQueueControl;
-
 /**
  * Queue for verifications that have to be performed.
   * The verifications are represented by a type T, which must provide an
@@ -205,21 +207,258 @@ public:
 };
 
 /**
- * RAII-style controller object for a CCheckQueue that guarantees the passed
- * queue is finished before continuing.
+ * Queue for verifications like CCheckQueue, with a work queue per thread instead of one shared queue.
+ *
+ * Checks added by the master are spread over the queues of all threads (the master has one too). Every
+ * thread takes batches from the back of its own queue and, once that is empty, steals batches from the
+ * front of the others'. Each queue has its own lock, held only while moving a batch in or out, so threads
+ * rarely contend and executing checks takes no lock at all. Progress is tracked with atomics, the shared
+ * mutex is only taken to put idle threads to sleep and wake them up.
+ *
+ * T has the same requirements as for CCheckQueue. Checks of different types can share a queue through
+ * CCheckVariant.
  */
 template <typename T>
+class CWorkStealingCheckQueue
+{
+private:
+    struct WorkQueue {
+        Mutex m_mutex;
+        std::deque<T> m_checks GUARDED_BY(m_mutex);
+    };
+
+    //! One work queue per worker thread, plus the master's at index 0
+    std::vector<std::unique_ptr<WorkQueue>> m_queues;
+
+    //! Protects sleeping and waking up only, never taken while there is work
+    Mutex m_sleep_mutex;
+    //! Worker threads block on this when out of work
+    std::condition_variable m_worker_cv;
+    //! Master thread blocks on this when out of work
+    std::condition_variable m_master_cv;
+    //! Bumped whenever work is added, so a thread that found nothing can tell whether it missed any
+    uint64_t m_work_epoch GUARDED_BY(m_sleep_mutex){0};
+    bool m_request_stop GUARDED_BY(m_sleep_mutex){false};
+
+    //! Number of checks that haven't completed yet, including those in the threads' own batches
+    std::atomic<unsigned int> m_todo{0};
+    //! The temporary evaluation result.
+    std::atomic<bool> m_all_ok{true};
+    //! Work queue the next Add() starts distributing at
+    size_t m_next_queue{0};
+
+    //! The maximum number of elements to be processed in one batch
+    const unsigned int nBatchSize;
+
+    std::vector<std::thread> m_worker_threads;
+
+    //! Move a batch out of a work queue, from the back of our own or the front of another one
+    bool TakeBatch(WorkQueue& queue, bool own, std::vector<T>& batch) EXCLUSIVE_LOCKS_REQUIRED(!queue.m_mutex)
+    {
+        LOCK(queue.m_mutex);
+        if (queue.m_checks.empty()) return false;
+        // Leave half of the queue to the other threads
+        const size_t count = std::max<size_t>(1, std::min<size_t>(nBatchSize, queue.m_checks.size() / 2));
+        batch.resize(count);
+        for (T& check : batch) {
+            if (own) {
+                check.swap(queue.m_checks.back());
+                queue.m_checks.pop_back();
+            } else {
+                check.swap(queue.m_checks.front());
+                queue.m_checks.pop_front();
+            }
+        }
+        return true;
+    }
+
+    bool FindBatch(size_t index, std::vector<T>& batch)
+    {
+        if (TakeBatch(*m_queues[index], /*own=*/true, batch)) return true;
+        for (size_t i = 1; i < m_queues.size(); ++i) {
+            if (TakeBatch(*m_queues[(index + i) % m_queues.size()], /*own=*/false, batch)) return true;
+        }
+        return false;
+    }
+
+    void RunBatch(std::vector<T>& batch)
+    {
+        const unsigned int count = batch.size();
+        // After a failure the remaining checks are only counted down
+        bool ok = m_all_ok.load(std::memory_order_relaxed);
+        for (T& check : batch) {
+            if (ok) ok = check();
+        }
+        if (!ok) m_all_ok.store(false, std::memory_order_relaxed);
+        // Checks are destroyed before they are reported done, the master may return right after
+        batch.clear();
+        if (m_todo.fetch_sub(count, std::memory_order_acq_rel) == count) {
+            // Take the lock so the master can't miss the notification between its check and its wait
+            { LOCK(m_sleep_mutex); }
+            m_master_cv.notify_one();
+        }
+    }
+
+    void WorkerLoop(size_t index) EXCLUSIVE_LOCKS_REQUIRED(!m_sleep_mutex)
+    {
+        std::vector<T> batch;
+        batch.reserve(nBatchSize);
+        while (true) {
+            const uint64_t epoch = WITH_LOCK(m_sleep_mutex, return m_work_epoch);
+            while (FindBatch(index, batch)) {
+                RunBatch(batch);
+            }
+            WAIT_LOCK(m_sleep_mutex, lock);
+            while (m_work_epoch == epoch && !m_request_stop) {
+                m_worker_cv.wait(lock);
+            }
+            if (m_request_stop) return;
+        }
+    }
+
+public:
+    //! Mutex to ensure only one concurrent CCheckQueueControl
+    Mutex m_control_mutex;
+
+    //! Create a new check queue
+    explicit CWorkStealingCheckQueue(unsigned int nBatchSizeIn)
+        : nBatchSize(nBatchSizeIn)
+    {
+        m_queues.push_back(std::make_unique<WorkQueue>());
+    }
+
+    //! Create a pool of new worker threads.
+    void StartWorkerThreads(const int threads_num) EXCLUSIVE_LOCKS_REQUIRED(!m_sleep_mutex)
+    {
+        assert(m_worker_threads.empty());
+        m_queues.resize(1);
+        for (int n = 0; n < threads_num; ++n) {
+            m_queues.push_back(std::make_unique<WorkQueue>());
+        }
+        m_all_ok = true;
+        for (int n = 0; n < threads_num; ++n) {
+            m_worker_threads.emplace_back([this, n]() {
+                util::ThreadRename(strprintf("scriptch.%i", n));
+                WorkerLoop(n + 1);
+            });
+        }
+    }
+
+    //! Wait until execution finishes, and return whether all evaluations were successful.
+    bool Wait() EXCLUSIVE_LOCKS_REQUIRED(!m_sleep_mutex)
+    {
+        std::vector<T> batch;
+        batch.reserve(nBatchSize);
+        // Help out until there is nothing left to take, only the master adds work so none can show up later
+        while (FindBatch(0, batch)) {
+            RunBatch(batch);
+        }
+        {
+            WAIT_LOCK(m_sleep_mutex, lock);
+            while (m_todo.load(std::memory_order_acquire) != 0) {
+                m_master_cv.wait(lock);
+            }
+        }
+        // reset the status for new work later
+        return m_all_ok.exchange(true);
+    }
+
+    //! Add a batch of checks to the queue
+    void Add(std::vector<T>& vChecks) EXCLUSIVE_LOCKS_REQUIRED(!m_sleep_mutex)
+    {
+        if (vChecks.empty()) {
+            return;
+        }
+
+        m_todo.fetch_add(vChecks.size(), std::memory_order_relaxed);
+        // Spread the checks over the work queues in contiguous slices, starting where the last call stopped
+        const size_t slices = std::min(vChecks.size(), m_queues.size());
+        const size_t per_slice = (vChecks.size() + slices - 1) / slices;
+        for (size_t begin = 0; begin < vChecks.size(); begin += per_slice) {
+            WorkQueue& queue = *m_queues[m_next_queue];
+            m_next_queue = (m_next_queue + 1) % m_queues.size();
+            LOCK(queue.m_mutex);
+            for (size_t i = begin; i < std::min(begin + per_slice, vChecks.size()); ++i) {
+                queue.m_checks.emplace_back();
+                vChecks[i].swap(queue.m_checks.back());
+            }
+        }
+
+        WITH_LOCK(m_sleep_mutex, ++m_work_epoch);
+        if (vChecks.size() == 1) {
+            m_worker_cv.notify_one();
+        } else {
+            m_worker_cv.notify_all();
+        }
+    }
+
+    //! Stop all of the worker threads.
+    void StopWorkerThreads() EXCLUSIVE_LOCKS_REQUIRED(!m_sleep_mutex)
+    {
+        WITH_LOCK(m_sleep_mutex, m_request_stop = true);
+        m_worker_cv.notify_all();
+        for (std::thread& t : m_worker_threads) {
+            t.join();
+        }
+        m_worker_threads.clear();
+        m_queues.resize(1);
+        WITH_LOCK(m_sleep_mutex, m_request_stop = false);
+    }
+
+    ~CWorkStealingCheckQueue()
+    {
+        assert(m_worker_threads.empty());
+    }
+};
+
+/**
+ * A check of one of several types, so checks of different kinds can share a queue and its threads.
+ * Default constructed it is empty and succeeds, like the placeholders the queues swap in.
+ */
+template <typename... Ts>
+class CCheckVariant
+{
+private:
+    std::variant<std::monostate, Ts...> m_check;
+
+public:
+    CCheckVariant() = default;
+    template <typename U, typename = std::enable_if_t<(std::is_same_v<std::decay_t<U>, Ts> || ...)>>
+    CCheckVariant(U&& check) : m_check(std::forward<U>(check)) {}
+
+    bool operator()()
+    {
+        return std::visit([](auto& check) {
+            if constexpr (std::is_same_v<std::decay_t<decltype(check)>, std::monostate>) {
+                return true;
+            } else {
+                return bool(check());
+            }
+        }, m_check);
+    }
+
+    void swap(CCheckVariant& x) noexcept
+    {
+        m_check.swap(x.m_check);
+    }
+};
+
+/**
+ * RAII-style controller object for a CCheckQueue (or CWorkStealingCheckQueue)
+ * that guarantees the passed queue is finished before continuing.
+ */
+template <typename T, typename Queue = CCheckQueue<T>>
 class CCheckQueueControl
 {
 private:
-    CCheckQueue<T> * const pqueue;
+    Queue * const pqueue;
     bool fDone;
 
 public:
     CCheckQueueControl() = delete;
     CCheckQueueControl(const CCheckQueueControl&) = delete;
     CCheckQueueControl& operator=(const CCheckQueueControl&) = delete;
-    explicit CCheckQueueControl(CCheckQueue<T> * const pqueueIn) : pqueue(pqueueIn), fDone(false)
+    explicit CCheckQueueControl(Queue * const pqueueIn) : pqueue(pqueueIn), fDone(false)
     {
         // passed queue is supposed to be unused, or nullptr
         if (pqueue != nullptr) {
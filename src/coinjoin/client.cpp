@@ -4,6 +4,8 @@
 
 #include <coinjoin/client.h>
 
+#include <bls/bls.h>
+#include <bls/bls_worker.h>
 #include <chainparams.h>
 #include <coinjoin/options.h>
 #include <consensus/validation.h>
@@ -12,6 +14,7 @@
 #include <masternode/meta.h>
 #include <masternode/sync.h>
 #include <net.h>
+#include <net_processing.h>
 #include <netmessagemaker.h>
 #include <shutdown.h>
 #include <util/check.h>
@@ -60,75 +63,114 @@ PeerMsgRet CCoinJoinClientQueueManager::ProcessDSQueue(const CNode& peer, CDataS
         }
     }
 
+    CDeterministicMNCPtr dmn;
     {
         LOCK(cs_ProcessDSQueue);
 
         {
             LOCK(cs_vecqueue);
             // process every dsq only once
-            for (const auto &q: vecCoinJoinQueue) {
-                if (q == dsq) {
-                    return {};
-                }
-                if (q.fReady == dsq.fReady && q.masternodeOutpoint == dsq.masternodeOutpoint) {
-                    // no way the same mn can send another dsq with the same readiness this soon
-                    LogPrint(BCLog::COINJOIN, /* Continued */
-                             "DSQUEUE -- Peer %s is sending WAY too many dsq messages for a masternode with collateral %s\n",
-                             peer.GetLogString(), dsq.masternodeOutpoint.ToStringShort());
+            if (const auto q = FindQueueLocked(dsq.masternodeOutpoint, dsq.fReady, dsq.nDenom)) {
+                if (*q == dsq) {
                     return {};
                 }
+                // no way the same mn can send another dsq with the same readiness this soon
+                LogPrint(BCLog::COINJOIN, /* Continued */
+                         "DSQUEUE -- Peer %s is sending WAY too many dsq messages for a masternode with collateral %s\n",
+                         peer.GetLogString(), dsq.masternodeOutpoint.ToStringShort());
+                return {};
             }
         } // cs_vecqueue
 
+        // the same queue (or a spammy one) is still waiting for signature verification
+        if (setPendingQueues.count({dsq.masternodeOutpoint, dsq.fReady})) return {};
+
         LogPrint(BCLog::COINJOIN, "DSQUEUE -- %s new\n", dsq.ToString());
 
         if (dsq.IsTimeOutOfBounds()) return {};
 
-        auto dmn = tip_mn_list.GetValidMNByCollateral(dsq.masternodeOutpoint);
+        dmn = tip_mn_list.GetValidMNByCollateral(dsq.masternodeOutpoint);
         if (!dmn) return {};
 
         if (dsq.m_protxHash.IsNull()) {
             dsq.m_protxHash = dmn->proTxHash;
         }
 
-        if (!dsq.CheckSignature(dmn->pdmnState->pubKeyOperator.Get())) {
-            return tl::unexpected{10};
+        if (bls::bls_legacy_scheme.load()) {
+            // dsq signatures always use the basic scheme while the worker verifies with the global one,
+            // so verify inline until the basic scheme is active
+            if (!dsq.CheckSignature(dmn->pdmnState->pubKeyOperator.Get())) {
+                return tl::unexpected{10};
+            }
+            if (!ProcessVerifiedDSQueue(dsq, dmn)) return {};
+            dsq.Relay(connman);
+            return {};
         }
 
-        // if the queue is ready, submit if we can
-        if (dsq.fReady && ranges::any_of(m_walletman.raw(),
-                                         [this, &dmn](const auto &pair) {
-                                             return pair.second->TrySubmitDenominate(dmn->pdmnState->addr,
-                                                                                     this->connman);
-                                         })) {
-            LogPrint(BCLog::COINJOIN, "DSQUEUE -- CoinJoin queue (%s) is ready on masternode %s\n", dsq.ToString(),
-                     dmn->pdmnState->addr.ToString());
-            return {};
-        } else {
-            int64_t nLastDsq = m_mn_metaman.GetMetaInfo(dmn->proTxHash)->GetLastDsq();
-            int64_t nDsqThreshold = m_mn_metaman.GetDsqThreshold(dmn->proTxHash, tip_mn_list.GetValidMNsCount());
-            LogPrint(BCLog::COINJOIN, "DSQUEUE -- nLastDsq: %d  nDsqThreshold: %d  nDsqCount: %d\n", nLastDsq,
-                     nDsqThreshold, m_mn_metaman.GetDsqCount());
-            // don't allow a few nodes to dominate the queuing process
-            if (nLastDsq != 0 && nDsqThreshold > m_mn_metaman.GetDsqCount()) {
-                LogPrint(BCLog::COINJOIN, "DSQUEUE -- Masternode %s is sending too many dsq messages\n",
-                         dmn->proTxHash.ToString());
-                return {};
+        setPendingQueues.emplace(dsq.masternodeOutpoint, dsq.fReady);
+    } // cs_ProcessDSQueue
+
+    // Verify off the message handler thread, batched with other pending signatures.
+    // Must not hold cs_ProcessDSQueue here, the callback can be invoked synchronously.
+    const NodeId peer_id = peer.GetId();
+    m_bls_worker.AsyncVerifySig(CBLSSignature(Span{dsq.vchSig}), dmn->pdmnState->pubKeyOperator.Get(), dsq.GetSignatureHash(),
+        [this, dsq, dmn, peer_id](bool valid) mutable {
+            bool fRelay{false};
+            {
+                LOCK(cs_ProcessDSQueue);
+                setPendingQueues.erase({dsq.masternodeOutpoint, dsq.fReady});
+                if (valid) {
+                    fRelay = ProcessVerifiedDSQueue(dsq, dmn);
+                }
+            }
+            if (!valid) {
+                LogPrint(BCLog::COINJOIN, "DSQUEUE -- invalid signature for %s from peer=%d\n", dsq.ToString(), peer_id);
+                if (m_peerman) m_peerman->Misbehaving(peer_id, 10);
+                return;
             }
+            if (fRelay) {
+                dsq.Relay(connman);
+            }
+        });
+    return {};
+}
+
+bool CCoinJoinClientQueueManager::ProcessVerifiedDSQueue(CCoinJoinQueue& dsq, const CDeterministicMNCPtr& dmn)
+{
+    AssertLockHeld(cs_ProcessDSQueue);
+
+    // if the queue is ready, submit if we can
+    if (dsq.fReady && ranges::any_of(m_walletman.raw(),
+                                     [this, &dmn, &dsq](const auto &pair) {
+                                         return pair.second->TrySubmitDenominate(dmn->pdmnState->addr, dsq.nDenom,
+                                                                                 this->connman);
+                                     })) {
+        LogPrint(BCLog::COINJOIN, "DSQUEUE -- CoinJoin queue (%s) is ready on masternode %s\n", dsq.ToString(),
+                 dmn->pdmnState->addr.ToString());
+        return false;
+    }
 
-            m_mn_metaman.AllowMixing(dmn->proTxHash);
+    const auto tip_mn_list = m_dmnman.GetListAtChainTip();
+    int64_t nLastDsq = m_mn_metaman.GetMetaInfo(dmn->proTxHash)->GetLastDsq();
+    int64_t nDsqThreshold = m_mn_metaman.GetDsqThreshold(dmn->proTxHash, tip_mn_list.GetValidMNsCount());
+    LogPrint(BCLog::COINJOIN, "DSQUEUE -- nLastDsq: %d  nDsqThreshold: %d  nDsqCount: %d\n", nLastDsq,
+             nDsqThreshold, m_mn_metaman.GetDsqCount());
+    // don't allow a few nodes to dominate the queuing process
+    if (nLastDsq != 0 && nDsqThreshold > m_mn_metaman.GetDsqCount()) {
+        LogPrint(BCLog::COINJOIN, "DSQUEUE -- Masternode %s is sending too many dsq messages\n",
+                 dmn->proTxHash.ToString());
+        return false;
+    }
 
-            LogPrint(BCLog::COINJOIN, "DSQUEUE -- new CoinJoin queue (%s) from masternode %s\n", dsq.ToString(),
-                     dmn->pdmnState->addr.ToString());
+    m_mn_metaman.AllowMixing(dmn->proTxHash);
 
-            ranges::any_of(m_walletman.raw(),
-                           [&dsq](const auto &pair) { return pair.second->MarkAlreadyJoinedQueueAsTried(dsq); });
+    LogPrint(BCLog::COINJOIN, "DSQUEUE -- new CoinJoin queue (%s) from masternode %s\n", dsq.ToString(),
+             dmn->pdmnState->addr.ToString());
 
-            WITH_LOCK(cs_vecqueue, vecCoinJoinQueue.push_back(dsq));
-        }
-    } // cs_ProcessDSQueue
-    dsq.Relay(connman);
-    return {};
+    ranges::any_of(m_walletman.raw(),
+                   [&dsq](const auto &pair) { return pair.second->MarkAlreadyJoinedQueueAsTried(dsq); });
+
+    return WITH_LOCK(cs_vecqueue, return AddQueueLocked(dsq));
 }
 
 void CCoinJoinClientManager::ProcessMessage(CNode& peer, CChainState& active_chainstate, CConnman& connman, const CTxMemPool& mempool, std::string_view msg_type, CDataStream& vRecv)
@@ -1087,7 +1129,7 @@ bool CCoinJoinClientSession::JoinExistingQueue(CAmount nBalanceNeedsAnonymized,
         }
 
         // mixing rate limit i.e. nLastDsq check should already pass in DSQUEUE ProcessMessage
-        // in order for dsq to get into vecCoinJoinQueue, so we should be safe to mix already,
+        // in order for dsq to get into coinJoinQueues, so we should be safe to mix already,
         // no need for additional verification here
 
         WalletCJLogPrint(m_wallet, "CCoinJoinClientSession::JoinExistingQueue -- trying queue: %s\n", dsq.ToString());
@@ -1097,6 +1139,8 @@ bool CCoinJoinClientSession::JoinExistingQueue(CAmount nBalanceNeedsAnonymized,
         // Try to match their denominations if possible, select exact number of denominations
         if (!m_wallet.SelectTxDSInsByDenomination(dsq.nDenom, nBalanceNeedsAnonymized, vecTxDSInTmp)) {
             WalletCJLogPrint(m_wallet, "CCoinJoinClientSession::JoinExistingQueue -- Couldn't match denomination %d (%s)\n", dsq.nDenom, CoinJoin::DenominationToString(dsq.nDenom));
+            // no other queue for this denomination can be matched either, skip them all at once
+            m_queueman->MarkQueuesTried(dsq.nDenom);
             continue;
         }
 
@@ -1236,13 +1280,15 @@ void CCoinJoinClientManager::ProcessPendingDsaRequest(CConnman& connman)
     }
 }
 
-bool CCoinJoinClientManager::TrySubmitDenominate(const CService& mnAddr, CConnman& connman)
+bool CCoinJoinClientManager::TrySubmitDenominate(const CService& mnAddr, int nDenom, CConnman& connman)
 {
     AssertLockNotHeld(cs_deqsessions);
     LOCK(cs_deqsessions);
     for (auto& session : deqSessions) {
         CDeterministicMNCPtr mnMixing;
-        if (session.GetMixingMasternodeInfo(mnMixing) && mnMixing->pdmnState->addr == mnAddr && session.GetState() == POOL_STATE_QUEUE) {
+        // a masternode can run several sessions at once, only submit to the one that became ready
+        if (session.GetMixingMasternodeInfo(mnMixing) && mnMixing->pdmnState->addr == mnAddr && session.nSessionDenom == nDenom &&
+            session.GetState() == POOL_STATE_QUEUE) {
             session.SubmitDenominate(connman);
             return true;
         }
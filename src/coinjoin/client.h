@@ -14,9 +14,11 @@
 #include <atomic>
 #include <deque>
 #include <memory>
+#include <set>
 #include <utility>
 #include <chain.h>
 
+class CBLSWorker;
 class CCoinJoinClientManager;
 class CCoinJoinClientQueueManager;
 class CConnman;
@@ -27,6 +29,7 @@ class CMasternodeMetaMan;
 class CMasternodeSync;
 class CoinJoinWalletManager;
 class CTxMemPool;
+class PeerManager;
 
 class UniValue;
 
@@ -206,17 +209,26 @@ private:
     CDeterministicMNManager& m_dmnman;
     CMasternodeMetaMan& m_mn_metaman;
     const CMasternodeSync& m_mn_sync;
+    CBLSWorker& m_bls_worker;
+    const std::unique_ptr<PeerManager>& m_peerman;
 
     mutable Mutex cs_ProcessDSQueue;
+    // Queues (masternode collateral, readiness) whose signature is being verified by m_bls_worker
+    std::set<std::pair<COutPoint, bool>> setPendingQueues GUARDED_BY(cs_ProcessDSQueue);
     const bool m_is_masternode;
 
+    /// Handle a dsq whose signature was verified, returns true if it should be relayed
+    bool ProcessVerifiedDSQueue(CCoinJoinQueue& dsq, const CDeterministicMNCPtr& dmn) EXCLUSIVE_LOCKS_REQUIRED(cs_ProcessDSQueue, !cs_vecqueue);
+
 public:
     explicit CCoinJoinClientQueueManager(CConnman& _connman, CoinJoinWalletManager& walletman, CDeterministicMNManager& dmnman,
-                                         CMasternodeMetaMan& mn_metaman, const CMasternodeSync& mn_sync, bool is_masternode) :
-        connman(_connman), m_walletman(walletman), m_dmnman(dmnman), m_mn_metaman(mn_metaman), m_mn_sync(mn_sync), m_is_masternode{is_masternode} {};
+                                         CMasternodeMetaMan& mn_metaman, const CMasternodeSync& mn_sync, CBLSWorker& bls_worker,
+                                         const std::unique_ptr<PeerManager>& peerman, bool is_masternode) :
+        connman(_connman), m_walletman(walletman), m_dmnman(dmnman), m_mn_metaman(mn_metaman), m_mn_sync(mn_sync), m_bls_worker(bls_worker),
+        m_peerman(peerman), m_is_masternode{is_masternode} {};
 
-    PeerMsgRet ProcessMessage(const CNode& peer, std::string_view msg_type, CDataStream& vRecv) EXCLUSIVE_LOCKS_REQUIRED(!cs_vecqueue);
-    PeerMsgRet ProcessDSQueue(const CNode& peer, CDataStream& vRecv);
+    PeerMsgRet ProcessMessage(const CNode& peer, std::string_view msg_type, CDataStream& vRecv) EXCLUSIVE_LOCKS_REQUIRED(!cs_vecqueue, !cs_ProcessDSQueue);
+    PeerMsgRet ProcessDSQueue(const CNode& peer, CDataStream& vRecv) EXCLUSIVE_LOCKS_REQUIRED(!cs_vecqueue, !cs_ProcessDSQueue);
     void DoMaintenance();
 };
 
@@ -286,7 +298,7 @@ public:
     /// Passively run mixing in the background according to the configuration in settings
     bool DoAutomaticDenominating(CChainState& active_chainstate, CConnman& connman, CTxMemPool& mempool, CSporkManager& spork_manager, bool fDryRun = false) EXCLUSIVE_LOCKS_REQUIRED(!cs_deqsessions);
 
-    bool TrySubmitDenominate(const CService& mnAddr, CConnman& connman) EXCLUSIVE_LOCKS_REQUIRED(!cs_deqsessions);
+    bool TrySubmitDenominate(const CService& mnAddr, int nDenom, CConnman& connman) EXCLUSIVE_LOCKS_REQUIRED(!cs_deqsessions);
     bool MarkAlreadyJoinedQueueAsTried(CCoinJoinQueue& dsq) const EXCLUSIVE_LOCKS_REQUIRED(!cs_deqsessions);
 
     void CheckTimeout() EXCLUSIVE_LOCKS_REQUIRED(!cs_deqsessions);
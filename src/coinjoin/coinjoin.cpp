@@ -9,6 +9,7 @@
 #include <chainparams.h>
 #include <consensus/validation.h>
 #include <governance/common.h>
+#include <hash.h>
 #include <llmq/chainlocks.h>
 #include <llmq/instantsend.h>
 #include <masternode/node.h>
@@ -22,6 +23,7 @@
 #include <validation.h>
 
 #include <tinyformat.h>
+#include <limits>
 #include <string>
 
 constexpr static CAmount DEFAULT_MAX_RAW_TX_FEE{COIN / 10};
@@ -163,7 +165,7 @@ void CCoinJoinBaseSession::SetNull()
 void CCoinJoinBaseManager::SetNull()
 {
     LOCK(cs_vecqueue);
-    vecCoinJoinQueue.clear();
+    coinJoinQueues.clear();
 }
 
 void CCoinJoinBaseManager::CheckQueue()
@@ -171,34 +173,90 @@ void CCoinJoinBaseManager::CheckQueue()
     TRY_LOCK(cs_vecqueue, lockDS);
     if (!lockDS) return; // it's ok to fail here, we run this quite frequently
 
-    // check mixing queue objects for timeouts
-    auto it = vecCoinJoinQueue.begin();
-    while (it != vecCoinJoinQueue.end()) {
-        if (it->IsTimeOutOfBounds()) {
-            LogPrint(BCLog::COINJOIN, "CCoinJoinBaseManager::%s -- Removing a queue (%s)\n", __func__, it->ToString());
-            it = vecCoinJoinQueue.erase(it);
-        } else {
-            ++it;
-        }
+    // check mixing queue objects for timeouts, only the oldest and the newest ones can be out of bounds
+    const int64_t current_time = GetAdjustedTime();
+    auto& index = coinJoinQueues.get<queue_time>();
+    while (!index.empty() && index.begin()->IsTimeOutOfBounds(current_time)) {
+        LogPrint(BCLog::COINJOIN, "CCoinJoinBaseManager::%s -- Removing a queue (%s)\n", __func__, index.begin()->ToString());
+        index.erase(index.begin());
+    }
+    while (!index.empty() && std::prev(index.end())->IsTimeOutOfBounds(current_time)) {
+        LogPrint(BCLog::COINJOIN, "CCoinJoinBaseManager::%s -- Removing a queue (%s)\n", __func__, std::prev(index.end())->ToString());
+        index.erase(std::prev(index.end()));
     }
 }
 
+const CCoinJoinQueue* CCoinJoinBaseManager::FindQueueLocked(const COutPoint& masternodeOutpoint, bool fReady, int nDenom) const
+{
+    AssertLockHeld(cs_vecqueue);
+    const auto& index = coinJoinQueues.get<queue_masternode>();
+    auto it = index.find(std::make_tuple(masternodeOutpoint, fReady, fReady ? nDenom : 0));
+    return it == index.end() ? nullptr : &*it;
+}
+
+bool CCoinJoinBaseManager::HasQueueFromMasternodeLocked(const COutPoint& masternodeOutpoint) const
+{
+    AssertLockHeld(cs_vecqueue);
+    const auto& index = coinJoinQueues.get<queue_masternode>();
+    auto it = index.lower_bound(std::make_tuple(masternodeOutpoint, false, std::numeric_limits<int>::min()));
+    return it != index.end() && it->masternodeOutpoint == masternodeOutpoint;
+}
+
+bool CCoinJoinBaseManager::AddQueueLocked(const CCoinJoinQueue& dsq)
+{
+    AssertLockHeld(cs_vecqueue);
+    return coinJoinQueues.insert(dsq).second;
+}
+
 bool CCoinJoinBaseManager::GetQueueItemAndTry(CCoinJoinQueue& dsqRet)
 {
     TRY_LOCK(cs_vecqueue, lockDS);
     if (!lockDS) return false; // it's ok to fail here, we run this quite frequently
 
-    for (auto& dsq : vecCoinJoinQueue) {
+    // untried queues are sorted by time, oldest first
+    auto& index = coinJoinQueues.get<queue_untried>();
+    const int64_t current_time = GetAdjustedTime();
+    for (auto it = index.begin(); it != index.end() && !it->fTried; ++it) {
         // only try each queue once
-        if (dsq.fTried || dsq.IsTimeOutOfBounds()) continue;
-        dsq.fTried = true;
-        dsqRet = dsq;
+        if (it->IsTimeOutOfBounds(current_time)) continue;
+        index.modify(it, [](CCoinJoinQueue& dsq) { dsq.fTried = true; });
+        dsqRet = *it;
         return true;
     }
 
     return false;
 }
 
+bool CCoinJoinBaseManager::GetQueueItemAndTry(CCoinJoinQueue& dsqRet, int nDenom)
+{
+    TRY_LOCK(cs_vecqueue, lockDS);
+    if (!lockDS) return false; // it's ok to fail here, we run this quite frequently
+
+    auto& index = coinJoinQueues.get<queue_denom>();
+    const int64_t current_time = GetAdjustedTime();
+    auto it = index.lower_bound(std::make_tuple(nDenom, false, std::numeric_limits<int64_t>::min()));
+    for (; it != index.end() && it->nDenom == nDenom && !it->fTried; ++it) {
+        if (it->IsTimeOutOfBounds(current_time)) continue;
+        index.modify(it, [](CCoinJoinQueue& dsq) { dsq.fTried = true; });
+        dsqRet = *it;
+        return true;
+    }
+
+    return false;
+}
+
+void CCoinJoinBaseManager::MarkQueuesTried(int nDenom)
+{
+    LOCK(cs_vecqueue);
+    auto& index = coinJoinQueues.get<queue_denom>();
+    // modifying fTried moves the entry behind all untried ones of this denomination, so always restart from the first one
+    auto it = index.lower_bound(std::make_tuple(nDenom, false, std::numeric_limits<int64_t>::min()));
+    while (it != index.end() && it->nDenom == nDenom && !it->fTried) {
+        index.modify(it, [](CCoinJoinQueue& dsq) { dsq.fTried = true; });
+        it = index.lower_bound(std::make_tuple(nDenom, false, std::numeric_limits<int64_t>::min()));
+    }
+}
+
 std::string CCoinJoinBaseSession::GetStateString() const
 {
     switch (nState) {
@@ -431,7 +489,7 @@ void CDSTXManager::AddDSTX(const CCoinJoinBroadcastTx& dstx)
 {
     AssertLockNotHeld(cs_mapdstx);
     LOCK(cs_mapdstx);
-    mapDSTX.insert(std::make_pair(dstx.tx->GetHash(), dstx));
+    mapDSTX.emplace(dstx.tx->GetHash(), dstx);
 }
 
 CCoinJoinBroadcastTx CDSTXManager::GetDSTX(const uint256& hash)
@@ -442,17 +500,31 @@ CCoinJoinBroadcastTx CDSTXManager::GetDSTX(const uint256& hash)
     return (it == mapDSTX.end()) ? CCoinJoinBroadcastTx() : it->second;
 }
 
+bool CDSTXManager::AddPendingDSTX(const CCoinJoinBroadcastTx& dstx)
+{
+    AssertLockNotHeld(cs_mapdstx);
+    LOCK(cs_mapdstx);
+    return setPendingDSTX.emplace(dstx.tx->GetHash(), Hash(dstx.vchSig)).second;
+}
+
+void CDSTXManager::RemovePendingDSTX(const CCoinJoinBroadcastTx& dstx)
+{
+    AssertLockNotHeld(cs_mapdstx);
+    LOCK(cs_mapdstx);
+    setPendingDSTX.erase({dstx.tx->GetHash(), Hash(dstx.vchSig)});
+}
+
 void CDSTXManager::CheckDSTXes(const CBlockIndex* pindex, const llmq::CChainLocksHandler& clhandler)
 {
     AssertLockNotHeld(cs_mapdstx);
     LOCK(cs_mapdstx);
-    auto it = mapDSTX.begin();
-    while (it != mapDSTX.end()) {
-        if (it->second.IsExpired(pindex, clhandler)) {
-            mapDSTX.erase(it++);
-        } else {
-            ++it;
-        }
+    // Same rules as CCoinJoinBroadcastTx::IsExpired: everything mined at or below a chainlocked tip
+    // and everything mined more than 24 blocks ago is expired. Unconfirmed DSTXes are not indexed.
+    const int nMaxExpiredHeight = clhandler.HasChainLock(pindex->nHeight, *pindex->phashBlock) ? pindex->nHeight : pindex->nHeight - 25;
+    auto it = setDSTXByHeight.begin();
+    while (it != setDSTXByHeight.end() && it->first <= nMaxExpiredHeight) {
+        mapDSTX.erase(it->second);
+        it = setDSTXByHeight.erase(it);
     }
     LogPrint(BCLog::COINJOIN, "CoinJoin::CheckDSTXes -- mapDSTX.size()=%llu\n", mapDSTX.size());
 }
@@ -480,6 +552,13 @@ void CDSTXManager::UpdateDSTXConfirmedHeight(const CTransactionRef& tx, std::opt
         return;
     }
 
+    const auto nOldHeight = it->second.GetConfirmedHeight();
+    if (nOldHeight.has_value()) {
+        setDSTXByHeight.erase({*nOldHeight, it->first});
+    }
+    if (nHeight.has_value()) {
+        setDSTXByHeight.emplace(*nHeight, it->first);
+    }
     it->second.SetConfirmedHeight(nHeight);
     LogPrint(BCLog::COINJOIN, "CDSTXManager::%s -- txid=%s, nHeight=%d\n", __func__, tx->GetHash().ToString(), nHeight.value_or(-1));
 }
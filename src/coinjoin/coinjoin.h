@@ -11,6 +11,7 @@
 #include <netaddress.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
+#include <saltedhasher.h>
 #include <spork.h>
 #include <sync.h>
 #include <timedata.h>
@@ -21,8 +22,14 @@
 #include <atomic>
 #include <map>
 #include <optional>
+#include <set>
+#include <tuple>
+#include <unordered_map>
 #include <utility>
 
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index_container.hpp>
+
 class CActiveMasternodeManager;
 class CChainState;
 class CConnman;
@@ -288,6 +295,7 @@ public:
     bool Sign(const CActiveMasternodeManager& mn_activeman);
     [[nodiscard]] bool CheckSignature(const CBLSPublicKey& blsPubKey) const;
 
+    std::optional<int> GetConfirmedHeight() const { return nConfirmedHeight; }
     void SetConfirmedHeight(std::optional<int> nConfirmedHeightIn) { assert(nConfirmedHeightIn == std::nullopt || *nConfirmedHeightIn > 0); nConfirmedHeight = nConfirmedHeightIn; }
     bool IsExpired(const CBlockIndex* pindex, const llmq::CChainLocksHandler& clhandler) const;
     [[nodiscard]] bool IsValidStructure() const;
@@ -324,6 +332,49 @@ public:
     int GetEntriesCountLocked() const EXCLUSIVE_LOCKS_REQUIRED(cs_coinjoin) { return vecEntries.size(); }
 };
 
+// Key extractors for CCoinJoinQueueIndex
+struct coinjoinqueue_masternode {
+    typedef std::tuple<COutPoint, bool, int> result_type;
+    // Only ready queues are told apart by denomination, a masternode still announces one new session at a time
+    result_type operator()(const CCoinJoinQueue& dsq) const { return {dsq.masternodeOutpoint, dsq.fReady, dsq.fReady ? dsq.nDenom : 0}; }
+};
+struct coinjoinqueue_time {
+    typedef int64_t result_type;
+    result_type operator()(const CCoinJoinQueue& dsq) const { return dsq.nTime; }
+};
+struct coinjoinqueue_untried {
+    typedef std::pair<bool, int64_t> result_type;
+    result_type operator()(const CCoinJoinQueue& dsq) const { return {dsq.fTried, dsq.nTime}; }
+};
+struct coinjoinqueue_denom {
+    typedef std::tuple<int, bool, int64_t> result_type;
+    result_type operator()(const CCoinJoinQueue& dsq) const { return {dsq.nDenom, dsq.fTried, dsq.nTime}; }
+};
+
+// Multi_index tags
+struct queue_masternode {};
+struct queue_time {};
+struct queue_untried {};
+struct queue_denom {};
+
+/**
+ * Known mixing queues, indexed by
+ * - masternode collateral, readiness and, for ready queues, denomination (at most one unready queue per
+ *   masternode, every concurrent session of a masternode can announce its readiness)
+ * - time, for expiry
+ * - (fTried, time), to find the oldest untried queue
+ * - (denomination, fTried, time), to pick queues of a single denomination
+ */
+typedef boost::multi_index_container<
+    CCoinJoinQueue,
+    boost::multi_index::indexed_by<
+        boost::multi_index::ordered_unique<boost::multi_index::tag<queue_masternode>, coinjoinqueue_masternode>,
+        boost::multi_index::ordered_non_unique<boost::multi_index::tag<queue_time>, coinjoinqueue_time>,
+        boost::multi_index::ordered_non_unique<boost::multi_index::tag<queue_untried>, coinjoinqueue_untried>,
+        boost::multi_index::ordered_non_unique<boost::multi_index::tag<queue_denom>, coinjoinqueue_denom>
+    >
+> CCoinJoinQueueIndex;
+
 // base class
 class CCoinJoinBaseManager
 {
@@ -331,16 +382,26 @@ protected:
     mutable Mutex cs_vecqueue;
 
     // The current mixing sessions in progress on the network
-    std::vector<CCoinJoinQueue> vecCoinJoinQueue GUARDED_BY(cs_vecqueue);
+    CCoinJoinQueueIndex coinJoinQueues GUARDED_BY(cs_vecqueue);
 
     void SetNull() EXCLUSIVE_LOCKS_REQUIRED(!cs_vecqueue);
     void CheckQueue() EXCLUSIVE_LOCKS_REQUIRED(!cs_vecqueue);
 
+    /// Find the queue announced by a masternode with the given readiness (and denomination if it is ready), nullptr if there is none
+    const CCoinJoinQueue* FindQueueLocked(const COutPoint& masternodeOutpoint, bool fReady, int nDenom) const EXCLUSIVE_LOCKS_REQUIRED(cs_vecqueue);
+    bool HasQueueFromMasternodeLocked(const COutPoint& masternodeOutpoint) const EXCLUSIVE_LOCKS_REQUIRED(cs_vecqueue);
+    /// Returns false if an unready queue from the same masternode, or a ready one of the same denomination, is already known
+    bool AddQueueLocked(const CCoinJoinQueue& dsq) EXCLUSIVE_LOCKS_REQUIRED(cs_vecqueue);
+
 public:
     CCoinJoinBaseManager() = default;
 
-    int GetQueueSize() const EXCLUSIVE_LOCKS_REQUIRED(!cs_vecqueue) { LOCK(cs_vecqueue); return vecCoinJoinQueue.size(); }
+    int GetQueueSize() const EXCLUSIVE_LOCKS_REQUIRED(!cs_vecqueue) { LOCK(cs_vecqueue); return coinJoinQueues.size(); }
     bool GetQueueItemAndTry(CCoinJoinQueue& dsqRet) EXCLUSIVE_LOCKS_REQUIRED(!cs_vecqueue);
+    /// Same as above but only considers queues for the given denomination
+    bool GetQueueItemAndTry(CCoinJoinQueue& dsqRet, int nDenom) EXCLUSIVE_LOCKS_REQUIRED(!cs_vecqueue);
+    /// Mark every queue for the given denomination as tried, e.g. when none of them can be joined
+    void MarkQueuesTried(int nDenom) EXCLUSIVE_LOCKS_REQUIRED(!cs_vecqueue);
 };
 
 // Various helpers and dstx manager implementation
@@ -362,13 +423,22 @@ namespace CoinJoin
 class CDSTXManager
 {
     Mutex cs_mapdstx;
-    std::map<uint256, CCoinJoinBroadcastTx> mapDSTX GUARDED_BY(cs_mapdstx);
+    std::unordered_map<uint256, CCoinJoinBroadcastTx, StaticSaltedHasher> mapDSTX GUARDED_BY(cs_mapdstx);
+    // (confirmed height, txid) of every mined DSTX, lets CheckDSTXes visit only the entries that expire
+    std::set<std::pair<int, uint256>> setDSTXByHeight GUARDED_BY(cs_mapdstx);
+    // (txid, signature hash) of the DSTXes whose signatures are being verified asynchronously, a copy with
+    // a bad signature must not hold back the valid one
+    std::set<std::pair<uint256, uint256>> setPendingDSTX GUARDED_BY(cs_mapdstx);
 
 public:
     CDSTXManager() = default;
     void AddDSTX(const CCoinJoinBroadcastTx& dstx) EXCLUSIVE_LOCKS_REQUIRED(!cs_mapdstx);
     CCoinJoinBroadcastTx GetDSTX(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(!cs_mapdstx);
 
+    /// Mark a DSTX as waiting for signature verification, returns false if the same DSTX with the same signature is already pending
+    bool AddPendingDSTX(const CCoinJoinBroadcastTx& dstx) EXCLUSIVE_LOCKS_REQUIRED(!cs_mapdstx);
+    void RemovePendingDSTX(const CCoinJoinBroadcastTx& dstx) EXCLUSIVE_LOCKS_REQUIRED(!cs_mapdstx);
+
     void UpdatedBlockTip(const CBlockIndex* pindex, const llmq::CChainLocksHandler& clhandler,
                          const CMasternodeSync& mn_sync)
         EXCLUSIVE_LOCKS_REQUIRED(!cs_mapdstx);
@@ -385,7 +455,7 @@ public:
 private:
     void CheckDSTXes(const CBlockIndex* pindex, const llmq::CChainLocksHandler& clhandler)
         EXCLUSIVE_LOCKS_REQUIRED(!cs_mapdstx);
-    void UpdateDSTXConfirmedHeight(const CTransactionRef& tx, std::optional<int> nHeight);
+    void UpdateDSTXConfirmedHeight(const CTransactionRef& tx, std::optional<int> nHeight) EXCLUSIVE_LOCKS_REQUIRED(cs_mapdstx);
 
 };
 
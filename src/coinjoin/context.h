@@ -14,6 +14,7 @@
 
 class CActiveMasternodeManager;
 class CBlockPolicyEstimator;
+class CBLSWorker;
 class CChainState;
 class CCoinJoinServer;
 class CConnman;
@@ -34,7 +35,7 @@ struct CJContext {
     CJContext(const CJContext&) = delete;
     CJContext(CChainState& chainstate, CConnman& connman, CDeterministicMNManager& dmnman, CMasternodeMetaMan& mn_metaman,
               CTxMemPool& mempool, const CActiveMasternodeManager* const mn_activeman, CSporkManager& spork_manager, const CMasternodeSync& mn_sync,
-              const std::unique_ptr<PeerManager>& peerman, bool relay_txes);
+              CBLSWorker& bls_worker, const std::unique_ptr<PeerManager>& peerman, bool relay_txes);
     ~CJContext();
 
     const std::unique_ptr<CDSTXManager> dstxman;
@@ -25,6 +25,25 @@
 
 #include <univalue.h>
 
+#include <algorithm>
+
+CCoinJoinServer::CCoinJoinServer(CChainState& chainstate, CConnman& _connman, CDeterministicMNManager& dmnman, CDSTXManager& dstxman,
+                                 CMasternodeMetaMan& mn_metaman, CTxMemPool& mempool, const CActiveMasternodeManager* const mn_activeman,
+                                 CSporkManager& spork_manager, const CMasternodeSync& mn_sync, const std::unique_ptr<PeerManager>& peerman) :
+    m_chainstate(chainstate),
+    connman(_connman),
+    m_dmnman(dmnman),
+    m_dstxman(dstxman),
+    m_mn_metaman(mn_metaman),
+    mempool(mempool),
+    m_spork_manager(spork_manager),
+    m_mn_activeman(mn_activeman),
+    m_mn_sync(mn_sync),
+    m_peerman(peerman),
+    nMaxSessions(std::clamp<int>(gArgs.GetArg("-coinjoinserversessions", DEFAULT_COINJOIN_SERVER_SESSIONS), 1, MAX_COINJOIN_SERVER_SESSIONS)),
+    fUnitTest(false)
+{}
+
 PeerMsgRet CCoinJoinServer::ProcessMessage(CNode& peer, std::string_view msg_type, CDataStream& vRecv)
 {
     if (!m_mn_activeman) return {};
@@ -37,7 +56,7 @@ PeerMsgRet CCoinJoinServer::ProcessMessage(CNode& peer, std::string_view msg_typ
     } else if (msg_type == NetMsgType::DSVIN) {
         ProcessDSVIN(peer, vRecv);
     } else if (msg_type == NetMsgType::DSSIGNFINALTX) {
-        ProcessDSSIGNFINALTX(vRecv);
+        ProcessDSSIGNFINALTX(peer, vRecv);
     }
     return {};
 }
@@ -47,18 +66,34 @@ void CCoinJoinServer::ProcessDSACCEPT(CNode& peer, CDataStream& vRecv)
     assert(m_mn_activeman);
     assert(m_mn_metaman.IsValid());
 
-    if (IsSessionReady()) {
-        // too many users in this session already, reject new ones
-        LogPrint(BCLog::COINJOIN, "DSACCEPT -- queue is already full!\n");
-        PushStatus(peer, STATUS_REJECTED, ERR_QUEUE_FULL);
-        return;
-    }
-
     CCoinJoinAccept dsa;
     vRecv >> dsa;
 
     LogPrint(BCLog::COINJOIN, "DSACCEPT -- nDenom %d (%s)  txCollateral %s", dsa.nDenom, CoinJoin::DenominationToString(dsa.nDenom), dsa.txCollateral.ToString()); /* Continued */
 
+    LOCK(cs_sessions);
+
+    CCoinJoinServerSession* session = FindSessionForDenom(dsa.nDenom);
+    if (session != nullptr && session->IsSessionReady()) {
+        // too many users in this session already, reject new ones
+        LogPrint(BCLog::COINJOIN, "DSACCEPT -- queue is already full!\n");
+        session->PushStatus(peer, STATUS_REJECTED, ERR_QUEUE_FULL);
+        return;
+    }
+    if (const auto participant_session = FindSessionForParticipant(peer.addr); participant_session != nullptr && participant_session != session) {
+        // dsi/dss are routed by address, a peer can only take part in one session at a time
+        LogPrint(BCLog::COINJOIN, "DSACCEPT -- peer=%d is already mixing in another session\n", peer.GetId());
+        participant_session->PushStatus(peer, STATUS_REJECTED, ERR_MODE);
+        return;
+    }
+    if (session == nullptr && int(vecSessions.size()) >= nMaxSessions) {
+        // every session is busy with another denomination
+        const bool fAllReady = ranges::all_of(vecSessions, [](const auto& s) { return s->IsSessionReady(); });
+        LogPrint(BCLog::COINJOIN, "DSACCEPT -- no free session for denom %d (%s)\n", dsa.nDenom, CoinJoin::DenominationToString(dsa.nDenom));
+        PushStatus(peer, STATUS_REJECTED, fAllReady ? ERR_QUEUE_FULL : ERR_DENOM);
+        return;
+    }
+
     auto mnList = m_dmnman.GetListAtChainTip();
     auto dmn = mnList.GetValidMNByCollateral(m_mn_activeman->GetOutPoint());
     if (!dmn) {
@@ -66,47 +101,52 @@ void CCoinJoinServer::ProcessDSACCEPT(CNode& peer, CDataStream& vRecv)
         return;
     }
 
-    if (vecSessionCollaterals.empty()) {
-        {
-            TRY_LOCK(cs_vecqueue, lockRecv);
-            if (!lockRecv) return;
-
-            auto mnOutpoint = m_mn_activeman->GetOutPoint();
+    PoolMessage nMessageID = MSG_NOERR;
 
-            if (ranges::any_of(vecCoinJoinQueue,
-                               [&mnOutpoint](const auto& q){return q.masternodeOutpoint == mnOutpoint;})) {
-                // refuse to create another queue this often
-                LogPrint(BCLog::COINJOIN, "DSACCEPT -- last dsq is still in queue, refuse to mix\n");
-                PushStatus(peer, STATUS_REJECTED, ERR_RECENT);
-                return;
-            }
+    if (session != nullptr) {
+        if (session->AddUser(dsa, peer.addr, nMessageID)) {
+            LogPrint(BCLog::COINJOIN, "DSACCEPT -- is compatible, please submit!\n");
+            session->PushStatus(peer, STATUS_ACCEPTED, nMessageID);
+        } else {
+            LogPrint(BCLog::COINJOIN, "DSACCEPT -- not compatible with existing transactions!\n");
+            session->PushStatus(peer, STATUS_REJECTED, nMessageID);
         }
+        return;
+    }
 
-        int64_t nLastDsq = m_mn_metaman.GetMetaInfo(dmn->proTxHash)->GetLastDsq();
-        int64_t nDsqThreshold = m_mn_metaman.GetDsqThreshold(dmn->proTxHash, mnList.GetValidMNsCount());
-        if (nLastDsq != 0 && nDsqThreshold > m_mn_metaman.GetDsqCount()) {
-            if (fLogIPs) {
-                LogPrint(BCLog::COINJOIN, "DSACCEPT -- last dsq too recent, must wait: peer=%d, addr=%s\n", peer.GetId(), peer.addr.ToString());
-            } else {
-                LogPrint(BCLog::COINJOIN, "DSACCEPT -- last dsq too recent, must wait: peer=%d\n", peer.GetId());
-            }
+    // Every new session announces a dsq of its own, so each of them waits for its turn in the queue rotation
+    {
+        TRY_LOCK(cs_vecqueue, lockRecv);
+        if (!lockRecv) return;
+
+        if (HasQueueFromMasternodeLocked(m_mn_activeman->GetOutPoint())) {
+            // refuse to create another queue this often
+            LogPrint(BCLog::COINJOIN, "DSACCEPT -- last dsq is still in queue, refuse to mix\n");
             PushStatus(peer, STATUS_REJECTED, ERR_RECENT);
             return;
         }
     }
 
-    PoolMessage nMessageID = MSG_NOERR;
+    int64_t nLastDsq = m_mn_metaman.GetMetaInfo(dmn->proTxHash)->GetLastDsq();
+    int64_t nDsqThreshold = m_mn_metaman.GetDsqThreshold(dmn->proTxHash, mnList.GetValidMNsCount());
+    if (nLastDsq != 0 && nDsqThreshold > m_mn_metaman.GetDsqCount()) {
+        if (fLogIPs) {
+            LogPrint(BCLog::COINJOIN, "DSACCEPT -- last dsq too recent, must wait: peer=%d, addr=%s\n", peer.GetId(), peer.addr.ToString());
+        } else {
+            LogPrint(BCLog::COINJOIN, "DSACCEPT -- last dsq too recent, must wait: peer=%d\n", peer.GetId());
+        }
+        PushStatus(peer, STATUS_REJECTED, ERR_RECENT);
+        return;
+    }
 
-    bool fResult = nSessionID == 0 ? CreateNewSession(dsa, nMessageID)
-            : AddUserToExistingSession(dsa, nMessageID);
-    if (fResult) {
+    auto new_session = std::make_unique<CCoinJoinServerSession>(*this);
+    if (new_session->Start(dsa, peer.addr, GetNewSessionID(), nMessageID)) {
         LogPrint(BCLog::COINJOIN, "DSACCEPT -- is compatible, please submit!\n");
-        PushStatus(peer, STATUS_ACCEPTED, nMessageID);
-        return;
+        new_session->PushStatus(peer, STATUS_ACCEPTED, nMessageID);
+        vecSessions.push_back(std::move(new_session));
     } else {
         LogPrint(BCLog::COINJOIN, "DSACCEPT -- not compatible with existing transactions!\n");
         PushStatus(peer, STATUS_REJECTED, nMessageID);
-        return;
     }
 }
 
@@ -135,15 +175,13 @@ PeerMsgRet CCoinJoinServer::ProcessDSQUEUE(const CNode& peer, CDataStream& vRecv
         if (!lockRecv) return {};
 
         // process every dsq only once
-        for (const auto& q : vecCoinJoinQueue) {
-            if (q == dsq) {
-                return {};
-            }
-            if (q.fReady == dsq.fReady && q.masternodeOutpoint == dsq.masternodeOutpoint) {
-                // no way the same mn can send another dsq with the same readiness this soon
-                LogPrint(BCLog::COINJOIN, "DSQUEUE -- Peer %s is sending WAY too many dsq messages for a masternode with collateral %s\n", peer.GetLogString(), dsq.masternodeOutpoint.ToStringShort());
+        if (const auto q = FindQueueLocked(dsq.masternodeOutpoint, dsq.fReady, dsq.nDenom)) {
+            if (*q == dsq) {
                 return {};
             }
+            // no way the same mn can send another dsq with the same readiness this soon
+            LogPrint(BCLog::COINJOIN, "DSQUEUE -- Peer %s is sending WAY too many dsq messages for a masternode with collateral %s\n", peer.GetLogString(), dsq.masternodeOutpoint.ToStringShort());
+            return {};
         }
     } // cs_vecqueue
 
@@ -177,7 +215,7 @@ PeerMsgRet CCoinJoinServer::ProcessDSQUEUE(const CNode& peer, CDataStream& vRecv
 
         TRY_LOCK(cs_vecqueue, lockRecv);
         if (!lockRecv) return {};
-        vecCoinJoinQueue.push_back(dsq);
+        if (!AddQueueLocked(dsq)) return {};
         dsq.Relay(connman);
     }
     return {};
@@ -185,10 +223,18 @@ PeerMsgRet CCoinJoinServer::ProcessDSQUEUE(const CNode& peer, CDataStream& vRecv
 
 void CCoinJoinServer::ProcessDSVIN(CNode& peer, CDataStream& vRecv)
 {
+    LOCK(cs_sessions);
+
+    CCoinJoinServerSession* session = FindSessionForParticipant(peer.addr);
+
     //do we have enough users in the current session?
-    if (!IsSessionReady()) {
+    if (session == nullptr || !session->IsSessionReady()) {
         LogPrint(BCLog::COINJOIN, "DSVIN -- session not complete!\n");
-        PushStatus(peer, STATUS_REJECTED, ERR_SESSION);
+        if (session != nullptr) {
+            session->PushStatus(peer, STATUS_REJECTED, ERR_SESSION);
+        } else {
+            PushStatus(peer, STATUS_REJECTED, ERR_SESSION);
+        }
         return;
     }
 
@@ -200,69 +246,96 @@ void CCoinJoinServer::ProcessDSVIN(CNode& peer, CDataStream& vRecv)
     PoolMessage nMessageID = MSG_NOERR;
 
     entry.addr = peer.addr;
-    if (AddEntry(entry, nMessageID)) {
-        PushStatus(peer, STATUS_ACCEPTED, nMessageID);
-        CheckPool();
-        LOCK(cs_coinjoin);
-        RelayStatus(STATUS_ACCEPTED);
+    if (session->AddEntry(entry, nMessageID)) {
+        session->PushStatus(peer, STATUS_ACCEPTED, nMessageID);
+        session->CheckPool();
+        session->RelayStatusToParticipants(STATUS_ACCEPTED);
     } else {
-        PushStatus(peer, STATUS_REJECTED, nMessageID);
+        session->PushStatus(peer, STATUS_REJECTED, nMessageID);
     }
+    PruneSessions();
 }
 
-void CCoinJoinServer::ProcessDSSIGNFINALTX(CDataStream& vRecv)
+void CCoinJoinServer::ProcessDSSIGNFINALTX(CNode& peer, CDataStream& vRecv)
 {
     std::vector<CTxIn> vecTxIn;
     vRecv >> vecTxIn;
 
     LogPrint(BCLog::COINJOIN, "DSSIGNFINALTX -- vecTxIn.size() %s\n", vecTxIn.size());
 
-    int nTxInIndex = 0;
-    int nTxInsCount = (int)vecTxIn.size();
+    LOCK(cs_sessions);
 
-    for (const auto& txin : vecTxIn) {
-        nTxInIndex++;
-        if (!AddScriptSig(txin)) {
-            LogPrint(BCLog::COINJOIN, "DSSIGNFINALTX -- AddScriptSig() failed at %d/%d, session: %d\n", nTxInIndex, nTxInsCount, nSessionID);
-            LOCK(cs_coinjoin);
-            RelayStatus(STATUS_REJECTED);
-            return;
-        }
-        LogPrint(BCLog::COINJOIN, "DSSIGNFINALTX -- AddScriptSig() %d/%d success\n", nTxInIndex, nTxInsCount);
+    CCoinJoinServerSession* session = FindSessionForParticipant(peer.addr);
+    if (session == nullptr) {
+        LogPrint(BCLog::COINJOIN, "DSSIGNFINALTX -- no session for peer=%d\n", peer.GetId());
+        return;
     }
-    // all is good
-    CheckPool();
+
+    // all is good if every signature could be added, the final transaction is committed
+    // together with the ones of other sessions by CommitFinalTransactions()
+    session->AddScriptSigs(vecTxIn);
+    PruneSessions();
 }
 
-void CCoinJoinServer::SetNull()
+CCoinJoinServerSession* CCoinJoinServer::FindSessionForDenom(int nDenom) const
 {
-    AssertLockHeld(cs_coinjoin);
-    // MN side
-    vecSessionCollaterals.clear();
+    AssertLockHeld(cs_sessions);
+    for (const auto& session : vecSessions) {
+        if (session->nSessionDenom == nDenom) return session.get();
+    }
+    return nullptr;
+}
 
-    CCoinJoinBaseSession::SetNull();
-    CCoinJoinBaseManager::SetNull();
+CCoinJoinServerSession* CCoinJoinServer::FindSessionForParticipant(const CService& addr) const
+{
+    AssertLockHeld(cs_sessions);
+    for (const auto& session : vecSessions) {
+        if (session->HasParticipant(addr)) return session.get();
+    }
+    return nullptr;
+}
+
+int CCoinJoinServer::GetNewSessionID() const
+{
+    AssertLockHeld(cs_sessions);
+    while (true) {
+        const int nSessionID = GetRandInt(999999) + 1;
+        if (std::none_of(vecSessions.begin(), vecSessions.end(), [nSessionID](const auto& session) { return session->GetSessionID() == nSessionID; })) {
+            return nSessionID;
+        }
+    }
+}
+
+void CCoinJoinServer::PruneSessions()
+{
+    AssertLockHeld(cs_sessions);
+    if (vecSessions.empty()) return;
+
+    vecSessions.erase(std::remove_if(vecSessions.begin(), vecSessions.end(), [](const auto& session) { return session->IsIdle(); }),
+                      vecSessions.end());
+    if (vecSessions.empty()) {
+        // same as a single finished session always did, start over with a clean view of the queues
+        CCoinJoinBaseManager::SetNull();
+    }
 }
 
 //
 // Check the mixing progress and send client updates if a Masternode
 //
-void CCoinJoinServer::CheckPool()
+void CCoinJoinServerSession::CheckPool()
 {
-    if (!m_mn_activeman) return;
-
-    if (int entries = GetEntriesCount(); entries != 0) LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CheckPool -- entries count %lu\n", entries);
+    if (int entries = GetEntriesCount(); entries != 0) LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CheckPool -- entries count %lu\n", entries);
 
     // If we have an entry for each collateral, then create final tx
     if (nState == POOL_STATE_ACCEPTING_ENTRIES && size_t(GetEntriesCount()) == vecSessionCollaterals.size()) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CheckPool -- FINALIZE TRANSACTIONS\n");
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CheckPool -- FINALIZE TRANSACTIONS\n");
         CreateFinalTransaction();
         return;
     }
 
     // Check for Time Out
     // If we timed out while accepting entries, then if we have more than minimum, create final tx
-    if (nState == POOL_STATE_ACCEPTING_ENTRIES && CCoinJoinServer::HasTimedOut()
+    if (nState == POOL_STATE_ACCEPTING_ENTRIES && HasTimedOut()
             && GetEntriesCount() >= CoinJoin::GetMinPoolParticipants()) {
         // Punish misbehaving participants
         ChargeFees();
@@ -271,18 +344,13 @@ void CCoinJoinServer::CheckPool()
         return;
     }
 
-    // If we have all the signatures, try to compile the transaction
-    if (nState == POOL_STATE_SIGNING && IsSignaturesComplete()) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CheckPool -- SIGNING\n");
-        CommitFinalTransaction();
-        return;
-    }
+    // Fully signed sessions are committed in a batch by CCoinJoinServer::CommitFinalTransactions
 }
 
-void CCoinJoinServer::CreateFinalTransaction()
+void CCoinJoinServerSession::CreateFinalTransaction()
 {
     AssertLockNotHeld(cs_coinjoin);
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CreateFinalTransaction -- FINALIZE TRANSACTIONS\n");
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CreateFinalTransaction -- FINALIZE TRANSACTIONS\n");
 
     LOCK(cs_coinjoin);
 
@@ -302,52 +370,84 @@ void CCoinJoinServer::CreateFinalTransaction()
     sort(txNew.vout.begin(), txNew.vout.end(), CompareOutputBIP69());
 
     finalMutableTransaction = txNew;
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CreateFinalTransaction -- finalMutableTransaction=%s", txNew.ToString()); /* Continued */
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CreateFinalTransaction -- finalMutableTransaction=%s", txNew.ToString()); /* Continued */
 
     // request signatures from clients
     SetState(POOL_STATE_SIGNING);
     RelayFinalTransaction(CTransaction(finalMutableTransaction));
 }
 
-void CCoinJoinServer::CommitFinalTransaction()
+bool CCoinJoinServerSession::IsReadyToCommit() const
+{
+    return nState == POOL_STATE_SIGNING && IsSignaturesComplete();
+}
+
+CTransactionRef CCoinJoinServerSession::GetFinalTransaction() const
 {
     AssertLockNotHeld(cs_coinjoin);
-    if (!m_mn_activeman) return; // check and relay final tx only on masternode
+    return WITH_LOCK(cs_coinjoin, return MakeTransactionRef(finalMutableTransaction));
+}
 
-    CTransactionRef finalTransaction = WITH_LOCK(cs_coinjoin, return MakeTransactionRef(finalMutableTransaction));
-    uint256 hashTx = finalTransaction->GetHash();
+void CCoinJoinServer::CommitFinalTransactions()
+{
+    AssertLockHeld(cs_sessions);
+    if (!m_mn_activeman) return; // check and relay final tx only on masternode
 
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CommitFinalTransaction -- finalTransaction=%s", finalTransaction->ToString()); /* Continued */
+    std::vector<std::pair<CCoinJoinServerSession*, CTransactionRef>> vecToCommit;
+    for (const auto& session : vecSessions) {
+        if (session->IsReadyToCommit()) {
+            LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CommitFinalTransactions -- SIGNING, nSessionID: %d\n", session->GetSessionID());
+            vecToCommit.emplace_back(session.get(), session->GetFinalTransaction());
+        }
+    }
+    if (vecToCommit.empty()) return;
 
+    // See if the transactions are valid, all of them under a single cs_main lock
+    std::vector<bool> vecAccepted(vecToCommit.size(), false);
     {
-        // See if the transaction is valid
-        TRY_LOCK(cs_main, lockMain);
-        mempool.PrioritiseTransaction(hashTx, 0.1 * COIN);
-        if (!lockMain || !ATMPIfSaneFee(m_chainstate, mempool, finalTransaction, m_spork_manager)) {
-            LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CommitFinalTransaction -- AcceptToMemoryPool() error: Transaction not valid\n");
-            WITH_LOCK(cs_coinjoin, SetNull());
-            // not much we can do in this case, just notify clients
-            RelayCompletedTransaction(ERR_INVALID_TX);
-            return;
+        LOCK(cs_main);
+        for (size_t i = 0; i < vecToCommit.size(); ++i) {
+            const CTransactionRef& finalTransaction = vecToCommit[i].second;
+            LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CommitFinalTransactions -- finalTransaction=%s", finalTransaction->ToString()); /* Continued */
+            mempool.PrioritiseTransaction(finalTransaction->GetHash(), 0.1 * COIN);
+            vecAccepted[i] = ATMPIfSaneFee(m_chainstate, mempool, finalTransaction, m_spork_manager);
         }
     }
 
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CommitFinalTransaction -- CREATING DSTX\n");
+    for (size_t i = 0; i < vecToCommit.size(); ++i) {
+        vecToCommit[i].first->CommitFinalTransaction(vecToCommit[i].second, vecAccepted[i]);
+    }
+}
+
+void CCoinJoinServerSession::CommitFinalTransaction(const CTransactionRef& finalTransaction, bool fAccepted)
+{
+    AssertLockNotHeld(cs_coinjoin);
+    uint256 hashTx = finalTransaction->GetHash();
+
+    if (!fAccepted) {
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CommitFinalTransaction -- AcceptToMemoryPool() error: Transaction not valid\n");
+        WITH_LOCK(cs_coinjoin, SetNull());
+        // not much we can do in this case, just notify clients
+        RelayCompletedTransaction(ERR_INVALID_TX);
+        return;
+    }
+
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CommitFinalTransaction -- CREATING DSTX\n");
 
     // create and sign masternode dstx transaction
-    if (!m_dstxman.GetDSTX(hashTx)) {
+    if (!m_server.m_dstxman.GetDSTX(hashTx)) {
         CCoinJoinBroadcastTx dstxNew(finalTransaction,
-                                    m_mn_activeman->GetOutPoint(),
-                                    m_mn_activeman->GetProTxHash(),
+                                    m_server.m_mn_activeman->GetOutPoint(),
+                                    m_server.m_mn_activeman->GetProTxHash(),
                                     GetAdjustedTime());
-        dstxNew.Sign(*m_mn_activeman);
-        m_dstxman.AddDSTX(dstxNew);
+        dstxNew.Sign(*m_server.m_mn_activeman);
+        m_server.m_dstxman.AddDSTX(dstxNew);
     }
 
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CommitFinalTransaction -- TRANSMITTING DSTX\n");
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CommitFinalTransaction -- TRANSMITTING DSTX\n");
 
     CInv inv(MSG_DSTX, hashTx);
-    Assert(m_peerman)->RelayInv(inv);
+    Assert(m_server.m_peerman)->RelayInv(inv);
 
     // Tell the clients it was successful
     RelayCompletedTransaction(MSG_SUCCESS);
@@ -356,7 +456,7 @@ void CCoinJoinServer::CommitFinalTransaction()
     ChargeRandomFees();
 
     // Reset
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CommitFinalTransaction -- COMPLETED -- RESETTING\n");
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CommitFinalTransaction -- COMPLETED -- RESETTING\n");
     WITH_LOCK(cs_coinjoin, SetNull());
 }
 
@@ -372,10 +472,9 @@ void CCoinJoinServer::CommitFinalTransaction()
 // transaction for the client to be able to enter the pool. This transaction is kept by the Masternode
 // until the transaction is either complete or fails.
 //
-void CCoinJoinServer::ChargeFees() const
+void CCoinJoinServerSession::ChargeFees() const
 {
     AssertLockNotHeld(cs_coinjoin);
-    if (!m_mn_activeman) return;
 
     //we don't need to charge collateral for every offence.
     if (GetRandInt(100) > 33) return;
@@ -391,7 +490,7 @@ void CCoinJoinServer::ChargeFees() const
 
             // This queue entry didn't send us the promised transaction
             if (!fFound) {
-                LogPrint(BCLog::COINJOIN, "CCoinJoinServer::ChargeFees -- found uncooperative node (didn't send transaction), found offence\n");
+                LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::ChargeFees -- found uncooperative node (didn't send transaction), found offence\n");
                 vecOffendersCollaterals.push_back(txCollateral);
             }
         }
@@ -403,7 +502,7 @@ void CCoinJoinServer::ChargeFees() const
         for (const auto& entry : vecEntries) {
             for (const auto& txdsin : entry.vecTxDSIn) {
                 if (!txdsin.fHasSig) {
-                    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::ChargeFees -- found uncooperative node (didn't sign), found offence\n");
+                    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::ChargeFees -- found uncooperative node (didn't sign), found offence\n");
                     vecOffendersCollaterals.push_back(entry.txCollateral);
                 }
             }
@@ -423,9 +522,9 @@ void CCoinJoinServer::ChargeFees() const
     Shuffle(vecOffendersCollaterals.begin(), vecOffendersCollaterals.end(), FastRandomContext());
 
     if (nState == POOL_STATE_ACCEPTING_ENTRIES || nState == POOL_STATE_SIGNING) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::ChargeFees -- found uncooperative node (didn't %s transaction), charging fees: %s", /* Continued */
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::ChargeFees -- found uncooperative node (didn't %s transaction), charging fees: %s", /* Continued */
             (nState == POOL_STATE_SIGNING) ? "sign" : "send", vecOffendersCollaterals[0]->ToString());
-        ConsumeCollateral(vecOffendersCollaterals[0]);
+        m_server.ConsumeCollateral(vecOffendersCollaterals[0]);
     }
 }
 
@@ -441,14 +540,12 @@ void CCoinJoinServer::ChargeFees() const
     stop these kinds of attacks 1 in 10 successful transactions are charged. This
     adds up to a cost of 0.001DRK per transaction on average.
 */
-void CCoinJoinServer::ChargeRandomFees() const
+void CCoinJoinServerSession::ChargeRandomFees() const
 {
-    if (!m_mn_activeman) return;
-
     for (const auto& txCollateral : vecSessionCollaterals) {
         if (GetRandInt(100) > 10) return;
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::ChargeRandomFees -- charging random fees, txCollateral=%s", txCollateral->ToString()); /* Continued */
-        ConsumeCollateral(txCollateral);
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::ChargeRandomFees -- charging random fees, txCollateral=%s", txCollateral->ToString()); /* Continued */
+        m_server.ConsumeCollateral(txCollateral);
     }
 }
 
@@ -463,10 +560,8 @@ void CCoinJoinServer::ConsumeCollateral(const CTransactionRef& txref) const
     }
 }
 
-bool CCoinJoinServer::HasTimedOut() const
+bool CCoinJoinServerSession::HasTimedOut() const
 {
-    if (!m_mn_activeman) return false;
-
     if (nState == POOL_STATE_IDLE) return false;
 
     int nTimeout = (nState == POOL_STATE_SIGNING) ? COINJOIN_SIGNING_TIMEOUT : COINJOIN_QUEUE_TIMEOUT;
@@ -474,6 +569,17 @@ bool CCoinJoinServer::HasTimedOut() const
     return GetTime() - nTimeLastSuccessfulStep >= nTimeout;
 }
 
+void CCoinJoinServerSession::CheckTimeout()
+{
+    // Too early to do anything
+    if (!HasTimedOut()) return;
+
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CheckTimeout -- %s timed out -- resetting, nSessionID: %d\n",
+        (nState == POOL_STATE_SIGNING) ? "Signing" : "Session", nSessionID);
+    ChargeFees();
+    WITH_LOCK(cs_coinjoin, SetNull());
+}
+
 //
 // Check for extraneous timeout
 //
@@ -483,13 +589,11 @@ void CCoinJoinServer::CheckTimeout()
 
     CheckQueue();
 
-    // Too early to do anything
-    if (!CCoinJoinServer::HasTimedOut()) return;
-
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CheckTimeout -- %s timed out -- resetting\n",
-        (nState == POOL_STATE_SIGNING) ? "Signing" : "Session");
-    ChargeFees();
-    WITH_LOCK(cs_coinjoin, SetNull());
+    LOCK(cs_sessions);
+    for (const auto& session : vecSessions) {
+        session->CheckTimeout();
+    }
+    PruneSessions();
 }
 
 /*
@@ -497,106 +601,86 @@ void CCoinJoinServer::CheckTimeout()
     After receiving multiple dsa messages, the queue will switch to "accepting entries"
     which is the active state right before merging the transaction
 */
-void CCoinJoinServer::CheckForCompleteQueue()
+void CCoinJoinServerSession::CheckForCompleteQueue()
 {
-    if (!m_mn_activeman) return;
-
     if (nState == POOL_STATE_QUEUE && IsSessionReady()) {
         SetState(POOL_STATE_ACCEPTING_ENTRIES);
 
         CCoinJoinQueue dsq(nSessionDenom,
-                            m_mn_activeman->GetOutPoint(),
-                            m_mn_activeman->GetProTxHash(),
+                            m_server.m_mn_activeman->GetOutPoint(),
+                            m_server.m_mn_activeman->GetProTxHash(),
                             GetAdjustedTime(), true);
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CheckForCompleteQueue -- queue is ready, signing and relaying (%s) " /* Continued */
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::CheckForCompleteQueue -- queue is ready, signing and relaying (%s) " /* Continued */
                                      "with %d participants\n", dsq.ToString(), vecSessionCollaterals.size());
-        dsq.Sign(*m_mn_activeman);
-        dsq.Relay(connman);
+        dsq.Sign(*m_server.m_mn_activeman);
+        dsq.Relay(m_server.connman);
     }
 }
 
 // Check to make sure a given input matches an input in the pool and its scriptSig is valid
-bool CCoinJoinServer::IsInputScriptSigValid(const CTxIn& txin) const
+bool CCoinJoinServerSession::IsInputScriptSigValid(CMutableTransaction& txNew, const std::vector<CScript>& vecPrevPubKeys, const CTxIn& txin) const
 {
     AssertLockHeld(cs_coinjoin);
-    CMutableTransaction txNew;
-    txNew.vin.clear();
-    txNew.vout.clear();
 
     int nTxInIndex = -1;
-    CScript sigPubKey = CScript();
-
-    {
-        int i = 0;
-        for (const auto &entry: vecEntries) {
-            for (const auto &txout: entry.vecTxOut) {
-                txNew.vout.push_back(txout);
-            }
-            for (const auto &txdsin: entry.vecTxDSIn) {
-                txNew.vin.push_back(txdsin);
-
-                if (txdsin.prevout == txin.prevout) {
-                    nTxInIndex = i;
-                    sigPubKey = txdsin.prevPubKey;
-                }
-                i++;
-            }
+    for (size_t i = 0; i < txNew.vin.size(); ++i) {
+        if (txNew.vin[i].prevout == txin.prevout) {
+            nTxInIndex = i;
         }
     }
     if (nTxInIndex >= 0) { //might have to do this one input at a time?
         txNew.vin[nTxInIndex].scriptSig = txin.scriptSig;
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::IsInputScriptSigValid -- verifying scriptSig %s\n", ScriptToAsmStr(txin.scriptSig).substr(0, 24));
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::IsInputScriptSigValid -- verifying scriptSig %s\n", ScriptToAsmStr(txin.scriptSig).substr(0, 24));
         // TODO we're using amount=0 here but we should use the correct amount. This works because Sparks ignores the amount while signing/verifying (only used in Bitcoin/Segwit)
-        if (!VerifyScript(txNew.vin[nTxInIndex].scriptSig, sigPubKey, SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC, MutableTransactionSignatureChecker(&txNew, nTxInIndex, 0))) {
-            LogPrint(BCLog::COINJOIN, "CCoinJoinServer::IsInputScriptSigValid -- VerifyScript() failed on input %d\n", nTxInIndex);
+        if (!VerifyScript(txNew.vin[nTxInIndex].scriptSig, vecPrevPubKeys[nTxInIndex], SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC, MutableTransactionSignatureChecker(&txNew, nTxInIndex, 0))) {
+            LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::IsInputScriptSigValid -- VerifyScript() failed on input %d\n", nTxInIndex);
             return false;
         }
     } else {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::IsInputScriptSigValid -- Failed to find matching input in pool, %s\n", txin.ToString());
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::IsInputScriptSigValid -- Failed to find matching input in pool, %s\n", txin.ToString());
         return false;
     }
 
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::IsInputScriptSigValid -- Successfully validated input and scriptSig\n");
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::IsInputScriptSigValid -- Successfully validated input and scriptSig\n");
     return true;
 }
 
 //
 // Add a client's transaction inputs/outputs to the pool
 //
-bool CCoinJoinServer::AddEntry(const CCoinJoinEntry& entry, PoolMessage& nMessageIDRet)
+bool CCoinJoinServerSession::AddEntry(const CCoinJoinEntry& entry, PoolMessage& nMessageIDRet)
 {
     AssertLockNotHeld(cs_coinjoin);
-    if (!m_mn_activeman) return false;
 
     if (size_t(GetEntriesCount()) >= vecSessionCollaterals.size()) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- ERROR: entries is full!\n", __func__);
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::%s -- ERROR: entries is full!\n", __func__);
         nMessageIDRet = ERR_ENTRIES_FULL;
         return false;
     }
 
-    if (!CoinJoin::IsCollateralValid(m_chainstate, mempool, *entry.txCollateral, m_spork_manager)) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- ERROR: collateral not valid!\n", __func__);
+    if (!CoinJoin::IsCollateralValid(m_server.m_chainstate, m_server.mempool, *entry.txCollateral, m_server.m_spork_manager)) {
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::%s -- ERROR: collateral not valid!\n", __func__);
         nMessageIDRet = ERR_INVALID_COLLATERAL;
         return false;
     }
 
     if (entry.vecTxDSIn.size() > COINJOIN_ENTRY_MAX_SIZE) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- ERROR: too many inputs! %d/%d\n", __func__, entry.vecTxDSIn.size(), COINJOIN_ENTRY_MAX_SIZE);
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::%s -- ERROR: too many inputs! %d/%d\n", __func__, entry.vecTxDSIn.size(), COINJOIN_ENTRY_MAX_SIZE);
         nMessageIDRet = ERR_MAXIMUM;
-        ConsumeCollateral(entry.txCollateral);
+        m_server.ConsumeCollateral(entry.txCollateral);
         return false;
     }
 
     std::vector<CTxIn> vin;
     for (const auto& txin : entry.vecTxDSIn) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- txin=%s\n", __func__, txin.ToString());
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::%s -- txin=%s\n", __func__, txin.ToString());
         LOCK(cs_coinjoin);
         for (const auto& inner_entry : vecEntries) {
             if (ranges::any_of(inner_entry.vecTxDSIn,
                             [&txin](const auto& txdsin){
                                     return txdsin.prevout == txin.prevout;
                             })) {
-                LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- ERROR: already have this txin in entries\n", __func__);
+                LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::%s -- ERROR: already have this txin in entries\n", __func__);
                 nMessageIDRet = ERR_ALREADY_HAVE;
                 // Two peers sent the same input? Can't really say who is the malicious one here,
                 // could be that someone is picking someone else's inputs randomly trying to force
@@ -608,62 +692,95 @@ bool CCoinJoinServer::AddEntry(const CCoinJoinEntry& entry, PoolMessage& nMessag
     }
 
     bool fConsumeCollateral{false};
-    if (!IsValidInOuts(m_chainstate, mempool, vin, entry.vecTxOut, nMessageIDRet, &fConsumeCollateral)) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- ERROR! IsValidInOuts() failed: %s\n", __func__, CoinJoin::GetMessageByID(nMessageIDRet).translated);
+    if (!IsValidInOuts(m_server.m_chainstate, m_server.mempool, vin, entry.vecTxOut, nMessageIDRet, &fConsumeCollateral)) {
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::%s -- ERROR! IsValidInOuts() failed: %s\n", __func__, CoinJoin::GetMessageByID(nMessageIDRet).translated);
         if (fConsumeCollateral) {
-            ConsumeCollateral(entry.txCollateral);
+            m_server.ConsumeCollateral(entry.txCollateral);
         }
         return false;
     }
 
     WITH_LOCK(cs_coinjoin, vecEntries.push_back(entry));
 
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- adding entry %d of %d required\n", __func__, GetEntriesCount(), CoinJoin::GetMaxPoolParticipants());
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::%s -- adding entry %d of %d required\n", __func__, GetEntriesCount(), CoinJoin::GetMaxPoolParticipants());
     nMessageIDRet = MSG_ENTRIES_ADDED;
 
     return true;
 }
 
-bool CCoinJoinServer::AddScriptSig(const CTxIn& txinNew)
+bool CCoinJoinServerSession::AddScriptSigs(const std::vector<CTxIn>& vecTxIn)
 {
     AssertLockNotHeld(cs_coinjoin);
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::AddScriptSig -- scriptSig=%s\n", ScriptToAsmStr(txinNew.scriptSig).substr(0, 24));
-
     LOCK(cs_coinjoin);
+
+    // Build the transaction the signatures are verified against once for the whole batch
+    // instead of once per input
+    CMutableTransaction txNew;
+    std::vector<CScript> vecPrevPubKeys;
+    for (const auto& entry : vecEntries) {
+        for (const auto& txout : entry.vecTxOut) {
+            txNew.vout.push_back(txout);
+        }
+        for (const auto& txdsin : entry.vecTxDSIn) {
+            txNew.vin.push_back(txdsin);
+            vecPrevPubKeys.push_back(txdsin.prevPubKey);
+        }
+    }
+
+    int nTxInIndex = 0;
+    int nTxInsCount = (int)vecTxIn.size();
+
+    for (const auto& txin : vecTxIn) {
+        nTxInIndex++;
+        if (!AddScriptSig(txNew, vecPrevPubKeys, txin)) {
+            LogPrint(BCLog::COINJOIN, "DSSIGNFINALTX -- AddScriptSig() failed at %d/%d, session: %d\n", nTxInIndex, nTxInsCount, nSessionID);
+            RelayStatus(STATUS_REJECTED);
+            return false;
+        }
+        LogPrint(BCLog::COINJOIN, "DSSIGNFINALTX -- AddScriptSig() %d/%d success\n", nTxInIndex, nTxInsCount);
+    }
+    return true;
+}
+
+bool CCoinJoinServerSession::AddScriptSig(CMutableTransaction& txNew, const std::vector<CScript>& vecPrevPubKeys, const CTxIn& txinNew)
+{
+    AssertLockHeld(cs_coinjoin);
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::AddScriptSig -- scriptSig=%s\n", ScriptToAsmStr(txinNew.scriptSig).substr(0, 24));
+
     for (const auto& entry : vecEntries) {
         if (ranges::any_of(entry.vecTxDSIn,
                         [&txinNew](const auto& txdsin){ return txdsin.scriptSig == txinNew.scriptSig; })){
-            LogPrint(BCLog::COINJOIN, "CCoinJoinServer::AddScriptSig -- already exists\n");
+            LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::AddScriptSig -- already exists\n");
             return false;
         }
     }
 
-    if (!IsInputScriptSigValid(txinNew)) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::AddScriptSig -- Invalid scriptSig\n");
+    if (!IsInputScriptSigValid(txNew, vecPrevPubKeys, txinNew)) {
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::AddScriptSig -- Invalid scriptSig\n");
         return false;
     }
 
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::AddScriptSig -- scriptSig=%s new\n", ScriptToAsmStr(txinNew.scriptSig).substr(0, 24));
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::AddScriptSig -- scriptSig=%s new\n", ScriptToAsmStr(txinNew.scriptSig).substr(0, 24));
 
     for (auto& txin : finalMutableTransaction.vin) {
         if (txin.prevout == txinNew.prevout && txin.nSequence == txinNew.nSequence) {
             txin.scriptSig = txinNew.scriptSig;
-            LogPrint(BCLog::COINJOIN, "CCoinJoinServer::AddScriptSig -- adding to finalMutableTransaction, scriptSig=%s\n", ScriptToAsmStr(txinNew.scriptSig).substr(0, 24));
+            LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::AddScriptSig -- adding to finalMutableTransaction, scriptSig=%s\n", ScriptToAsmStr(txinNew.scriptSig).substr(0, 24));
         }
     }
     for (auto& entry : vecEntries) {
         if (entry.AddScriptSig(txinNew)) {
-            LogPrint(BCLog::COINJOIN, "CCoinJoinServer::AddScriptSig -- adding to entries, scriptSig=%s\n", ScriptToAsmStr(txinNew.scriptSig).substr(0, 24));
+            LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::AddScriptSig -- adding to entries, scriptSig=%s\n", ScriptToAsmStr(txinNew.scriptSig).substr(0, 24));
             return true;
         }
     }
 
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::AddScriptSig -- Couldn't set sig!\n");
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::AddScriptSig -- Couldn't set sig!\n");
     return false;
 }
 
 // Check to make sure everything is signed
-bool CCoinJoinServer::IsSignaturesComplete() const
+bool CCoinJoinServerSession::IsSignaturesComplete() const
 {
     AssertLockNotHeld(cs_coinjoin);
     LOCK(cs_coinjoin);
@@ -694,65 +811,66 @@ bool CCoinJoinServer::IsAcceptableDSA(const CCoinJoinAccept& dsa, PoolMessage& n
     return true;
 }
 
-bool CCoinJoinServer::CreateNewSession(const CCoinJoinAccept& dsa, PoolMessage& nMessageIDRet)
+bool CCoinJoinServerSession::Start(const CCoinJoinAccept& dsa, const CService& addr, int nNewSessionID, PoolMessage& nMessageIDRet)
 {
-    if (!m_mn_activeman || nSessionID != 0) return false;
+    if (nSessionID != 0) return false;
 
     // new session can only be started in idle mode
     if (nState != POOL_STATE_IDLE) {
         nMessageIDRet = ERR_MODE;
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CreateNewSession -- incompatible mode: nState=%d\n", nState);
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::Start -- incompatible mode: nState=%d\n", nState);
         return false;
     }
 
-    if (!IsAcceptableDSA(dsa, nMessageIDRet)) {
+    if (!m_server.IsAcceptableDSA(dsa, nMessageIDRet)) {
         return false;
     }
 
     // start new session
     nMessageIDRet = MSG_NOERR;
-    nSessionID = GetRandInt(999999) + 1;
+    nSessionID = nNewSessionID;
     nSessionDenom = dsa.nDenom;
 
     SetState(POOL_STATE_QUEUE);
 
-    if (!fUnitTest) {
+    if (!m_server.fUnitTest) {
         //broadcast that I'm accepting entries, only if it's the first entry through
         CCoinJoinQueue dsq(nSessionDenom,
-                            m_mn_activeman->GetOutPoint(),
-                            m_mn_activeman->GetProTxHash(),
+                            m_server.m_mn_activeman->GetOutPoint(),
+                            m_server.m_mn_activeman->GetProTxHash(),
                             GetAdjustedTime(), false);
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CreateNewSession -- signing and relaying new queue: %s\n", dsq.ToString());
-        dsq.Sign(*m_mn_activeman);
-        dsq.Relay(connman);
-        LOCK(cs_vecqueue);
-        vecCoinJoinQueue.push_back(dsq);
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::Start -- signing and relaying new queue: %s\n", dsq.ToString());
+        dsq.Sign(*m_server.m_mn_activeman);
+        dsq.Relay(m_server.connman);
+        LOCK(m_server.cs_vecqueue);
+        m_server.AddQueueLocked(dsq);
     }
 
     vecSessionCollaterals.push_back(MakeTransactionRef(dsa.txCollateral));
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::CreateNewSession -- new session created, nSessionID: %d  nSessionDenom: %d (%s)  vecSessionCollaterals.size(): %d  CoinJoin::GetMaxPoolParticipants(): %d\n",
+    vecParticipants.push_back(addr);
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::Start -- new session created, nSessionID: %d  nSessionDenom: %d (%s)  vecSessionCollaterals.size(): %d  CoinJoin::GetMaxPoolParticipants(): %d\n",
         nSessionID, nSessionDenom, CoinJoin::DenominationToString(nSessionDenom), vecSessionCollaterals.size(), CoinJoin::GetMaxPoolParticipants());
 
     return true;
 }
 
-bool CCoinJoinServer::AddUserToExistingSession(const CCoinJoinAccept& dsa, PoolMessage& nMessageIDRet)
+bool CCoinJoinServerSession::AddUser(const CCoinJoinAccept& dsa, const CService& addr, PoolMessage& nMessageIDRet)
 {
-    if (!m_mn_activeman || nSessionID == 0 || IsSessionReady()) return false;
+    if (nSessionID == 0 || IsSessionReady()) return false;
 
-    if (!IsAcceptableDSA(dsa, nMessageIDRet)) {
+    if (!m_server.IsAcceptableDSA(dsa, nMessageIDRet)) {
         return false;
     }
 
     // we only add new users to an existing session when we are in queue mode
     if (nState != POOL_STATE_QUEUE) {
         nMessageIDRet = ERR_MODE;
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::AddUserToExistingSession -- incompatible mode: nState=%d\n", nState);
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::AddUser -- incompatible mode: nState=%d\n", nState);
         return false;
     }
 
     if (dsa.nDenom != nSessionDenom) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::AddUserToExistingSession -- incompatible denom %d (%s) != nSessionDenom %d (%s)\n",
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::AddUser -- incompatible denom %d (%s) != nSessionDenom %d (%s)\n",
             dsa.nDenom, CoinJoin::DenominationToString(dsa.nDenom), nSessionDenom, CoinJoin::DenominationToString(nSessionDenom));
         nMessageIDRet = ERR_DENOM;
         return false;
@@ -762,21 +880,27 @@ bool CCoinJoinServer::AddUserToExistingSession(const CCoinJoinAccept& dsa, PoolM
 
     nMessageIDRet = MSG_NOERR;
     vecSessionCollaterals.push_back(MakeTransactionRef(dsa.txCollateral));
+    vecParticipants.push_back(addr);
 
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::AddUserToExistingSession -- new user accepted, nSessionID: %d  nSessionDenom: %d (%s)  vecSessionCollaterals.size(): %d  CoinJoin::GetMaxPoolParticipants(): %d\n",
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::AddUser -- new user accepted, nSessionID: %d  nSessionDenom: %d (%s)  vecSessionCollaterals.size(): %d  CoinJoin::GetMaxPoolParticipants(): %d\n",
         nSessionID, nSessionDenom, CoinJoin::DenominationToString(nSessionDenom), vecSessionCollaterals.size(), CoinJoin::GetMaxPoolParticipants());
 
     return true;
 }
 
+bool CCoinJoinServerSession::HasParticipant(const CService& addr) const
+{
+    return ranges::any_of(vecParticipants, [&addr](const auto& participant) { return participant == addr; });
+}
+
 // Returns true if either max size has been reached or if the mix timed out and min size was reached
-bool CCoinJoinServer::IsSessionReady() const
+bool CCoinJoinServerSession::IsSessionReady() const
 {
     if (nState == POOL_STATE_QUEUE) {
         if ((int)vecSessionCollaterals.size() >= CoinJoin::GetMaxPoolParticipants()) {
             return true;
         }
-        if (CCoinJoinServer::HasTimedOut() && (int)vecSessionCollaterals.size() >= CoinJoin::GetMinPoolParticipants()) {
+        if (HasTimedOut() && (int)vecSessionCollaterals.size() >= CoinJoin::GetMinPoolParticipants()) {
             return true;
         }
     }
@@ -786,17 +910,17 @@ bool CCoinJoinServer::IsSessionReady() const
     return false;
 }
 
-void CCoinJoinServer::RelayFinalTransaction(const CTransaction& txFinal)
+void CCoinJoinServerSession::RelayFinalTransaction(const CTransaction& txFinal)
 {
     AssertLockHeld(cs_coinjoin);
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- nSessionID: %d  nSessionDenom: %d (%s)\n",
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::%s -- nSessionID: %d  nSessionDenom: %d (%s)\n",
         __func__, nSessionID, nSessionDenom, CoinJoin::DenominationToString(nSessionDenom));
 
     // final mixing tx with empty signatures should be relayed to mixing participants only
     for (const auto& entry : vecEntries) {
-        bool fOk = connman.ForNode(entry.addr, [&txFinal, this](CNode* pnode) {
+        bool fOk = m_server.connman.ForNode(entry.addr, [&txFinal, this](CNode* pnode) {
             CNetMsgMaker msgMaker(pnode->GetCommonVersion());
-            connman.PushMessage(pnode, msgMaker.Make(NetMsgType::DSFINALTX, nSessionID.load(), txFinal));
+            m_server.connman.PushMessage(pnode, msgMaker.Make(NetMsgType::DSFINALTX, nSessionID.load(), txFinal));
             return true;
         });
         if (!fOk) {
@@ -807,20 +931,27 @@ void CCoinJoinServer::RelayFinalTransaction(const CTransaction& txFinal)
     }
 }
 
-void CCoinJoinServer::PushStatus(CNode& peer, PoolStatusUpdate nStatusUpdate, PoolMessage nMessageID) const
+void CCoinJoinServerSession::PushStatus(CNode& peer, PoolStatusUpdate nStatusUpdate, PoolMessage nMessageID) const
 {
     CCoinJoinStatusUpdate psssup(nSessionID, nState, 0, nStatusUpdate, nMessageID);
+    m_server.connman.PushMessage(&peer, CNetMsgMaker(peer.GetCommonVersion()).Make(NetMsgType::DSSTATUSUPDATE, psssup));
+}
+
+void CCoinJoinServer::PushStatus(CNode& peer, PoolStatusUpdate nStatusUpdate, PoolMessage nMessageID) const
+{
+    // no session for this peer
+    CCoinJoinStatusUpdate psssup(0, POOL_STATE_IDLE, 0, nStatusUpdate, nMessageID);
     connman.PushMessage(&peer, CNetMsgMaker(peer.GetCommonVersion()).Make(NetMsgType::DSSTATUSUPDATE, psssup));
 }
 
-void CCoinJoinServer::RelayStatus(PoolStatusUpdate nStatusUpdate, PoolMessage nMessageID)
+void CCoinJoinServerSession::RelayStatus(PoolStatusUpdate nStatusUpdate, PoolMessage nMessageID)
 {
     AssertLockHeld(cs_coinjoin);
     unsigned int nDisconnected{};
     // status updates should be relayed to mixing participants only
     for (const auto& entry : vecEntries) {
         // make sure everyone is still connected
-        bool fOk = connman.ForNode(entry.addr, [&nStatusUpdate, &nMessageID, this](CNode* pnode) {
+        bool fOk = m_server.connman.ForNode(entry.addr, [&nStatusUpdate, &nMessageID, this](CNode* pnode) {
             PushStatus(*pnode, nStatusUpdate, nMessageID);
             return true;
         });
@@ -832,12 +963,12 @@ void CCoinJoinServer::RelayStatus(PoolStatusUpdate nStatusUpdate, PoolMessage nM
     if (nDisconnected == 0) return; // all is clear
 
     // something went wrong
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- can't continue, %llu client(s) disconnected, nSessionID: %d  nSessionDenom: %d (%s)\n",
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::%s -- can't continue, %llu client(s) disconnected, nSessionID: %d  nSessionDenom: %d (%s)\n",
         __func__, nDisconnected, nSessionID, nSessionDenom, CoinJoin::DenominationToString(nSessionDenom));
 
     // notify everyone else that this session should be terminated
     for (const auto& entry : vecEntries) {
-        connman.ForNode(entry.addr, [this](CNode* pnode) {
+        m_server.connman.ForNode(entry.addr, [this](CNode* pnode) {
             PushStatus(*pnode, STATUS_REJECTED, MSG_NOERR);
             return true;
         });
@@ -850,18 +981,25 @@ void CCoinJoinServer::RelayStatus(PoolStatusUpdate nStatusUpdate, PoolMessage nM
     }
 }
 
-void CCoinJoinServer::RelayCompletedTransaction(PoolMessage nMessageID)
+void CCoinJoinServerSession::RelayStatusToParticipants(PoolStatusUpdate nStatusUpdate)
+{
+    AssertLockNotHeld(cs_coinjoin);
+    LOCK(cs_coinjoin);
+    RelayStatus(nStatusUpdate);
+}
+
+void CCoinJoinServerSession::RelayCompletedTransaction(PoolMessage nMessageID)
 {
     AssertLockNotHeld(cs_coinjoin);
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::%s -- nSessionID: %d  nSessionDenom: %d (%s)\n",
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::%s -- nSessionID: %d  nSessionDenom: %d (%s)\n",
         __func__, nSessionID, nSessionDenom, CoinJoin::DenominationToString(nSessionDenom));
 
     // final mixing tx with empty signatures should be relayed to mixing participants only
     LOCK(cs_coinjoin);
     for (const auto& entry : vecEntries) {
-        bool fOk = connman.ForNode(entry.addr, [&nMessageID, this](CNode* pnode) {
+        bool fOk = m_server.connman.ForNode(entry.addr, [&nMessageID, this](CNode* pnode) {
             CNetMsgMaker msgMaker(pnode->GetCommonVersion());
-            connman.PushMessage(pnode, msgMaker.Make(NetMsgType::DSCOMPLETE, nSessionID.load(), nMessageID));
+            m_server.connman.PushMessage(pnode, msgMaker.Make(NetMsgType::DSCOMPLETE, nSessionID.load(), nMessageID));
             return true;
         });
         if (!fOk) {
@@ -872,37 +1010,73 @@ void CCoinJoinServer::RelayCompletedTransaction(PoolMessage nMessageID)
     }
 }
 
-void CCoinJoinServer::SetState(PoolState nStateNew)
+void CCoinJoinServerSession::SetState(PoolState nStateNew)
 {
-    if (!m_mn_activeman) return;
-
     if (nStateNew == POOL_STATE_ERROR) {
-        LogPrint(BCLog::COINJOIN, "CCoinJoinServer::SetState -- Can't set state to ERROR as a Masternode. \n");
+        LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::SetState -- Can't set state to ERROR as a Masternode. \n");
         return;
     }
 
-    LogPrint(BCLog::COINJOIN, "CCoinJoinServer::SetState -- nState: %d, nStateNew: %d\n", nState, nStateNew);
+    LogPrint(BCLog::COINJOIN, "CCoinJoinServerSession::SetState -- nSessionID: %d, nState: %d, nStateNew: %d\n", nSessionID, nState, nStateNew);
     nTimeLastSuccessfulStep = GetTime();
     nState = nStateNew;
 }
 
+void CCoinJoinServerSession::SetNull()
+{
+    AssertLockHeld(cs_coinjoin);
+    // MN side
+    vecSessionCollaterals.clear();
+    vecParticipants.clear();
+
+    CCoinJoinBaseSession::SetNull();
+}
+
 void CCoinJoinServer::DoMaintenance()
 {
     if (!m_mn_activeman) return; // only run on masternodes
     if (!m_mn_sync.IsBlockchainSynced()) return;
     if (ShutdownRequested()) return;
 
-    CheckForCompleteQueue();
-    CheckPool();
+    {
+        LOCK(cs_sessions);
+        for (const auto& session : vecSessions) {
+            session->CheckForCompleteQueue();
+            session->CheckPool();
+        }
+        CommitFinalTransactions();
+        PruneSessions();
+    }
     CheckTimeout();
 }
 
+void CCoinJoinServerSession::GetJsonInfo(UniValue& obj) const
+{
+    obj.pushKV("denomination",  ValueFromAmount(CoinJoin::DenominationToAmount(nSessionDenom)));
+    obj.pushKV("state",         GetStateString());
+    obj.pushKV("entries_count", GetEntriesCount());
+}
+
 void CCoinJoinServer::GetJsonInfo(UniValue& obj) const
 {
     obj.clear();
     obj.setObject();
     obj.pushKV("queue_size",    GetQueueSize());
-    obj.pushKV("denomination",  ValueFromAmount(CoinJoin::DenominationToAmount(nSessionDenom)));
-    obj.pushKV("state",         GetStateString());
-    obj.pushKV("entries_count", GetEntriesCount());
+
+    LOCK(cs_sessions);
+    // the oldest session is reported at the top level, like the only one used to be
+    if (vecSessions.empty()) {
+        obj.pushKV("denomination",  ValueFromAmount(CoinJoin::DenominationToAmount(0)));
+        obj.pushKV("state",         "IDLE");
+        obj.pushKV("entries_count", 0);
+    } else {
+        vecSessions.front()->GetJsonInfo(obj);
+    }
+    UniValue arrSessions(UniValue::VARR);
+    for (const auto& session : vecSessions) {
+        UniValue objSession(UniValue::VOBJ);
+        session->GetJsonInfo(objSession);
+        arrSessions.push_back(objSession);
+    }
+    obj.pushKV("sessions",      arrSessions);
 }
@@ -10,6 +10,9 @@
 #include <net_types.h>
 #include <spork.h>
 
+#include <memory>
+#include <vector>
+
 class CActiveMasternodeManager;
 class CChainState;
 class CCoinJoinServer;
@@ -23,11 +26,93 @@ class PeerManager;
 
 class UniValue;
 
+/** Default for -coinjoinserversessions, how many mixing sessions a masternode runs at once */
+static constexpr int DEFAULT_COINJOIN_SERVER_SESSIONS{1};
+/** Concurrent sessions never share a denomination so there can't be more of them than denominations */
+static constexpr int MAX_COINJOIN_SERVER_SESSIONS{5};
+
+/** A single mixing session run by a masternode, one denomination and one set of participants
+ */
+class CCoinJoinServerSession : public CCoinJoinBaseSession
+{
+private:
+    CCoinJoinServer& m_server;
+
+    // Mixing uses collateral transactions to trust parties entering the pool
+    // to behave honestly. If they don't it takes their money.
+    std::vector<CTransactionRef> vecSessionCollaterals;
+    // Peers that were accepted to this session, dsi/dss messages are routed by address
+    std::vector<CService> vecParticipants;
+
+    /// Check that all inputs are signed. (Are all inputs signed?)
+    bool IsSignaturesComplete() const EXCLUSIVE_LOCKS_REQUIRED(!cs_coinjoin);
+
+    // Set the 'state' value, with some logging and capturing when the state changed
+    void SetState(PoolState nStateNew);
+
+    void CreateFinalTransaction() EXCLUSIVE_LOCKS_REQUIRED(!cs_coinjoin);
+
+    /// Add signature to a txin, `txNew` is the final transaction the signatures are checked against
+    bool AddScriptSig(CMutableTransaction& txNew, const std::vector<CScript>& vecPrevPubKeys, const CTxIn& txin) EXCLUSIVE_LOCKS_REQUIRED(cs_coinjoin);
+    /// Check to make sure a given input matches an input in the pool and its scriptSig is valid
+    bool IsInputScriptSigValid(CMutableTransaction& txNew, const std::vector<CScript>& vecPrevPubKeys, const CTxIn& txin) const EXCLUSIVE_LOCKS_REQUIRED(cs_coinjoin);
+
+    /// Relay mixing Messages
+    void RelayFinalTransaction(const CTransaction& txFinal) EXCLUSIVE_LOCKS_REQUIRED(cs_coinjoin);
+    void RelayStatus(PoolStatusUpdate nStatusUpdate, PoolMessage nMessageID = MSG_NOERR) EXCLUSIVE_LOCKS_REQUIRED(cs_coinjoin);
+    void RelayCompletedTransaction(PoolMessage nMessageID) EXCLUSIVE_LOCKS_REQUIRED(!cs_coinjoin);
+
+    void SetNull() override EXCLUSIVE_LOCKS_REQUIRED(cs_coinjoin);
+
+public:
+    explicit CCoinJoinServerSession(CCoinJoinServer& server) : m_server(server) {}
+
+    bool IsIdle() const { return nState == POOL_STATE_IDLE; }
+    int GetSessionID() const { return nSessionID; }
+    bool HasParticipant(const CService& addr) const;
+
+    /// Start a new session for the given dsa and announce it with a dsq
+    bool Start(const CCoinJoinAccept& dsa, const CService& addr, int nNewSessionID, PoolMessage& nMessageIDRet);
+    bool AddUser(const CCoinJoinAccept& dsa, const CService& addr, PoolMessage& nMessageIDRet);
+    /// Do we have enough users to take entries?
+    bool IsSessionReady() const;
+
+    /// Add a clients entry to the pool
+    bool AddEntry(const CCoinJoinEntry& entry, PoolMessage& nMessageIDRet) EXCLUSIVE_LOCKS_REQUIRED(!cs_coinjoin);
+    /// Verify and add all signatures a client sent for the final transaction, stops at the first invalid one
+    bool AddScriptSigs(const std::vector<CTxIn>& vecTxIn) EXCLUSIVE_LOCKS_REQUIRED(!cs_coinjoin);
+
+    /// Charge fees to bad actors (Charge clients a fee if they're abusive)
+    void ChargeFees() const EXCLUSIVE_LOCKS_REQUIRED(!cs_coinjoin);
+    /// Rarely charge fees to pay miners
+    void ChargeRandomFees() const;
+
+    /// Check for process
+    void CheckPool() EXCLUSIVE_LOCKS_REQUIRED(!cs_coinjoin);
+    void CheckForCompleteQueue();
+    bool HasTimedOut() const;
+    void CheckTimeout() EXCLUSIVE_LOCKS_REQUIRED(!cs_coinjoin);
+
+    /// Do we have all signatures and can try to commit the final transaction?
+    bool IsReadyToCommit() const EXCLUSIVE_LOCKS_REQUIRED(!cs_coinjoin);
+    CTransactionRef GetFinalTransaction() const EXCLUSIVE_LOCKS_REQUIRED(!cs_coinjoin);
+    /// Relay the final transaction if it was accepted to the mempool, notify participants and reset the session
+    void CommitFinalTransaction(const CTransactionRef& finalTransaction, bool fAccepted) EXCLUSIVE_LOCKS_REQUIRED(!cs_coinjoin);
+
+    void PushStatus(CNode& peer, PoolStatusUpdate nStatusUpdate, PoolMessage nMessageID) const;
+    void RelayStatusToParticipants(PoolStatusUpdate nStatusUpdate) EXCLUSIVE_LOCKS_REQUIRED(!cs_coinjoin);
+    void Reset() EXCLUSIVE_LOCKS_REQUIRED(!cs_coinjoin) { LOCK(cs_coinjoin); SetNull(); }
+
+    void GetJsonInfo(UniValue& obj) const EXCLUSIVE_LOCKS_REQUIRED(!cs_coinjoin);
+};
+
 /** Used to keep track of current status of mixing pool
  */
-class CCoinJoinServer : public CCoinJoinBaseSession, public CCoinJoinBaseManager
+class CCoinJoinServer : public CCoinJoinBaseManager
 {
 private:
+    friend class CCoinJoinServerSession;
+
     CChainState& m_chainstate;
     CConnman& connman;
     CDeterministicMNManager& m_dmnman;
@@ -39,85 +124,48 @@ private:
     const CMasternodeSync& m_mn_sync;
     const std::unique_ptr<PeerManager>& m_peerman;
 
-    // Mixing uses collateral transactions to trust parties entering the pool
-    // to behave honestly. If they don't it takes their money.
-    std::vector<CTransactionRef> vecSessionCollaterals;
+    // Sessions are few and short lived, one lock for all of them keeps the message handler
+    // and the maintenance thread from stepping on each other
+    mutable Mutex cs_sessions;
+    std::vector<std::unique_ptr<CCoinJoinServerSession>> vecSessions GUARDED_BY(cs_sessions);
+    const int nMaxSessions;
 
     bool fUnitTest;
 
-    /// Add a clients entry to the pool
-    bool AddEntry(const CCoinJoinEntry& entry, PoolMessage& nMessageIDRet) EXCLUSIVE_LOCKS_REQUIRED(!cs_coinjoin);
-    /// Add signature to a txin
-    bool AddScriptSig(const CTxIn& txin) EXCLUSIVE_LOCKS_REQUIRED(!cs_coinjoin);
-
-    /// Charge fees to bad actors (Charge clients a fee if they're abusive)
-    void ChargeFees() const EXCLUSIVE_LOCKS_REQUIRED(!cs_coinjoin);
-    /// Rarely charge fees to pay miners
-    void ChargeRandomFees() const;
     /// Consume collateral in cases when peer misbehaved
     void ConsumeCollateral(const CTransactionRef& txref) const;
 
-    /// Check for process
-    void CheckPool();
-
-    void CreateFinalTransaction() EXCLUSIVE_LOCKS_REQUIRED(!cs_coinjoin);
-    void CommitFinalTransaction() EXCLUSIVE_LOCKS_REQUIRED(!cs_coinjoin);
-
     /// Is this nDenom and txCollateral acceptable?
     bool IsAcceptableDSA(const CCoinJoinAccept& dsa, PoolMessage& nMessageIDRet) const;
-    bool CreateNewSession(const CCoinJoinAccept& dsa, PoolMessage& nMessageIDRet) EXCLUSIVE_LOCKS_REQUIRED(!cs_vecqueue);
-    bool AddUserToExistingSession(const CCoinJoinAccept& dsa, PoolMessage& nMessageIDRet);
-    /// Do we have enough users to take entries?
-    bool IsSessionReady() const;
 
-    /// Check that all inputs are signed. (Are all inputs signed?)
-    bool IsSignaturesComplete() const EXCLUSIVE_LOCKS_REQUIRED(!cs_coinjoin);
-    /// Check to make sure a given input matches an input in the pool and its scriptSig is valid
-    bool IsInputScriptSigValid(const CTxIn& txin) const EXCLUSIVE_LOCKS_REQUIRED(cs_coinjoin);
+    CCoinJoinServerSession* FindSessionForDenom(int nDenom) const EXCLUSIVE_LOCKS_REQUIRED(cs_sessions);
+    CCoinJoinServerSession* FindSessionForParticipant(const CService& addr) const EXCLUSIVE_LOCKS_REQUIRED(cs_sessions);
+    int GetNewSessionID() const EXCLUSIVE_LOCKS_REQUIRED(cs_sessions);
+    /// Drop sessions that went back to idle
+    void PruneSessions() EXCLUSIVE_LOCKS_REQUIRED(cs_sessions, !cs_vecqueue);
 
-    // Set the 'state' value, with some logging and capturing when the state changed
-    void SetState(PoolState nStateNew);
+    /// Accept the final transactions of all fully signed sessions to the mempool in one go
+    void CommitFinalTransactions() EXCLUSIVE_LOCKS_REQUIRED(cs_sessions);
 
-    /// Relay mixing Messages
-    void RelayFinalTransaction(const CTransaction& txFinal) EXCLUSIVE_LOCKS_REQUIRED(cs_coinjoin);
     void PushStatus(CNode& peer, PoolStatusUpdate nStatusUpdate, PoolMessage nMessageID) const;
-    void RelayStatus(PoolStatusUpdate nStatusUpdate, PoolMessage nMessageID = MSG_NOERR) EXCLUSIVE_LOCKS_REQUIRED(cs_coinjoin);
-    void RelayCompletedTransaction(PoolMessage nMessageID) EXCLUSIVE_LOCKS_REQUIRED(!cs_coinjoin);
 
-    void ProcessDSACCEPT(CNode& peer, CDataStream& vRecv) EXCLUSIVE_LOCKS_REQUIRED(!cs_vecqueue);
+    void ProcessDSACCEPT(CNode& peer, CDataStream& vRecv) EXCLUSIVE_LOCKS_REQUIRED(!cs_vecqueue, !cs_sessions);
     PeerMsgRet ProcessDSQUEUE(const CNode& peer, CDataStream& vRecv) EXCLUSIVE_LOCKS_REQUIRED(!cs_vecqueue);
-    void ProcessDSVIN(CNode& peer, CDataStream& vRecv) EXCLUSIVE_LOCKS_REQUIRED(!cs_coinjoin);
-    void ProcessDSSIGNFINALTX(CDataStream& vRecv) EXCLUSIVE_LOCKS_REQUIRED(!cs_coinjoin);
-
-    void SetNull() override EXCLUSIVE_LOCKS_REQUIRED(cs_coinjoin);
+    void ProcessDSVIN(CNode& peer, CDataStream& vRecv) EXCLUSIVE_LOCKS_REQUIRED(!cs_vecqueue, !cs_sessions);
+    void ProcessDSSIGNFINALTX(CNode& peer, CDataStream& vRecv) EXCLUSIVE_LOCKS_REQUIRED(!cs_vecqueue, !cs_sessions);
 
 public:
     explicit CCoinJoinServer(CChainState& chainstate, CConnman& _connman, CDeterministicMNManager& dmnman, CDSTXManager& dstxman,
                              CMasternodeMetaMan& mn_metaman, CTxMemPool& mempool, const CActiveMasternodeManager* const mn_activeman,
-                             CSporkManager& spork_manager, const CMasternodeSync& mn_sync, const std::unique_ptr<PeerManager>& peerman) :
-        m_chainstate(chainstate),
-        connman(_connman),
-        m_dmnman(dmnman),
-        m_dstxman(dstxman),
-        m_mn_metaman(mn_metaman),
-        mempool(mempool),
-        m_mn_activeman(mn_activeman),
-        m_spork_manager(spork_manager),
-        m_mn_sync(mn_sync),
-        m_peerman(peerman),
-        vecSessionCollaterals(),
-        fUnitTest(false)
-    {}
-
-    PeerMsgRet ProcessMessage(CNode& pfrom, std::string_view msg_type, CDataStream& vRecv);
+                             CSporkManager& spork_manager, const CMasternodeSync& mn_sync, const std::unique_ptr<PeerManager>& peerman);
 
-    bool HasTimedOut() const;
-    void CheckTimeout();
-    void CheckForCompleteQueue();
+    PeerMsgRet ProcessMessage(CNode& pfrom, std::string_view msg_type, CDataStream& vRecv) EXCLUSIVE_LOCKS_REQUIRED(!cs_vecqueue, !cs_sessions);
+
+    void CheckTimeout() EXCLUSIVE_LOCKS_REQUIRED(!cs_vecqueue, !cs_sessions);
 
-    void DoMaintenance();
+    void DoMaintenance() EXCLUSIVE_LOCKS_REQUIRED(!cs_vecqueue, !cs_sessions);
 
-    void GetJsonInfo(UniValue& obj) const;
+    void GetJsonInfo(UniValue& obj) const EXCLUSIVE_LOCKS_REQUIRED(!cs_sessions);
 };
 
 #endif // BITCOIN_COINJOIN_SERVER_H
@@ -11,15 +11,22 @@
 #include <memusage.h>
 #include <primitives/transaction.h>
 #include <serialize.h>
+#include <support/allocators/pool.h>
 #include <uint256.h>
 #include <util/hasher.h>
 
 #include <assert.h>
 #include <stdint.h>
 
+#include <atomic>
 #include <functional>
 #include <unordered_map>
 
+/** Default for -coinscachepool */
+static constexpr bool DEFAULT_COINS_CACHE_POOL{true};
+/** Whether new coins caches allocate their entries from pooled chunks, set from -coinscachepool at startup */
+extern std::atomic<bool> g_coins_cache_pool;
+
 /**
  * A UTXO entry.
  *
@@ -131,7 +138,19 @@ struct CCoinsCacheEntry
     CCoinsCacheEntry(Coin&& coin_, unsigned char flag) : coin(std::move(coin_)), flags(flag) {}
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+/**
+ * The coins cache map. Its nodes come from a PoolResource owned by the cache, so a large -dbcache isn't spread
+ * over millions of separate heap allocations and its memory usage is known exactly.
+ *
+ * The node layout of std::unordered_map is implementation defined. Most implementations add one or two pointers
+ * and maybe the cached hash to the value, so MAX_BLOCK_SIZE_BYTES leaves room for four pointers to make sure
+ * all nodes are pooled.
+ */
+using CCoinsMap = std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher, std::equal_to<COutPoint>,
+                                     PoolAllocator<std::pair<const COutPoint, CCoinsCacheEntry>,
+                                                   sizeof(std::pair<const COutPoint, CCoinsCacheEntry>) + sizeof(void*) * 4>>;
+
+using CCoinsMapMemoryResource = CCoinsMap::allocator_type::ResourceType;
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -218,6 +237,7 @@ protected:
      * declared as "const".
      */
     mutable uint256 hashBlock;
+    mutable CCoinsMapMemoryResource m_cache_coins_memory_resource;
     mutable CCoinsMap cacheCoins;
 
     /* Cached dynamic memory usage for the inner Coin objects. */
@@ -275,6 +295,13 @@ public:
      */
     void EmplaceCoinInternalDANGER(COutPoint&& outpoint, Coin&& coin);
 
+    /**
+     * Cache an unspent coin just read from the base view, as a lookup would
+     * have. Does nothing if the outpoint is cached already. Used to warm the
+     * cache with coins read on other threads.
+     */
+    void CacheFetchedCoin(const COutPoint& outpoint, Coin&& coin);
+
     /**
      * Spend a coin. Pass moveto in order to get the deleted data.
      * If no unspent output exists for the passed outpoint, this call
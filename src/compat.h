@@ -123,6 +123,18 @@ typedef char* sockopt_arg_type;
 #define USE_EPOLL
 #endif
 
+// io_uring needs multishot poll and EXT_ARG waits (Linux 5.13), whether the running kernel has them (or allows
+// io_uring at all) is only known at runtime. <linux/io_uring.h> itself pulls in <linux/fs.h> and its macros, so
+// only util/edge.cpp includes it and the headers are checked by version here
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && __has_include(<linux/version.h>)
+#include <linux/version.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 13, 0)
+#define USE_IO_URING
+#endif
+#endif
+#endif
+
 #if defined(__FreeBSD__) || defined(__APPLE__)
 #define USE_KQUEUE
 #endif
@@ -6,6 +6,8 @@
 
 #include <memory>
 #include <random.h>
+#include <sync.h>
+#include <util/string.h>
 
 #include <leveldb/cache.h>
 #include <leveldb/env.h>
@@ -14,6 +16,15 @@
 #include <stdint.h>
 #include <algorithm>
 #include <optional>
+#include <set>
+#include <sstream>
+#include <vector>
+
+namespace {
+Mutex g_dbwrappers_mutex;
+//! All open databases, for ForEachDBWrapper
+std::set<const CDBWrapper*> g_dbwrappers GUARDED_BY(g_dbwrappers_mutex);
+} // namespace
 
 class CBitcoinLevelDBLogger : public leveldb::Logger {
 public:
@@ -98,13 +109,139 @@ static void SetMaxOpenFiles(leveldb::Options *options) {
              options->max_open_files, default_open_files);
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+const char* DBMetrics::OpName(Op op)
+{
+    switch (op) {
+    case Op::READ: return "read";
+    case Op::EXISTS: return "exists";
+    case Op::WRITE_BATCH: return "writebatch";
+    case Op::SEEK: return "seek";
+    } // no default case, so the compiler can warn about missing cases
+    assert(false);
+}
+
+void DBMetrics::RecordOperation(Op op, std::chrono::microseconds duration)
+{
+    OpCounters& counters = m_ops[static_cast<size_t>(op)];
+    const int64_t us{duration.count()};
+    ++counters.count;
+    counters.total_us += us;
+    int64_t max{counters.max_us.load(std::memory_order_relaxed)};
+    while (us > max && !counters.max_us.compare_exchange_weak(max, us, std::memory_order_relaxed)) {}
+    const auto bucket{std::upper_bound(LATENCY_BOUNDS_US.begin(), LATENCY_BOUNDS_US.end(), us) - LATENCY_BOUNDS_US.begin()};
+    ++counters.latency_histogram[bucket];
+}
+
+void DBMetrics::RecordBatch(size_t bytes)
+{
+    m_batch_bytes += bytes;
+    const auto bucket{std::upper_bound(BATCH_SIZE_BOUNDS.begin(), BATCH_SIZE_BOUNDS.end(), bytes) - BATCH_SIZE_BOUNDS.begin()};
+    ++m_batch_size_histogram[bucket];
+}
+
+DBMetrics::OpStats DBMetrics::GetOpStats(Op op) const
+{
+    const OpCounters& counters = m_ops[static_cast<size_t>(op)];
+    OpStats stats;
+    stats.count = counters.count;
+    stats.total = std::chrono::microseconds{counters.total_us.load()};
+    stats.max = std::chrono::microseconds{counters.max_us.load()};
+    for (size_t i = 0; i < stats.latency_histogram.size(); ++i) {
+        stats.latency_histogram[i] = counters.latency_histogram[i];
+    }
+    return stats;
+}
+
+std::array<uint64_t, DBMetrics::BATCH_SIZE_BOUNDS.size() + 1> DBMetrics::GetBatchSizeHistogram() const
+{
+    std::array<uint64_t, BATCH_SIZE_BOUNDS.size() + 1> histogram;
+    for (size_t i = 0; i < histogram.size(); ++i) {
+        histogram[i] = m_batch_size_histogram[i];
+    }
+    return histogram;
+}
+
+std::vector<DBLevelStats> ParseDBCompactionStats(const std::string& stats)
+{
+    // The table follows a header and a line of dashes:
+    //   Level  Files Size(MB) Time(sec) Read(MB) Write(MB)
+    //   --------------------------------------------------
+    //     1        3        5         0        0         2
+    std::vector<DBLevelStats> levels;
+    std::istringstream lines{stats};
+    lines.imbue(std::locale::classic());
+    std::string line;
+    bool in_table{false};
+    while (std::getline(lines, line)) {
+        if (!in_table) {
+            in_table = line.find("-----") != std::string::npos;
+            continue;
+        }
+        std::istringstream fields{line};
+        fields.imbue(std::locale::classic());
+        DBLevelStats level;
+        if (!(fields >> level.level >> level.files >> level.size_mb >> level.time_sec >> level.read_mb >> level.write_mb)) break;
+        levels.push_back(level);
+    }
+    return levels;
+}
+
+bool ReadDBProfiles(const ArgsManager& args, std::map<std::string, DBProfile>& profiles, std::string& error)
+{
+    for (const std::string& arg : args.GetArgs("-dbprofile")) {
+        const size_t colon = arg.find(':');
+        if (colon == 0 || colon == std::string::npos) {
+            error = strprintf("Invalid -dbprofile '%s', expected <db>:<key>=<value>[,<key>=<value>...]", arg);
+            return false;
+        }
+        const std::string name{arg.substr(0, colon)};
+        DBProfile& profile = profiles[name];
+        for (const std::string& setting : SplitString(std::string_view{arg}.substr(colon + 1), ',')) {
+            const size_t equals = setting.find('=');
+            const std::string key{setting.substr(0, equals)};
+            const std::optional<int64_t> value{equals == std::string::npos ? std::nullopt : ToIntegral<int64_t>(setting.substr(equals + 1))};
+            const auto in_range = [&value](int64_t min, int64_t max) { return value && *value >= min && *value <= max; };
+            if (key == "blockcache" && in_range(10, 90)) {
+                profile.block_cache_percent = *value;
+            } else if (key == "blocksize" && in_range(1 << 10, 4 << 20)) {
+                profile.block_size = *value;
+            } else if (key == "bloombits" && in_range(0, 64)) {
+                profile.bloom_bits = *value;
+            } else if (key == "compression" && in_range(0, 1)) {
+                profile.compression = *value;
+            } else if (key == "maxfilesize" && in_range(1 << 20, 1 << 30)) {
+                profile.max_file_size = *value;
+            } else {
+                error = strprintf("Invalid -dbprofile setting '%s' for %s", setting, name);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static DBProfile GetDBProfile(const std::string& name)
+{
+    std::map<std::string, DBProfile> profiles;
+    std::string error;
+    // The options were checked on startup
+    if (!ReadDBProfiles(gArgs, profiles, error)) {
+        LogPrintf("%s\n", error);
+    }
+    const auto it = profiles.find(name);
+    return it != profiles.end() ? it->second : DBProfile{};
+}
+
+static leveldb::Options GetOptions(size_t nCacheSize, const DBProfile& profile)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = leveldb::kNoCompression;
+    options.block_cache = leveldb::NewLRUCache(uint64_t{nCacheSize} * profile.block_cache_percent / 100);
+    // up to two write buffers may be held in memory simultaneously
+    options.write_buffer_size = uint64_t{nCacheSize} * (100 - profile.block_cache_percent) / 200;
+    options.block_size = profile.block_size;
+    options.max_file_size = profile.max_file_size;
+    options.filter_policy = profile.bloom_bits > 0 ? leveldb::NewBloomFilterPolicy(profile.bloom_bits) : nullptr;
+    options.compression = profile.compression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
     options.info_log = new CBitcoinLevelDBLogger();
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
@@ -116,14 +253,16 @@ static leveldb::Options GetOptions(size_t nCacheSize)
 }
 
 CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate)
-    : m_name{path.stem().string()}
+    // Indexes keep their database in a "db" directory, name them after the index
+    : m_name{path.stem() == "db" ? path.parent_path().filename().string() : path.stem().string()}
 {
     penv = nullptr;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    if (!fMemory) m_profile = GetDBProfile(m_name);
+    options = GetOptions(nCacheSize, m_profile);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -165,10 +304,15 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     }
 
     LogPrintf("Using obfuscation key for %s: %s\n", path.string(), HexStr(obfuscate_key));
+    LogPrint(BCLog::LEVELDB, "LevelDB profile for %s: blockcache=%d%% blocksize=%u bloombits=%d compression=%d maxfilesize=%u\n",
+             m_name, m_profile.block_cache_percent, m_profile.block_size, m_profile.bloom_bits, m_profile.compression, m_profile.max_file_size);
+
+    WITH_LOCK(g_dbwrappers_mutex, g_dbwrappers.insert(this));
 }
 
 CDBWrapper::~CDBWrapper()
 {
+    WITH_LOCK(g_dbwrappers_mutex, g_dbwrappers.erase(this));
     delete pdb;
     pdb = nullptr;
     delete options.filter_policy;
@@ -188,7 +332,10 @@ bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
     if (log_memory) {
         mem_before = DynamicMemoryUsage() / 1024.0 / 1024;
     }
+    const auto start{SteadyClock::now()};
     leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
+    RecordOperation(DBMetrics::Op::WRITE_BATCH, start);
+    m_metrics.RecordBatch(batch.SizeEstimate());
     dbwrapper_private::HandleError(status);
     if (log_memory) {
         double mem_after = DynamicMemoryUsage() / 1024.0 / 1024;
@@ -209,6 +356,34 @@ size_t CDBWrapper::DynamicMemoryUsage() const
     return parsed.value();
 }
 
+void CDBWrapper::RecordOperation(DBMetrics::Op op, SteadyClock::time_point start) const
+{
+    const auto duration{std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - start)};
+    m_metrics.RecordOperation(op, duration);
+    if (duration >= DB_SLOW_OPERATION) {
+        LogPrint(BCLog::LEVELDB, "Slow %s on %s: %.3fms\n", DBMetrics::OpName(op), m_name, duration.count() / 1000.0);
+    }
+}
+
+std::optional<std::string> CDBWrapper::GetProperty(const std::string& property) const
+{
+    std::string value;
+    if (!pdb->GetProperty(property, &value)) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+void ForEachDBWrapper(const std::function<void(const CDBWrapper&)>& func)
+{
+    LOCK(g_dbwrappers_mutex);
+    std::vector<const CDBWrapper*> dbs{g_dbwrappers.begin(), g_dbwrappers.end()};
+    std::sort(dbs.begin(), dbs.end(), [](const CDBWrapper* a, const CDBWrapper* b) { return a->GetName() < b->GetName(); });
+    for (const CDBWrapper* db : dbs) {
+        func(*db);
+    }
+}
+
 // Prefixed with null character to avoid collisions with other keys
 //
 // We must use a string constructor which specifies length so that we copy
@@ -237,7 +412,20 @@ bool CDBWrapper::IsEmpty()
 
 CDBIterator::~CDBIterator() { delete piter; }
 bool CDBIterator::Valid() const { return piter->Valid(); }
-void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
+void CDBIterator::SeekToFirst()
+{
+    const auto start{SteadyClock::now()};
+    piter->SeekToFirst();
+    parent.RecordOperation(DBMetrics::Op::SEEK, start);
+}
+
+void CDBIterator::Seek(const CDataStream& ssKey)
+{
+    leveldb::Slice slKey((const char*)ssKey.data(), ssKey.size());
+    const auto start{SteadyClock::now()};
+    piter->Seek(slKey);
+    parent.RecordOperation(DBMetrics::Op::SEEK, start);
+}
 void CDBIterator::Next() { piter->Next(); }
 
 namespace dbwrapper_private {
@@ -12,7 +12,15 @@
 #include <streams.h>
 #include <util/strencodings.h>
 #include <util/system.h>
-
+#include <util/time.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
 #include <typeindex>
 
 #include <leveldb/db.h>
@@ -29,6 +37,89 @@ public:
 
 class CDBWrapper;
 
+/** LevelDB settings of a database, set per database with -dbprofile */
+struct DBProfile {
+    //! Share of the cache size given to the block cache in percent, the two write buffers split the rest
+    int block_cache_percent{50};
+    //! Approximate amount of data packed into a block
+    size_t block_size{4 * 1024};
+    //! Bits per key of the bloom filter, 0 for none
+    int bloom_bits{10};
+    //! Compress blocks, only has an effect if LevelDB was built with Snappy
+    bool compression{false};
+    //! Size at which a new table file is started
+    size_t max_file_size{2 * 1024 * 1024};
+};
+
+/** Operations slower than this are logged in the leveldb category */
+static constexpr auto DB_SLOW_OPERATION{std::chrono::milliseconds{100}};
+
+/** Counters and latency histograms of the operations on a database, updated without locking */
+class DBMetrics
+{
+public:
+    enum class Op {
+        READ,
+        EXISTS,
+        WRITE_BATCH,
+        SEEK,
+    };
+    static constexpr size_t NUM_OPS{4};
+    static const char* OpName(Op op);
+
+    //! Latency buckets hold operations faster than these microseconds, a last bucket the slower ones
+    static constexpr std::array<int64_t, 6> LATENCY_BOUNDS_US{10, 100, 1000, 10000, 100000, 1000000};
+    //! Batch size buckets hold batches smaller than these bytes, a last bucket the larger ones
+    static constexpr std::array<size_t, 5> BATCH_SIZE_BOUNDS{1 << 10, 16 << 10, 256 << 10, 4 << 20, 64 << 20};
+
+    struct OpStats {
+        uint64_t count{0};
+        std::chrono::microseconds total{0};
+        std::chrono::microseconds max{0};
+        std::array<uint64_t, LATENCY_BOUNDS_US.size() + 1> latency_histogram{};
+    };
+
+    void RecordOperation(Op op, std::chrono::microseconds duration);
+    void RecordReadMiss() { ++m_read_misses; }
+    void RecordBatch(size_t bytes);
+
+    OpStats GetOpStats(Op op) const;
+    uint64_t GetReadMisses() const { return m_read_misses; }
+    uint64_t GetBatchBytes() const { return m_batch_bytes; }
+    std::array<uint64_t, BATCH_SIZE_BOUNDS.size() + 1> GetBatchSizeHistogram() const;
+
+private:
+    struct OpCounters {
+        std::atomic<uint64_t> count{0};
+        std::atomic<int64_t> total_us{0};
+        std::atomic<int64_t> max_us{0};
+        std::array<std::atomic<uint64_t>, LATENCY_BOUNDS_US.size() + 1> latency_histogram{};
+    };
+    std::array<OpCounters, NUM_OPS> m_ops;
+    std::atomic<uint64_t> m_read_misses{0};
+    std::atomic<uint64_t> m_batch_bytes{0};
+    std::array<std::atomic<uint64_t>, BATCH_SIZE_BOUNDS.size() + 1> m_batch_size_histogram{};
+};
+
+/** Compaction statistics of one level of a database, as reported in "leveldb.stats" */
+struct DBLevelStats {
+    int level{0};
+    int files{0};
+    double size_mb{0};
+    double time_sec{0};
+    double read_mb{0};
+    double write_mb{0};
+};
+
+/** Parse the compaction table of LevelDB's "leveldb.stats" property, levels without compactions or files are left out */
+std::vector<DBLevelStats> ParseDBCompactionStats(const std::string& stats);
+
+/**
+ * Read the -dbprofile options, each of them setting some of the DBProfile fields of a database:
+ * <db>:<key>=<value>[,<key>=<value>...]. Returns false with an error message if one is malformed.
+ */
+bool ReadDBProfiles(const ArgsManager& args, std::map<std::string, DBProfile>& profiles, std::string& error);
+
 /** These should be considered an implementation detail of the specific database.
  */
 namespace dbwrapper_private {
@@ -150,10 +241,7 @@ public:
         Seek(ssKey);
     }
 
-    void Seek(const CDataStream& ssKey) {
-        leveldb::Slice slKey((const char*)ssKey.data(), ssKey.size());
-        piter->Seek(slKey);
-    }
+    void Seek(const CDataStream& ssKey);
 
     void Next();
 
@@ -188,6 +276,13 @@ public:
         return true;
     }
 
+    CDataStream GetValue() {
+        leveldb::Slice slValue = piter->value();
+        CDataStream ssValue{MakeByteSpan(slValue), SER_DISK, CLIENT_VERSION};
+        ssValue.Xor(dbwrapper_private::GetObfuscateKey(parent));
+        return ssValue;
+    }
+
     unsigned int GetValueSize() {
         return piter->value().size();
     }
@@ -222,6 +317,12 @@ private:
     //! the name of this database
     std::string m_name;
 
+    //! the LevelDB settings of this database
+    DBProfile m_profile;
+
+    //! operation counters of this database
+    mutable DBMetrics m_metrics;
+
     //! a key used for optional XOR-obfuscation of the database
     std::vector<unsigned char> obfuscate_key;
 
@@ -262,10 +363,14 @@ public:
         leveldb::Slice slKey((const char*)ssKey.data(), ssKey.size());
 
         std::string strValue;
+        const auto start{SteadyClock::now()};
         leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        RecordOperation(DBMetrics::Op::READ, start);
         if (!status.ok()) {
-            if (status.IsNotFound())
+            if (status.IsNotFound()) {
+                m_metrics.RecordReadMiss();
                 return false;
+            }
             LogPrintf("LevelDB read failure: %s\n", status.ToString());
             dbwrapper_private::HandleError(status);
         }
@@ -322,7 +427,9 @@ public:
         leveldb::Slice slKey((const char*)key.data(), key.size());
 
         std::string strValue;
+        const auto start{SteadyClock::now()};
         leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        RecordOperation(DBMetrics::Op::EXISTS, start);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -345,6 +452,16 @@ public:
     // Get an estimate of LevelDB memory usage (in bytes).
     size_t DynamicMemoryUsage() const;
 
+    const std::string& GetName() const { return m_name; }
+    const DBProfile& GetProfile() const { return m_profile; }
+
+    //! Value of a LevelDB property like "leveldb.stats", nullopt if it doesn't exist
+    std::optional<std::string> GetProperty(const std::string& property) const;
+
+    const DBMetrics& GetMetrics() const { return m_metrics; }
+    //! Account for an operation started at start, logging it if it was slow
+    void RecordOperation(DBMetrics::Op op, SteadyClock::time_point start) const;
+
     CDBIterator *NewIterator()
     {
         return new CDBIterator(*this, pdb->NewIterator(iteroptions));
@@ -394,6 +511,9 @@ public:
 
 };
 
+/** Call func for each open database, none of them is closed until it returns */
+void ForEachDBWrapper(const std::function<void(const CDBWrapper&)>& func);
+
 template<typename CDBTransaction>
 class CDBTransactionIterator
 {
@@ -6,6 +6,8 @@
 
 #include <uint256.h>
 
+#include <set>
+
 CEvoDBScopedCommitter::CEvoDBScopedCommitter(CEvoDB &_evoDB) :
     evoDB(_evoDB)
 {
@@ -61,18 +63,34 @@ bool CEvoDB::CommitRootTransaction()
     return ret;
 }
 
-bool CEvoDB::VerifyBestBlock(const uint256& hash)
+bool CEvoDB::VerifyBestBlock(const uint256& hash, const std::string& key)
 {
     // Make sure evodb is consistent.
     // If we already have best block hash saved, the previous block should match it.
     uint256 hashBestBlock;
-    if (!Read(EVODB_BEST_BLOCK, hashBestBlock)) {
+    if (!Read(key, hashBestBlock)) {
         return false;
     }
     return hashBestBlock == hash;
 }
 
-void CEvoDB::WriteBestBlock(const uint256& hash)
+void CEvoDB::WriteBestBlock(const uint256& hash, const std::string& key)
+{
+    Write(key, hash);
+}
+
+bool IsEvoDBChainStateKey(CDataStream key)
 {
-    Write(EVODB_BEST_BLOCK, hash);
+    // Prefixes of the CDeterministicMNManager, CCreditPoolManager, CMNHFManager, CQuorumBlockProcessor
+    // and CQuorumSnapshotManager entries
+    static const std::set<std::string> chain_state_prefixes{
+        "dmn_S3", "dmn_D3", "cpm_S", "mnhf_s", "q_mc", "q_mcih", "q_mcihi", "llmq_S",
+    };
+    std::string prefix;
+    try {
+        key >> prefix;
+    } catch (const std::exception&) {
+        return false;
+    }
+    return chain_state_prefixes.count(prefix) > 0;
 }
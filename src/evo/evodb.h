@@ -14,6 +14,16 @@ class uint256;
 // "b_b3" was used after masternode type introduction in evoDB
 // "b_b4" was used after storing protx version for each masternode in evoDB
 static const std::string EVODB_BEST_BLOCK = "b_b4";
+// Best block of a chainstate loaded from a UTXO snapshot, kept apart from EVODB_BEST_BLOCK while
+// the background chainstate still validates the blocks below the snapshot base
+static const std::string EVODB_SNAPSHOT_BEST_BLOCK = "b_b4s";
+
+/**
+ * Whether a raw EvoDB key holds chain state that follows from the blocks alone, i.e. masternode
+ * lists, mined quorum commitments, quorum snapshots, the credit pool and EHF signals. Best block
+ * markers and node-local data like the quorum secret key shares of a masternode don't.
+ */
+bool IsEvoDBChainStateKey(CDataStream key);
 
 class CEvoDB;
 
@@ -102,8 +112,8 @@ public:
 
     bool IsEmpty() { return db.IsEmpty(); }
 
-    bool VerifyBestBlock(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(!cs);
-    void WriteBestBlock(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(!cs);
+    bool VerifyBestBlock(const uint256& hash, const std::string& key = EVODB_BEST_BLOCK) EXCLUSIVE_LOCKS_REQUIRED(!cs);
+    void WriteBestBlock(const uint256& hash, const std::string& key = EVODB_BEST_BLOCK) EXCLUSIVE_LOCKS_REQUIRED(!cs);
 
 private:
     // only CEvoDBScopedCommitter is allowed to invoke these
@@ -190,6 +190,14 @@ PeerMsgRet CMNAuth::ProcessMessage(CNode& peer, CConnman& connman, CMasternodeMe
         peer.m_masternode_iqr_connection = true;
     }
 
+    if (mn_activeman != nullptr && peer.GetCommonVersion() >= CRC32C_CHECKSUM_PROTO_VERSION &&
+        (!peer.m_v2_transport || peer.m_v2_transport->IsV1())) {
+        // Masternode to masternode traffic is mostly small signing messages where the double SHA256
+        // checksum is a noticeable cost. Everything we send after this is checksummed with CRC32C,
+        // the peer's transport switches as soon as it reads the message.
+        connman.PushMessage(&peer, CNetMsgMaker(peer.GetCommonVersion()).Make(NetMsgType::SENDCRC32C));
+    }
+
     LogPrint(BCLog::NET_NETCONN, "CMNAuth::%s -- Valid MNAUTH for %s, peer=%d\n", __func__, mnauth.proRegTxHash.ToString(), peer.GetId());
     return {};
 }
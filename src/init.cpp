@@ -19,6 +19,7 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <context.h>
+#include <dbwrapper.h>
 #include <deploymentstatus.h>
 #include <node/coinstats.h>
 #include <fs.h>
@@ -39,6 +40,7 @@
 #include <netbase.h>
 #include <node/blockstorage.h>
 #include <node/context.h>
+#include <node/txreconciliation.h>
 #include <node/ui_interface.h>
 #include <policy/feerate.h>
 #include <policy/fees.h>
@@ -261,6 +263,8 @@ void PrepareShutdown(NodeContext& node)
     // Thus the implicit locking order requirement is: (1) cs_main, (2) g_cs_orphans, (3) cs_vNodes.
     if (node.connman) {
         node.connman->StopThreads();
+        // Workers may still hold peers, let them finish before the nodes are deleted
+        if (node.peerman) node.peerman->StopMessageWorkers();
         LOCK2(::cs_main, ::g_cs_orphans);
         node.connman->StopNodes();
     }
@@ -272,6 +276,7 @@ void PrepareShutdown(NodeContext& node)
     if (node.scheduler) node.scheduler->stop();
     if (node.chainman && node.chainman->m_load_block.joinable()) node.chainman->m_load_block.join();
     StopScriptCheckWorkerThreads();
+    StopInputPrefetchThreads();
 
     // After there are no more peers/RPC left to give us new data which may generate
     // CValidationInterface callbacks, flush them...
@@ -478,6 +483,9 @@ std::string GetSupportedSocketEventsStr()
 #endif
 #ifdef USE_KQUEUE
     strSupportedModes += ", 'kqueue'";
+#endif
+#ifdef USE_IO_URING
+    strSupportedModes += ", 'iouring'";
 #endif
     return strSupportedModes;
 }
@@ -510,22 +518,30 @@ void SetupServerArgs(NodeContext& node)
     argsman.AddArg("-alertnotify=<cmd>", "Execute command when an alert is raised (%s in cmd is replaced by message)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #endif
     argsman.AddArg("-assumevalid=<hex>", strprintf("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s)", defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex()), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-blockfilemmap", strprintf("Read blocks through read-only memory mappings of the block files (default: %u)", DEFAULT_BLOCK_FILE_MMAP), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-blocksdir=<dir>", "Specify directory to hold blocks subdirectory for *.dat files (default: <datadir>)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-fastprune", "Use smaller block files and lower minimum prune height for testing purposes", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
 #if HAVE_SYSTEM
     argsman.AddArg("-blocknotify=<cmd>", "Execute command when the best block changes (%s in cmd is replaced by block hash)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #endif
     argsman.AddArg("-blockreconstructionextratxn=<n>", strprintf("Extra transactions to keep in memory for compact block reconstructions (default: %u)", DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-blockreconstructionhinttxn=<n>", strprintf("Recently IS-locked and evicted transactions to keep in memory as compact block reconstruction hints (default: %u)", DEFAULT_BLOCK_RECONSTRUCTION_HINT_TXN), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-blocksonly", strprintf("Whether to reject transactions from network peers. Automatic broadcast and rebroadcast of any transactions from inbound peers is disabled, unless the peer has the 'forcerelay' permission. RPC transactions are not affected. (default: %u)", DEFAULT_BLOCKSONLY), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #if HAVE_SYSTEM
     argsman.AddArg("-chainlocknotify=<cmd>", "Execute command when the best chainlock changes (%s in cmd is replaced by chainlocked block hash)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #endif
     argsman.AddArg("-coinstatsindex", strprintf("Maintain coinstats index used by the gettxoutsetinfo RPC (default: %u)", DEFAULT_COINSTATSINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-coinscachepool", strprintf("Allocate the in-memory UTXO set from pooled memory chunks instead of one heap allocation per coin, packing more coins into -dbcache (default: %u)", DEFAULT_COINS_CACHE_POOL), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-conf=<file>", strprintf("Specify path to read-only configuration file. Relative paths will be prefixed by datadir location. (default: %s)", BITCOIN_CONF_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-datadir=<dir>", "Specify data directory", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
     argsman.AddArg("-dbcache=<n>", strprintf("Maximum database cache size <n> MiB (%d to %d, default: %d). In addition, unused mempool memory is shared for this cache (see -maxmempool).", nMinDbCache, nMaxDbCache, nDefaultDbCache), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-dbprofile=<db>:<key>=<value>[,...]", "Set LevelDB parameters of database <db> (chainstate, index for the block index, evodb, isdb, recsigdb, dkgdb, txindex, coinstats, basic for the block filter index). "
+                   "Keys are blockcache (share of its cache used as block cache in percent, the rest goes to the write buffers, 10 to 90, default: 50), blocksize (bytes, default: 4096), "
+                   "bloombits (bloom filter bits per key, 0 for none, default: 10), compression (0 or 1, only effective if LevelDB was built with Snappy, default: 0) and maxfilesize (bytes, default: 2097152). "
+                   "Can be specified multiple times", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-debuglogfile=<file>", strprintf("Specify location of debug log file. Relative paths will be prefixed by a net-specific datadir location. (-nodebuglogfile to disable; default: %s)", DEFAULT_DEBUGLOGFILE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-incrementalflush=<n>", strprintf("Write the UTXO cache to disk in chunks of about <n> MiB per block while validation continues, instead of all at once. Memory of coins waiting to be written comes on top of -dbcache. Ignored when pruning (0 to disable, default: %d)", DEFAULT_INCREMENTAL_FLUSH), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-includeconf=<file>", "Specify additional configuration file, relative to the -datadir path (only useable from configuration file, not command line)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-loadblock=<file>", "Imports blocks from external file on startup", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-maxmempool=<n>", strprintf("Keep the transaction memory pool below <n> megabytes (default: %u)", DEFAULT_MAX_MEMPOOL_SIZE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -533,10 +549,13 @@ void SetupServerArgs(NodeContext& node)
     argsman.AddArg("-maxrecsigsage=<n>", strprintf("Number of seconds to keep LLMQ recovery sigs (default: %u)", llmq::DEFAULT_MAX_RECOVERED_SIGS_AGE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-mempoolexpiry=<n>", strprintf("Do not keep transactions in the mempool longer than <n> hours (default: %u)", DEFAULT_MEMPOOL_EXPIRY), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex()), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-mnsyncparallel", strprintf("Start governance sync as soon as the best header is reached and request it from several peers at once (default: %u)", DEFAULT_MNSYNC_PARALLEL), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-mnsyncpeers=<n>", strprintf("Number of peers to request governance data from per sync tick with -mnsyncparallel (1 to %d, default: %d)", MAX_MNSYNC_PEERS, DEFAULT_MNSYNC_PEERS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-pid=<file>", strprintf("Specify pid file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)", BITCOIN_PID_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-prefetchthreads=<n>", strprintf("Set the number of threads reading the coins spent by a block from disk in parallel before it is connected (0 to %d, default: %d)", MAX_PREFETCH_THREADS, DEFAULT_PREFETCH_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-prune=<n>", strprintf("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex, -coinstatsindex, -rescan and -disablegovernance=false. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >%u = automatically prune block files to stay under the specified target size in MiB)", MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -555,6 +574,7 @@ void SetupServerArgs(NodeContext& node)
     argsman.AddArg("-addressindex", strprintf("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)", DEFAULT_ADDRESSINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::INDEXING);
     argsman.AddArg("-reindex", "Rebuild chain state and block index from the blk*.dat files on disk", ArgsManager::ALLOW_ANY, OptionsCategory::INDEXING);
     argsman.AddArg("-reindex-chainstate", "Rebuild chain state from the currently indexed blocks. When in pruning mode or if blocks on disk might be corrupted, use full -reindex instead.", ArgsManager::ALLOW_ANY, OptionsCategory::INDEXING);
+    argsman.AddArg("-reindexthreads=<n>", strprintf("Set the number of threads deserializing and checking blocks ahead of their import during -reindex and -loadblock (0 to %d, 0 imports them on one thread, default: %d)", MAX_REINDEX_THREADS, DEFAULT_REINDEX_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::INDEXING);
     argsman.AddArg("-spentindex", strprintf("Maintain a full spent index, used to query the spending txid and input index for an outpoint (default: %u)", DEFAULT_SPENTINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::INDEXING);
     argsman.AddArg("-timestampindex", strprintf("Maintain a timestamp index for block hashes, used to query blocks hashes by a range of timestamps (default: %u)", DEFAULT_TIMESTAMPINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::INDEXING);
     argsman.AddArg("-txindex", strprintf("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)", DEFAULT_TXINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::INDEXING);
@@ -595,8 +615,12 @@ void SetupServerArgs(NodeContext& node)
     argsman.AddArg("-proxy=<ip:port>", "Connect through SOCKS5 proxy, set -noproxy to disable (default: disabled)", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     argsman.AddArg("-proxyrandomize", strprintf("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)", DEFAULT_PROXYRANDOMIZE), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     argsman.AddArg("-seednode=<ip>", "Connect to a node to retrieve peer addresses, and disconnect. This option can be specified multiple times to connect to multiple nodes.", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
-    argsman.AddArg("-socketevents=<mode>", "Socket events mode, which must be one of 'select', 'poll', 'epoll' or 'kqueue', depending on your system (default: Linux - 'epoll', FreeBSD/Apple - 'kqueue', Windows - 'select')", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+    argsman.AddArg("-socketevents=<mode>", "Socket events mode, which must be one of 'select', 'poll', 'epoll', 'iouring' or 'kqueue', depending on your system (default: Linux - 'epoll', FreeBSD/Apple - 'kqueue', Windows - 'select')", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+    argsman.AddArg("-msghandlerthreads=<n>", strprintf("Number of worker threads processing signature shares, recovered signatures, islocks, governance votes and dsq messages of different peers concurrently, 0 processes everything on the message handler thread (0-%d, default: %d)", MAX_MSGHANDLER_THREADS, DEFAULT_MSGHANDLER_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+    argsman.AddArg("-socketthreads=<n>", strprintf("Number of threads servicing peer sockets, connections are spread evenly among them (1-%d, default: %d)", MAX_SOCKET_THREADS, DEFAULT_SOCKET_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     argsman.AddArg("-networkactive", "Enable all P2P network activity (default: 1). Can be changed by the setnetworkactive RPC command", ArgsManager::ALLOW_BOOL, OptionsCategory::CONNECTION);
+    argsman.AddArg("-txreconciliation", strprintf("Relay transactions to peers that signal NODE_TXRECON through periodic set reconciliation instead of announcing each of them, not used by masternodes (default: %u)", DEFAULT_TXRECONCILIATION_ENABLE), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+    argsman.AddArg("-v2transport", strprintf("Support BIP324 v2 encrypted transport connections, signalled with NODE_P2P_V2. Outbound v2 connections are only made to peers that signal it (default: %u)", DEFAULT_V2_TRANSPORT), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     argsman.AddArg("-timeout=<n>", strprintf("Specify socket connection timeout in milliseconds. If an initial attempt to connect is unsuccessful after this amount of time, drop it (minimum: 1, default: %d)", DEFAULT_CONNECT_TIMEOUT), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     argsman.AddArg("-torcontrol=<ip>:<port>", strprintf("Tor control port to use if onion listening enabled (default: %s)", DEFAULT_TOR_CONTROL), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     argsman.AddArg("-torpassword=<pass>", "Tor control port password (default: empty)", ArgsManager::ALLOW_ANY | ArgsManager::SENSITIVE, OptionsCategory::CONNECTION);
@@ -743,6 +767,7 @@ void SetupServerArgs(NodeContext& node)
 
     SetupChainParamsBaseOptions(argsman);
 
+    argsman.AddArg("-coinjoinserversessions=<n>", strprintf("Number of CoinJoin mixing sessions with different denominations a masternode can run at once (%u-%u, default: %u)", 1, MAX_COINJOIN_SERVER_SESSIONS, DEFAULT_COINJOIN_SERVER_SESSIONS), ArgsManager::ALLOW_ANY, OptionsCategory::MASTERNODE);
     argsman.AddArg("-llmq-data-recovery=<n>", strprintf("Enable automated quorum data recovery (default: %u)", llmq::DEFAULT_ENABLE_QUORUM_DATA_RECOVERY), ArgsManager::ALLOW_ANY, OptionsCategory::MASTERNODE);
     argsman.AddArg("-llmq-qvvec-sync=<quorum_name>:<mode>", strprintf("Defines from which LLMQ type the masternode should sync quorum verification vectors. Can be used multiple times with different LLMQ types. <mode>: %d (sync always from all quorums of the type defined by <quorum_name>), %d (sync from all quorums of the type defined by <quorum_name> if a member of any of the quorums)", (int32_t)llmq::QvvecSyncMode::Always, (int32_t)llmq::QvvecSyncMode::OnlyIfTypeMember), ArgsManager::ALLOW_ANY, OptionsCategory::MASTERNODE);
     argsman.AddArg("-masternodeblsprivkey=<hex>", "Set the masternode BLS private key and enable the client to act as a masternode", ArgsManager::ALLOW_ANY | ArgsManager::SENSITIVE, OptionsCategory::MASTERNODE);
@@ -924,6 +949,27 @@ static void PeriodicStats(ArgsManager& args, ChainstateManager& chainman, const
     // No need for cs_main, we never use null tip here
     statsClient.gaugeDouble("network.difficulty", (double)GetDifficulty(tip));
 
+    ForEachDBWrapper([](const CDBWrapper& db) {
+        if (db.GetName().empty()) return;
+        const std::string prefix{"leveldb." + db.GetName()};
+        const DBMetrics& metrics = db.GetMetrics();
+        for (const auto op : {DBMetrics::Op::READ, DBMetrics::Op::EXISTS, DBMetrics::Op::WRITE_BATCH, DBMetrics::Op::SEEK}) {
+            const DBMetrics::OpStats op_stats{metrics.GetOpStats(op)};
+            const std::string op_prefix{prefix + "." + DBMetrics::OpName(op)};
+            statsClient.gauge(op_prefix + ".count", op_stats.count, 1.0f);
+            statsClient.gauge(op_prefix + ".totalTimeUs", count_microseconds(op_stats.total), 1.0f);
+            statsClient.gauge(op_prefix + ".maxTimeUs", count_microseconds(op_stats.max), 1.0f);
+        }
+        statsClient.gauge(prefix + ".readMisses", metrics.GetReadMisses(), 1.0f);
+        statsClient.gauge(prefix + ".batchBytes", metrics.GetBatchBytes(), 1.0f);
+        statsClient.gauge(prefix + ".memoryUsageBytes", db.DynamicMemoryUsage(), 1.0f);
+        double compaction_time_sec{0};
+        for (const DBLevelStats& level : ParseDBCompactionStats(db.GetProperty("leveldb.stats").value_or(""))) {
+            compaction_time_sec += level.time_sec;
+        }
+        statsClient.gaugeDouble(prefix + ".compactionTimeSec", compaction_time_sec);
+    });
+
     statsClient.gauge("transactions.txCacheSize", WITH_LOCK(cs_main, return chainman.ActiveChainstate().CoinsTip().GetCacheSize()), 1.0f);
     statsClient.gauge("transactions.totalTransactions", tip->nChainTx, 1.0f);
 
@@ -1314,6 +1360,15 @@ bool AppInitParameterInteraction(const ArgsManager& args)
 
     fCheckBlockIndex = args.GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = args.GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
+    g_coins_cache_pool = args.GetBoolArg("-coinscachepool", DEFAULT_COINS_CACHE_POOL);
+    g_block_file_mmap = args.GetBoolArg("-blockfilemmap", DEFAULT_BLOCK_FILE_MMAP);
+    {
+        std::map<std::string, DBProfile> db_profiles;
+        std::string error;
+        if (!ReadDBProfiles(args, db_profiles, error)) {
+            return InitError(Untranslated(error));
+        }
+    }
 
     hashAssumeValid = uint256S(args.GetArg("-assumevalid", chainparams.GetConsensus().defaultAssumeValid.GetHex()));
     if (!hashAssumeValid.IsNull())
@@ -1434,6 +1489,12 @@ bool AppInitParameterInteraction(const ArgsManager& args)
     if (args.GetBoolArg("-peerbloomfilters", DEFAULT_PEERBLOOMFILTERS))
         nLocalServices = ServiceFlags(nLocalServices | NODE_BLOOM);
 
+    if (args.GetBoolArg("-v2transport", DEFAULT_V2_TRANSPORT))
+        nLocalServices = ServiceFlags(nLocalServices | NODE_P2P_V2);
+
+    if (args.GetBoolArg("-txreconciliation", DEFAULT_TXRECONCILIATION_ENABLE) && !args.IsArgSet("-masternodeblsprivkey"))
+        nLocalServices = ServiceFlags(nLocalServices | NODE_TXRECON);
+
     nMaxTipAge = args.GetArg("-maxtipage", DEFAULT_MAX_TIP_AGE);
 
     if (args.IsArgSet("-proxy") && args.GetArg("-proxy", "").empty()) {
@@ -1611,6 +1672,12 @@ bool AppInitMain(const CoreContext& context, NodeContext& node, interfaces::Bloc
         StartScriptCheckWorkerThreads(script_threads);
     }
 
+    const int prefetch_threads = std::clamp<int>(args.GetArg("-prefetchthreads", DEFAULT_PREFETCH_THREADS), 0, MAX_PREFETCH_THREADS);
+    LogPrintf("Input prefetching uses %d threads\n", prefetch_threads);
+    if (prefetch_threads >= 1) {
+        StartInputPrefetchThreads(prefetch_threads);
+    }
+
     assert(!node.scheduler);
     node.scheduler = std::make_unique<CScheduler>();
 
@@ -2263,7 +2330,7 @@ bool AppInitMain(const CoreContext& context, NodeContext& node, interfaces::Bloc
     // ********************************************************* Step 7c: Setup CoinJoin
 
     node.cj_ctx = std::make_unique<CJContext>(chainman.ActiveChainstate(), *node.connman, *node.dmnman, *node.mn_metaman, *node.mempool,
-                                              node.mn_activeman.get(), *node.sporkman, *node.mn_sync, node.peerman, !ignores_incoming_txs);
+                                              node.mn_activeman.get(), *node.sporkman, *node.mn_sync, *node.llmq_ctx->bls_worker, node.peerman, !ignores_incoming_txs);
 
 #ifdef ENABLE_WALLET
     node.coinjoin_loader = interfaces::MakeCoinJoinLoader(*node.cj_ctx->walletman);
@@ -2582,6 +2649,8 @@ bool AppInitMain(const CoreContext& context, NodeContext& node, interfaces::Bloc
         return InitError(strprintf(_("Invalid -socketevents ('%s') specified. Only these modes are supported: %s"), sem_str, GetSupportedSocketEventsStr()));
     }
     connOptions.socketEventsMode = sem;
+    connOptions.nSocketThreads = std::clamp<int>(args.GetArg("-socketthreads", DEFAULT_SOCKET_THREADS), 1, MAX_SOCKET_THREADS);
+    connOptions.m_use_v2transport = args.GetBoolArg("-v2transport", DEFAULT_V2_TRANSPORT);
 
     const std::string& i2psam_arg = args.GetArg("-i2psam", "");
     if (!i2psam_arg.empty()) {
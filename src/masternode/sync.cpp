@@ -14,11 +14,15 @@
 #include <util/time.h>
 #include <util/translation.h>
 
+#include <algorithm>
+
 class CMasternodeSync;
 
 CMasternodeSync::CMasternodeSync(CConnman& _connman, CNetFulfilledRequestManager& netfulfilledman, const CGovernanceManager& govman) :
     nTimeAssetSyncStarted(GetTime()),
     nTimeLastBumped(GetTime()),
+    fParallel(gArgs.GetBoolArg("-mnsyncparallel", DEFAULT_MNSYNC_PARALLEL)),
+    nSyncPeers(std::clamp<int>(gArgs.GetArg("-mnsyncpeers", DEFAULT_MNSYNC_PEERS), 1, MAX_MNSYNC_PEERS)),
     connman(_connman),
     m_netfulfilledman(netfulfilledman),
     m_govman(govman)
@@ -39,6 +43,12 @@ void CMasternodeSync::Reset(bool fForce, bool fNotifyReset)
     nTimeLastBumped = GetTime();
     nTimeLastUpdateBlockTip = 0;
     fReachedBestHeader = false;
+    fGovernanceSyncStarted = false;
+    nTimeGovernanceSyncStarted = 0;
+    nTimeGovernanceSyncFinished = 0;
+    nGovernanceSyncRequests = 0;
+    nGovernanceObjectsReceived = 0;
+    nGovernanceVotesReceived = 0;
     if (fNotifyReset) {
         uiInterface.NotifyAdditionalDataSyncProgressChanged(-1);
     }
@@ -62,20 +72,38 @@ std::string CMasternodeSync::GetAssetName() const
     }
 }
 
+int64_t CMasternodeSync::GetGovernanceSyncDuration() const
+{
+    if (nTimeGovernanceSyncStarted == 0) return 0;
+    const int64_t nTimeEnd = nTimeGovernanceSyncFinished != 0 ? nTimeGovernanceSyncFinished.load() : GetTime();
+    return std::max<int64_t>(nTimeEnd - nTimeGovernanceSyncStarted, 0);
+}
+
 void CMasternodeSync::SwitchToNextAsset()
 {
     assert(m_netfulfilledman.IsValid());
 
+    // Peers asked for governance data during the overlap with blockchain sync still count as tried
+    bool fKeepTriedPeerCount{false};
+
     switch(nCurrentAsset)
     {
         case(MASTERNODE_SYNC_BLOCKCHAIN):
             LogPrintf("CMasternodeSync::SwitchToNextAsset -- Completed %s in %llds\n", GetAssetName(), GetTime() - nTimeAssetSyncStarted);
             nCurrentAsset = MASTERNODE_SYNC_GOVERNANCE;
+            if (fGovernanceSyncStarted.exchange(true)) {
+                fKeepTriedPeerCount = true;
+            } else {
+                nTimeGovernanceSyncStarted = GetTime();
+            }
             LogPrintf("CMasternodeSync::SwitchToNextAsset -- Starting %s\n", GetAssetName());
             break;
         case(MASTERNODE_SYNC_GOVERNANCE):
             LogPrintf("CMasternodeSync::SwitchToNextAsset -- Completed %s in %llds\n", GetAssetName(), GetTime() - nTimeAssetSyncStarted);
             nCurrentAsset = MASTERNODE_SYNC_FINISHED;
+            nTimeGovernanceSyncFinished = GetTime();
+            LogPrintf("CMasternodeSync::SwitchToNextAsset -- Governance sync received %d objects and %d votes from %d peers in %llds\n",
+                      nGovernanceObjectsReceived, nGovernanceVotesReceived, nGovernanceSyncRequests, GetGovernanceSyncDuration());
             uiInterface.NotifyAdditionalDataSyncProgressChanged(1);
 
             connman.ForEachNode(CConnman::AllNodes, [this](const CNode* pnode) {
@@ -85,7 +113,9 @@ void CMasternodeSync::SwitchToNextAsset()
 
             break;
     }
-    nTriedPeerCount = 0;
+    if (!fKeepTriedPeerCount) {
+        nTriedPeerCount = 0;
+    }
     nTimeAssetSyncStarted = GetTime();
     BumpAssetLastTime("CMasternodeSync::SwitchToNextAsset");
 }
@@ -134,7 +164,8 @@ void CMasternodeSync::ProcessTick()
         return;
     }
 
-    if(GetTime() - nTimeLastProcess < MASTERNODE_SYNC_TICK_SECONDS) {
+    const int nTickSeconds = fParallel ? MASTERNODE_SYNC_PARALLEL_TICK_SECONDS : MASTERNODE_SYNC_TICK_SECONDS;
+    if(GetTime() - nTimeLastProcess < nTickSeconds) {
         // too early, nothing to do here
         return;
     }
@@ -153,6 +184,17 @@ void CMasternodeSync::ProcessTick()
     LogPrint(BCLog::MNSYNC, "CMasternodeSync::ProcessTick -- nTick %d nCurrentAsset %d nTriedPeerCount %d nSyncProgress %f\n", nTick, nCurrentAsset, nTriedPeerCount, nSyncProgress);
     uiInterface.NotifyAdditionalDataSyncProgressChanged(nSyncProgress);
 
+    if (fParallel && nCurrentAsset == MASTERNODE_SYNC_BLOCKCHAIN && fReachedBestHeader && !fGovernanceSyncStarted && m_govman.IsValid()) {
+        // We are at the best header and only wait for the chain to settle,
+        // no need to keep governance sync waiting for that too
+        fGovernanceSyncStarted = true;
+        nTimeGovernanceSyncStarted = GetTime();
+        LogPrintf("CMasternodeSync::ProcessTick -- nTick %d nCurrentAsset %d -- starting governance sync in parallel\n", nTick, nCurrentAsset);
+    }
+    // Governance requests go out either in the governance asset or during the blockchain tail in parallel mode
+    const bool fSyncGovernance = nCurrentAsset == MASTERNODE_SYNC_GOVERNANCE || (nCurrentAsset == MASTERNODE_SYNC_BLOCKCHAIN && fGovernanceSyncStarted);
+    int nGovernanceRequestsLeft = fParallel ? nSyncPeers : 1;
+
     for (auto& pnode : snap.Nodes())
     {
         CNetMsgMaker msgMaker(pnode->GetCommonVersion());
@@ -218,7 +260,7 @@ void CMasternodeSync::ProcessTick()
 
             // GOVOBJ : SYNC GOVERNANCE ITEMS FROM OUR PEERS
 
-            if(nCurrentAsset == MASTERNODE_SYNC_GOVERNANCE) {
+            if (fSyncGovernance) {
                 if (!m_govman.IsValid()) {
                     SwitchToNextAsset();
                     return;
@@ -226,7 +268,7 @@ void CMasternodeSync::ProcessTick()
                 LogPrint(BCLog::GOBJECT, "CMasternodeSync::ProcessTick -- nTick %d nCurrentAsset %d nTimeLastBumped %lld GetTime() %lld diff %lld\n", nTick, nCurrentAsset, nTimeLastBumped, GetTime(), GetTime() - nTimeLastBumped);
 
                 // check for timeout first
-                if(GetTime() - nTimeLastBumped > MASTERNODE_SYNC_TIMEOUT_SECONDS) {
+                if (nCurrentAsset == MASTERNODE_SYNC_GOVERNANCE && GetTime() - nTimeLastBumped > MASTERNODE_SYNC_TIMEOUT_SECONDS) {
                     LogPrint(BCLog::MNSYNC, "CMasternodeSync::ProcessTick -- nTick %d nCurrentAsset %d -- timeout\n", nTick, nCurrentAsset);
                     if(nTriedPeerCount == 0) {
                         LogPrintf("CMasternodeSync::ProcessTick -- WARNING: failed to sync %s\n", GetAssetName());
@@ -245,16 +287,18 @@ void CMasternodeSync::ProcessTick()
                 m_netfulfilledman.AddFulfilledRequest(pnode->addr, "governance-sync");
 
                 nTriedPeerCount++;
+                nGovernanceSyncRequests++;
 
                 SendGovernanceSyncRequest(pnode);
 
-                break; //this will cause each peer to get one request each six seconds for the various assets we need
+                // this will cause one (or -mnsyncpeers in parallel mode) peer(s) to get a request each tick for the various assets we need
+                if (--nGovernanceRequestsLeft == 0) break;
             }
         }
     }
 
 
-    if (nCurrentAsset != MASTERNODE_SYNC_GOVERNANCE) {
+    if (!fSyncGovernance) {
         // looped through all nodes and not syncing governance yet/already, release them
         return;
     }
@@ -270,6 +314,8 @@ void CMasternodeSync::ProcessTick()
             static int64_t nTimeNoObjectsLeft = 0;
             static int nLastTick = 0;
             static int nLastVotes = 0;
+            // the blockchain asset has to complete before governance can be considered done
+            if (nCurrentAsset != MASTERNODE_SYNC_GOVERNANCE) continue;
             if(nTimeNoObjectsLeft == 0) {
                 // asked all objects for votes for the first time
                 nTimeNoObjectsLeft = GetTime();
@@ -277,10 +323,10 @@ void CMasternodeSync::ProcessTick()
             // make sure the condition below is checked only once per tick
             if(nLastTick == nTick) continue;
             if(GetTime() - nTimeNoObjectsLeft > MASTERNODE_SYNC_TIMEOUT_SECONDS &&
-                m_govman.GetVoteCount() - nLastVotes < std::max(int(0.0001 * nLastVotes), MASTERNODE_SYNC_TICK_SECONDS)
+                m_govman.GetVoteCount() - nLastVotes < std::max(int(0.0001 * nLastVotes), nTickSeconds)
             ) {
                 // We already asked for all objects, waited for MASTERNODE_SYNC_TIMEOUT_SECONDS
-                // after that and less then 0.01% or MASTERNODE_SYNC_TICK_SECONDS
+                // after that and less then 0.01% or nTickSeconds
                 // (i.e. 1 per second) votes were received during the last tick.
                 // We can be pretty sure that we are done syncing.
                 LogPrintf("CMasternodeSync::ProcessTick -- nTick %d nCurrentAsset %d -- asked for all objects, nothing to do\n", nTick, MASTERNODE_SYNC_GOVERNANCE);
@@ -25,10 +25,20 @@ static constexpr int MASTERNODE_SYNC_FINISHED        = 999;
 static constexpr int MASTERNODE_SYNC_TICK_SECONDS    = 6;
 static constexpr int MASTERNODE_SYNC_TIMEOUT_SECONDS = 30; // our blocks are 2.5 minutes so 30 seconds should be fine
 static constexpr int MASTERNODE_SYNC_RESET_SECONDS   = 900; // Reset fReachedBestHeader in CMasternodeSync::Reset if UpdateBlockTip hasn't been called for this seconds
+static constexpr int MASTERNODE_SYNC_PARALLEL_TICK_SECONDS = 1;
+
+static constexpr bool DEFAULT_MNSYNC_PARALLEL{false};
+static constexpr int DEFAULT_MNSYNC_PEERS{3};
+static constexpr int MAX_MNSYNC_PEERS{16};
 
 //
 // CMasternodeSync : Sync masternode assets in stages
 //
+// With -mnsyncparallel governance sync starts as soon as the best header is
+// reached instead of waiting for the blockchain asset to time out, governance
+// sync requests fan out to up to -mnsyncpeers peers per tick and ticks run
+// every MASTERNODE_SYNC_PARALLEL_TICK_SECONDS.
+//
 
 class CMasternodeSync
 {
@@ -48,6 +58,16 @@ private:
     /// Last time UpdateBlockTip has been called
     std::atomic<int64_t> nTimeLastUpdateBlockTip{0};
 
+    const bool fParallel;
+    const int nSyncPeers;
+    /// Set once governance sync has been kicked off, possibly while still in MASTERNODE_SYNC_BLOCKCHAIN
+    std::atomic<bool> fGovernanceSyncStarted{false};
+    std::atomic<int64_t> nTimeGovernanceSyncStarted{0};
+    std::atomic<int64_t> nTimeGovernanceSyncFinished{0};
+    std::atomic<int> nGovernanceSyncRequests{0};
+    std::atomic<int64_t> nGovernanceObjectsReceived{0};
+    std::atomic<int64_t> nGovernanceVotesReceived{0};
+
     CConnman& connman;
     CNetFulfilledRequestManager& m_netfulfilledman;
     const CGovernanceManager& m_govman;
@@ -59,6 +79,9 @@ public:
 
     bool IsBlockchainSynced() const { return nCurrentAsset > MASTERNODE_SYNC_BLOCKCHAIN; }
     bool IsSynced() const { return nCurrentAsset == MASTERNODE_SYNC_FINISHED; }
+    /// Governance data can be accepted, either because the blockchain is synced or because parallel sync started it early
+    bool IsGovernanceSyncAllowed() const { return IsBlockchainSynced() || fGovernanceSyncStarted; }
+    bool IsParallel() const { return fParallel; }
 
     int GetAssetID() const { return nCurrentAsset; }
     int GetAttempt() const { return nTriedPeerCount; }
@@ -67,6 +90,15 @@ public:
     std::string GetAssetName() const;
     std::string GetSyncStatus() const;
 
+    void AddReceivedGovernanceObject() { if (!IsSynced()) ++nGovernanceObjectsReceived; }
+    void AddReceivedGovernanceVote() { if (!IsSynced()) ++nGovernanceVotesReceived; }
+    int64_t GetGovernanceSyncStartTime() const { return nTimeGovernanceSyncStarted; }
+    int GetGovernanceSyncRequests() const { return nGovernanceSyncRequests; }
+    int64_t GetGovernanceObjectsReceived() const { return nGovernanceObjectsReceived; }
+    int64_t GetGovernanceVotesReceived() const { return nGovernanceVotesReceived; }
+    /// Seconds spent syncing governance so far (or in total once finished), 0 if it hasn't started yet
+    int64_t GetGovernanceSyncDuration() const;
+
     void Reset(bool fForce = false, bool fNotifyReset = true);
     void SwitchToNextAsset();
 
@@ -7,6 +7,7 @@
 
 #include <indirectmap.h>
 #include <prevector.h>
+#include <support/allocators/pool.h>
 
 #include <stdlib.h>
 
@@ -167,6 +168,22 @@ static inline size_t DynamicUsage(const std::unordered_map<X, Y, Z>& m)
     return MallocUsage(sizeof(unordered_node<std::pair<const X, Y> >)) * m.size() + MallocUsage(sizeof(void*) * m.bucket_count());
 }
 
+template <class Key, class T, class Hash, class Pred, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+static inline size_t DynamicUsage(const std::unordered_map<Key, T, Hash, Pred, PoolAllocator<std::pair<const Key, T>, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>>& m)
+{
+    const auto* pool_resource = m.get_allocator().resource();
+    if (!pool_resource->IsPooled()) {
+        return MallocUsage(sizeof(unordered_node<std::pair<const Key, T> >)) * m.size() + MallocUsage(sizeof(void*) * m.bucket_count());
+    }
+
+    // Pooled memory is accounted by chunk, in use or not. The chunks are kept in a std::list,
+    // whose nodes hold the previous and next pointers and the chunk pointer.
+    const size_t estimated_list_node_size = MallocUsage(sizeof(void*) * 3);
+    const size_t usage_resource = estimated_list_node_size * pool_resource->NumAllocatedChunks();
+    const size_t usage_chunks = MallocUsage(pool_resource->ChunkSizeBytes()) * pool_resource->NumAllocatedChunks();
+    return usage_resource + usage_chunks + MallocUsage(sizeof(void*) * m.bucket_count());
+}
+
 }
 
 #endif // BITCOIN_MEMUSAGE_H
@@ -41,6 +41,8 @@
 
 #include <statsd_client.h>
 
+#include <crc32c/crc32c.h>
+
 #ifdef WIN32
 #include <string.h>
 #else
@@ -102,6 +104,14 @@ static constexpr std::chrono::seconds MAX_UPLOAD_TIMEFRAME{60 * 60 * 24};
 // A random time period (0 to 1 seconds) is added to feeler connections to prevent synchronization.
 static constexpr auto FEELER_SLEEP_WINDOW{1s};
 
+/** Maximum number of queued buffers handed to a single sendmsg() call, well below any IOV_MAX */
+static constexpr size_t MAX_SEND_BUFFERS_PER_CALL{64};
+
+/** Queued messages are framed and committed to the wire order while less than this is waiting to be sent.
+ *  Small enough that a high priority message never waits long behind committed low priority ones, large
+ *  enough to batch many small messages into one sendmsg() call. */
+static constexpr size_t SEND_WINDOW_SIZE{64 * 1024};
+
 /** Used to pass flags to the Bind() function */
 enum BindFlags {
     BF_NONE         = 0,
@@ -608,6 +618,9 @@ CNode* CConnman::ConnectNode(CAddress addrConnect, const char *pszDest, bool fCo
     if (!addr_bind.IsValid()) {
         addr_bind = GetBindAddress(*sock);
     }
+    // Only use v2 with peers known to support it, a v1 peer would drop the connection
+    const bool use_v2transport = m_use_v2transport && !pszDest &&
+                                 (addrConnect.nServices & NODE_P2P_V2);
     CNode* pnode = new CNode(id,
                              nLocalServices,
                              std::move(sock),
@@ -618,7 +631,8 @@ CNode* CConnman::ConnectNode(CAddress addrConnect, const char *pszDest, bool fCo
                              pszDest ? pszDest : "",
                              conn_type,
                              /*inbound_onion=*/false,
-                             std::move(i2p_transient_session));
+                             std::move(i2p_transient_session),
+                             use_v2transport);
     pnode->AddRef();
     statsClient.inc("peers.connect", 1.0f);
 
@@ -642,22 +656,24 @@ void CNode::CloseSocketDisconnect(CConnman* connman)
     fCanSendData = false;
 
     connman->mapSocketToNode.erase(m_sock->Get());
+    auto& shard = connman->GetSocketShard(*this);
     {
-        LOCK(connman->cs_sendable_receivable_nodes);
-        connman->mapReceivableNodes.erase(GetId());
-        connman->mapSendableNodes.erase(GetId());
+        LOCK(shard.cs_sendable_receivable_nodes);
+        shard.mapReceivableNodes.erase(GetId());
+        shard.mapSendableNodes.erase(GetId());
     }
     {
-        LOCK(connman->cs_mapNodesWithDataToSend);
-        if (connman->mapNodesWithDataToSend.erase(GetId()) != 0) {
+        LOCK(shard.cs_mapNodesWithDataToSend);
+        if (shard.mapNodesWithDataToSend.erase(GetId()) != 0) {
             // See comment in PushMessage
             Release();
         }
     }
 
-    if (connman->m_edge_trig_events && !connman->m_edge_trig_events->UnregisterEvents(m_sock->Get())) {
+    if (shard.m_edge_trig_events && !shard.m_edge_trig_events->UnregisterEvents(m_sock->Get())) {
         LogPrint(BCLog::NET, "EdgeTriggeredEvents::UnregisterEvents() failed\n");
     }
+    --shard.m_num_nodes;
 
     LogPrint(BCLog::NET, "disconnecting peer=%d\n", id);
     m_sock.reset();
@@ -700,6 +716,46 @@ std::string ConnectionTypeAsString(ConnectionType conn_type)
     assert(false);
 }
 
+SendPriority GetSendPriority(const std::string& msg_type)
+{
+    static const std::unordered_map<std::string, SendPriority> priorities{
+        {NetMsgType::QSIGSESANN, SendPriority::LLMQ},
+        {NetMsgType::QSIGSHARESINV, SendPriority::LLMQ},
+        {NetMsgType::QGETSIGSHARES, SendPriority::LLMQ},
+        {NetMsgType::QBSIGSHARES, SendPriority::LLMQ},
+        {NetMsgType::QSIGSHARE, SendPriority::LLMQ},
+        {NetMsgType::QSIGREC, SendPriority::LLMQ},
+        {NetMsgType::ISDLOCK, SendPriority::LLMQ},
+        {NetMsgType::CLSIG, SendPriority::LLMQ},
+        {NetMsgType::BLOCK, SendPriority::BULK},
+        {NetMsgType::MERKLEBLOCK, SendPriority::BULK},
+        {NetMsgType::MNLISTDIFF, SendPriority::BULK},
+        {NetMsgType::QUORUMROTATIONINFO, SendPriority::BULK},
+        {NetMsgType::QDATA, SendPriority::BULK},
+        {NetMsgType::MNGOVERNANCEOBJECT, SendPriority::BULK},
+        {NetMsgType::MNGOVERNANCEOBJECTVOTE, SendPriority::BULK},
+        {NetMsgType::CFILTER, SendPriority::BULK},
+        {NetMsgType::CFHEADERS, SendPriority::BULK},
+        {NetMsgType::CFCHECKPT, SendPriority::BULK},
+    };
+    const auto it = priorities.find(msg_type);
+    return it != priorities.end() ? it->second : SendPriority::NORMAL;
+}
+
+std::string SendPriorityAsString(SendPriority priority)
+{
+    switch (priority) {
+    case SendPriority::LLMQ:
+        return "llmq";
+    case SendPriority::NORMAL:
+        return "normal";
+    case SendPriority::BULK:
+        return "bulk";
+    } // no default case, so the compiler can warn about missing cases
+
+    assert(false);
+}
+
 CService CNode::GetAddrLocal() const
 {
     AssertLockNotHeld(m_addr_local_mutex);
@@ -756,12 +812,21 @@ void CNode::CopyStats(CNodeStats& stats)
         LOCK(cs_vSend);
         X(mapSendBytesPerMsgType);
         X(nSendBytes);
+        stats.nSendOverheadBytes = m_send_queued_bytes - std::min(m_send_queued_bytes, m_send_payload_bytes);
+        for (size_t i = 0; i < SEND_PRIORITY_COUNT; ++i) {
+            stats.m_send_queue_stats[i].m_queued_msgs = m_send_queues[i].size();
+            stats.m_send_queue_stats[i].m_queued_bytes = m_send_queue_bytes[i];
+            stats.m_send_queue_stats[i].m_sent_msgs = m_sent_msgs_by_priority[i];
+        }
     }
     {
         LOCK(cs_vRecv);
         X(mapRecvBytesPerMsgType);
         X(nRecvBytes);
+        stats.nRecvOverheadBytes = nRecvBytes - std::min(nRecvBytes, m_recv_payload_bytes);
     }
+    stats.m_transport_type = m_v2_transport ? m_v2_transport->GetTransportType() : "v1";
+    stats.m_session_id = m_v2_transport ? m_v2_transport->GetSessionID() : "";
     X(m_legacyWhitelisted);
     X(m_permissionFlags);
 
@@ -817,6 +882,7 @@ bool CNode::ReceiveMsgBytes(Span<const uint8_t> msg_bytes, bool& complete)
             }
             assert(i != mapRecvBytesPerMsgType.end());
             i->second += msg.m_raw_message_size;
+            m_recv_payload_bytes += msg.m_message_size;
             statsClient.count("bandwidth.message." + std::string(msg.m_type) + ".bytesReceived", msg.m_raw_message_size, 1.0f);
 
             // push the message to the process queue,
@@ -879,7 +945,11 @@ int V1TransportDeserializer::readData(Span<const uint8_t> msg_bytes)
         vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024));
     }
 
-    hasher.Write(msg_bytes.first(nCopy));
+    if (m_crc32c) {
+        m_crc = crc32c::Extend(m_crc, msg_bytes.data(), nCopy);
+    } else {
+        hasher.Write(msg_bytes.first(nCopy));
+    }
     memcpy(&vRecv[nDataPos], msg_bytes.data(), nCopy);
     nDataPos += nCopy;
 
@@ -907,16 +977,21 @@ CNetMessage V1TransportDeserializer::GetMessage(const std::chrono::microseconds
     msg.m_message_size = hdr.nMessageSize;
     msg.m_raw_message_size = hdr.nMessageSize + CMessageHeader::HEADER_SIZE;
 
-    uint256 hash = GetMessageHash();
+    uint8_t checksum[CMessageHeader::CHECKSUM_SIZE];
+    if (m_crc32c) {
+        WriteLE32(checksum, m_crc);
+    } else {
+        memcpy(checksum, GetMessageHash().begin(), CMessageHeader::CHECKSUM_SIZE);
+    }
 
     // We just received a message off the wire, harvest entropy from the time (and the message checksum)
-    RandAddEvent(ReadLE32(hash.begin()));
+    RandAddEvent(ReadLE32(checksum));
 
     // Check checksum and header message type string
-    if (memcmp(hash.begin(), hdr.pchChecksum, CMessageHeader::CHECKSUM_SIZE) != 0) {
+    if (memcmp(checksum, hdr.pchChecksum, CMessageHeader::CHECKSUM_SIZE) != 0) {
         LogPrint(BCLog::NET, "Header error: Wrong checksum (%s, %u bytes), expected %s was %s, peer=%d\n",
                  SanitizeString(msg.m_type), msg.m_message_size,
-                 HexStr(Span{hash}.first(CMessageHeader::CHECKSUM_SIZE)),
+                 HexStr(checksum),
                  HexStr(hdr.pchChecksum),
                  m_node_id);
         reject_message = true;
@@ -924,6 +999,9 @@ CNetMessage V1TransportDeserializer::GetMessage(const std::chrono::microseconds
         LogPrint(BCLog::NET, "Header error: Invalid message type (%s, %u bytes), peer=%d\n",
                  SanitizeString(hdr.GetCommand()), msg.m_message_size, m_node_id);
         reject_message = true;
+    } else if (!m_crc32c && msg.m_type == NetMsgType::SENDCRC32C) {
+        // The peer checksums everything it sends after this with CRC32C
+        m_crc32c = true;
     }
 
     // Always reset the network deserializer (prepare for the next message)
@@ -931,48 +1009,478 @@ CNetMessage V1TransportDeserializer::GetMessage(const std::chrono::microseconds
     return msg;
 }
 
-void V1TransportSerializer::prepareForTransport(CSerializedNetMsg& msg, std::vector<unsigned char>& header) const
+void V1TransportSerializer::prepareForTransport(const std::string& msg_type, Span<const unsigned char> payload, const uint256& payload_hash,
+                                               std::vector<unsigned char>& header) const
 {
-    // create dbl-sha256 checksum
-    uint256 hash = Hash(msg.data);
-
-    // create header
-    CMessageHeader hdr(Params().MessageStart(), msg.m_type.c_str(), msg.data.size());
-    memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+    // create header, the checksum is the start of the dbl-sha256 of the payload, or its CRC32C once a
+    // sendcrc32c went out
+    CMessageHeader hdr(Params().MessageStart(), msg_type.c_str(), payload.size());
+    if (m_crc32c) {
+        WriteLE32(hdr.pchChecksum, crc32c::Crc32c(payload.data(), payload.size()));
+    } else {
+        memcpy(hdr.pchChecksum, payload_hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+        if (msg_type == NetMsgType::SENDCRC32C) m_crc32c = true;
+    }
 
     // serialize header
     header.reserve(CMessageHeader::HEADER_SIZE);
     CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, header, 0, hdr};
 }
 
+void TransportSerializer::prepareForWire(const CSharedNetMsg& msg, std::vector<CSharedNetData>& buffers) const
+{
+    std::vector<unsigned char> header;
+    prepareForTransport(msg, header);
+    buffers.push_back(std::make_shared<const std::vector<unsigned char>>(std::move(header)));
+    if (!msg.data->empty()) buffers.push_back(msg.data);
+}
+
+namespace {
+/** BIP324 short message ids, the index is the id and 0 means the full message type follows. 1-28 are
+ *  assigned by BIP324, the high frequency Sparks messages start at 128 to stay clear of future assignments. */
+const std::array<std::string, 256> V2_MESSAGE_IDS = [] {
+    std::array<std::string, 256> ids;
+    ids[1] = NetMsgType::ADDR;
+    ids[2] = NetMsgType::BLOCK;
+    ids[3] = NetMsgType::BLOCKTXN;
+    ids[4] = NetMsgType::CMPCTBLOCK;
+    ids[6] = NetMsgType::FILTERADD;
+    ids[7] = NetMsgType::FILTERCLEAR;
+    ids[8] = NetMsgType::FILTERLOAD;
+    ids[9] = NetMsgType::GETBLOCKS;
+    ids[10] = NetMsgType::GETBLOCKTXN;
+    ids[11] = NetMsgType::GETDATA;
+    ids[12] = NetMsgType::GETHEADERS;
+    ids[13] = NetMsgType::HEADERS;
+    ids[14] = NetMsgType::INV;
+    ids[15] = NetMsgType::MEMPOOL;
+    ids[16] = NetMsgType::MERKLEBLOCK;
+    ids[17] = NetMsgType::NOTFOUND;
+    ids[18] = NetMsgType::PING;
+    ids[19] = NetMsgType::PONG;
+    ids[20] = NetMsgType::SENDCMPCT;
+    ids[21] = NetMsgType::TX;
+    ids[22] = NetMsgType::GETCFILTERS;
+    ids[23] = NetMsgType::CFILTER;
+    ids[24] = NetMsgType::GETCFHEADERS;
+    ids[25] = NetMsgType::CFHEADERS;
+    ids[26] = NetMsgType::GETCFCHECKPT;
+    ids[27] = NetMsgType::CFCHECKPT;
+    ids[28] = NetMsgType::ADDRV2;
+    ids[128] = NetMsgType::QSIGSHARESINV;
+    ids[129] = NetMsgType::QBSIGSHARES;
+    ids[130] = NetMsgType::ISDLOCK;
+    ids[131] = NetMsgType::CLSIG;
+    ids[132] = NetMsgType::QSIGREC;
+    ids[133] = NetMsgType::MNAUTH;
+    return ids;
+}();
+
+const std::unordered_map<std::string, uint8_t> V2_MESSAGE_MAP = [] {
+    std::unordered_map<std::string, uint8_t> map;
+    for (size_t i = 1; i < V2_MESSAGE_IDS.size(); ++i) {
+        if (!V2_MESSAGE_IDS[i].empty()) map.emplace(V2_MESSAGE_IDS[i], i);
+    }
+    return map;
+}();
+
+/** The first bytes of a v1 version message, a v2 responder compares the peer's first bytes with these */
+std::array<uint8_t, CMessageHeader::MESSAGE_START_SIZE + CMessageHeader::COMMAND_SIZE> GetV1Prefix(const CChainParams& chain_params)
+{
+    std::array<uint8_t, CMessageHeader::MESSAGE_START_SIZE + CMessageHeader::COMMAND_SIZE> prefix{};
+    std::copy(std::begin(chain_params.MessageStart()), std::end(chain_params.MessageStart()), prefix.begin());
+    const std::string version{NetMsgType::VERSION};
+    std::copy(version.begin(), version.end(), prefix.begin() + CMessageHeader::MESSAGE_START_SIZE);
+    return prefix;
+}
+} // namespace
+
+V2Transport::V2Transport(const CChainParams& chain_params, NodeId node_id, bool initiator) noexcept :
+    m_chain_params{chain_params},
+    m_node_id{node_id},
+    m_initiator{initiator},
+    m_recv_state{initiator ? RecvState::KEY : RecvState::KEY_MAYBE_V1},
+    m_send_state{SendState::MAYBE_V1},
+    m_recv_version{INIT_PROTO_VERSION}
+{
+    FastRandomContext rng;
+    LOCK(m_mutex);
+    m_send_garbage = rng.randbytes<uint8_t>(rng.randrange(MAX_GARBAGE_LEN + 1));
+    if (m_initiator) StartSending();
+}
+
+V2Transport::V2Transport(const CChainParams& chain_params, NodeId node_id, bool initiator, const CKey& key, Span<const std::byte> ent32,
+                         std::vector<uint8_t> garbage) noexcept :
+    m_chain_params{chain_params},
+    m_node_id{node_id},
+    m_initiator{initiator},
+    m_cipher{key, ent32},
+    m_recv_state{initiator ? RecvState::KEY : RecvState::KEY_MAYBE_V1},
+    m_send_state{SendState::MAYBE_V1},
+    m_recv_version{INIT_PROTO_VERSION}
+{
+    assert(garbage.size() <= MAX_GARBAGE_LEN);
+    LOCK(m_mutex);
+    m_send_garbage = std::move(garbage);
+    if (m_initiator) StartSending();
+}
+
+void V2Transport::StartSending()
+{
+    AssertLockHeld(m_mutex);
+    assert(m_send_state == SendState::MAYBE_V1);
+    const auto& key = m_cipher.GetOurPubKey();
+    m_send_buffer.insert(m_send_buffer.end(), UCharCast(key.data()), UCharCast(key.data()) + key.size());
+    m_send_buffer.insert(m_send_buffer.end(), m_send_garbage.begin(), m_send_garbage.end());
+    m_send_state = SendState::AWAITING_KEY;
+}
+
+void V2Transport::FinishKeyExchange()
+{
+    AssertLockHeld(m_mutex);
+    assert(m_send_state == SendState::AWAITING_KEY);
+    const auto terminator = UCharSpanCast(m_cipher.GetSendGarbageTerminator());
+    m_send_buffer.insert(m_send_buffer.end(), terminator.begin(), terminator.end());
+    // The version packet has no contents yet, it authenticates our garbage
+    EncryptPacket({}, m_send_garbage);
+    m_send_garbage.clear();
+    m_send_state = SendState::READY;
+    for (const auto& [msg_type, payload] : m_send_queue) {
+        SendMessage(msg_type, payload);
+    }
+    m_send_queue.clear();
+}
+
+void V2Transport::FallBackToV1()
+{
+    AssertLockHeld(m_mutex);
+    m_recv_state = RecvState::V1;
+    m_send_state = SendState::V1;
+    const V1TransportSerializer serializer;
+    for (const auto& [msg_type, payload] : m_send_queue) {
+        std::vector<unsigned char> header;
+        serializer.prepareForTransport(msg_type, payload, Hash(payload), header);
+        m_send_buffer.insert(m_send_buffer.end(), header.begin(), header.end());
+        m_send_buffer.insert(m_send_buffer.end(), payload.begin(), payload.end());
+    }
+    m_send_queue.clear();
+    LogPrint(BCLog::NET, "V2 transport: peer sent a v1 version message, falling back to v1, peer=%d\n", m_node_id);
+}
+
+void V2Transport::EncryptPacket(Span<const unsigned char> contents, Span<const uint8_t> aad)
+{
+    AssertLockHeld(m_mutex);
+    const size_t offset = m_send_buffer.size();
+    m_send_buffer.resize(offset + contents.size() + BIP324Cipher::EXPANSION);
+    m_cipher.Encrypt(AsBytes(contents), AsBytes(aad), /*ignore=*/false, AsWritableBytes(Span{m_send_buffer}.subspan(offset)));
+}
+
+void V2Transport::SendMessage(const std::string& msg_type, Span<const unsigned char> payload)
+{
+    AssertLockHeld(m_mutex);
+    std::vector<unsigned char> contents;
+    if (auto it = V2_MESSAGE_MAP.find(msg_type); it != V2_MESSAGE_MAP.end()) {
+        contents.reserve(1 + payload.size());
+        contents.push_back(it->second);
+    } else {
+        contents.reserve(1 + CMessageHeader::COMMAND_SIZE + payload.size());
+        contents.push_back(0);
+        contents.resize(1 + CMessageHeader::COMMAND_SIZE);
+        std::copy(msg_type.begin(), msg_type.begin() + std::min(msg_type.size(), CMessageHeader::COMMAND_SIZE), contents.begin() + 1);
+    }
+    contents.insert(contents.end(), payload.begin(), payload.end());
+    EncryptPacket(contents, {});
+}
+
+bool V2Transport::DecodeMessage(Span<const uint8_t> contents)
+{
+    AssertLockHeld(m_mutex);
+    if (contents.empty()) return false;
+    m_recv_reject = false;
+    if (contents[0] == 0) {
+        if (contents.size() < 1 + CMessageHeader::COMMAND_SIZE) return false;
+        CMessageHeader hdr;
+        std::copy(contents.begin() + 1, contents.begin() + 1 + CMessageHeader::COMMAND_SIZE, hdr.pchCommand);
+        m_recv_type = hdr.GetCommand();
+        m_recv_reject = !hdr.IsCommandValid();
+        contents = contents.subspan(1 + CMessageHeader::COMMAND_SIZE);
+    } else {
+        m_recv_type = V2_MESSAGE_IDS[contents[0]];
+        // Unknown short ids are dropped like invalid message types, they could be assigned by a future version
+        m_recv_reject = m_recv_type.empty();
+        contents = contents.subspan(1);
+    }
+    m_recv_payload.assign(contents.begin(), contents.end());
+    return true;
+}
+
+int V2Transport::Read(Span<const uint8_t>& msg_bytes)
+{
+    LOCK(m_mutex);
+    size_t consumed{0};
+    // move up to n bytes into m_recv_buffer
+    const auto take = [&](size_t n) EXCLUSIVE_LOCKS_REQUIRED(m_mutex) {
+        n = std::min(n, msg_bytes.size());
+        m_recv_buffer.insert(m_recv_buffer.end(), msg_bytes.begin(), msg_bytes.begin() + n);
+        msg_bytes = msg_bytes.subspan(n);
+        consumed += n;
+    };
+
+    while (!msg_bytes.empty() && m_recv_state != RecvState::APP_READY && m_recv_state != RecvState::V1) {
+        switch (m_recv_state) {
+        case RecvState::KEY_MAYBE_V1: {
+            const auto v1_prefix = GetV1Prefix(m_chain_params);
+            take(v1_prefix.size() - m_recv_buffer.size());
+            if (!std::equal(m_recv_buffer.begin(), m_recv_buffer.end(), v1_prefix.begin())) {
+                // Not a v1 version message, so this is the start of the peer's key
+                m_recv_state = RecvState::KEY;
+                StartSending();
+            } else if (m_recv_buffer.size() == v1_prefix.size()) {
+                FallBackToV1();
+            }
+            break;
+        }
+        case RecvState::KEY: {
+            take(EllSwiftPubKey::size() - m_recv_buffer.size());
+            if (m_recv_buffer.size() < EllSwiftPubKey::size()) break;
+            std::array<std::byte, EllSwiftPubKey::size()> their_key;
+            std::copy(m_recv_buffer.begin(), m_recv_buffer.end(), UCharCast(their_key.data()));
+            m_recv_buffer.clear();
+            m_cipher.Initialize(EllSwiftPubKey{their_key}, m_initiator);
+            m_recv_state = RecvState::GARB_GARBTERM;
+            FinishKeyExchange();
+            break;
+        }
+        case RecvState::GARB_GARBTERM: {
+            // Byte by byte, whatever follows the terminator belongs to the first packet
+            take(1);
+            const auto terminator = UCharSpanCast(m_cipher.GetReceiveGarbageTerminator());
+            if (m_recv_buffer.size() >= terminator.size() &&
+                std::equal(terminator.begin(), terminator.end(), m_recv_buffer.end() - terminator.size())) {
+                m_recv_garbage.assign(m_recv_buffer.begin(), m_recv_buffer.end() - terminator.size());
+                m_recv_buffer.clear();
+                m_recv_state = RecvState::VERSION;
+            } else if (m_recv_buffer.size() >= MAX_GARBAGE_LEN + terminator.size()) {
+                LogPrint(BCLog::NET, "V2 transport error: missing garbage terminator, peer=%d\n", m_node_id);
+                return -1;
+            }
+            break;
+        }
+        case RecvState::VERSION:
+        case RecvState::APP: {
+            if (!m_recv_len) {
+                take(BIP324Cipher::LENGTH_LEN - m_recv_buffer.size());
+                if (m_recv_buffer.size() < BIP324Cipher::LENGTH_LEN) break;
+                m_recv_len = m_cipher.DecryptLength(MakeByteSpan(m_recv_buffer));
+                m_recv_buffer.clear();
+                if (*m_recv_len > MAX_CONTENTS_LEN) {
+                    LogPrint(BCLog::NET, "V2 transport error: packet too large (%u bytes), peer=%d\n", *m_recv_len, m_node_id);
+                    return -1;
+                }
+            }
+            const size_t packet_len = *m_recv_len + BIP324Cipher::EXPANSION - BIP324Cipher::LENGTH_LEN;
+            take(packet_len - m_recv_buffer.size());
+            if (m_recv_buffer.size() < packet_len) break;
+
+            std::vector<uint8_t> contents(*m_recv_len);
+            bool ignore{false};
+            // Only the first packet authenticates the garbage
+            if (!m_cipher.Decrypt(MakeByteSpan(m_recv_buffer), MakeByteSpan(m_recv_garbage), ignore, MakeWritableByteSpan(contents))) {
+                LogPrint(BCLog::NET, "V2 transport error: packet decryption failure, peer=%d\n", m_node_id);
+                return -1;
+            }
+            m_recv_garbage.clear();
+            m_recv_buffer.clear();
+            m_recv_raw_size = packet_len + BIP324Cipher::LENGTH_LEN;
+            m_recv_len.reset();
+            if (ignore) break; // decoy
+            if (m_recv_state == RecvState::VERSION) {
+                // The version packet's contents are reserved for future extensions
+                m_recv_state = RecvState::APP;
+                break;
+            }
+            if (!DecodeMessage(contents)) {
+                LogPrint(BCLog::NET, "V2 transport error: malformed packet contents, peer=%d\n", m_node_id);
+                return -1;
+            }
+            m_recv_state = RecvState::APP_READY;
+            break;
+        }
+        case RecvState::APP_READY:
+        case RecvState::V1:
+            assert(false);
+        }
+    }
+    return consumed;
+}
+
+bool V2Transport::Complete() const
+{
+    return WITH_LOCK(m_mutex, return m_recv_state == RecvState::APP_READY);
+}
+
+void V2Transport::SetVersion(int version)
+{
+    WITH_LOCK(m_mutex, m_recv_version = version);
+}
+
+CNetMessage V2Transport::GetMessage(std::chrono::microseconds time, bool& reject_message)
+{
+    LOCK(m_mutex);
+    assert(m_recv_state == RecvState::APP_READY);
+    CNetMessage msg(CDataStream{m_recv_payload, SER_NETWORK, m_recv_version});
+    msg.m_type = std::move(m_recv_type);
+    msg.m_time = time;
+    msg.m_message_size = m_recv_payload.size();
+    msg.m_raw_message_size = m_recv_raw_size;
+    reject_message = m_recv_reject;
+    if (reject_message) {
+        LogPrint(BCLog::NET, "V2 transport error: invalid message type (%s, %u bytes), peer=%d\n",
+                 SanitizeString(msg.m_type), msg.m_message_size, m_node_id);
+    }
+    m_recv_type.clear();
+    m_recv_payload.clear();
+    m_recv_state = RecvState::APP;
+    return msg;
+}
+
+std::vector<uint8_t> V2Transport::TakeV1Prefix()
+{
+    LOCK(m_mutex);
+    assert(m_recv_state == RecvState::V1);
+    return std::move(m_recv_buffer);
+}
+
+bool V2Transport::PushMessage(const std::string& msg_type, Span<const unsigned char> payload)
+{
+    LOCK(m_mutex);
+    switch (m_send_state) {
+    case SendState::V1:
+        return false;
+    case SendState::MAYBE_V1:
+    case SendState::AWAITING_KEY:
+        m_send_queue.emplace_back(msg_type, std::vector<unsigned char>(payload.begin(), payload.end()));
+        return true;
+    case SendState::READY:
+        SendMessage(msg_type, payload);
+        return true;
+    }
+    assert(false);
+}
+
+bool V2Transport::GetBytesToSend(std::vector<unsigned char>& bytes)
+{
+    LOCK(m_mutex);
+    if (m_send_buffer.empty()) return false;
+    bytes = std::move(m_send_buffer);
+    m_send_buffer.clear();
+    return true;
+}
+
+bool V2Transport::IsV1() const
+{
+    return WITH_LOCK(m_mutex, return m_recv_state == RecvState::V1);
+}
+
+std::string V2Transport::GetTransportType() const
+{
+    LOCK(m_mutex);
+    if (m_send_state == SendState::V1) return "v1";
+    return m_cipher ? "v2" : "detecting";
+}
+
+std::string V2Transport::GetSessionID() const
+{
+    LOCK(m_mutex);
+    return m_cipher ? HexStr(m_cipher.GetSessionID()) : "";
+}
+
+int V2TransportDeserializer::Read(Span<const uint8_t>& msg_bytes)
+{
+    if (m_v1) return m_v1_deserializer.Read(msg_bytes);
+    const int ret = m_transport->Read(msg_bytes);
+    if (ret >= 0 && m_transport->IsV1()) {
+        // Replay the start of the version message that was held back while detecting
+        m_v1 = true;
+        const std::vector<uint8_t> prefix{m_transport->TakeV1Prefix()};
+        Span<const uint8_t> prefix_bytes{prefix};
+        if (m_v1_deserializer.Read(prefix_bytes) < 0) return -1;
+    }
+    return ret;
+}
+
+void V2TransportSerializer::prepareForWire(const CSharedNetMsg& msg, std::vector<CSharedNetData>& buffers) const
+{
+    const bool is_v2 = m_transport->PushMessage(msg.m_type, *msg.data);
+    // Anything the transport produced so far goes out first, including messages queued during the handshake
+    std::vector<unsigned char> bytes;
+    if (m_transport->GetBytesToSend(bytes)) {
+        buffers.push_back(std::make_shared<const std::vector<unsigned char>>(std::move(bytes)));
+    }
+    if (!is_v2) TransportSerializer::prepareForWire(msg, buffers);
+}
+
+/** Keep the lock free count of everything left to send up to date */
+static void UpdateSendMsgSize(CNode& node) EXCLUSIVE_LOCKS_REQUIRED(node.cs_vSend)
+{
+    size_t count = node.vSendMsg.size();
+    for (const auto& queue : node.m_send_queues) {
+        count += queue.size();
+    }
+    node.nSendMsgSize = count;
+}
+
 size_t CConnman::SocketSendData(CNode& node)
 {
-    auto it = node.vSendMsg.begin();
     size_t nSentSize = 0;
 
-    while (it != node.vSendMsg.end()) {
-        const auto& data = *it;
-        assert(data.size() > node.nSendOffset);
+    std::vector<Span<const unsigned char>> buffers;
+    buffers.reserve(MAX_SEND_BUFFERS_PER_CALL);
+    while (true) {
+        // Let queued messages in as the window drains, the highest priority ones go first
+        FillSendWindow(node);
+        if (node.vSendMsg.empty()) break;
+
+        // Gather as many queued buffers as possible into a single sendmsg() call
+        buffers.clear();
+        size_t nRequested = 0;
+        size_t nOffset = node.nSendOffset;
+        for (auto jt = node.vSendMsg.begin(); jt != node.vSendMsg.end() && buffers.size() < MAX_SEND_BUFFERS_PER_CALL; ++jt) {
+            const auto& data = **jt;
+            assert(data.size() > nOffset);
+            buffers.emplace_back(data.data() + nOffset, data.size() - nOffset);
+            nRequested += data.size() - nOffset;
+            nOffset = 0;
+        }
         int nBytes = 0;
         {
             LOCK(node.m_sock_mutex);
             if (!node.m_sock) {
                 break;
             }
-            nBytes = node.m_sock->Send(reinterpret_cast<const char*>(data.data()) + node.nSendOffset, data.size() - node.nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+            nBytes = node.m_sock->SendMany(buffers, MSG_NOSIGNAL | MSG_DONTWAIT);
         }
         if (nBytes > 0) {
             node.m_last_send = GetTime<std::chrono::seconds>();
             node.nSendBytes += nBytes;
-            node.nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (node.nSendOffset == data.size()) {
+            node.nSendSize -= nBytes;
+            node.m_send_window_size -= nBytes;
+            // drop everything that was sent completely, remember how far we got into the rest
+            size_t nLeft = nBytes;
+            while (nLeft > 0) {
+                const size_t nRemaining = node.vSendMsg.front()->size() - node.nSendOffset;
+                if (nLeft < nRemaining) {
+                    node.nSendOffset += nLeft;
+                    break;
+                }
+                nLeft -= nRemaining;
                 node.nSendOffset = 0;
-                node.nSendSize -= data.size();
-                node.fPauseSend = node.nSendSize > nSendBufferMaxSize;
-                it++;
-            } else {
-                // could not send full message; stop sending more
+                node.vSendMsg.pop_front();
+            }
+            node.fPauseSend = node.nSendSize > nSendBufferMaxSize;
+            if (size_t(nBytes) < nRequested) {
+                // could not send everything; stop sending more
                 node.fCanSendData = false;
                 break;
             }
@@ -991,12 +1499,11 @@ size_t CConnman::SocketSendData(CNode& node)
         }
     }
 
-    if (it == node.vSendMsg.end()) {
+    if (node.vSendMsg.empty()) {
         assert(node.nSendOffset == 0);
-        assert(node.nSendSize == 0);
+        assert(node.m_send_window_size == 0);
     }
-    node.vSendMsg.erase(node.vSendMsg.begin(), it);
-    node.nSendMsgSize = node.vSendMsg.size();
+    UpdateSendMsgSize(node);
     return nSentSize;
 }
 
@@ -1412,12 +1919,15 @@ void CConnman::CreateNodeFromAcceptedSocket(std::unique_ptr<Sock>&& sock,
                              addr_bind,
                              /*addrNameIn=*/"",
                              ConnectionType::INBOUND,
-                             inbound_onion);
+                             inbound_onion,
+                             /*i2p_sam_session=*/nullptr,
+                             m_use_v2transport);
     pnode->AddRef();
     pnode->m_permissionFlags = permissionFlags;
     // If this flag is present, the user probably expect that RPC and QT report it as whitelisted (backward compatibility)
     pnode->m_legacyWhitelisted = legacyWhitelisted;
     pnode->m_prefer_evict = discouraged;
+    pnode->m_socket_shard = PickSocketShard();
     m_msgproc->InitializeNode(pnode);
 
     {
@@ -1436,14 +1946,7 @@ void CConnman::CreateNodeFromAcceptedSocket(std::unique_ptr<Sock>&& sock,
     {
         LOCK2(cs_mapSocketToNode, pnode->m_sock_mutex);
         mapSocketToNode.emplace(pnode->m_sock->Get(), pnode);
-        if (m_edge_trig_events) {
-            if (!m_edge_trig_events->RegisterEvents(pnode->m_sock->Get())) {
-                LogPrint(BCLog::NET, "EdgeTriggeredEvents::RegisterEvents() failed\n");
-            }
-        }
-        if (m_wakeup_pipe) {
-            m_wakeup_pipe->Write();
-        }
+        RegisterSocketEvents(*pnode);
     }
 
     // We received a new connection, harvest entropy from the time (and our peer count)
@@ -1485,6 +1988,30 @@ bool CConnman::AddConnection(const std::string& address, ConnectionType conn_typ
     return true;
 }
 
+size_t CConnman::PickSocketShard()
+{
+    auto it = std::min_element(m_socket_shards.begin(), m_socket_shards.end(), [](const auto& a, const auto& b) {
+        return a->m_num_nodes < b->m_num_nodes;
+    });
+    ++(*it)->m_num_nodes;
+    return (*it)->m_id;
+}
+
+void CConnman::RegisterSocketEvents(CNode& node)
+{
+    AssertLockHeld(node.m_sock_mutex);
+
+    auto& shard = GetSocketShard(node);
+    if (shard.m_edge_trig_events) {
+        if (!shard.m_edge_trig_events->RegisterEvents(node.m_sock->Get())) {
+            LogPrint(BCLog::NET, "EdgeTriggeredEvents::RegisterEvents() failed\n");
+        }
+    }
+    if (shard.m_wakeup_pipe) {
+        shard.m_wakeup_pipe->Write();
+    }
+}
+
 void CConnman::DisconnectNodes()
 {
     {
@@ -1715,13 +2242,16 @@ bool CConnman::InactivityCheck(const CNode& node) const
     return false;
 }
 
-bool CConnman::GenerateSelectSet(const std::vector<CNode*>& nodes,
+bool CConnman::GenerateSelectSet(const SocketShard& shard,
+                                 const std::vector<CNode*>& nodes,
                                  std::set<SOCKET>& recv_set,
                                  std::set<SOCKET>& send_set,
                                  std::set<SOCKET>& error_set)
 {
-    for (const ListenSocket& hListenSocket : vhListenSocket) {
-        recv_set.insert(hListenSocket.sock->Get());
+    if (shard.m_id == 0) {
+        for (const ListenSocket& hListenSocket : vhListenSocket) {
+            recv_set.insert(hListenSocket.sock->Get());
+        }
     }
 
     for (CNode* pnode : nodes)
@@ -1743,20 +2273,21 @@ bool CConnman::GenerateSelectSet(const std::vector<CNode*>& nodes,
         }
     }
 
-    if (m_wakeup_pipe) {
+    if (shard.m_wakeup_pipe) {
         // We add a pipe to the read set so that the select() call can be woken up from the outside
         // This is done when data is added to send buffers (vSendMsg) or when new peers are added
         // This is currently only implemented for POSIX compliant systems. This means that Windows will fall back to
         // timing out after 50ms and then trying to send. This is ok as we assume that heavy-load daemons are usually
         // run on Linux and friends.
-        recv_set.insert(m_wakeup_pipe->m_pipe[0]);
+        recv_set.insert(shard.m_wakeup_pipe->m_pipe[0]);
     }
 
     return !recv_set.empty() || !send_set.empty() || !error_set.empty();
 }
 
 #ifdef USE_KQUEUE
-void CConnman::SocketEventsKqueue(std::set<SOCKET>& recv_set,
+void CConnman::SocketEventsKqueue(SocketShard& shard,
+                                  std::set<SOCKET>& recv_set,
                                   std::set<SOCKET>& send_set,
                                   std::set<SOCKET>& error_set,
                                   bool only_poll)
@@ -1769,7 +2300,7 @@ void CConnman::SocketEventsKqueue(std::set<SOCKET>& recv_set,
     timeout.tv_nsec = (only_poll ? 0 : SELECT_TIMEOUT_MILLISECONDS % 1000) * 1000 * 1000;
 
     int n{-1};
-    ToggleWakeupPipe([&](){n = kevent(Assert(m_edge_trig_events)->GetFileDescriptor(), nullptr, 0, events, maxEvents, &timeout);});
+    shard.ToggleWakeupPipe([&](){n = kevent(Assert(shard.m_edge_trig_events)->GetFileDescriptor(), nullptr, 0, events, maxEvents, &timeout);});
     if (n == -1) {
         LogPrintf("kevent wait error\n");
     } else if (n > 0) {
@@ -1793,7 +2324,8 @@ void CConnman::SocketEventsKqueue(std::set<SOCKET>& recv_set,
 #endif
 
 #ifdef USE_EPOLL
-void CConnman::SocketEventsEpoll(std::set<SOCKET>& recv_set,
+void CConnman::SocketEventsEpoll(SocketShard& shard,
+                                 std::set<SOCKET>& recv_set,
                                  std::set<SOCKET>& send_set,
                                  std::set<SOCKET>& error_set,
                                  bool only_poll)
@@ -1802,7 +2334,7 @@ void CConnman::SocketEventsEpoll(std::set<SOCKET>& recv_set,
     epoll_event events[maxEvents];
 
     int n{-1};
-    ToggleWakeupPipe([&](){n = epoll_wait(Assert(m_edge_trig_events)->GetFileDescriptor(), events, maxEvents, only_poll ? 0 : SELECT_TIMEOUT_MILLISECONDS);});
+    shard.ToggleWakeupPipe([&](){n = epoll_wait(Assert(shard.m_edge_trig_events)->GetFileDescriptor(), events, maxEvents, only_poll ? 0 : SELECT_TIMEOUT_MILLISECONDS);});
     for (int i = 0; i < n; i++) {
         auto& e = events[i];
         if((e.events & EPOLLERR) || (e.events & EPOLLHUP)) {
@@ -1821,15 +2353,46 @@ void CConnman::SocketEventsEpoll(std::set<SOCKET>& recv_set,
 }
 #endif
 
+#ifdef USE_IO_URING
+void CConnman::SocketEventsIOUring(SocketShard& shard,
+                                   std::set<SOCKET>& recv_set,
+                                   std::set<SOCKET>& send_set,
+                                   std::set<SOCKET>& error_set,
+                                   bool only_poll)
+{
+    std::vector<std::pair<SOCKET, uint32_t>> events;
+    bool ret{false};
+    shard.ToggleWakeupPipe([&](){ret = Assert(shard.m_edge_trig_events)->WaitEvents(events, std::chrono::milliseconds{only_poll ? 0 : SELECT_TIMEOUT_MILLISECONDS});});
+    if (!ret) {
+        LogPrintf("io_uring wait error\n");
+    }
+    for (const auto& [socket, revents] : events) {
+        if (revents & (POLLERR | POLLHUP)) {
+            error_set.insert(socket);
+            continue;
+        }
+
+        if (revents & POLLIN) {
+            recv_set.insert(socket);
+        }
+
+        if (revents & POLLOUT) {
+            send_set.insert(socket);
+        }
+    }
+}
+#endif
+
 #ifdef USE_POLL
-void CConnman::SocketEventsPoll(const std::vector<CNode*>& nodes,
+void CConnman::SocketEventsPoll(SocketShard& shard,
+                                const std::vector<CNode*>& nodes,
                                 std::set<SOCKET>& recv_set,
                                 std::set<SOCKET>& send_set,
                                 std::set<SOCKET>& error_set,
                                 bool only_poll)
 {
     std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
-    if (!GenerateSelectSet(nodes, recv_select_set, send_select_set, error_select_set)) {
+    if (!GenerateSelectSet(shard, nodes, recv_select_set, send_select_set, error_select_set)) {
         if (!only_poll) interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
         return;
     }
@@ -1858,7 +2421,7 @@ void CConnman::SocketEventsPoll(const std::vector<CNode*>& nodes,
     }
 
     int r{-1};
-    ToggleWakeupPipe([&](){r = poll(vpollfds.data(), vpollfds.size(), only_poll ? 0 : SELECT_TIMEOUT_MILLISECONDS);});
+    shard.ToggleWakeupPipe([&](){r = poll(vpollfds.data(), vpollfds.size(), only_poll ? 0 : SELECT_TIMEOUT_MILLISECONDS);});
     if (r < 0) {
         return;
     }
@@ -1873,14 +2436,15 @@ void CConnman::SocketEventsPoll(const std::vector<CNode*>& nodes,
 }
 #endif
 
-void CConnman::SocketEventsSelect(const std::vector<CNode*>& nodes,
+void CConnman::SocketEventsSelect(SocketShard& shard,
+                                  const std::vector<CNode*>& nodes,
                                   std::set<SOCKET>& recv_set,
                                   std::set<SOCKET>& send_set,
                                   std::set<SOCKET>& error_set,
                                   bool only_poll)
 {
     std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
-    if (!GenerateSelectSet(nodes, recv_select_set, send_select_set, error_select_set)) {
+    if (!GenerateSelectSet(shard, nodes, recv_select_set, send_select_set, error_select_set)) {
         interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
         return;
     }
@@ -1916,7 +2480,7 @@ void CConnman::SocketEventsSelect(const std::vector<CNode*>& nodes,
     }
 
     int nSelect{-1};
-    ToggleWakeupPipe([&](){nSelect = select(hSocketMax + 1, &fdsetRecv, &fdsetSend, &fdsetError, &timeout);});
+    shard.ToggleWakeupPipe([&](){nSelect = select(hSocketMax + 1, &fdsetRecv, &fdsetSend, &fdsetError, &timeout);});
     if (interruptNet)
         return;
 
@@ -1951,7 +2515,8 @@ void CConnman::SocketEventsSelect(const std::vector<CNode*>& nodes,
     }
 }
 
-void CConnman::SocketEvents(const std::vector<CNode*>& nodes,
+void CConnman::SocketEvents(SocketShard& shard,
+                            const std::vector<CNode*>& nodes,
                             std::set<SOCKET>& recv_set,
                             std::set<SOCKET>& send_set,
                             std::set<SOCKET>& error_set,
@@ -1960,28 +2525,33 @@ void CConnman::SocketEvents(const std::vector<CNode*>& nodes,
     switch (socketEventsMode) {
 #ifdef USE_KQUEUE
         case SocketEventsMode::KQueue:
-            SocketEventsKqueue(recv_set, send_set, error_set, only_poll);
+            SocketEventsKqueue(shard, recv_set, send_set, error_set, only_poll);
             break;
 #endif
 #ifdef USE_EPOLL
         case SocketEventsMode::EPoll:
-            SocketEventsEpoll(recv_set, send_set, error_set, only_poll);
+            SocketEventsEpoll(shard, recv_set, send_set, error_set, only_poll);
+            break;
+#endif
+#ifdef USE_IO_URING
+        case SocketEventsMode::IOUring:
+            SocketEventsIOUring(shard, recv_set, send_set, error_set, only_poll);
             break;
 #endif
 #ifdef USE_POLL
         case SocketEventsMode::Poll:
-            SocketEventsPoll(nodes, recv_set, send_set, error_set, only_poll);
+            SocketEventsPoll(shard, nodes, recv_set, send_set, error_set, only_poll);
             break;
 #endif
         case SocketEventsMode::Select:
-            SocketEventsSelect(nodes, recv_set, send_set, error_set, only_poll);
+            SocketEventsSelect(shard, nodes, recv_set, send_set, error_set, only_poll);
             break;
         default:
             assert(false);
     }
 }
 
-void CConnman::SocketHandler(CMasternodeSync& mn_sync)
+void CConnman::SocketHandler(SocketShard& shard, CMasternodeSync& mn_sync)
 {
     AssertLockNotHeld(m_total_bytes_sent_mutex);
 
@@ -1989,18 +2559,18 @@ void CConnman::SocketHandler(CMasternodeSync& mn_sync)
     std::set<SOCKET> send_set;
     std::set<SOCKET> error_set;
 
-    bool only_poll = [this]() {
+    bool only_poll = [this, &shard]() {
         // Check if we have work to do and thus should avoid waiting for events
-        LOCK2(m_nodes_mutex, cs_sendable_receivable_nodes);
-        if (!mapReceivableNodes.empty()) {
+        LOCK2(m_nodes_mutex, shard.cs_sendable_receivable_nodes);
+        if (!shard.mapReceivableNodes.empty()) {
             return true;
-        } else if (!mapSendableNodes.empty()) {
-            if (LOCK(cs_mapNodesWithDataToSend); !mapNodesWithDataToSend.empty()) {
+        } else if (!shard.mapSendableNodes.empty()) {
+            if (LOCK(shard.cs_mapNodesWithDataToSend); !shard.mapNodesWithDataToSend.empty()) {
                 // We must check if at least one of the nodes with pending messages is also
                 // sendable, as otherwise a single node would be able to make the network
                 // thread busy with polling.
-                for (auto& p : mapNodesWithDataToSend) {
-                    if (mapSendableNodes.count(p.first)) {
+                for (auto& p : shard.mapNodesWithDataToSend) {
+                    if (shard.mapSendableNodes.count(p.first)) {
                         return true;
                         break;
                     }
@@ -2011,28 +2581,31 @@ void CConnman::SocketHandler(CMasternodeSync& mn_sync)
     }();
 
     {
-        const NodesSnapshot snap{*this, /* filter = */ CConnman::AllNodes, /* shuffle = */ false};
+        const NodesSnapshot snap{*this, /* filter = */ [&shard](const CNode* pnode) { return pnode->m_socket_shard == shard.m_id; }, /* shuffle = */ false};
 
         // Check for the readiness of the already connected sockets and the
         // listening sockets in one call ("readiness" as in poll(2) or
         // select(2)). If none are ready, wait for a short while and return
         // empty sets.
-        SocketEvents(snap.Nodes(), recv_set, send_set, error_set, only_poll);
+        SocketEvents(shard, snap.Nodes(), recv_set, send_set, error_set, only_poll);
 
     // Drain the wakeup pipe
-    if (m_wakeup_pipe && recv_set.count(m_wakeup_pipe->m_pipe[0])) {
-        m_wakeup_pipe->Drain();
+    if (shard.m_wakeup_pipe && recv_set.count(shard.m_wakeup_pipe->m_pipe[0])) {
+        shard.m_wakeup_pipe->Drain();
     }
 
         // Service (send/receive) each of the already connected nodes.
-        SocketHandlerConnected(recv_set, send_set, error_set);
+        SocketHandlerConnected(shard, recv_set, send_set, error_set);
     }
 
     // Accept new connections from listening sockets.
-    SocketHandlerListening(recv_set, mn_sync);
+    if (shard.m_id == 0) {
+        SocketHandlerListening(recv_set, mn_sync);
+    }
 }
 
-void CConnman::SocketHandlerConnected(const std::set<SOCKET>& recv_set,
+void CConnman::SocketHandlerConnected(SocketShard& shard,
+                                      const std::set<SOCKET>& recv_set,
                                       const std::set<SOCKET>& send_set,
                                       const std::set<SOCKET>& error_set)
 {
@@ -2064,8 +2637,8 @@ void CConnman::SocketHandlerConnected(const std::set<SOCKET>& recv_set,
                 continue;
             }
 
-            LOCK(cs_sendable_receivable_nodes);
-            auto jt = mapReceivableNodes.emplace(it->second->GetId(), it->second);
+            LOCK(shard.cs_sendable_receivable_nodes);
+            auto jt = shard.mapReceivableNodes.emplace(it->second->GetId(), it->second);
             assert(jt.first->second == it->second);
             it->second->fHasRecvData = true;
         }
@@ -2075,8 +2648,8 @@ void CConnman::SocketHandlerConnected(const std::set<SOCKET>& recv_set,
                 continue;
             }
 
-            LOCK(cs_sendable_receivable_nodes);
-            auto jt = mapSendableNodes.emplace(it->second->GetId(), it->second);
+            LOCK(shard.cs_sendable_receivable_nodes);
+            auto jt = shard.mapSendableNodes.emplace(it->second->GetId(), it->second);
             assert(jt.first->second == it->second);
             it->second->fCanSendData = true;
         }
@@ -2084,12 +2657,12 @@ void CConnman::SocketHandlerConnected(const std::set<SOCKET>& recv_set,
         // collect nodes that have a receivable socket
         // also clean up mapReceivableNodes from nodes that were receivable in the last iteration but aren't anymore
         {
-            LOCK(cs_sendable_receivable_nodes);
+            LOCK(shard.cs_sendable_receivable_nodes);
 
-            vReceivableNodes.reserve(mapReceivableNodes.size());
-            for (auto it = mapReceivableNodes.begin(); it != mapReceivableNodes.end(); ) {
+            vReceivableNodes.reserve(shard.mapReceivableNodes.size());
+            for (auto it = shard.mapReceivableNodes.begin(); it != shard.mapReceivableNodes.end(); ) {
                 if (!it->second->fHasRecvData) {
-                    it = mapReceivableNodes.erase(it);
+                    it = shard.mapReceivableNodes.erase(it);
                 } else {
                     // Implement the following logic:
                     // * If there is data to send, try sending data. As this only
@@ -2111,13 +2684,13 @@ void CConnman::SocketHandlerConnected(const std::set<SOCKET>& recv_set,
         // collect nodes that have data to send and have a socket with non-empty write buffers
         // also clean up mapNodesWithDataToSend from nodes that had messages to send in the last iteration
         // but don't have any in this iteration
-        LOCK(cs_mapNodesWithDataToSend);
-        vSendableNodes.reserve(mapNodesWithDataToSend.size());
-        for (auto it = mapNodesWithDataToSend.begin(); it != mapNodesWithDataToSend.end(); ) {
+        LOCK(shard.cs_mapNodesWithDataToSend);
+        vSendableNodes.reserve(shard.mapNodesWithDataToSend.size());
+        for (auto it = shard.mapNodesWithDataToSend.begin(); it != shard.mapNodesWithDataToSend.end(); ) {
             if (it->second->nSendMsgSize == 0) {
                 // See comment in PushMessage
                 it->second->Release();
-                it = mapNodesWithDataToSend.erase(it);
+                it = shard.mapNodesWithDataToSend.erase(it);
             } else {
                 if (it->second->fCanSendData) {
                     it->second->AddRef();
@@ -2174,13 +2747,13 @@ void CConnman::SocketHandlerConnected(const std::set<SOCKET>& recv_set,
     }
 
     {
-        LOCK(cs_sendable_receivable_nodes);
+        LOCK(shard.cs_sendable_receivable_nodes);
         // remove nodes from mapSendableNodes, so that the next iteration knows that there is no work to do
         // (even if there are pending messages to be sent)
-        for (auto it = mapSendableNodes.begin(); it != mapSendableNodes.end(); ) {
+        for (auto it = shard.mapSendableNodes.begin(); it != shard.mapSendableNodes.end(); ) {
             if (!it->second->fCanSendData) {
                 LogPrint(BCLog::NET, "%s -- remove mapSendableNodes, peer=%d\n", __func__, it->second->GetId());
-                it = mapSendableNodes.erase(it);
+                it = shard.mapSendableNodes.erase(it);
             } else {
                 ++it;
             }
@@ -2222,6 +2795,8 @@ size_t CConnman::SocketRecvData(CNode *pnode)
             pnode->CloseSocketDisconnect(this);
         }
         RecordBytesRecv(nBytes);
+        // The v2 handshake answers what was just received
+        PushTransportBytes(*pnode);
         if (notify) {
             size_t nSizeAdded = 0;
             auto it(pnode->vRecvMsg.begin());
@@ -2269,7 +2844,7 @@ size_t CConnman::SocketRecvData(CNode *pnode)
     return (size_t)nBytes;
 }
 
-void CConnman::ThreadSocketHandler(CMasternodeSync& mn_sync)
+void CConnman::ThreadSocketHandler(SocketShard& shard, CMasternodeSync& mn_sync)
 {
     AssertLockNotHeld(m_total_bytes_sent_mutex);
 
@@ -2279,7 +2854,9 @@ void CConnman::ThreadSocketHandler(CMasternodeSync& mn_sync)
     {
         // Handle sockets before we do the next round of disconnects. This allows us to flush send buffers one last time
         // before actually closing sockets. Receiving is however skipped in case a peer is pending to be disconnected
-        SocketHandler(mn_sync);
+        SocketHandler(shard, mn_sync);
+        // Nodes of all shards are disconnected from the first one, other shards only do IO
+        if (shard.m_id != 0) continue;
         if (GetTimeMillis() - nLastCleanupNodes > 1000) {
             ForEachNode(AllNodes, [&](CNode* pnode) {
                 if (InactivityCheck(*pnode)) pnode->fDisconnect = true;
@@ -3127,6 +3704,9 @@ void CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
         pnode->m_masternode_connection = true;
     if (masternode_probe_connection == MasternodeProbeConn::IsConnection)
         pnode->m_masternode_probe_connection = true;
+    pnode->m_socket_shard = PickSocketShard();
+    // A v2 initiator opens with its key
+    PushTransportBytes(*pnode);
 
     {
         LOCK2(cs_mapSocketToNode, pnode->m_sock_mutex);
@@ -3139,15 +3719,8 @@ void CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
         m_nodes.push_back(pnode);
     }
     {
-        if (m_edge_trig_events) {
-            LOCK(pnode->m_sock_mutex);
-            if (!m_edge_trig_events->RegisterEvents(pnode->m_sock->Get())) {
-                LogPrint(BCLog::NET, "EdgeTriggeredEvents::RegisterEvents() failed\n");
-            }
-        }
-        if (m_wakeup_pipe) {
-            m_wakeup_pipe->Write();
-        }
+        LOCK(pnode->m_sock_mutex);
+        RegisterSocketEvents(*pnode);
     }
 }
 
@@ -3306,7 +3879,7 @@ bool CConnman::BindListenPort(const CService& addrBind, bilingual_str& strError,
         return false;
     }
 
-    if (m_edge_trig_events && !m_edge_trig_events->AddSocket(sock->Get())) {
+    if (auto& edge_trig_events = m_socket_shards.front()->m_edge_trig_events; edge_trig_events && !edge_trig_events->AddSocket(sock->Get())) {
         LogPrintf("Error: EdgeTriggeredEvents::AddSocket() failed\n");
         return false;
     }
@@ -3450,12 +4023,23 @@ bool CConnman::Start(CDeterministicMNManager& dmnman, CMasternodeMetaMan& mn_met
     AssertLockNotHeld(m_total_bytes_sent_mutex);
     Init(connOptions);
 
-    if (socketEventsMode == SocketEventsMode::EPoll || socketEventsMode == SocketEventsMode::KQueue) {
-        m_edge_trig_events = std::make_unique<EdgeTriggeredEvents>(socketEventsMode);
-        if (!m_edge_trig_events->IsValid()) {
-            LogPrintf("Unable to initialize EdgeTriggeredEvents instance\n");
-            m_edge_trig_events.reset();
-            return false;
+#ifdef USE_IO_URING
+    if (socketEventsMode == SocketEventsMode::IOUring && !EdgeTriggeredEvents{socketEventsMode}.IsValid()) {
+        // Built with io_uring but the kernel is too old or has it disabled (sysctl, seccomp), epoll is always there
+        LogPrintf("io_uring is not usable on this system, falling back to -socketevents=epoll\n");
+        socketEventsMode = SocketEventsMode::EPoll;
+    }
+#endif
+
+    if (socketEventsMode == SocketEventsMode::EPoll || socketEventsMode == SocketEventsMode::KQueue ||
+        socketEventsMode == SocketEventsMode::IOUring) {
+        for (auto& shard : m_socket_shards) {
+            shard->m_edge_trig_events = std::make_unique<EdgeTriggeredEvents>(socketEventsMode);
+            if (!shard->m_edge_trig_events->IsValid()) {
+                LogPrintf("Unable to initialize EdgeTriggeredEvents instance\n");
+                shard->m_edge_trig_events.reset();
+                return false;
+            }
         }
     }
 
@@ -3514,16 +4098,23 @@ bool CConnman::Start(CDeterministicMNManager& dmnman, CMasternodeMetaMan& mn_met
     }
 
 #ifdef USE_WAKEUP_PIPE
-    m_wakeup_pipe = std::make_unique<WakeupPipe>(m_edge_trig_events.get());
-    if (!m_wakeup_pipe->IsValid()) {
-        /* We log the error but do not halt initialization */
-        LogPrintf("Unable to initialize WakeupPipe instance\n");
-        m_wakeup_pipe.reset();
+    for (auto& shard : m_socket_shards) {
+        shard->m_wakeup_pipe = std::make_unique<WakeupPipe>(shard->m_edge_trig_events.get());
+        if (!shard->m_wakeup_pipe->IsValid()) {
+            /* We log the error but do not halt initialization */
+            LogPrintf("Unable to initialize WakeupPipe instance\n");
+            shard->m_wakeup_pipe.reset();
+        }
     }
 #endif /* USE_WAKEUP_PIPE */
 
     // Send and receive from sockets, accept connections
-    threadSocketHandler = std::thread(&util::TraceThread, "net", [this, &mn_sync] { ThreadSocketHandler(mn_sync); });
+    for (auto& shard : m_socket_shards) {
+        shard->threadSocketHandler = std::thread(&util::TraceThread, shard->m_thread_name.c_str(), [this, &shard = *shard, &mn_sync] { ThreadSocketHandler(shard, mn_sync); });
+    }
+    if (m_socket_shards.size() > 1) {
+        LogPrintf("Using %d socket handler threads\n", m_socket_shards.size());
+    }
 
     if (!gArgs.GetBoolArg("-dnsseed", DEFAULT_DNSSEED))
         LogPrintf("DNS seeding disabled\n");
@@ -3627,8 +4218,10 @@ void CConnman::StopThreads()
         threadOpenAddedConnections.join();
     if (threadDNSAddressSeed.joinable())
         threadDNSAddressSeed.join();
-    if (threadSocketHandler.joinable())
-        threadSocketHandler.join();
+    for (auto& shard : m_socket_shards) {
+        if (shard->threadSocketHandler.joinable())
+            shard->threadSocketHandler.join();
+    }
 }
 
 void CConnman::StopNodes()
@@ -3656,7 +4249,7 @@ void CConnman::StopNodes()
     }
     for (ListenSocket& hListenSocket : vhListenSocket) {
         if (hListenSocket.sock) {
-            if (m_edge_trig_events && !m_edge_trig_events->RemoveSocket(hListenSocket.sock->Get())) {
+            if (auto& edge_trig_events = m_socket_shards.front()->m_edge_trig_events; edge_trig_events && !edge_trig_events->RemoveSocket(hListenSocket.sock->Get())) {
                 LogPrintf("EdgeTriggeredEvents::RemoveSocket() failed\n");
             }
         }
@@ -3672,24 +4265,29 @@ void CConnman::StopNodes()
         DeleteNode(pnode);
     }
     WITH_LOCK(cs_mapSocketToNode, mapSocketToNode.clear());
-    {
-        LOCK(cs_sendable_receivable_nodes);
-        mapReceivableNodes.clear();
-    }
-    {
-        LOCK(cs_mapNodesWithDataToSend);
-        mapNodesWithDataToSend.clear();
+    for (auto& shard : m_socket_shards) {
+        {
+            LOCK(shard->cs_sendable_receivable_nodes);
+            shard->mapReceivableNodes.clear();
+        }
+        {
+            LOCK(shard->cs_mapNodesWithDataToSend);
+            shard->mapNodesWithDataToSend.clear();
+        }
+        shard->m_num_nodes = 0;
     }
     m_nodes_disconnected.clear();
     vhListenSocket.clear();
     semOutbound.reset();
     semAddnode.reset();
-    /**
-     * m_wakeup_pipe must be reset *before* m_edge_trig_events as it may
-     * attempt to call EdgeTriggeredEvents::UnregisterPipe() in its destructor
-     */
-    m_wakeup_pipe.reset();
-    m_edge_trig_events.reset();
+    for (auto& shard : m_socket_shards) {
+        /**
+         * m_wakeup_pipe must be reset *before* m_edge_trig_events as it may
+         * attempt to call EdgeTriggeredEvents::UnregisterPipe() in its destructor
+         */
+        shard->m_wakeup_pipe.reset();
+        shard->m_edge_trig_events.reset();
+    }
 }
 
 void CConnman::DeleteNode(CNode* pnode)
@@ -4132,9 +4730,13 @@ CNode::CNode(NodeId idIn,
              const std::string& addrNameIn,
              ConnectionType conn_type_in,
              bool inbound_onion,
-             std::unique_ptr<i2p::sam::Session>&& i2p_sam_session)
-    : m_deserializer{std::make_unique<V1TransportDeserializer>(V1TransportDeserializer(Params(), idIn, SER_NETWORK, INIT_PROTO_VERSION))},
-      m_serializer{std::make_unique<V1TransportSerializer>(V1TransportSerializer())},
+             std::unique_ptr<i2p::sam::Session>&& i2p_sam_session,
+             bool use_v2transport)
+    : m_v2_transport{use_v2transport ? std::make_shared<V2Transport>(Params(), idIn, /*initiator=*/conn_type_in != ConnectionType::INBOUND) : nullptr},
+      m_deserializer{m_v2_transport ? std::unique_ptr<TransportDeserializer>{std::make_unique<V2TransportDeserializer>(m_v2_transport, Params(), idIn, SER_NETWORK, INIT_PROTO_VERSION)}
+                                    : std::make_unique<V1TransportDeserializer>(V1TransportDeserializer(Params(), idIn, SER_NETWORK, INIT_PROTO_VERSION))},
+      m_serializer{m_v2_transport ? std::unique_ptr<const TransportSerializer>{std::make_unique<V2TransportSerializer>(m_v2_transport)}
+                                  : std::make_unique<V1TransportSerializer>()},
       m_sock{sock},
       m_connected{GetTime<std::chrono::seconds>()},
       addr{addrIn},
@@ -4166,51 +4768,117 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
     return pnode && pnode->fSuccessfullyConnected && !pnode->fDisconnect;
 }
 
-void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
+void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg, std::optional<SendPriority> priority)
+{
+    // the payload is moved, not copied, and only hashed if the transport checksums with the hash
+    PushMessage(pnode, CSharedNetMsg{std::move(msg), pnode->m_serializer->UsesPayloadHash()}, priority);
+}
+
+void CConnman::PushMessage(CNode* pnode, const CSharedNetMsg& msg, std::optional<SendPriority> priority)
 {
     AssertLockNotHeld(m_total_bytes_sent_mutex);
-    size_t nMessageSize = msg.data.size();
+    size_t nMessageSize = msg.data->size();
     LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n", SanitizeString(msg.m_type), nMessageSize, pnode->GetId());
     if (gArgs.GetBoolArg("-capturemessages", false)) {
-        CaptureMessage(pnode->addr, msg.m_type, msg.data, /* incoming */ false);
+        CaptureMessage(pnode->addr, msg.m_type, *msg.data, /* incoming */ false);
     }
 
-    // make sure we use the appropriate network transport format
-    std::vector<unsigned char> serializedHeader;
-    pnode->m_serializer->prepareForTransport(msg, serializedHeader);
-
-    size_t nTotalSize = nMessageSize + serializedHeader.size();
-    statsClient.count("bandwidth.message." + SanitizeString(msg.m_type.c_str()) + ".bytesSent", nTotalSize, 1.0f);
-    statsClient.inc("message.sent." + SanitizeString(msg.m_type.c_str()), 1.0f);
-
     {
         LOCK(pnode->cs_vSend);
-        bool hasPendingData = !pnode->vSendMsg.empty();
+        const bool hasPendingData = pnode->nSendMsgSize != 0;
+        const size_t queue = static_cast<size_t>(priority.value_or(GetSendPriority(msg.m_type)));
+        pnode->m_send_queues[queue].push_back(msg);
+        pnode->m_send_queue_bytes[queue] += nMessageSize;
+        pnode->nSendSize += nMessageSize;
+        if (pnode->nSendSize > nSendBufferMaxSize) pnode->fPauseSend = true;
+        // Usually the window has room and the message goes straight through, the queues only fill up
+        // while the peer reads slower than we send
+        FillSendWindow(*pnode);
+        ScheduleSend(*pnode, hasPendingData);
+    }
+}
+
+void CConnman::FillSendWindow(CNode& node)
+{
+    AssertLockHeld(node.cs_vSend);
+    while (node.m_send_window_size < SEND_WINDOW_SIZE) {
+        const auto queue = std::find_if(node.m_send_queues.begin(), node.m_send_queues.end(),
+                                        [](const auto& q) { return !q.empty(); });
+        if (queue == node.m_send_queues.end()) break;
+        const size_t priority = std::distance(node.m_send_queues.begin(), queue);
+        const CSharedNetMsg msg{std::move(queue->front())};
+        queue->pop_front();
+        const size_t nMessageSize = msg.data->size();
+        node.m_send_queue_bytes[priority] -= nMessageSize;
+        node.nSendSize -= nMessageSize;
+        ++node.m_sent_msgs_by_priority[priority];
+
+        // make sure we use the appropriate network transport format, encrypting transports need to see
+        // messages in the order they go on the wire
+        std::vector<CSharedNetData> buffers;
+        node.m_serializer->prepareForWire(msg, buffers);
+        size_t nTotalSize = 0;
+        for (const auto& buffer : buffers) {
+            nTotalSize += buffer->size();
+        }
 
         //log total amount of bytes per message type
-        pnode->mapSendBytesPerMsgType[msg.m_type] += nTotalSize;
-        pnode->nSendSize += nTotalSize;
+        node.mapSendBytesPerMsgType[msg.m_type] += nTotalSize;
+        QueueSendBuffers(node, std::move(buffers), nMessageSize);
 
-        if (pnode->nSendSize > nSendBufferMaxSize) pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
-        if (nMessageSize) pnode->vSendMsg.push_back(std::move(msg.data));
-        pnode->nSendMsgSize = pnode->vSendMsg.size();
+        statsClient.count("bandwidth.message." + SanitizeString(msg.m_type.c_str()) + ".bytesSent", nTotalSize, 1.0f);
+        statsClient.inc("message.sent." + SanitizeString(msg.m_type.c_str()), 1.0f);
+    }
+    UpdateSendMsgSize(node);
+}
 
-        {
-            LOCK(cs_mapNodesWithDataToSend);
-            // we're not holding m_nodes_mutex here, so there is a chance of this node being disconnected shortly before
-            // we get here. Whoever called PushMessage still has a ref to CNode*, but will later Release() it, so we
-            // might end up having an entry in mapNodesWithDataToSend that is not in m_nodes anymore. We need to
-            // Add/Release refs when adding/erasing mapNodesWithDataToSend.
-            if (mapNodesWithDataToSend.emplace(pnode->GetId(), pnode).second) {
-                pnode->AddRef();
-            }
-        }
+void CConnman::QueueSendBuffers(CNode& node, std::vector<CSharedNetData>&& buffers, size_t nPayloadSize)
+{
+    AssertLockHeld(node.cs_vSend);
+    node.m_send_payload_bytes += nPayloadSize;
+    for (auto& buffer : buffers) {
+        node.nSendSize += buffer->size();
+        node.m_send_window_size += buffer->size();
+        node.m_send_queued_bytes += buffer->size();
+        node.vSendMsg.push_back(std::move(buffer));
+    }
+    if (node.nSendSize > nSendBufferMaxSize) node.fPauseSend = true;
+    UpdateSendMsgSize(node);
+}
+
+void CConnman::ScheduleSend(CNode& node, bool hasPendingData)
+{
+    AssertLockHeld(node.cs_vSend);
+    if (node.nSendMsgSize == 0) return;
 
-        // wake up select() call in case there was no pending data before (so it was not selecting this socket for sending)
-        if (!hasPendingData && (m_wakeup_pipe && m_wakeup_pipe->m_need_wakeup.load()))
-            m_wakeup_pipe->Write();
+    auto& shard = GetSocketShard(node);
+    {
+        LOCK(shard.cs_mapNodesWithDataToSend);
+        // we're not holding m_nodes_mutex here, so there is a chance of this node being disconnected shortly before
+        // we get here. Whoever called PushMessage still has a ref to CNode*, but will later Release() it, so we
+        // might end up having an entry in mapNodesWithDataToSend that is not in m_nodes anymore. We need to
+        // Add/Release refs when adding/erasing mapNodesWithDataToSend.
+        if (shard.mapNodesWithDataToSend.emplace(node.GetId(), &node).second) {
+            node.AddRef();
+        }
     }
+
+    // wake up select() call in case there was no pending data before (so it was not selecting this socket for sending)
+    if (!hasPendingData && (shard.m_wakeup_pipe && shard.m_wakeup_pipe->m_need_wakeup.load()))
+        shard.m_wakeup_pipe->Write();
+}
+
+void CConnman::PushTransportBytes(CNode& node)
+{
+    if (!node.m_v2_transport) return;
+    LOCK(node.cs_vSend);
+    std::vector<unsigned char> bytes;
+    if (!node.m_v2_transport->GetBytesToSend(bytes)) return;
+    const bool hasPendingData = node.nSendMsgSize != 0;
+    std::vector<CSharedNetData> buffers;
+    buffers.push_back(std::make_shared<const std::vector<unsigned char>>(std::move(bytes)));
+    QueueSendBuffers(node, std::move(buffers), /*nPayloadSize=*/0);
+    ScheduleSend(node, hasPendingData);
 }
 
 bool CConnman::ForNode(const CService& addr, std::function<bool(const CNode* pnode)> cond, std::function<bool(CNode* pnode)> func)
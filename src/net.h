@@ -7,6 +7,7 @@
 #define BITCOIN_NET_H
 
 #include <addrman.h>
+#include <bip324.h>
 #include <bloom.h>
 #include <chainparams.h>
 #include <compat.h>
@@ -34,6 +35,8 @@
 #include <util/wpipe.h>
 #include <consensus/params.h>
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <condition_variable>
 #include <cstdint>
@@ -117,6 +120,12 @@ static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
 #else
 #define DEFAULT_SOCKETEVENTS "select"
 #endif
+/** Default for -socketthreads, the number of threads servicing peer sockets */
+static const int DEFAULT_SOCKET_THREADS = 1;
+/** Maximum for -socketthreads */
+static const int MAX_SOCKET_THREADS = 16;
+/** Default for -v2transport */
+static const bool DEFAULT_V2_TRANSPORT{false};
 
 typedef int64_t NodeId;
 
@@ -144,6 +153,37 @@ struct CSerializedNetMsg
     std::string m_type;
 };
 
+/** Immutable serialized bytes, a payload can sit in the send queues of many peers at once */
+using CSharedNetData = std::shared_ptr<const std::vector<unsigned char>>;
+
+/** A serialized message with an immutable payload that can be pushed to many peers without copying it */
+struct CSharedNetMsg
+{
+    explicit CSharedNetMsg(CSerializedNetMsg&& msg, bool hash_payload = true) :
+        data{std::make_shared<const std::vector<unsigned char>>(std::move(msg.data))},
+        m_payload_hash{hash_payload ? std::make_optional(Hash(*data)) : std::nullopt},
+        m_type{std::move(msg.m_type)}
+    {}
+
+    CSharedNetData data;
+    /** Double SHA256 of the payload, computed once however many peers the message goes to. Left out when
+     *  the only recipient's transport doesn't checksum with it */
+    std::optional<uint256> m_payload_hash;
+    std::string m_type;
+};
+
+/** Send queue classes of a peer, lower classes go out first. Messages are only reordered at message
+ *  boundaries, a message that started going out is always finished first. */
+enum class SendPriority : uint8_t {
+    LLMQ,   //!< LLMQ signing, InstantSend and ChainLock messages, latency matters for the whole network
+    NORMAL, //!< everything not in one of the other classes
+    BULK,   //!< blocks, masternode list diffs and other large replies to sync requests
+};
+static constexpr size_t SEND_PRIORITY_COUNT{3};
+
+SendPriority GetSendPriority(const std::string& msg_type);
+std::string SendPriorityAsString(SendPriority priority);
+
 /** Different types of connections to a peer. This enum encapsulates the
  * information we have available at the time of opening or accepting the
  * connection. Aside from INBOUND, all types are initiated by us.
@@ -277,6 +317,13 @@ extern std::map<CNetAddr, LocalServiceInfo> mapLocalHost GUARDED_BY(g_maplocalho
 extern const std::string NET_MESSAGE_TYPE_OTHER;
 using mapMsgTypeSize = std::map</* message type */ std::string, /* total bytes */ uint64_t>;
 
+struct CNodeSendQueueStats
+{
+    uint64_t m_queued_msgs{0};
+    uint64_t m_queued_bytes{0};
+    uint64_t m_sent_msgs{0};
+};
+
 class CNodeStats
 {
 public:
@@ -300,6 +347,12 @@ public:
     mapMsgTypeSize mapSendBytesPerMsgType;
     uint64_t nRecvBytes;
     mapMsgTypeSize mapRecvBytesPerMsgType;
+    // Headers, checksums, encryption tags and handshake bytes
+    uint64_t nSendOverheadBytes;
+    uint64_t nRecvOverheadBytes;
+    std::string m_transport_type;
+    std::string m_session_id;
+    std::array<CNodeSendQueueStats, SEND_PRIORITY_COUNT> m_send_queue_stats;
     NetPermissionFlags m_permissionFlags;
     bool m_legacyWhitelisted;
     std::chrono::microseconds m_last_ping_time;
@@ -366,6 +419,8 @@ private:
     const NodeId m_node_id; // Only for logging
     mutable CHash256 hasher;
     mutable uint256 data_hash;
+    bool m_crc32c{false};           // the peer sent sendcrc32c, checksums are CRC32C from then on
+    uint32_t m_crc{0};              // CRC32C of the data received so far
     bool in_data;                   // parsing header (false) or data (true)
     CDataStream hdrbuf;             // partially received header
     CMessageHeader hdr;             // complete header
@@ -386,6 +441,7 @@ private:
         nDataPos = 0;
         data_hash.SetNull();
         hasher.Reset();
+        m_crc = 0;
     }
 
 public:
@@ -427,13 +483,176 @@ public:
 class TransportSerializer {
 public:
     // prepare message for transport (header construction, error-correction computation, payload encryption, etc.)
-    virtual void prepareForTransport(CSerializedNetMsg& msg, std::vector<unsigned char>& header) const = 0;
+    virtual void prepareForTransport(const std::string& msg_type, Span<const unsigned char> payload, const uint256& payload_hash,
+                                     std::vector<unsigned char>& header) const = 0;
+    void prepareForTransport(const CSharedNetMsg& msg, std::vector<unsigned char>& header) const
+    {
+        prepareForTransport(msg.m_type, *msg.data,
+                            msg.m_payload_hash ? *msg.m_payload_hash : (UsesPayloadHash() ? Hash(*msg.data) : uint256{}), header);
+    }
+    void prepareForTransport(CSerializedNetMsg& msg, std::vector<unsigned char>& header) const
+    {
+        prepareForTransport(msg.m_type, msg.data, Hash(msg.data), header);
+    }
+    // append the buffers that go on the wire for msg, by default the header followed by the shared payload
+    virtual void prepareForWire(const CSharedNetMsg& msg, std::vector<CSharedNetData>& buffers) const;
+    // whether prepareForTransport needs the double SHA256 of the payload, if not it may be left null
+    virtual bool UsesPayloadHash() const { return true; }
     virtual ~TransportSerializer() {}
 };
 
 class V1TransportSerializer : public TransportSerializer {
+private:
+    // Set after a sendcrc32c was framed, every later message is checksummed with CRC32C. Only ever
+    // goes from false to true, under the node's cs_vSend like all framing.
+    mutable std::atomic_bool m_crc32c{false};
+
+public:
+    using TransportSerializer::prepareForTransport;
+    void prepareForTransport(const std::string& msg_type, Span<const unsigned char> payload, const uint256& payload_hash,
+                             std::vector<unsigned char>& header) const override;
+    bool UsesPayloadHash() const override { return !m_crc32c; }
+};
+
+/** BIP324 v2 transport. After an ellswift key exchange every message is an encrypted and authenticated
+ * packet whose type is a single byte for common messages instead of the 24 byte v1 header. The serializer
+ * and deserializer of a connection share one instance. As responder it falls back to v1 when the peer
+ * opens with a v1 version message.
+ */
+class V2Transport
+{
+public:
+    static constexpr size_t MAX_GARBAGE_LEN{4095};
+    /** Largest packet contents accepted, a full size message with the long form of its type */
+    static constexpr uint32_t MAX_CONTENTS_LEN{1 + CMessageHeader::COMMAND_SIZE + MAX_PROTOCOL_MESSAGE_LENGTH};
+
+private:
+    enum class RecvState : uint8_t {
+        KEY_MAYBE_V1,  //!< (responder) the first bytes may still turn out to be a v1 version message
+        KEY,           //!< receiving the peer's ellswift public key
+        GARB_GARBTERM, //!< receiving the peer's garbage up to its garbage terminator
+        VERSION,       //!< receiving the version packet, decoys before it are skipped
+        APP,           //!< receiving application packets
+        APP_READY,     //!< a complete message waits for GetMessage()
+        V1,            //!< fell back to v1, nothing more is parsed here
+    };
+    enum class SendState : uint8_t {
+        MAYBE_V1,      //!< (responder) nothing is sent until we know the peer speaks v2
+        AWAITING_KEY,  //!< our key and garbage are out, messages are queued until the peer's key arrives
+        READY,         //!< messages are encrypted as they are pushed
+        V1,            //!< fell back to v1
+    };
+
+    const CChainParams& m_chain_params;
+    const NodeId m_node_id; // Only for logging
+    const bool m_initiator;
+
+    mutable Mutex m_mutex;
+    BIP324Cipher m_cipher GUARDED_BY(m_mutex);
+    RecvState m_recv_state GUARDED_BY(m_mutex);
+    SendState m_send_state GUARDED_BY(m_mutex);
+
+    /** Partially received key, garbage or packet */
+    std::vector<uint8_t> m_recv_buffer GUARDED_BY(m_mutex);
+    /** Contents length of the packet being received, once it was decrypted */
+    std::optional<uint32_t> m_recv_len GUARDED_BY(m_mutex);
+    /** The peer's garbage, authenticated as AAD of its first packet */
+    std::vector<uint8_t> m_recv_garbage GUARDED_BY(m_mutex);
+    int m_recv_version GUARDED_BY(m_mutex);
+    /** The message handed out by the next GetMessage() */
+    std::string m_recv_type GUARDED_BY(m_mutex);
+    std::vector<uint8_t> m_recv_payload GUARDED_BY(m_mutex);
+    uint32_t m_recv_raw_size GUARDED_BY(m_mutex){0};
+    bool m_recv_reject GUARDED_BY(m_mutex){false};
+
+    /** Our garbage, authenticated as AAD of our version packet */
+    std::vector<uint8_t> m_send_garbage GUARDED_BY(m_mutex);
+    /** Bytes ready to go on the wire, in order */
+    std::vector<unsigned char> m_send_buffer GUARDED_BY(m_mutex);
+    /** Messages pushed before the key exchange finished */
+    std::deque<std::pair<std::string, std::vector<unsigned char>>> m_send_queue GUARDED_BY(m_mutex);
+
+    void StartSending() EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    void FinishKeyExchange() EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    void FallBackToV1() EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    void EncryptPacket(Span<const unsigned char> contents, Span<const uint8_t> aad) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    void SendMessage(const std::string& msg_type, Span<const unsigned char> payload) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    bool DecodeMessage(Span<const uint8_t> contents) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+public:
+    V2Transport(const CChainParams& chain_params, NodeId node_id, bool initiator) noexcept;
+    /** Use the given key, key encoding entropy and garbage (testing only) */
+    V2Transport(const CChainParams& chain_params, NodeId node_id, bool initiator, const CKey& key, Span<const std::byte> ent32,
+                std::vector<uint8_t> garbage) noexcept;
+
+    /** Consume received bytes up to the end of the next complete message, advances msg_bytes.
+     *  Returns the number of bytes consumed or -1 if the peer violated the protocol */
+    int Read(Span<const uint8_t>& msg_bytes) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    bool Complete() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    void SetVersion(int version) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    CNetMessage GetMessage(std::chrono::microseconds time, bool& reject_message) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** The v1 bytes that were held back while detecting the peer's transport */
+    std::vector<uint8_t> TakeV1Prefix() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Encrypt or queue a message, returns false if the connection fell back to v1 and the caller has to frame it */
+    bool PushMessage(const std::string& msg_type, Span<const unsigned char> payload) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Move the bytes that are ready to go on the wire into bytes, returns false if there are none */
+    bool GetBytesToSend(std::vector<unsigned char>& bytes) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    bool IsV1() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** "v2" once the key exchange finished, "v1" after a fallback and "detecting" before that */
+    std::string GetTransportType() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Hex encoded session id, empty until the key exchange finished */
+    std::string GetSessionID() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+};
+
+class V2TransportDeserializer final : public TransportDeserializer
+{
+private:
+    const std::shared_ptr<V2Transport> m_transport;
+    V1TransportDeserializer m_v1_deserializer;
+    bool m_v1{false};
+
+public:
+    V2TransportDeserializer(std::shared_ptr<V2Transport> transport, const CChainParams& chain_params, const NodeId node_id, int nTypeIn, int nVersionIn)
+        : m_transport{std::move(transport)},
+          m_v1_deserializer{chain_params, node_id, nTypeIn, nVersionIn}
+    {
+    }
+
+    bool Complete() const override
+    {
+        return m_v1 ? m_v1_deserializer.Complete() : m_transport->Complete();
+    }
+    void SetVersion(int nVersionIn) override
+    {
+        m_v1_deserializer.SetVersion(nVersionIn);
+        m_transport->SetVersion(nVersionIn);
+    }
+    int Read(Span<const uint8_t>& msg_bytes) override;
+    CNetMessage GetMessage(std::chrono::microseconds time, bool& reject_message) override
+    {
+        return m_v1 ? m_v1_deserializer.GetMessage(time, reject_message) : m_transport->GetMessage(time, reject_message);
+    }
+};
+
+class V2TransportSerializer final : public TransportSerializer {
+private:
+    const std::shared_ptr<V2Transport> m_transport;
+    V1TransportSerializer m_v1_serializer;
+
 public:
-    void prepareForTransport(CSerializedNetMsg& msg, std::vector<unsigned char>& header) const override;
+    explicit V2TransportSerializer(std::shared_ptr<V2Transport> transport) : m_transport{std::move(transport)} {}
+
+    using TransportSerializer::prepareForTransport;
+    // v1 framing, only used after the connection fell back to v1
+    void prepareForTransport(const std::string& msg_type, Span<const unsigned char> payload, const uint256& payload_hash,
+                             std::vector<unsigned char>& header) const override
+    {
+        m_v1_serializer.prepareForTransport(msg_type, payload, payload_hash, header);
+    }
+    void prepareForWire(const CSharedNetMsg& msg, std::vector<CSharedNetData>& buffers) const override;
+    bool UsesPayloadHash() const override { return m_transport->IsV1() && m_v1_serializer.UsesPayloadHash(); }
 };
 
 /** Information about a peer */
@@ -443,6 +662,8 @@ class CNode
     friend struct ConnmanTestMsg;
 
 public:
+    /** Set for BIP324 v2 connections, shared by m_deserializer and m_serializer */
+    const std::shared_ptr<V2Transport> m_v2_transport;
     const std::unique_ptr<TransportDeserializer> m_deserializer; // Used only by SocketHandler thread
     const std::unique_ptr<const TransportSerializer> m_serializer;
 
@@ -459,12 +680,24 @@ public:
      */
     std::shared_ptr<Sock> m_sock GUARDED_BY(m_sock_mutex);
 
-    /** Total size of all vSendMsg entries */
+    /** Total size of all vSendMsg entries and of the payloads in m_send_queues */
     size_t nSendSize GUARDED_BY(cs_vSend){0};
     /** Offset inside the first vSendMsg already sent */
     size_t nSendOffset GUARDED_BY(cs_vSend){0};
+    /** Size of the vSendMsg entries that were not sent yet */
+    size_t m_send_window_size GUARDED_BY(cs_vSend){0};
     uint64_t nSendBytes GUARDED_BY(cs_vSend){0};
-    std::list<std::vector<unsigned char>> vSendMsg GUARDED_BY(cs_vSend);
+    /** Bytes queued for sending and the message payloads among them, the difference is transport overhead */
+    uint64_t m_send_queued_bytes GUARDED_BY(cs_vSend){0};
+    uint64_t m_send_payload_bytes GUARDED_BY(cs_vSend){0};
+    // Messages waiting for their turn, one queue per SendPriority. They are only framed for the transport when
+    // they move on to vSendMsg, so encrypting transports still see them in wire order.
+    std::array<std::deque<CSharedNetMsg>, SEND_PRIORITY_COUNT> m_send_queues GUARDED_BY(cs_vSend);
+    std::array<size_t, SEND_PRIORITY_COUNT> m_send_queue_bytes GUARDED_BY(cs_vSend){};
+    std::array<uint64_t, SEND_PRIORITY_COUNT> m_sent_msgs_by_priority GUARDED_BY(cs_vSend){};
+    // Message headers and payloads in the order they go on the wire, payloads may be shared with other nodes
+    std::list<CSharedNetData> vSendMsg GUARDED_BY(cs_vSend);
+    // Number of vSendMsg entries and queued messages, zero when there is nothing to send
     std::atomic<size_t> nSendMsgSize{0};
     Mutex cs_vSend;
     Mutex m_sock_mutex;
@@ -477,6 +710,8 @@ public:
     RecursiveMutex cs_sendProcessing;
 
     uint64_t nRecvBytes GUARDED_BY(cs_vRecv){0};
+    /** Payload bytes of received messages, nRecvBytes minus this is transport overhead */
+    uint64_t m_recv_payload_bytes GUARDED_BY(cs_vRecv){0};
 
     std::atomic<std::chrono::seconds> m_last_send{0s};
     std::atomic<std::chrono::seconds> m_last_recv{0s};
@@ -537,6 +772,9 @@ public:
     std::atomic_bool fHasRecvData{false};
     std::atomic_bool fCanSendData{false};
 
+    // Index of the socket handler shard servicing this node, set before the socket is registered
+    size_t m_socket_shard{0};
+
     /**
      * Get network the peer connected through.
      *
@@ -658,7 +896,8 @@ public:
           const std::string &addrNameIn,
           ConnectionType conn_type_in,
           bool inbound_onion,
-          std::unique_ptr<i2p::sam::Session>&& i2p_sam_session = nullptr);
+          std::unique_ptr<i2p::sam::Session>&& i2p_sam_session = nullptr,
+          bool use_v2transport = false);
     CNode(const CNode&) = delete;
     CNode& operator=(const CNode&) = delete;
 
@@ -894,7 +1133,9 @@ public:
         std::vector<std::string> m_specified_outgoing;
         std::vector<std::string> m_added_nodes;
         SocketEventsMode socketEventsMode = SocketEventsMode::Select;
+        int nSocketThreads = DEFAULT_SOCKET_THREADS;
         bool m_i2p_accept_incoming;
+        bool m_use_v2transport = DEFAULT_V2_TRANSPORT;
     };
 
     void Init(const Options& connOptions) EXCLUSIVE_LOCKS_REQUIRED(!m_added_nodes_mutex, !m_total_bytes_sent_mutex)
@@ -925,7 +1166,16 @@ public:
             m_added_nodes = connOptions.m_added_nodes;
         }
         socketEventsMode = connOptions.socketEventsMode;
+        m_use_v2transport = connOptions.m_use_v2transport;
         m_onion_binds = connOptions.onion_binds;
+        // Shards can only be (re)created while no socket handler thread is running
+        const size_t nShards = std::clamp(connOptions.nSocketThreads, 1, MAX_SOCKET_THREADS);
+        if (m_socket_shards.size() != nShards) {
+            m_socket_shards.clear();
+            for (size_t i = 0; i < nShards; ++i) {
+                m_socket_shards.push_back(std::make_unique<SocketShard>(i));
+            }
+        }
     }
 
     CConnman(uint64_t seed0, uint64_t seed1, AddrMan& addrman, bool network_active = true);
@@ -1005,7 +1255,12 @@ public:
 
     bool IsMasternodeOrDisconnectRequested(const CService& addr);
 
-    void PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
+    /** Queue a message in the send class of its type, or in `priority` when it belongs to a reply whose
+     *  messages must reach the peer in order, like a merkleblock and its matched transactions */
+    void PushMessage(CNode* pnode, CSerializedNetMsg&& msg, std::optional<SendPriority> priority = std::nullopt)
+        EXCLUSIVE_LOCKS_REQUIRED(!mutexMsgProc, !m_total_bytes_sent_mutex);
+    /** Queue a message whose payload is shared with other peers, only the header is created per peer */
+    void PushMessage(CNode* pnode, const CSharedNetMsg& msg, std::optional<SendPriority> priority = std::nullopt)
         EXCLUSIVE_LOCKS_REQUIRED(!mutexMsgProc, !m_total_bytes_sent_mutex);
 
     template<typename Condition, typename Callable>
@@ -1247,6 +1502,8 @@ public:
     };
 
 private:
+    struct SocketShard;
+
     struct ListenSocket {
     public:
         std::shared_ptr<Sock> sock;
@@ -1302,19 +1559,22 @@ private:
 
     /**
      * Generate a collection of sockets to check for IO readiness.
+     * @param[in] shard Shard the sockets are generated for, listening sockets belong to the first one.
      * @param[in] nodes Select from these nodes' sockets.
      * @param[out] recv_set Sockets to check for read readiness.
      * @param[out] send_set Sockets to check for write readiness.
      * @param[out] error_set Sockets to check for errors.
      * @return true if at least one socket is to be checked (the returned set is not empty)
      */
-    bool GenerateSelectSet(const std::vector<CNode*>& nodes,
+    bool GenerateSelectSet(const SocketShard& shard,
+                           const std::vector<CNode*>& nodes,
                            std::set<SOCKET>& recv_set,
                            std::set<SOCKET>& send_set,
                            std::set<SOCKET>& error_set);
 
     /**
      * Check which sockets are ready for IO.
+     * @param[in] shard Socket handler shard to wait on.
      * @param[in] nodes Select from these nodes' sockets (in supported event methods).
      * @param[in] only_poll Permit zero timeout polling
      * @param[out] recv_set Sockets which are ready for read.
@@ -1322,32 +1582,44 @@ private:
      * @param[out] error_set Sockets which have errors.
      * This calls `GenerateSelectSet()` to gather a list of sockets to check.
      */
-    void SocketEvents(const std::vector<CNode*>& nodes,
+    void SocketEvents(SocketShard& shard,
+                      const std::vector<CNode*>& nodes,
                       std::set<SOCKET>& recv_set,
                       std::set<SOCKET>& send_set,
                       std::set<SOCKET>& error_set,
                       bool only_poll);
 
 #ifdef USE_KQUEUE
-    void SocketEventsKqueue(std::set<SOCKET>& recv_set,
+    void SocketEventsKqueue(SocketShard& shard,
+                            std::set<SOCKET>& recv_set,
                             std::set<SOCKET>& send_set,
                             std::set<SOCKET>& error_set,
                             bool only_poll);
 #endif
 #ifdef USE_EPOLL
-    void SocketEventsEpoll(std::set<SOCKET>& recv_set,
+    void SocketEventsEpoll(SocketShard& shard,
+                           std::set<SOCKET>& recv_set,
                            std::set<SOCKET>& send_set,
                            std::set<SOCKET>& error_set,
                            bool only_poll);
 #endif
+#ifdef USE_IO_URING
+    void SocketEventsIOUring(SocketShard& shard,
+                             std::set<SOCKET>& recv_set,
+                             std::set<SOCKET>& send_set,
+                             std::set<SOCKET>& error_set,
+                             bool only_poll);
+#endif
 #ifdef USE_POLL
-    void SocketEventsPoll(const std::vector<CNode*>& nodes,
+    void SocketEventsPoll(SocketShard& shard,
+                          const std::vector<CNode*>& nodes,
                           std::set<SOCKET>& recv_set,
                           std::set<SOCKET>& send_set,
                           std::set<SOCKET>& error_set,
                           bool only_poll);
 #endif
-    void SocketEventsSelect(const std::vector<CNode*>& nodes,
+    void SocketEventsSelect(SocketShard& shard,
+                            const std::vector<CNode*>& nodes,
                             std::set<SOCKET>& recv_set,
                             std::set<SOCKET>& send_set,
                             std::set<SOCKET>& error_set,
@@ -1355,16 +1627,19 @@ private:
 
     /**
      * Check connected and listening sockets for IO readiness and process them accordingly.
+     * Only the first shard accepts new connections.
      */
-    void SocketHandler(CMasternodeSync& mn_sync) EXCLUSIVE_LOCKS_REQUIRED(!m_total_bytes_sent_mutex, !mutexMsgProc);
+    void SocketHandler(SocketShard& shard, CMasternodeSync& mn_sync) EXCLUSIVE_LOCKS_REQUIRED(!m_total_bytes_sent_mutex, !mutexMsgProc);
 
     /**
      * Do the read/write for connected sockets that are ready for IO.
+     * @param[in] shard Shard the sockets belong to.
      * @param[in] recv_set Sockets that are ready for read.
      * @param[in] send_set Sockets that are ready for send.
      * @param[in] error_set Sockets that have an exceptional condition (error).
      */
-    void SocketHandlerConnected(const std::set<SOCKET>& recv_set,
+    void SocketHandlerConnected(SocketShard& shard,
+                                const std::set<SOCKET>& recv_set,
                                 const std::set<SOCKET>& send_set,
                                 const std::set<SOCKET>& error_set)
         EXCLUSIVE_LOCKS_REQUIRED(!m_total_bytes_sent_mutex, !mutexMsgProc);
@@ -1376,7 +1651,11 @@ private:
     void SocketHandlerListening(const std::set<SOCKET>& recv_set, CMasternodeSync& mn_sync)
         EXCLUSIVE_LOCKS_REQUIRED(!mutexMsgProc);
 
-    void ThreadSocketHandler(CMasternodeSync& mn_sync) EXCLUSIVE_LOCKS_REQUIRED(!m_total_bytes_sent_mutex, !mutexMsgProc);
+    /**
+     * Main loop of a socket handler thread. The thread of the first shard also runs the
+     * inactivity checks and disconnects nodes for all shards.
+     */
+    void ThreadSocketHandler(SocketShard& shard, CMasternodeSync& mn_sync) EXCLUSIVE_LOCKS_REQUIRED(!m_total_bytes_sent_mutex, !mutexMsgProc);
     void ThreadDNSAddressSeed() EXCLUSIVE_LOCKS_REQUIRED(!m_addr_fetches_mutex, !m_nodes_mutex);
     void ThreadOpenMasternodeConnections(CDeterministicMNManager& dmnman, CMasternodeMetaMan& mn_metaman,
                                          CMasternodeSync& mn_sync)
@@ -1405,6 +1684,14 @@ private:
     NodeId GetNewNodeId();
 
     size_t SocketSendData(CNode& node) EXCLUSIVE_LOCKS_REQUIRED(node.cs_vSend);
+    /** Append framed buffers to vSendMsg, after everything that is already committed to the wire */
+    void QueueSendBuffers(CNode& node, std::vector<CSharedNetData>&& buffers, size_t nPayloadSize) EXCLUSIVE_LOCKS_REQUIRED(node.cs_vSend);
+    /** Frame queued messages, highest priority first, and move them to vSendMsg until the send window is full */
+    void FillSendWindow(CNode& node) EXCLUSIVE_LOCKS_REQUIRED(node.cs_vSend);
+    /** Make the socket handler pick the node up if it has anything to send */
+    void ScheduleSend(CNode& node, bool hasPendingData) EXCLUSIVE_LOCKS_REQUIRED(node.cs_vSend);
+    /** Queue the bytes a v2 transport produced on its own, e.g. during the handshake */
+    void PushTransportBytes(CNode& node) EXCLUSIVE_LOCKS_REQUIRED(!node.cs_vSend);
     size_t SocketRecvData(CNode* pnode) EXCLUSIVE_LOCKS_REQUIRED(!mutexMsgProc);
     void DumpAddresses();
 
@@ -1556,28 +1843,52 @@ private:
     std::unique_ptr<i2p::sam::Session> m_i2p_sam_session;
 
     SocketEventsMode socketEventsMode;
-    std::unique_ptr<EdgeTriggeredEvents> m_edge_trig_events{nullptr};
-    std::unique_ptr<WakeupPipe> m_wakeup_pipe{nullptr};
 
-    template <typename Callable>
-    void ToggleWakeupPipe(Callable&& func)
+    /** Offer BIP324 v2 to inbound peers and use it with outbound peers that signal NODE_P2P_V2 */
+    bool m_use_v2transport{DEFAULT_V2_TRANSPORT};
+
+    /**
+     * Sockets of connected nodes are split among -socketthreads shards, each with its own thread,
+     * events instance and wakeup pipe. New nodes go to the shard servicing the fewest nodes.
+     */
+    struct SocketShard
     {
-        if (m_wakeup_pipe) {
-            m_wakeup_pipe->Toggle(func);
-        } else {
-            func();
+        explicit SocketShard(size_t id) : m_id(id), m_thread_name(id == 0 ? "net" : strprintf("net.%d", id)) {}
+
+        const size_t m_id;
+        const std::string m_thread_name;
+        std::unique_ptr<EdgeTriggeredEvents> m_edge_trig_events{nullptr};
+        std::unique_ptr<WakeupPipe> m_wakeup_pipe{nullptr};
+        std::atomic<size_t> m_num_nodes{0};
+
+        Mutex cs_sendable_receivable_nodes;
+        std::unordered_map<NodeId, CNode*> mapReceivableNodes GUARDED_BY(cs_sendable_receivable_nodes);
+        std::unordered_map<NodeId, CNode*> mapSendableNodes GUARDED_BY(cs_sendable_receivable_nodes);
+        /** Protected by cs_mapNodesWithDataToSend */
+        std::unordered_map<NodeId, CNode*> mapNodesWithDataToSend GUARDED_BY(cs_mapNodesWithDataToSend);
+        mutable RecursiveMutex cs_mapNodesWithDataToSend;
+
+        std::thread threadSocketHandler;
+
+        template <typename Callable>
+        void ToggleWakeupPipe(Callable&& func)
+        {
+            if (m_wakeup_pipe) {
+                m_wakeup_pipe->Toggle(func);
+            } else {
+                func();
+            }
         }
-    }
+    };
+    std::vector<std::unique_ptr<SocketShard>> m_socket_shards;
 
-    Mutex cs_sendable_receivable_nodes;
-    std::unordered_map<NodeId, CNode*> mapReceivableNodes GUARDED_BY(cs_sendable_receivable_nodes);
-    std::unordered_map<NodeId, CNode*> mapSendableNodes GUARDED_BY(cs_sendable_receivable_nodes);
-    /** Protected by cs_mapNodesWithDataToSend */
-    std::unordered_map<NodeId, CNode*> mapNodesWithDataToSend GUARDED_BY(cs_mapNodesWithDataToSend);
-    mutable RecursiveMutex cs_mapNodesWithDataToSend;
+    SocketShard& GetSocketShard(const CNode& node) const { return *m_socket_shards[node.m_socket_shard]; }
+    /** Pick the shard servicing the fewest nodes for a new connection, must be set before anything is pushed to the node */
+    size_t PickSocketShard();
+    /** Register the socket of a new node for events with its shard and wake the shard up */
+    void RegisterSocketEvents(CNode& node) EXCLUSIVE_LOCKS_REQUIRED(node.m_sock_mutex);
 
     std::thread threadDNSAddressSeed;
-    std::thread threadSocketHandler;
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
     std::thread threadOpenMasternodeConnections;
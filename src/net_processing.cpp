@@ -19,14 +19,17 @@
 #include <netbase.h>
 #include <net_types.h>
 #include <node/blockstorage.h>
+#include <node/txreconciliation.h>
 #include <policy/policy.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <random.h>
+#include <saltedhasher.h>
 #include <reverse_iterator.h>
 #include <scheduler.h>
 #include <streams.h>
 #include <tinyformat.h>
+#include <unordered_lru_cache.h>
 #include <index/txindex.h>
 #include <txmempool.h>
 #include <util/check.h> // For NDEBUG compile time check
@@ -36,6 +39,7 @@
 #include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <list>
 #include <memory>
 #include <optional>
@@ -51,6 +55,8 @@
 #include <coinjoin/context.h>
 #include <coinjoin/server.h>
 
+#include <bls/bls_worker.h>
+#include <ctpl_stl.h>
 #include <evo/deterministicmns.h>
 #include <evo/mnauth.h>
 #include <evo/simplifiedmns.h>
@@ -354,6 +360,10 @@ struct Peer {
     /** Set of txids to reconsider once their parent transactions have been accepted **/
     std::set<uint256> m_orphan_work_set GUARDED_BY(g_cs_orphans);
 
+    /** Set while one of this peer's messages is processed on m_msgproc_pool. Nothing else of this peer
+     *  is processed until it is done, this keeps the peer's messages in order. */
+    std::atomic_bool m_msg_in_flight{false};
+
     /** Protects m_getdata_requests **/
     Mutex m_getdata_requests_mutex;
     /** Work queue of items requested by this peer **/
@@ -391,12 +401,16 @@ public:
     void BlockChecked(const CBlock& block, const BlockValidationState& state) override
         EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
     void NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock) override;
+    void TransactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason) override
+        EXCLUSIVE_LOCKS_REQUIRED(!m_cmpct_hint_mutex);
+    void NotifyTransactionLock(const CTransactionRef& tx, const std::shared_ptr<const llmq::CInstantSendLock>& islock) override
+        EXCLUSIVE_LOCKS_REQUIRED(!m_cmpct_hint_mutex);
 
     /** Implement NetEventsInterface */
     void InitializeNode(CNode* pnode) override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
-    void FinalizeNode(const CNode& node) override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
+    void FinalizeNode(const CNode& node) override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_msg_in_flight_mutex);
     bool ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt) override
-        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex);
+        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex, !m_msg_in_flight_mutex, !m_verified_dstxes_mutex);
     bool SendMessages(CNode* pto) override EXCLUSIVE_LOCKS_REQUIRED(pto->cs_sendProcessing)
         EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex);
 
@@ -406,6 +420,7 @@ public:
     bool GetNodeStateStats(NodeId nodeid, CNodeStateStats& stats) const override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
     bool IgnoresIncomingTxs() override { return m_ignore_incoming_txs; }
     void SendPings() override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);;
+    void StopMessageWorkers() override;
     void PushInventory(NodeId nodeid, const CInv& inv) override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
     void RelayInv(CInv &inv, const int minProtoVersion) override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
     void RelayInvFiltered(CInv &inv, const CTransaction &relatedTx, const int minProtoVersion) override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
@@ -423,6 +438,10 @@ private:
     /** Helper to process result of external handlers of message */
     void ProcessPeerMsgRet(const PeerMsgRet& ret, CNode& pfrom) EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
 
+    /** Process a message of a peer on m_msgproc_pool, releases the peer once done */
+    void ProcessMessageOnWorker(CNode& pfrom, const PeerRef& peer, CNetMessage& msg, const std::atomic<bool>& interruptMsgProc)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex, !m_msg_in_flight_mutex);
+
     /** Consider evicting an outbound peer based on the amount of time they've been behind our tip */
     void ConsiderEviction(CNode& pto, int64_t time_in_seconds) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
@@ -474,6 +493,20 @@ private:
 
     void ProcessOrphanTx(std::set<uint256>& orphan_work_set) EXCLUSIVE_LOCKS_REQUIRED(cs_main, g_cs_orphans)
         EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
+    /** Try to accept a transaction (or the transaction of a DSTX if dstx is not nullptr) received from a peer to the mempool.
+     *  If relayed_by_peer is false the transaction came from a peer that is gone, pfrom is neither credited nor punished for it. */
+    void ProcessTransaction(CNode& pfrom, Peer& peer, const CTransactionRef& ptx, const CCoinJoinBroadcastTx* dstx,
+                            bool relayed_by_peer = true)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex);
+    /** Finish processing of a DSTX whose masternode signature is known to be valid */
+    void ProcessVerifiedDSTX(CNode& pfrom, Peer& peer, const CCoinJoinBroadcastTx& dstx, bool relayed_by_peer = true)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex);
+    /** Accept the DSTXes verified by the BLS worker which came from pfrom or from peers that are gone */
+    void ProcessVerifiedDSTXes(CNode& pfrom, Peer& peer)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex, !m_verified_dstxes_mutex);
+    /** Verify the signature of a DSTX through the BLS worker, valid ones are queued in m_verified_dstxes */
+    void VerifyDSTXAsync(NodeId peer_id, const CCoinJoinBroadcastTx& dstx, const CBLSPublicKey& pubKeyOperator)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
     /** Process a single headers message from a peer. */
     void ProcessHeadersMessage(CNode& pfrom, const Peer& peer,
                                const std::vector<CBlockHeader>& headers,
@@ -675,6 +708,27 @@ private:
     Mutex m_recent_confirmed_transactions_mutex;
     CRollingBloomFilter m_recent_confirmed_transactions GUARDED_BY(m_recent_confirmed_transactions_mutex){48'000, 0.000'001};
 
+    /**
+     * Transactions that are likely to show up in upcoming blocks and are looked at before the mempool
+     * when reconstructing compact blocks: recently IS-locked ones, which the quorums already agreed on,
+     * and ones the mempool evicted (expiry, size limit) which can still be mined. They are kept here
+     * after they leave the mempool, that's what saves the getblocktxn round trip. The last
+     * -blockreconstructionhinttxn/DEFAULT_BLOCK_RECONSTRUCTION_HINT_TXN are kept in a ring buffer.
+     */
+    Mutex m_cmpct_hint_mutex;
+    std::vector<std::pair<uint256, CTransactionRef>> m_cmpct_hint_txn GUARDED_BY(m_cmpct_hint_mutex);
+    /** Offset into m_cmpct_hint_txn to insert the next tx */
+    size_t m_cmpct_hint_txn_it GUARDED_BY(m_cmpct_hint_mutex){0};
+    const size_t m_max_cmpct_hint_txn;
+
+    void AddToCompactHintTransactions(const CTransactionRef& tx) EXCLUSIVE_LOCKS_REQUIRED(!m_cmpct_hint_mutex);
+
+    /** Reconciliation based transaction relay with peers that negotiated it, nullptr if disabled (and on masternodes) */
+    std::unique_ptr<TxReconciliationTracker> m_txreconciliation;
+
+    /** Announce transactions a reconciliation found the peer to be missing, bypassing the trickle queue */
+    void PushReconciledInvs(CNode& node, const std::vector<uint256>& txids);
+
     /* Returns a bool indicating whether we requested this block.
      * Also used if a block was /not/ received and timed out or started with another peer
      */
@@ -693,6 +747,12 @@ private:
      */
     void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<const CBlockIndex*>& vBlocks, NodeId& nodeStaller) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+    /** While a UTXO snapshot is being validated in the background, add the not-in-flight missing blocks
+     *  between the background chainstate tip and the snapshot base to vBlocks, until it has at most count
+     *  entries. Only peers that know a block descending from the snapshot base are asked.
+     */
+    void FindHistoricalBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<const CBlockIndex*>& vBlocks) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
     std::map<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator> > mapBlocksInFlight GUARDED_BY(cs_main);
 
     /** When our tip was last updated. */
@@ -724,6 +784,20 @@ private:
 
     /** Number of peers from which we're downloading blocks. */
     int nPeersWithValidatedDownloads GUARDED_BY(cs_main) = 0;
+
+    /** Protects m_verified_dstxes */
+    Mutex m_verified_dstxes_mutex;
+    /** DSTXes whose signatures were verified asynchronously, with the peer they came from. They are accepted along
+     *  with the messages of that peer or, once it disconnected, of any other peer so they don't get lost. */
+    std::vector<std::pair<NodeId, CCoinJoinBroadcastTx>> m_verified_dstxes GUARDED_BY(m_verified_dstxes_mutex);
+
+    /** Signalled whenever a peer's m_msg_in_flight is cleared */
+    Mutex m_msg_in_flight_mutex;
+    std::condition_variable m_msg_in_flight_cv;
+
+    /** Workers for -msghandlerthreads, messages of different peers that don't need cs_main are processed
+     *  here concurrently (see IsParallelSafeMessage). Declared last so it's drained before anything else is destroyed. */
+    ctpl::thread_pool m_msgproc_pool;
 };
 } // namespace
 
@@ -753,6 +827,24 @@ namespace {
     static std::vector<std::pair<uint256, CTransactionRef>> vExtraTxnForCompact GUARDED_BY(g_cs_orphans);
     /** Offset into vExtraTxnForCompact to insert the next tx */
     static size_t vExtraTxnForCompactIt GUARDED_BY(g_cs_orphans) = 0;
+
+    /**
+     * Messages that may be processed on a -msghandlerthreads worker. Their handlers don't need cs_main for
+     * the bulk of their work, only touch the sending peer's own state and guard everything else with their
+     * own locks. addr is not among them, relaying it pushes into other peers' unguarded address queues.
+     */
+    bool IsParallelSafeMessage(const std::string& msg_type)
+    {
+        return msg_type == NetMsgType::QSIGSESANN ||
+               msg_type == NetMsgType::QSIGSHARESINV ||
+               msg_type == NetMsgType::QGETSIGSHARES ||
+               msg_type == NetMsgType::QBSIGSHARES ||
+               msg_type == NetMsgType::QSIGSHARE ||
+               msg_type == NetMsgType::QSIGREC ||
+               msg_type == NetMsgType::ISDLOCK ||
+               msg_type == NetMsgType::MNGOVERNANCEOBJECTVOTE ||
+               msg_type == NetMsgType::DSQUEUE;
+    }
 } // namespace
 
 namespace {
@@ -835,6 +927,12 @@ struct CNodeState {
     //! Time of last new block announcement
     int64_t m_last_block_announcement{0};
 
+    //! Compact blocks from this peer we tried to reconstruct, how many of them needed no getblocktxn
+    //! round trip and how many of their transactions came from the reconstruction hints
+    uint64_t m_cmpct_blocks{0};
+    uint64_t m_cmpct_blocks_reconstructed{0};
+    uint64_t m_cmpct_hint_txn{0};
+
     /*
      * State associated with objects download.
      *
@@ -1256,6 +1354,38 @@ void PeerManagerImpl::FindNextBlocksToDownload(NodeId nodeid, unsigned int count
         }
     }
 }
+
+void PeerManagerImpl::FindHistoricalBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<const CBlockIndex*>& vBlocks)
+{
+    if (vBlocks.size() >= count) return;
+
+    const CChainState* background{nullptr};
+    for (CChainState* chainstate : m_chainman.GetAll()) {
+        if (m_chainman.IsBackgroundIBD(chainstate)) background = chainstate;
+    }
+    if (background == nullptr) return;
+
+    const CBlockIndex* base = m_chainman.m_blockman.LookupBlockIndex(*Assert(m_chainman.SnapshotBlockhash()));
+    const CBlockIndex* tip = background->m_chain.Tip();
+    CNodeState* state = State(nodeid);
+    assert(state != nullptr);
+    if (base == nullptr || tip == nullptr || tip->nHeight >= base->nHeight ||
+        state->pindexBestKnownBlock == nullptr || state->pindexBestKnownBlock->GetAncestor(base->nHeight) != base) {
+        return;
+    }
+
+    // Same download window as for the active chain, starting at the background chainstate tip
+    std::vector<const CBlockIndex*> vToFetch;
+    for (const CBlockIndex* pindex = base->GetAncestor(std::min<int>(tip->nHeight + BLOCK_DOWNLOAD_WINDOW, base->nHeight));
+         pindex != tip; pindex = pindex->pprev) {
+        vToFetch.push_back(pindex);
+    }
+    for (const CBlockIndex* pindex : reverse_iterate(vToFetch)) {
+        if (pindex->nStatus & BLOCK_HAVE_DATA || mapBlocksInFlight.count(pindex->GetBlockHash())) continue;
+        vBlocks.push_back(pindex);
+        if (vBlocks.size() == count) return;
+    }
+}
 } // namespace
 
 void PeerManagerImpl::PushNodeVersion(CNode& pnode, const Peer& peer)
@@ -1486,6 +1616,11 @@ void PeerManagerImpl::ReattemptInitialBroadcast(CScheduler& scheduler)
 void PeerManagerImpl::FinalizeNode(const CNode& node) {
     NodeId nodeid = node.GetId();
     int misbehavior{0};
+    if (PeerRef peer = GetPeerRef(nodeid); peer != nullptr && peer->m_msg_in_flight) {
+        // Only happens on shutdown, otherwise the worker holds a reference to the node
+        WAIT_LOCK(m_msg_in_flight_mutex, lock);
+        m_msg_in_flight_cv.wait(lock, [&peer] { return !peer->m_msg_in_flight; });
+    }
     LOCK(cs_main);
     {
     {
@@ -1508,6 +1643,7 @@ void PeerManagerImpl::FinalizeNode(const CNode& node) {
         mapBlocksInFlight.erase(entry.hash);
     }
     EraseOrphansFor(nodeid);
+    if (m_txreconciliation) m_txreconciliation->ForgetPeer(nodeid);
     nPreferredDownload -= state->fPreferredDownload;
     nPeersWithValidatedDownloads -= (state->nBlocksInFlightValidHeaders != 0);
     assert(nPeersWithValidatedDownloads >= 0);
@@ -1567,6 +1703,10 @@ bool PeerManagerImpl::GetNodeStateStats(NodeId nodeid, CNodeStateStats& stats) c
             if (queue.pindex)
                 stats.vHeightInFlight.push_back(queue.pindex->nHeight);
         }
+        stats.m_cmpct_blocks = state->m_cmpct_blocks;
+        stats.m_cmpct_blocks_reconstructed = state->m_cmpct_blocks_reconstructed;
+        stats.m_cmpct_hint_txn = state->m_cmpct_hint_txn;
+        stats.m_txreconciliation = m_txreconciliation && m_txreconciliation->IsPeerRegistered(nodeid);
     }
 
     PeerRef peer = GetPeerRef(nodeid);
@@ -1614,6 +1754,17 @@ static void AddToCompactExtraTransactions(const CTransactionRef& tx) EXCLUSIVE_L
     vExtraTxnForCompactIt = (vExtraTxnForCompactIt + 1) % max_extra_txn;
 }
 
+void PeerManagerImpl::AddToCompactHintTransactions(const CTransactionRef& tx)
+{
+    if (m_max_cmpct_hint_txn == 0) return;
+    LOCK(m_cmpct_hint_mutex);
+    if (m_cmpct_hint_txn.empty()) {
+        m_cmpct_hint_txn.resize(m_max_cmpct_hint_txn);
+    }
+    m_cmpct_hint_txn[m_cmpct_hint_txn_it] = std::make_pair(tx->GetHash(), tx);
+    m_cmpct_hint_txn_it = (m_cmpct_hint_txn_it + 1) % m_max_cmpct_hint_txn;
+}
+
 bool AddOrphanTx(const CTransactionRef& tx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
 {
     const uint256& hash = tx->GetHash();
@@ -1935,7 +2086,8 @@ PeerManagerImpl::PeerManagerImpl(const CChainParams& chainparams, CConnman& conn
       m_govman(govman),
       m_sporkman(sporkman),
       m_mn_activeman(mn_activeman),
-      m_ignore_incoming_txs(ignore_incoming_txs)
+      m_ignore_incoming_txs(ignore_incoming_txs),
+      m_max_cmpct_hint_txn(std::max<int64_t>(0, gArgs.GetArg("-blockreconstructionhinttxn", DEFAULT_BLOCK_RECONSTRUCTION_HINT_TXN)))
 {
     // Stale tip checking and peer eviction are on two different timers, but we
     // don't want them to get out of sync due to drift in the scheduler, so we
@@ -1947,6 +2099,34 @@ PeerManagerImpl::PeerManagerImpl(const CChainParams& chainparams, CConnman& conn
     // schedule next run for 10-15 minutes in the future
     const std::chrono::milliseconds delta = std::chrono::minutes{10} + GetRandMillis(std::chrono::minutes{5});
     scheduler.scheduleFromNow([&] { ReattemptInitialBroadcast(scheduler); }, delta);
+
+    // Masternodes flood transactions to each other without delay, reconciling would only slow them down
+    if (gArgs.GetBoolArg("-txreconciliation", DEFAULT_TXRECONCILIATION_ENABLE) && m_mn_activeman == nullptr) {
+        m_txreconciliation = std::make_unique<TxReconciliationTracker>(TXRECONCILIATION_VERSION);
+    }
+
+    const int msgproc_threads = std::clamp<int>(gArgs.GetArg("-msghandlerthreads", DEFAULT_MSGHANDLER_THREADS), 0, MAX_MSGHANDLER_THREADS);
+    if (msgproc_threads > 0) {
+        m_msgproc_pool.resize(msgproc_threads);
+        RenameThreadPool(m_msgproc_pool, "msgproc");
+    }
+}
+
+void PeerManagerImpl::PushReconciledInvs(CNode& node, const std::vector<uint256>& txids)
+{
+    const CNetMsgMaker msgMaker(node.GetCommonVersion());
+    std::vector<CInv> invs;
+    invs.reserve(std::min<size_t>(txids.size(), MAX_INV_SZ));
+    for (const uint256& txid : txids) {
+        invs.emplace_back(MSG_TX, txid);
+        if (invs.size() == MAX_INV_SZ) {
+            m_connman.PushMessage(&node, msgMaker.Make(NetMsgType::INV, invs));
+            invs.clear();
+        }
+    }
+    if (!invs.empty()) {
+        m_connman.PushMessage(&node, msgMaker.Make(NetMsgType::INV, invs));
+    }
 }
 
 /**
@@ -2023,12 +2203,76 @@ void PeerManagerImpl::BlockDisconnected(const std::shared_ptr<const CBlock> &blo
     m_recent_confirmed_transactions.reset();
 }
 
+void PeerManagerImpl::TransactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason)
+{
+    // Evicted transactions are still valid and may get mined by a miner that kept them
+    if (reason == MemPoolRemovalReason::EXPIRY || reason == MemPoolRemovalReason::SIZELIMIT) {
+        AddToCompactHintTransactions(tx);
+    }
+}
+
+void PeerManagerImpl::NotifyTransactionLock(const CTransactionRef& tx, const std::shared_ptr<const llmq::CInstantSendLock>& islock)
+{
+    AddToCompactHintTransactions(tx);
+}
+
 // All of the following cache a recent block, and are protected by cs_most_recent_block
 static RecursiveMutex cs_most_recent_block;
 static std::shared_ptr<const CBlock> most_recent_block GUARDED_BY(cs_most_recent_block);
 static std::shared_ptr<const CBlockHeaderAndShortTxIDs> most_recent_compact_block GUARDED_BY(cs_most_recent_block);
 static uint256 most_recent_block_hash GUARDED_BY(cs_most_recent_block);
 
+namespace {
+/**
+ * Messages that are pushed to many peers are serialized and checksummed once per protocol
+ * version, every other peer gets a reference to the same payload.
+ */
+class CBroadcastMsgCache
+{
+private:
+    struct Key {
+        std::string msg_type;
+        uint256 hash;
+        int version;
+
+        bool operator==(const Key& other) const
+        {
+            return hash == other.hash && version == other.version && msg_type == other.msg_type;
+        }
+    };
+    struct KeyHasher {
+        size_t operator()(const Key& key) const
+        {
+            return StaticSaltedHasher()(std::make_pair(key.hash, key.version)) ^ std::hash<std::string>()(key.msg_type);
+        }
+    };
+
+    static constexpr size_t MAX_CACHED_MSGS{256};
+
+    Mutex cs;
+    unordered_lru_cache<Key, std::shared_ptr<const CSharedNetMsg>, KeyHasher, MAX_CACHED_MSGS> cache GUARDED_BY(cs);
+
+public:
+    /** Return the cached message for `hash` or serialize `args` with `msgMaker` and cache it */
+    template <typename... Args>
+    std::shared_ptr<const CSharedNetMsg> Get(const CNetMsgMaker& msgMaker, const std::string& msg_type, const uint256& hash, Args&&... args)
+        EXCLUSIVE_LOCKS_REQUIRED(!cs)
+    {
+        const Key key{msg_type, hash, msgMaker.GetVersion()};
+        std::shared_ptr<const CSharedNetMsg> msg;
+        if (WITH_LOCK(cs, return cache.get(key, msg))) {
+            return msg;
+        }
+        // Serialize outside of the lock, two threads racing on the same object produce identical payloads
+        msg = std::make_shared<const CSharedNetMsg>(msgMaker.Make(msg_type, std::forward<Args>(args)...));
+        WITH_LOCK(cs, cache.insert(key, msg));
+        return msg;
+    }
+};
+} // namespace
+
+static CBroadcastMsgCache g_broadcast_msg_cache;
+
 /**
  * Maintain state about the best-seen block and fast-announce a compact block
  * to compatible peers.
@@ -2055,7 +2299,6 @@ void PeerManagerImpl::NewPoWValidBlock(const CBlockIndex *pindex, const std::sha
 
     m_connman.ForEachNode([this, &pcmpctblock, pindex, &msgMaker, &hashBlock](CNode* pnode) {
         LockAssertion lock(::cs_main);
-        // TODO: Avoid the repeated-serialization here
         if (pnode->fDisconnect)
             return;
         ProcessBlockAvailability(pnode->GetId());
@@ -2065,7 +2308,7 @@ void PeerManagerImpl::NewPoWValidBlock(const CBlockIndex *pindex, const std::sha
         if (state.m_requested_hb_cmpctblocks && !PeerHasHeader(&state, pindex) && PeerHasHeader(&state, pindex->pprev)) {
             LogPrint(BCLog::NET, "%s sending header-and-ids %s to peer=%d\n", "PeerManager::NewPoWValidBlock",
                     hashBlock.ToString(), pnode->GetId());
-            m_connman.PushMessage(pnode, msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock));
+            m_connman.PushMessage(pnode, *g_broadcast_msg_cache.Get(msgMaker, NetMsgType::CMPCTBLOCK, hashBlock, *pcmpctblock));
             state.pindexBestHeaderSent = pindex;
         }
     });
@@ -2251,6 +2494,12 @@ void PeerManagerImpl::SendPings()
     for(auto& it : m_peer_map) it.second->m_ping_queued = true;
 }
 
+void PeerManagerImpl::StopMessageWorkers()
+{
+    // Waits for the queued messages, each of them releases its peer once done
+    m_msgproc_pool.stop(/*isWait=*/true);
+}
+
 bool PeerManagerImpl::IsInvInFilter(NodeId nodeid, const uint256& hash) const
 {
     PeerRef peer = GetPeerRef(nodeid);
@@ -2459,6 +2708,14 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
         std::shared_ptr<const CBlock> pblock;
         if (a_recent_block && a_recent_block->GetHash() == pindex->GetBlockHash()) {
             pblock = a_recent_block;
+        } else if (inv.IsMsgBlk()) {
+            // Send the block as it is stored, it's serialized the same way on the wire
+            std::vector<uint8_t> block_data;
+            if (!ReadRawBlockFromDisk(block_data, pindex, m_chainparams.MessageStart())) {
+                assert(!"cannot load block from disk");
+            }
+            m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::BLOCK, Span{block_data}));
+            // Don't set pblock as we've sent the block
         } else {
             // Send block from disk
             std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
@@ -2480,6 +2737,9 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
                     }
                 }
                 if (sendMerkleBlock) {
+                    // The matched transactions and their islocks must follow the merkleblock directly, they are
+                    // queued in its send class so they can't overtake it
+                    const SendPriority reply_priority{GetSendPriority(NetMsgType::MERKLEBLOCK)};
                     m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::MERKLEBLOCK, merkleBlock));
                     // CMerkleBlock just contains hashes, so also push any transactions in the block the client did not see
                     // This avoids hurting performance by pointlessly requiring a round-trip
@@ -2489,12 +2749,12 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
                     // however we MUST always provide at least what the remote peer needs
                     typedef std::pair<unsigned int, uint256> PairType;
                     for (PairType &pair : merkleBlock.vMatchedTxn) {
-                        m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::TX, *pblock->vtx[pair.first]));
+                        m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::TX, *pblock->vtx[pair.first]), reply_priority);
                     }
                     for (PairType &pair : merkleBlock.vMatchedTxn) {
                         auto islock = isman.GetInstantSendLockByTxid(pair.second);
                         if (islock != nullptr) {
-                            m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::ISDLOCK, *islock));
+                            m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::ISDLOCK, *islock), reply_priority);
                         }
                     }
                 }
@@ -2509,7 +2769,7 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
                     pindex->nHeight >= m_chainman.ActiveChain().Height() - MAX_CMPCTBLOCK_DEPTH) {
                     if (a_recent_compact_block &&
                         a_recent_compact_block->header.GetHash() == pindex->GetBlockHash()) {
-                        m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, *a_recent_compact_block));
+                        m_connman.PushMessage(&pfrom, *g_broadcast_msg_cache.Get(msgMaker, NetMsgType::CMPCTBLOCK, pindex->GetBlockHash(), *a_recent_compact_block));
                     } else {
                         CBlockHeaderAndShortTxIDs cmpctblock{*pblock};
                         m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, cmpctblock));
@@ -2526,10 +2786,11 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
             if (inv.hash == peer.m_continuation_block) {
                 // Send immediately. This must send even if redundant,
                 // and we want it right after the last block so they don't
-                // wait for other stuff first.
+                // wait for other stuff first. Blocks are queued in the lowest send class, so is the inv to
+                // keep it from overtaking them.
                 std::vector<CInv> vInv;
                 vInv.push_back(CInv(MSG_BLOCK, m_chainman.ActiveChain().Tip()->GetBlockHash()));
-                m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::INV, vInv));
+                m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::INV, vInv), GetSendPriority(NetMsgType::BLOCK));
                 peer.m_continuation_block.SetNull();
             }
         }
@@ -2726,7 +2987,7 @@ void PeerManagerImpl::ProcessGetData(CNode& pfrom, Peer& peer, const std::atomic
         if (!push && (inv.type == MSG_QUORUM_RECOVERED_SIG)) {
             llmq::CRecoveredSig o;
             if (m_llmq_ctx->sigman->GetRecoveredSigForGetData(inv.hash, o)) {
-                m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::QSIGREC, o));
+                m_connman.PushMessage(&pfrom, *g_broadcast_msg_cache.Get(msgMaker, NetMsgType::QSIGREC, inv.hash, o));
                 push = true;
             }
         }
@@ -2734,7 +2995,7 @@ void PeerManagerImpl::ProcessGetData(CNode& pfrom, Peer& peer, const std::atomic
         if (!push && (inv.type == MSG_CLSIG)) {
             llmq::CChainLockSig o;
             if (m_llmq_ctx->clhandler->GetChainLockByHash(inv.hash, o)) {
-                m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::CLSIG, o));
+                m_connman.PushMessage(&pfrom, *g_broadcast_msg_cache.Get(msgMaker, NetMsgType::CLSIG, inv.hash, o));
                 push = true;
             }
         }
@@ -2742,7 +3003,7 @@ void PeerManagerImpl::ProcessGetData(CNode& pfrom, Peer& peer, const std::atomic
         if (!push && inv.type == MSG_ISDLOCK) {
             llmq::CInstantSendLock o;
             if (m_llmq_ctx->isman->GetInstantSendLockByHash(inv.hash, o)) {
-                m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::ISDLOCK, o));
+                m_connman.PushMessage(&pfrom, *g_broadcast_msg_cache.Get(msgMaker, NetMsgType::ISDLOCK, inv.hash, o));
                 push = true;
             }
         }
@@ -2780,7 +3041,9 @@ void PeerManagerImpl::ProcessGetData(CNode& pfrom, Peer& peer, const std::atomic
         // In normal operation, we often send NOTFOUND messages for parents of
         // transactions that we relay; if a peer is missing a parent, they may
         // assume we have them and request the parents from us.
-        m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::NOTFOUND, vNotFound));
+        // Clients take it as the end of the reply, so it's queued in the lowest send class, after every
+        // message served for this getdata.
+        m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::NOTFOUND, vNotFound), SendPriority::BULK);
     }
 }
 
@@ -3212,8 +3475,13 @@ void PeerManagerImpl::ProcessGetCFCheckPt(CNode& peer, CDataStream& vRecv)
     m_connman.PushMessage(&peer, std::move(msg));
 }
 
+/**
+ * Validate everything about a DSTX except for its signature, which is left to the caller.
+ * On success the operator key of the masternode that signed it is returned in pubKeyOperator.
+ */
 std::pair<bool /*ret*/, bool /*do_return*/> static ValidateDSTX(CDeterministicMNManager& dmnman, CDSTXManager& dstxman, ChainstateManager& chainman,
-                                                                CMasternodeMetaMan& mn_metaman, CTxMemPool& mempool, CCoinJoinBroadcastTx& dstx, uint256 hashTx)
+                                                                CMasternodeMetaMan& mn_metaman, CCoinJoinBroadcastTx& dstx, uint256 hashTx,
+                                                                CBLSPublicKey& pubKeyOperator)
 {
     assert(mn_metaman.IsValid());
 
@@ -3266,16 +3534,212 @@ std::pair<bool /*ret*/, bool /*do_return*/> static ValidateDSTX(CDeterministicMN
         // we have no idea about (e.g we were offline)? How to handle them?
     }
 
-    if (!dstx.CheckSignature(dmn->pdmnState->pubKeyOperator.Get())) {
-        LogPrint(BCLog::COINJOIN, "DSTX -- CheckSignature() failed for %s\n", hashTx.ToString());
-        return {false, true};
+    pubKeyOperator = dmn->pdmnState->pubKeyOperator.Get();
+    return {true, false};
+}
+
+void PeerManagerImpl::VerifyDSTXAsync(NodeId peer_id, const CCoinJoinBroadcastTx& dstx, const CBLSPublicKey& pubKeyOperator)
+{
+    // Must not hold any of our locks here, the callback can be invoked synchronously
+    m_llmq_ctx->bls_worker->AsyncVerifySig(CBLSSignature(Span{dstx.vchSig}), pubKeyOperator, dstx.GetSignatureHash(),
+        [this, peer_id, dstx](bool valid) {
+            m_cj_ctx->dstxman->RemovePendingDSTX(dstx);
+            if (!valid) {
+                LogPrint(BCLog::COINJOIN, "DSTX -- CheckSignature() failed for %s\n", dstx.tx->GetHash().ToString());
+                return;
+            }
+            // Queued even if the peer is gone already, the signature is valid no matter who relayed it
+            WITH_LOCK(m_verified_dstxes_mutex, m_verified_dstxes.emplace_back(peer_id, dstx));
+            m_connman.WakeMessageHandler();
+        });
+}
+
+void PeerManagerImpl::ProcessVerifiedDSTXes(CNode& pfrom, Peer& peer)
+{
+    std::vector<std::pair<NodeId, CCoinJoinBroadcastTx>> verified_dstxes;
+    WITH_LOCK(m_verified_dstxes_mutex, verified_dstxes.swap(m_verified_dstxes));
+    if (verified_dstxes.empty()) return;
+
+    std::vector<std::pair<NodeId, CCoinJoinBroadcastTx>> other_peers;
+    for (const auto& [peer_id, dstx] : verified_dstxes) {
+        if (peer_id == pfrom.GetId()) {
+            ProcessVerifiedDSTX(pfrom, peer, dstx);
+        } else if (GetPeerRef(peer_id) == nullptr) {
+            ProcessVerifiedDSTX(pfrom, peer, dstx, /*relayed_by_peer=*/false);
+        } else {
+            other_peers.emplace_back(peer_id, dstx);
+        }
+    }
+    if (!other_peers.empty()) {
+        LOCK(m_verified_dstxes_mutex);
+        m_verified_dstxes.insert(m_verified_dstxes.begin(), other_peers.begin(), other_peers.end());
+    }
+}
+
+void PeerManagerImpl::ProcessVerifiedDSTX(CNode& pfrom, Peer& peer, const CCoinJoinBroadcastTx& dstx, bool relayed_by_peer)
+{
+    const uint256 hashTx = dstx.tx->GetHash();
+    if (m_cj_ctx->dstxman->GetDSTX(hashTx)) {
+        LogPrint(BCLog::COINJOIN, "DSTX -- Already have %s, skipping...\n", hashTx.ToString());
+        return;
+    }
+    // Checked in ValidateDSTX already but another DSTX of the same masternode could have been accepted
+    // while this one was waiting for signature verification
+    if (!m_mn_metaman.GetMetaInfo(dstx.m_protxHash)->IsValidForMixingTxes()) {
+        LogPrint(BCLog::COINJOIN, "DSTX -- Masternode %s is sending too many transactions %s\n", dstx.masternodeOutpoint.ToStringShort(), hashTx.ToString());
+        return;
     }
 
     LogPrint(BCLog::COINJOIN, "DSTX -- Got Masternode transaction %s\n", hashTx.ToString());
-    mempool.PrioritiseTransaction(hashTx, 0.1*COIN);
-    mn_metaman.DisallowMixing(dmn->proTxHash);
+    m_mempool.PrioritiseTransaction(hashTx, 0.1*COIN);
+    m_mn_metaman.DisallowMixing(dstx.m_protxHash);
 
-    return {true, false};
+    ProcessTransaction(pfrom, peer, dstx.tx, &dstx, relayed_by_peer);
+}
+
+void PeerManagerImpl::ProcessTransaction(CNode& pfrom, Peer& peer, const CTransactionRef& ptx, const CCoinJoinBroadcastTx* dstx,
+                                         bool relayed_by_peer)
+{
+    const CTransaction& tx = *ptx;
+    const uint256& txid = ptx->GetHash();
+    const int nInvType = dstx ? MSG_DSTX : MSG_TX;
+    const CInv inv(nInvType, txid);
+    const bool is_masternode = m_mn_activeman != nullptr;
+
+    LOCK2(cs_main, g_cs_orphans);
+
+    if (AlreadyHave(inv)) {
+        if (relayed_by_peer && pfrom.HasPermission(NetPermissionFlags::ForceRelay)) {
+            // Always relay transactions received from peers with forcerelay permission, even
+            // if they were already in the mempool,
+            // allowing the node to function as a gateway for
+            // nodes hidden behind it.
+            if (!m_mempool.exists(tx.GetHash())) {
+                LogPrintf("Not relaying non-mempool transaction %s from forcerelay peer=%d\n", tx.GetHash().ToString(), pfrom.GetId());
+            } else {
+                LogPrintf("Force relaying tx %s from peer=%d\n", tx.GetHash().ToString(), pfrom.GetId());
+                RelayTransaction(tx.GetHash());
+            }
+        }
+        return;
+    }
+
+    const MempoolAcceptResult result = AcceptToMemoryPool(m_chainman.ActiveChainstate(), m_mempool, ptx, m_sporkman, false /* bypass_limits */);
+    const TxValidationState& state = result.m_state;
+
+    if (result.m_result_type == MempoolAcceptResult::ResultType::VALID) {
+        // Process custom txes, this changes AlreadyHave to "true"
+        if (nInvType == MSG_DSTX) {
+            LogPrint(BCLog::COINJOIN, "DSTX -- Masternode transaction accepted, txid=%s, peer=%d\n",
+                     tx.GetHash().ToString(), pfrom.GetId());
+            m_cj_ctx->dstxman->AddDSTX(*dstx);
+        }
+
+        m_mempool.check(m_chainman.ActiveChainstate());
+        RelayTransaction(tx.GetHash());
+
+        for (unsigned int i = 0; i < tx.vout.size(); i++) {
+            auto it_by_prev = mapOrphanTransactionsByPrev.find(COutPoint(txid, i));
+            if (it_by_prev != mapOrphanTransactionsByPrev.end()) {
+                for (const auto& elem : it_by_prev->second) {
+                    peer.m_orphan_work_set.insert(elem->first);
+                }
+            }
+        }
+
+        if (relayed_by_peer) pfrom.m_last_tx_time = GetTime<std::chrono::seconds>();
+
+        LogPrint(BCLog::MEMPOOL, "AcceptToMemoryPool: peer=%d: accepted %s (poolsz %u txn, %u kB)\n",
+                 pfrom.GetId(),
+                 tx.GetHash().ToString(),
+                 m_mempool.size(), m_mempool.DynamicMemoryUsage() / 1000);
+
+        // Recursively process any orphan transactions that depended on this one
+        ProcessOrphanTx(peer.m_orphan_work_set);
+    }
+    else if (!relayed_by_peer && state.GetResult() == TxValidationResult::TX_MISSING_INPUTS)
+    {
+        // Parents are requested from and orphans are accounted to the peer that sent the transaction
+        LogPrint(BCLog::MEMPOOL, "not keeping orphan %s of a disconnected peer\n", tx.GetHash().ToString());
+    }
+    else if (state.GetResult() == TxValidationResult::TX_MISSING_INPUTS)
+    {
+        bool fRejectedParents = false; // It may be the case that the orphans parents have all been rejected
+
+        // Deduplicate parent txids, so that we don't have to loop over
+        // the same parent txid more than once down below.
+        std::vector<uint256> unique_parents;
+        unique_parents.reserve(tx.vin.size());
+        for (const CTxIn& txin : tx.vin) {
+            // We start with all parents, and then remove duplicates below.
+            unique_parents.push_back(txin.prevout.hash);
+        }
+        std::sort(unique_parents.begin(), unique_parents.end());
+        unique_parents.erase(std::unique(unique_parents.begin(), unique_parents.end()), unique_parents.end());
+        for (const uint256& parent_txid : unique_parents) {
+            if (m_recent_rejects.contains(parent_txid)) {
+                fRejectedParents = true;
+                break;
+            }
+        }
+        if (!fRejectedParents) {
+            const auto current_time = GetTime<std::chrono::microseconds>();
+
+            for (const uint256& parent_txid : unique_parents) {
+                CInv _inv(MSG_TX, parent_txid);
+                AddKnownInv(peer, _inv.hash);
+                if (!AlreadyHave(_inv)) RequestObject(State(pfrom.GetId()), _inv, current_time, is_masternode);
+                // We don't know if the previous tx was a regular or a mixing one, try both
+                CInv _inv2(MSG_DSTX, parent_txid);
+                AddKnownInv(peer, _inv2.hash);
+                if (!AlreadyHave(_inv2)) RequestObject(State(pfrom.GetId()), _inv2, current_time, is_masternode);
+            }
+            AddOrphanTx(ptx, pfrom.GetId());
+
+            // DoS prevention: do not allow mapOrphanTransactions to grow unbounded (see CVE-2012-3789)
+            unsigned int nMaxOrphanTxSize = (unsigned int)std::max((int64_t)0, gArgs.GetArg("-maxorphantxsize", DEFAULT_MAX_ORPHAN_TRANSACTIONS_SIZE)) * 1000000;
+            unsigned int nEvicted = LimitOrphanTxSize(nMaxOrphanTxSize);
+            if (nEvicted > 0) {
+                LogPrint(BCLog::MEMPOOL, "mapOrphan overflow, removed %u tx\n", nEvicted);
+            }
+        } else {
+            LogPrint(BCLog::MEMPOOL, "not keeping orphan with rejected parents %s\n",tx.GetHash().ToString());
+            // We will continue to reject this tx since it has rejected
+            // parents so avoid re-requesting it from other peers.
+            m_recent_rejects.insert(tx.GetHash());
+            m_llmq_ctx->isman->TransactionRemovedFromMempool(ptx);
+        }
+    } else {
+        m_recent_rejects.insert(tx.GetHash());
+        if (RecursiveDynamicUsage(*ptx) < 100000) {
+            AddToCompactExtraTransactions(ptx);
+        }
+    }
+
+    // If a tx has been detected by m_recent_rejects, we will have reached
+    // this point and the tx will have been ignored. Because we haven't run
+    // the tx through AcceptToMemoryPool, we won't have computed a DoS
+    // score for it or determined exactly why we consider it invalid.
+    //
+    // This means we won't penalize any peer subsequently relaying a DoSy
+    // tx (even if we penalized the first peer who gave it to us) because
+    // we have to account for m_recent_rejects showing false positives. In
+    // other words, we shouldn't penalize a peer if we aren't *sure* they
+    // submitted a DoSy tx.
+    //
+    // Note that m_recent_rejects doesn't just record DoSy or invalid
+    // transactions, but any tx not accepted by the m_mempool, which may be
+    // due to node policy (vs. consensus). So we can't blanket penalize a
+    // peer simply for relaying a tx that our m_recent_rejects has caught,
+    // regardless of false positives.
+
+    if (state.IsInvalid()) {
+        LogPrint(BCLog::MEMPOOLREJ, "%s from peer=%d was not accepted: %s\n", tx.GetHash().ToString(),
+            pfrom.GetId(),
+            state.ToString());
+        if (relayed_by_peer) MaybePunishNodeForTx(pfrom.GetId(), state);
+        m_llmq_ctx->isman->TransactionRemovedFromMempool(ptx);
+    }
 }
 
 void PeerManagerImpl::ProcessBlock(CNode& pfrom, const std::shared_ptr<const CBlock>& pblock, bool fForceProcessing)
@@ -3431,6 +3895,14 @@ void PeerManagerImpl::ProcessMessage(
             m_connman.PushMessage(&pfrom, msg_maker.Make(NetMsgType::SENDADDRV2));
         }
 
+        // Signal support for transaction reconciliation, this has to happen between VERSION and VERACK.
+        // Masternode connections keep flooding, so do peers that don't want transactions from us.
+        if (m_txreconciliation && (nServices & NODE_TXRECON) && fRelay && !pfrom.IsBlockOnlyConn() &&
+            !pfrom.m_masternode_connection) {
+            const uint64_t recon_salt = m_txreconciliation->PreRegisterPeer(pfrom.GetId());
+            m_connman.PushMessage(&pfrom, msg_maker.Make(NetMsgType::SENDTXRCNCL, TXRECONCILIATION_VERSION, recon_salt));
+        }
+
         m_connman.PushMessage(&pfrom, msg_maker.Make(NetMsgType::VERACK));
 
         pfrom.nServices = nServices;
@@ -3609,6 +4081,54 @@ void PeerManagerImpl::ProcessMessage(
         return;
     }
 
+    if (msg_type == NetMsgType::SENDCRC32C) {
+        // Nothing to do here, the transport already checks the peer's later messages against CRC32C
+        LogPrint(BCLog::NET, "peer=%d switched to CRC32C message checksums\n", pfrom.GetId());
+        return;
+    }
+
+    if (msg_type == NetMsgType::REQTXRCNCL) {
+        uint32_t remote_set_size;
+        vRecv >> remote_set_size;
+        const auto sketch = m_txreconciliation ? m_txreconciliation->RespondToRequest(pfrom.GetId(), remote_set_size) : std::nullopt;
+        if (!sketch) {
+            // Only the peers that connected to us initiate reconciliations
+            Misbehaving(pfrom.GetId(), 10, "unexpected reqtxrcncl");
+            return;
+        }
+        m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::SKETCH, *sketch));
+        return;
+    }
+
+    if (msg_type == NetMsgType::SKETCH) {
+        TxReconSketch sketch;
+        vRecv >> sketch;
+        std::vector<uint32_t> to_ask;
+        std::vector<uint256> to_announce;
+        const auto success = m_txreconciliation ? m_txreconciliation->ProcessSketch(pfrom.GetId(), sketch, to_ask, to_announce) : std::nullopt;
+        if (!success) {
+            // Possibly the answer to a reconciliation that timed out, its transactions were flooded already
+            LogPrint(BCLog::NET, "unexpected sketch from peer=%d ignored\n", pfrom.GetId());
+            return;
+        }
+        m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::RECONCILDIFF, *success, to_ask));
+        PushReconciledInvs(pfrom, to_announce);
+        return;
+    }
+
+    if (msg_type == NetMsgType::RECONCILDIFF) {
+        bool success;
+        std::vector<uint32_t> asked;
+        vRecv >> success >> asked;
+        const auto to_announce = m_txreconciliation ? m_txreconciliation->ProcessDiff(pfrom.GetId(), success, asked) : std::nullopt;
+        if (!to_announce) {
+            LogPrint(BCLog::NET, "unexpected reconcildiff from peer=%d ignored\n", pfrom.GetId());
+            return;
+        }
+        PushReconciledInvs(pfrom, *to_announce);
+        return;
+    }
+
     if (msg_type == NetMsgType::SENDCMPCT) {
         bool sendcmpct_hb{false};
         uint64_t sendcmpct_version{0};
@@ -3643,6 +4163,30 @@ void PeerManagerImpl::ProcessMessage(
         return;
     }
 
+    // Transaction reconciliation is negotiated between VERSION and VERACK as well
+    if (msg_type == NetMsgType::SENDTXRCNCL) {
+        if (!m_txreconciliation) {
+            LogPrint(BCLog::NET, "sendtxrcncl from peer=%d ignored, transaction reconciliation is disabled\n", pfrom.GetId());
+            return;
+        }
+        if (pfrom.fSuccessfullyConnected) {
+            LogPrint(BCLog::NET_NETCONN, "sendtxrcncl received after verack from peer=%d; disconnecting\n", pfrom.GetId());
+            pfrom.fDisconnect = true;
+            return;
+        }
+        uint32_t peer_recon_version;
+        uint64_t remote_salt;
+        vRecv >> peer_recon_version >> remote_salt;
+        const auto result = m_txreconciliation->RegisterPeer(pfrom.GetId(), pfrom.IsInboundConn(), peer_recon_version, remote_salt);
+        if (result == TxReconciliationTracker::RegisterResult::PROTOCOL_VIOLATION ||
+            result == TxReconciliationTracker::RegisterResult::ALREADY_REGISTERED) {
+            LogPrint(BCLog::NET_NETCONN, "invalid sendtxrcncl from peer=%d; disconnecting\n", pfrom.GetId());
+            pfrom.fDisconnect = true;
+        }
+        // NOT_FOUND means we didn't offer reconciliation to this peer, transactions are flooded to it
+        return;
+    }
+
     if (!pfrom.fSuccessfullyConnected) {
         LogPrint(BCLog::NET, "Unsupported message \"%s\" prior to verack from peer=%d\n", SanitizeString(msg_type), pfrom.GetId());
         return;
@@ -4134,141 +4678,29 @@ void PeerManagerImpl::ProcessMessage(
         if (nInvType == MSG_DSTX) {
            // Validate DSTX and return bRet if we need to return from here
            uint256 hashTx = tx.GetHash();
-           const auto& [bRet, bDoReturn] = ValidateDSTX(*m_dmnman, *(m_cj_ctx->dstxman), m_chainman, m_mn_metaman, m_mempool, dstx, hashTx);
+           CBLSPublicKey pubKeyOperator;
+           const auto& [bRet, bDoReturn] = ValidateDSTX(*m_dmnman, *(m_cj_ctx->dstxman), m_chainman, m_mn_metaman, dstx, hashTx, pubKeyOperator);
            if (bDoReturn) {
                return;
            }
+           if (!bls::bls_legacy_scheme.load()) {
+               // Batch the signature check with other pending ones on the BLS worker, the DSTX is
+               // picked up again by ProcessMessages once it's verified
+               if (m_cj_ctx->dstxman->AddPendingDSTX(dstx)) {
+                   VerifyDSTXAsync(pfrom.GetId(), dstx, pubKeyOperator);
+               }
+               return;
+           }
+           // DSTX signatures always use the basic scheme while the worker verifies with the global one
+           if (!dstx.CheckSignature(pubKeyOperator)) {
+               LogPrint(BCLog::COINJOIN, "DSTX -- CheckSignature() failed for %s\n", hashTx.ToString());
+               return;
+           }
+           ProcessVerifiedDSTX(pfrom, *peer, dstx);
+           return;
         }
 
-        LOCK2(cs_main, g_cs_orphans);
-
-        if (AlreadyHave(inv)) {
-            if (pfrom.HasPermission(NetPermissionFlags::ForceRelay)) {
-                // Always relay transactions received from peers with forcerelay permission, even
-                // if they were already in the mempool,
-                // allowing the node to function as a gateway for
-                // nodes hidden behind it.
-                if (!m_mempool.exists(tx.GetHash())) {
-                    LogPrintf("Not relaying non-mempool transaction %s from forcerelay peer=%d\n", tx.GetHash().ToString(), pfrom.GetId());
-                } else {
-                    LogPrintf("Force relaying tx %s from peer=%d\n", tx.GetHash().ToString(), pfrom.GetId());
-                    RelayTransaction(tx.GetHash());
-                }
-            }
-            return;
-        }
-
-        const MempoolAcceptResult result = AcceptToMemoryPool(m_chainman.ActiveChainstate(), m_mempool, ptx, m_sporkman, false /* bypass_limits */);
-        const TxValidationState& state = result.m_state;
-
-        if (result.m_result_type == MempoolAcceptResult::ResultType::VALID) {
-            // Process custom txes, this changes AlreadyHave to "true"
-            if (nInvType == MSG_DSTX) {
-                LogPrint(BCLog::COINJOIN, "DSTX -- Masternode transaction accepted, txid=%s, peer=%d\n",
-                         tx.GetHash().ToString(), pfrom.GetId());
-                m_cj_ctx->dstxman->AddDSTX(dstx);
-            }
-
-            m_mempool.check(m_chainman.ActiveChainstate());
-            RelayTransaction(tx.GetHash());
-
-            for (unsigned int i = 0; i < tx.vout.size(); i++) {
-                auto it_by_prev = mapOrphanTransactionsByPrev.find(COutPoint(txid, i));
-                if (it_by_prev != mapOrphanTransactionsByPrev.end()) {
-                    for (const auto& elem : it_by_prev->second) {
-                        peer->m_orphan_work_set.insert(elem->first);
-                    }
-                }
-            }
-
-            pfrom.m_last_tx_time = GetTime<std::chrono::seconds>();
-
-            LogPrint(BCLog::MEMPOOL, "AcceptToMemoryPool: peer=%d: accepted %s (poolsz %u txn, %u kB)\n",
-                     pfrom.GetId(),
-                     tx.GetHash().ToString(),
-                     m_mempool.size(), m_mempool.DynamicMemoryUsage() / 1000);
-
-            // Recursively process any orphan transactions that depended on this one
-            ProcessOrphanTx(peer->m_orphan_work_set);
-        }
-        else if (state.GetResult() == TxValidationResult::TX_MISSING_INPUTS)
-        {
-            bool fRejectedParents = false; // It may be the case that the orphans parents have all been rejected
-
-            // Deduplicate parent txids, so that we don't have to loop over
-            // the same parent txid more than once down below.
-            std::vector<uint256> unique_parents;
-            unique_parents.reserve(tx.vin.size());
-            for (const CTxIn& txin : tx.vin) {
-                // We start with all parents, and then remove duplicates below.
-                unique_parents.push_back(txin.prevout.hash);
-            }
-            std::sort(unique_parents.begin(), unique_parents.end());
-            unique_parents.erase(std::unique(unique_parents.begin(), unique_parents.end()), unique_parents.end());
-            for (const uint256& parent_txid : unique_parents) {
-                if (m_recent_rejects.contains(parent_txid)) {
-                    fRejectedParents = true;
-                    break;
-                }
-            }
-            if (!fRejectedParents) {
-                const auto current_time = GetTime<std::chrono::microseconds>();
-
-                for (const uint256& parent_txid : unique_parents) {
-                    CInv _inv(MSG_TX, parent_txid);
-                    AddKnownInv(*peer, _inv.hash);
-                    if (!AlreadyHave(_inv)) RequestObject(State(pfrom.GetId()), _inv, current_time, is_masternode);
-                    // We don't know if the previous tx was a regular or a mixing one, try both
-                    CInv _inv2(MSG_DSTX, parent_txid);
-                    AddKnownInv(*peer, _inv2.hash);
-                    if (!AlreadyHave(_inv2)) RequestObject(State(pfrom.GetId()), _inv2, current_time, is_masternode);
-                }
-                AddOrphanTx(ptx, pfrom.GetId());
-
-                // DoS prevention: do not allow mapOrphanTransactions to grow unbounded (see CVE-2012-3789)
-                unsigned int nMaxOrphanTxSize = (unsigned int)std::max((int64_t)0, gArgs.GetArg("-maxorphantxsize", DEFAULT_MAX_ORPHAN_TRANSACTIONS_SIZE)) * 1000000;
-                unsigned int nEvicted = LimitOrphanTxSize(nMaxOrphanTxSize);
-                if (nEvicted > 0) {
-                    LogPrint(BCLog::MEMPOOL, "mapOrphan overflow, removed %u tx\n", nEvicted);
-                }
-            } else {
-                LogPrint(BCLog::MEMPOOL, "not keeping orphan with rejected parents %s\n",tx.GetHash().ToString());
-                // We will continue to reject this tx since it has rejected
-                // parents so avoid re-requesting it from other peers.
-                m_recent_rejects.insert(tx.GetHash());
-                m_llmq_ctx->isman->TransactionRemovedFromMempool(ptx);
-            }
-        } else {
-            m_recent_rejects.insert(tx.GetHash());
-            if (RecursiveDynamicUsage(*ptx) < 100000) {
-                AddToCompactExtraTransactions(ptx);
-            }
-        }
-
-        // If a tx has been detected by m_recent_rejects, we will have reached
-        // this point and the tx will have been ignored. Because we haven't run
-        // the tx through AcceptToMemoryPool, we won't have computed a DoS
-        // score for it or determined exactly why we consider it invalid.
-        //
-        // This means we won't penalize any peer subsequently relaying a DoSy
-        // tx (even if we penalized the first peer who gave it to us) because
-        // we have to account for m_recent_rejects showing false positives. In
-        // other words, we shouldn't penalize a peer if we aren't *sure* they
-        // submitted a DoSy tx.
-        //
-        // Note that m_recent_rejects doesn't just record DoSy or invalid
-        // transactions, but any tx not accepted by the m_mempool, which may be
-        // due to node policy (vs. consensus). So we can't blanket penalize a
-        // peer simply for relaying a tx that our m_recent_rejects has caught,
-        // regardless of false positives.
-
-        if (state.IsInvalid()) {
-            LogPrint(BCLog::MEMPOOLREJ, "%s from peer=%d was not accepted: %s\n", tx.GetHash().ToString(),
-                pfrom.GetId(),
-                state.ToString());
-            MaybePunishNodeForTx(pfrom.GetId(), state);
-            m_llmq_ctx->isman->TransactionRemovedFromMempool(ptx);
-        }
+        ProcessTransaction(pfrom, *peer, ptx, nullptr);
         return;
     }
 
@@ -4378,7 +4810,7 @@ void PeerManagerImpl::ProcessMessage(
                 }
 
                 PartiallyDownloadedBlock& partialBlock = *(*queuedBlockIt)->partialBlock;
-                ReadStatus status = partialBlock.InitData(cmpctblock, vExtraTxnForCompact);
+                ReadStatus status = WITH_LOCK(m_cmpct_hint_mutex, return partialBlock.InitData(cmpctblock, vExtraTxnForCompact, m_cmpct_hint_txn));
                 if (status == READ_STATUS_INVALID) {
                     MarkBlockAsReceived(pindex->GetBlockHash()); // Reset in-flight state in case Misbehaving does not result in a disconnect
                     Misbehaving(pfrom.GetId(), 100, "invalid compact block");
@@ -4396,6 +4828,9 @@ void PeerManagerImpl::ProcessMessage(
                     if (!partialBlock.IsTxAvailable(i))
                         req.indexes.push_back(i);
                 }
+                nodestate->m_cmpct_blocks++;
+                nodestate->m_cmpct_hint_txn += partialBlock.GetHintCount();
+                if (req.indexes.empty()) nodestate->m_cmpct_blocks_reconstructed++;
                 if (req.indexes.empty()) {
                     // Dirty hack to jump to BLOCKTXN code (TODO: move message handling into their own functions)
                     BlockTransactions txn;
@@ -4413,14 +4848,17 @@ void PeerManagerImpl::ProcessMessage(
                 // Optimistically try to reconstruct anyway since we might be
                 // able to without any round trips.
                 PartiallyDownloadedBlock tempBlock(&m_mempool);
-                ReadStatus status = tempBlock.InitData(cmpctblock, vExtraTxnForCompact);
+                ReadStatus status = WITH_LOCK(m_cmpct_hint_mutex, return tempBlock.InitData(cmpctblock, vExtraTxnForCompact, m_cmpct_hint_txn));
                 if (status != READ_STATUS_OK) {
                     // TODO: don't ignore failures
                     return;
                 }
+                nodestate->m_cmpct_blocks++;
+                nodestate->m_cmpct_hint_txn += tempBlock.GetHintCount();
                 std::vector<CTransactionRef> dummy;
                 status = tempBlock.FillBlock(*pblock, dummy);
                 if (status == READ_STATUS_OK) {
+                    nodestate->m_cmpct_blocks_reconstructed++;
                     fBlockReconstructed = true;
                 }
             }
@@ -5006,6 +5444,9 @@ bool PeerManagerImpl::ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt
     PeerRef peer = GetPeerRef(pfrom->GetId());
     if (peer == nullptr) return false;
 
+    // A worker is still busy with the previous message, it wakes us up when done
+    if (peer->m_msg_in_flight) return false;
+
     {
         LOCK(peer->m_getdata_requests_mutex);
         if (!peer->m_getdata_requests.empty()) {
@@ -5020,6 +5461,8 @@ bool PeerManagerImpl::ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt
         }
     }
 
+    ProcessVerifiedDSTXes(*pfrom, *peer);
+
     if (pfrom->fDisconnect)
         return false;
 
@@ -5056,6 +5499,16 @@ bool PeerManagerImpl::ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt
 
     msg.SetVersion(pfrom->GetCommonVersion());
 
+    if (m_msgproc_pool.size() > 0 && pfrom->fSuccessfullyConnected && IsParallelSafeMessage(msg.m_type)) {
+        peer->m_msg_in_flight = true;
+        pfrom->AddRef();
+        auto pmsg = std::make_shared<CNetMessage>(std::move(msg));
+        m_msgproc_pool.push([this, pfrom, peer, pmsg, &interruptMsgProc](int) {
+            ProcessMessageOnWorker(*pfrom, peer, *pmsg, interruptMsgProc);
+        });
+        return false;
+    }
+
     try {
         ProcessMessage(*pfrom, msg.m_type, msg.m_recv, msg.m_time, interruptMsgProc);
         if (interruptMsgProc) return false;
@@ -5072,6 +5525,28 @@ bool PeerManagerImpl::ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt
     return fMoreWork;
 }
 
+void PeerManagerImpl::ProcessMessageOnWorker(CNode& pfrom, const PeerRef& peer, CNetMessage& msg, const std::atomic<bool>& interruptMsgProc)
+{
+    if (!interruptMsgProc) {
+        try {
+            ProcessMessage(pfrom, msg.m_type, msg.m_recv, msg.m_time, interruptMsgProc);
+        } catch (const std::exception& e) {
+            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' (%s) caught\n", __func__, SanitizeString(msg.m_type), msg.m_message_size, e.what(), typeid(e).name());
+        } catch (...) {
+            LogPrint(BCLog::NET, "%s(%s, %u bytes): Unknown exception caught\n", __func__, SanitizeString(msg.m_type), msg.m_message_size);
+        }
+    }
+
+    // The node may be deleted as soon as it's released, FinalizeNode waits for the flag below
+    pfrom.Release();
+    {
+        LOCK(m_msg_in_flight_mutex);
+        peer->m_msg_in_flight = false;
+    }
+    m_msg_in_flight_cv.notify_all();
+    m_connman.WakeMessageHandler();
+}
+
 void PeerManagerImpl::ConsiderEviction(CNode& pto, int64_t time_in_seconds)
 {
     AssertLockHeld(cs_main);
@@ -5409,6 +5884,8 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
 
     PeerRef peer = GetPeerRef(pto->GetId());
     if (!peer) return false;
+    // Don't touch the peer while a worker processes one of its messages
+    if (peer->m_msg_in_flight) return true;
     const Consensus::Params& consensusParams = m_chainparams.GetConsensus();
 
     // We must call MaybeDiscourageAndDisconnect first, to ensure that we'll
@@ -5560,7 +6037,7 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
                     {
                         LOCK(cs_most_recent_block);
                         if (most_recent_block_hash == pBestIndex->GetBlockHash()) {
-                            m_connman.PushMessage(pto, msgMaker.Make(NetMsgType::CMPCTBLOCK, *most_recent_compact_block));
+                            m_connman.PushMessage(pto, *g_broadcast_msg_cache.Get(msgMaker, NetMsgType::CMPCTBLOCK, most_recent_block_hash, *most_recent_compact_block));
                             fGotBlockFromCache = true;
                         }
                     }
@@ -5583,8 +6060,12 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
                         vHeadersCompressed.push_back(compressible_header);
                     });
 
-                    // Push message to peer
-                    m_connman.PushMessage(pto, msgMaker.Make(NetMsgType::HEADERS2, vHeadersCompressed));
+                    // Push message to peer, a single new tip header is the same for every peer
+                    if (vHeaders.size() == 1) {
+                        m_connman.PushMessage(pto, *g_broadcast_msg_cache.Get(msgMaker, NetMsgType::HEADERS2, pBestIndex->GetBlockHash(), vHeadersCompressed));
+                    } else {
+                        m_connman.PushMessage(pto, msgMaker.Make(NetMsgType::HEADERS2, vHeadersCompressed));
+                    }
                     state.pindexBestHeaderSent = pBestIndex;
                 } else if (state.fPreferHeaders) {
                     if (vHeaders.size() > 1) {
@@ -5596,7 +6077,11 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
                         LogPrint(BCLog::NET, "%s: sending header %s to peer=%d\n", __func__,
                                 vHeaders.front().GetHash().ToString(), pto->GetId());
                     }
-                    m_connman.PushMessage(pto, msgMaker.Make(NetMsgType::HEADERS, vHeaders));
+                    if (vHeaders.size() == 1) {
+                        m_connman.PushMessage(pto, *g_broadcast_msg_cache.Get(msgMaker, NetMsgType::HEADERS, pBestIndex->GetBlockHash(), vHeaders));
+                    } else {
+                        m_connman.PushMessage(pto, msgMaker.Make(NetMsgType::HEADERS, vHeaders));
+                    }
                     state.pindexBestHeaderSent = pBestIndex;
                 } else
                     fRevertToInv = true;
@@ -5629,6 +6114,20 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
             peer->m_blocks_for_headers_relay.clear();
         }
 
+        //
+        // Message: reqtxrcncl
+        //
+        if (m_txreconciliation && !pto->IsBlockOnlyConn()) {
+            std::vector<uint256> to_flood;
+            if (!pto->GetVerifiedProRegTxHash().IsNull()) {
+                // The peer authenticated as a masternode, flood to it like to all masternodes
+                to_flood = m_txreconciliation->ForgetPeer(pto->GetId());
+            } else if (const auto set_size = m_txreconciliation->InitiateReconciliation(pto->GetId(), current_time, to_flood)) {
+                m_connman.PushMessage(pto, msgMaker.Make(NetMsgType::REQTXRCNCL, *set_size));
+            }
+            PushReconciledInvs(*pto, to_flood);
+        }
+
         //
         // Message: inventory
         //
@@ -5778,6 +6277,12 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
                             }
                         }
                         int nInvType = m_cj_ctx->dstxman->GetDSTX(hash) ? MSG_DSTX : MSG_TX;
+                        // Reconciling peers learn about plain transactions at the next reconciliation, DSTXes
+                        // are always announced since the inv type is what tells them apart
+                        if (nInvType == MSG_TX && m_txreconciliation && m_txreconciliation->AddToSet(pto->GetId(), hash)) {
+                            peer->m_tx_relay->m_tx_inventory_known_filter.insert(hash);
+                            continue;
+                        }
                         queueAndMaybePushInv(CInv(nInvType, hash));
                     }
                 }
@@ -5875,6 +6380,11 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
             std::vector<const CBlockIndex*> vToDownload;
             NodeId staller = -1;
             FindNextBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload, staller);
+            // Historical blocks for the background chainstate are only fetched once the active chain has
+            // nothing to download from this peer, and not from peers that only keep recent blocks
+            if (vToDownload.empty() && !pto->m_limited_node) {
+                FindHistoricalBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload);
+            }
             for (const CBlockIndex *pindex : vToDownload) {
                 vGetData.push_back(CInv(MSG_BLOCK, pindex->GetBlockHash()));
                 MarkBlockAsInFlight(pto->GetId(), pindex->GetBlockHash(), pindex);
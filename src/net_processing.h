@@ -35,8 +35,14 @@ extern RecursiveMutex g_cs_orphans;
 static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS_SIZE = 10; // this allows around 100 TXs of max size (and many more of normal size)
 /** Default number of orphan+recently-replaced txn to keep around for block reconstruction */
 static const unsigned int DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN = 100;
+/** Default number of IS-locked and evicted transactions to keep as compact block reconstruction hints */
+static const unsigned int DEFAULT_BLOCK_RECONSTRUCTION_HINT_TXN = 1000;
 static const bool DEFAULT_PEERBLOOMFILTERS = true;
 static const bool DEFAULT_PEERBLOCKFILTERS = false;
+/** Default for -msghandlerthreads, workers that process messages not needing cs_main concurrently (0 = all on the message handler thread) */
+static const int DEFAULT_MSGHANDLER_THREADS{0};
+/** Maximum for -msghandlerthreads */
+static const int MAX_MSGHANDLER_THREADS{16};
 /** Threshold for marking a node to be discouraged, e.g. disconnected and added to the discouragement filter. */
 static const int DISCOURAGEMENT_THRESHOLD{100};
 
@@ -51,6 +57,10 @@ struct CNodeStateStats {
     uint64_t m_addr_processed = 0;
     uint64_t m_addr_rate_limited = 0;
     bool m_addr_relay_enabled{false};
+    uint64_t m_cmpct_blocks{0};
+    uint64_t m_cmpct_blocks_reconstructed{0};
+    uint64_t m_cmpct_hint_txn{0};
+    bool m_txreconciliation{false};
 };
 
 class PeerManager : public CValidationInterface, public NetEventsInterface
@@ -84,6 +94,9 @@ public:
     /** Send ping message to all peers */
     virtual void SendPings() = 0;
 
+    /** Finish the messages queued on the -msghandlerthreads workers and stop them, call once the message handler thread is stopped */
+    virtual void StopMessageWorkers() = 0;
+
     /** Is an inventory in the known inventory filter. Used by InstantSend. */
     virtual bool IsInvInFilter(NodeId nodeid, const uint256& hash) const = 0;
 
@@ -8,6 +8,55 @@
 #include <shutdown.h>
 #include <util/system.h>
 
+void NetFulfilledExpiryWheel::Place(Item&& item)
+{
+    const int64_t delta = item.expire - m_now;
+    if (delta <= 0) {
+        // already due, fire on the next tick
+        m_level0[(m_now + 1) & SLOT_MASK].emplace_back(std::move(item));
+    } else if (delta < SLOTS) {
+        m_level0[item.expire & SLOT_MASK].emplace_back(std::move(item));
+    } else if (delta < SPAN_LEVEL1) {
+        m_level1[(item.expire >> SLOT_BITS) & SLOT_MASK].emplace_back(std::move(item));
+    } else {
+        m_overflow.emplace_back(std::move(item));
+    }
+    ++m_size;
+}
+
+void NetFulfilledExpiryWheel::Cascade(std::vector<Item>&& items)
+{
+    m_size -= items.size();
+    for (auto& item : items) {
+        if (item.expire <= m_now) {
+            // Place() would defer it to the next second, the slot of m_now wasn't processed yet
+            m_level0[m_now & SLOT_MASK].emplace_back(std::move(item));
+            ++m_size;
+        } else {
+            Place(std::move(item));
+        }
+    }
+}
+
+void NetFulfilledExpiryWheel::Insert(Item item)
+{
+    assert(m_now != 0);
+    Place(std::move(item));
+}
+
+void NetFulfilledExpiryWheel::Clear()
+{
+    for (auto& slot : m_level0) slot.clear();
+    for (auto& slot : m_level1) slot.clear();
+    m_overflow.clear();
+    m_size = 0;
+}
+
+static CService SquashAddress(const CService& addr)
+{
+    return Params().AllowMultiplePorts() ? addr : CService(addr, 0);
+}
+
 CNetFulfilledRequestManager::CNetFulfilledRequestManager() :
     m_db{std::make_unique<db_type>("netfulfilled.dat", "magicFulfilledCache")}
 {
@@ -29,69 +78,116 @@ CNetFulfilledRequestManager::~CNetFulfilledRequestManager()
     m_db->Store(*this);
 }
 
+uint16_t NetFulfilledRequestStore::InternRequestType(const std::string& strRequest)
+{
+    AssertLockHeld(cs_mapFulfilledRequests);
+    const auto [it, inserted] = mapRequestTypeIds.try_emplace(strRequest, vecRequestTypes.size());
+    if (inserted) {
+        assert(vecRequestTypes.size() < std::numeric_limits<uint16_t>::max());
+        vecRequestTypes.emplace_back(strRequest);
+    }
+    return it->second;
+}
+
+void NetFulfilledRequestStore::SetFulfilledRequest(const CService& addr, uint16_t type, int64_t expire)
+{
+    AssertLockHeld(cs_mapFulfilledRequests);
+    auto& requests = mapFulfilledRequests[addr];
+    auto it = std::find_if(requests.begin(), requests.end(), [type](const auto& request) { return request.type == type; });
+    if (it != requests.end()) {
+        // The wheel entry for the old expiry time stays behind and is ignored once it fires
+        it->expire = expire;
+    } else {
+        requests.push_back({type, expire});
+    }
+    expiryWheel.Insert({addr, type, expire});
+}
+
+void NetFulfilledRequestStore::ExpireRequests(int64_t now)
+{
+    AssertLockHeld(cs_mapFulfilledRequests);
+    expiryWheel.Advance(now, [&](const NetFulfilledExpiryWheel::Item& item) {
+        auto it = mapFulfilledRequests.find(item.addr);
+        if (it == mapFulfilledRequests.end()) return;
+        auto& requests = it->second;
+        // Only drop the request if it wasn't refreshed after this wheel entry was scheduled
+        requests.erase(std::remove_if(requests.begin(), requests.end(), [&](const auto& request) {
+            return request.type == item.type && request.expire <= now;
+        }), requests.end());
+        if (requests.empty()) {
+            mapFulfilledRequests.erase(it);
+        }
+    });
+}
+
+void NetFulfilledRequestStore::Load(const fulfilledreqmap_t& mapLegacy)
+{
+    LOCK(cs_mapFulfilledRequests);
+    const int64_t now = GetTime();
+    expiryWheel.Advance(now, [](const auto&) {});
+    for (const auto& [addr, entry] : mapLegacy) {
+        for (const auto& [strRequest, expire] : entry) {
+            if (expire <= now) continue;
+            SetFulfilledRequest(addr, InternRequestType(strRequest), expire);
+        }
+    }
+}
+
 void CNetFulfilledRequestManager::AddFulfilledRequest(const CService& addr, const std::string& strRequest)
 {
     LOCK(cs_mapFulfilledRequests);
-    CService addrSquashed = Params().AllowMultiplePorts() ? addr : CService(addr, 0);
-    mapFulfilledRequests[addrSquashed][strRequest] = GetTime() + Params().FulfilledRequestExpireTime();
+    const int64_t now = GetTime();
+    ExpireRequests(now);
+    SetFulfilledRequest(SquashAddress(addr), InternRequestType(strRequest), now + Params().FulfilledRequestExpireTime());
 }
 
 bool CNetFulfilledRequestManager::HasFulfilledRequest(const CService& addr, const std::string& strRequest)
 {
     LOCK(cs_mapFulfilledRequests);
-    CService addrSquashed = Params().AllowMultiplePorts() ? addr : CService(addr, 0);
-    fulfilledreqmap_t::iterator it = mapFulfilledRequests.find(addrSquashed);
+    const auto it_type = mapRequestTypeIds.find(strRequest);
+    if (it_type == mapRequestTypeIds.end()) return false;
+
+    const auto it = mapFulfilledRequests.find(SquashAddress(addr));
+    if (it == mapFulfilledRequests.end()) return false;
 
-    return  it != mapFulfilledRequests.end() &&
-            it->second.find(strRequest) != it->second.end() &&
-            it->second[strRequest] > GetTime();
+    const int64_t now = GetTime();
+    return std::any_of(it->second.begin(), it->second.end(), [&](const auto& request) {
+        return request.type == it_type->second && request.expire > now;
+    });
 }
 
 void CNetFulfilledRequestManager::RemoveAllFulfilledRequests(const CService& addr)
 {
     LOCK(cs_mapFulfilledRequests);
-    CService addrSquashed = Params().AllowMultiplePorts() ? addr : CService(addr, 0);
-    fulfilledreqmap_t::iterator it = mapFulfilledRequests.find(addrSquashed);
-
-    if (it != mapFulfilledRequests.end()) {
-        mapFulfilledRequests.erase(it++);
-    }
+    mapFulfilledRequests.erase(SquashAddress(addr));
 }
 
 void CNetFulfilledRequestManager::CheckAndRemove()
 {
     LOCK(cs_mapFulfilledRequests);
+    ExpireRequests(GetTime());
+}
 
-    int64_t now = GetTime();
-    fulfilledreqmap_t::iterator it = mapFulfilledRequests.begin();
-
-    while(it != mapFulfilledRequests.end()) {
-        fulfilledreqmapentry_t::iterator it_entry = it->second.begin();
-        while(it_entry != it->second.end()) {
-            if(now > it_entry->second) {
-                it->second.erase(it_entry++);
-            } else {
-                ++it_entry;
-            }
-        }
-        if(it->second.size() == 0) {
-            mapFulfilledRequests.erase(it++);
-        } else {
-            ++it;
-        }
-    }
+size_t CNetFulfilledRequestManager::GetPeerCount() const
+{
+    LOCK(cs_mapFulfilledRequests);
+    return mapFulfilledRequests.size();
 }
 
 void NetFulfilledRequestStore::Clear()
 {
     LOCK(cs_mapFulfilledRequests);
     mapFulfilledRequests.clear();
+    expiryWheel.Clear();
 }
 
 std::string NetFulfilledRequestStore::ToString() const
 {
+    LOCK(cs_mapFulfilledRequests);
     std::ostringstream info;
-    info << "Nodes with fulfilled requests: " << (int)mapFulfilledRequests.size();
+    info << "Nodes with fulfilled requests: " << (int)mapFulfilledRequests.size() <<
+            ", request types: " << (int)vecRequestTypes.size() <<
+            ", scheduled expirations: " << (int)expiryWheel.Size();
     return info.str();
 }
 
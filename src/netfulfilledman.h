@@ -9,33 +9,180 @@
 #include <serialize.h>
 #include <sync.h>
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <map>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 template<typename T>
 class CFlatDB;
 class CNetFulfilledRequestManager;
 
+/**
+ * Hierarchical timing wheel used to expire fulfilled requests without scanning the whole store.
+ *
+ * Time is measured in whole seconds. Level 0 has one slot per second for the next 256 seconds,
+ * level 1 has one slot per 256 seconds for the next ~18 hours and anything further away is kept
+ * in an overflow list that is re-distributed once per level 1 revolution. Advancing the wheel
+ * costs O(1) per elapsed second plus the number of items that fall due.
+ */
+class NetFulfilledExpiryWheel
+{
+public:
+    struct Item {
+        CService addr;
+        uint16_t type;
+        int64_t expire;
+    };
+
+private:
+    static constexpr int SLOT_BITS{8};
+    static constexpr int SLOTS{1 << SLOT_BITS};
+    static constexpr int64_t SLOT_MASK{SLOTS - 1};
+    static constexpr int64_t SPAN_LEVEL1{int64_t{SLOTS} * SLOTS};
+
+    std::array<std::vector<Item>, SLOTS> m_level0;
+    std::array<std::vector<Item>, SLOTS> m_level1;
+    std::vector<Item> m_overflow;
+    //! Last second that was fully processed, 0 if the wheel was never advanced
+    int64_t m_now{0};
+    size_t m_size{0};
+
+    void Place(Item&& item);
+    //! Re-distribute the items of a higher level at the start of second m_now, the ones due fire in this second
+    void Cascade(std::vector<Item>&& items);
+
+public:
+    void Insert(Item item);
+    /** Move the wheel forward to `now`, handing every item with `expire <= now` to `on_expire` */
+    template <typename Callable>
+    void Advance(int64_t now, Callable&& on_expire);
+    void Clear();
+
+    size_t Size() const { return m_size; }
+};
+
+template <typename Callable>
+void NetFulfilledExpiryWheel::Advance(int64_t now, Callable&& on_expire)
+{
+    if (m_now == 0) {
+        m_now = now;
+        return;
+    }
+    if (now <= m_now) return;
+
+    if (now - m_now >= SPAN_LEVEL1) {
+        // Long jump (e.g. node was suspended), walking every tick would be slower than re-sorting everything
+        std::vector<Item> items;
+        items.reserve(m_size);
+        for (auto* level : {&m_level0, &m_level1}) {
+            for (auto& slot : *level) {
+                std::move(slot.begin(), slot.end(), std::back_inserter(items));
+                slot.clear();
+            }
+        }
+        std::move(m_overflow.begin(), m_overflow.end(), std::back_inserter(items));
+        m_overflow.clear();
+        m_size = 0;
+        m_now = now;
+        for (auto& item : items) {
+            if (item.expire <= now) {
+                on_expire(item);
+            } else {
+                Place(std::move(item));
+            }
+        }
+        return;
+    }
+
+    while (m_now < now) {
+        ++m_now;
+        if ((m_now & SLOT_MASK) == 0) {
+            if ((m_now & (SPAN_LEVEL1 - 1)) == 0) {
+                std::vector<Item> overflow;
+                overflow.swap(m_overflow);
+                Cascade(std::move(overflow));
+            }
+            std::vector<Item> cascade;
+            cascade.swap(m_level1[(m_now >> SLOT_BITS) & SLOT_MASK]);
+            Cascade(std::move(cascade));
+        }
+        std::vector<Item> due;
+        due.swap(m_level0[m_now & SLOT_MASK]);
+        m_size -= due.size();
+        for (auto& item : due) {
+            if (item.expire <= m_now) {
+                on_expire(item);
+            } else {
+                Place(std::move(item));
+            }
+        }
+    }
+}
+
 class NetFulfilledRequestStore
 {
 protected:
+    // Legacy (on-disk) representation, see Serialize/Unserialize
     typedef std::map<std::string, int64_t> fulfilledreqmapentry_t;
     typedef std::map<CService, fulfilledreqmapentry_t> fulfilledreqmap_t;
 
+    struct FulfilledRequest {
+        uint16_t type;
+        int64_t expire;
+    };
+    // Only a handful of request types exist, a flat vector beats any node based container here
+    using peer_requests_t = std::vector<FulfilledRequest>;
+
 protected:
+    mutable Mutex cs_mapFulfilledRequests;
+
     //keep track of what node has/was asked for and when
-    fulfilledreqmap_t mapFulfilledRequests;
-    mutable RecursiveMutex cs_mapFulfilledRequests;
+    std::unordered_map<CService, peer_requests_t, CServiceHash> mapFulfilledRequests GUARDED_BY(cs_mapFulfilledRequests);
+    //interned request strings, index is the request type id
+    std::vector<std::string> vecRequestTypes GUARDED_BY(cs_mapFulfilledRequests);
+    std::unordered_map<std::string, uint16_t> mapRequestTypeIds GUARDED_BY(cs_mapFulfilledRequests);
+    NetFulfilledExpiryWheel expiryWheel GUARDED_BY(cs_mapFulfilledRequests);
+
+    uint16_t InternRequestType(const std::string& strRequest) EXCLUSIVE_LOCKS_REQUIRED(cs_mapFulfilledRequests);
+    void SetFulfilledRequest(const CService& addr, uint16_t type, int64_t expire) EXCLUSIVE_LOCKS_REQUIRED(cs_mapFulfilledRequests);
+    void ExpireRequests(int64_t now) EXCLUSIVE_LOCKS_REQUIRED(cs_mapFulfilledRequests);
 
 public:
-    SERIALIZE_METHODS(NetFulfilledRequestStore, obj)
+    template <typename Stream>
+    void Serialize(Stream& s) const EXCLUSIVE_LOCKS_REQUIRED(!cs_mapFulfilledRequests)
     {
-        LOCK(obj.cs_mapFulfilledRequests);
-        READWRITE(obj.mapFulfilledRequests);
+        // Keep the nested map format so that existing netfulfilled.dat files stay compatible
+        fulfilledreqmap_t mapLegacy;
+        {
+            LOCK(cs_mapFulfilledRequests);
+            for (const auto& [addr, requests] : mapFulfilledRequests) {
+                auto& entry = mapLegacy[addr];
+                for (const auto& request : requests) {
+                    entry.emplace(vecRequestTypes[request.type], request.expire);
+                }
+            }
+        }
+        s << mapLegacy;
     }
 
-    void Clear();
+    template <typename Stream>
+    void Unserialize(Stream& s) EXCLUSIVE_LOCKS_REQUIRED(!cs_mapFulfilledRequests)
+    {
+        fulfilledreqmap_t mapLegacy;
+        s >> mapLegacy;
+        Load(mapLegacy);
+    }
+
+    void Load(const fulfilledreqmap_t& mapLegacy) EXCLUSIVE_LOCKS_REQUIRED(!cs_mapFulfilledRequests);
+    void Clear() EXCLUSIVE_LOCKS_REQUIRED(!cs_mapFulfilledRequests);
 
-    std::string ToString() const;
+    std::string ToString() const EXCLUSIVE_LOCKS_REQUIRED(!cs_mapFulfilledRequests);
 };
 
 // Fulfilled requests are used to prevent nodes from asking for the same data on sync
@@ -56,14 +203,16 @@ public:
     bool LoadCache(bool load_cache);
 
     bool IsValid() const { return is_valid; }
-    void CheckAndRemove();
+    void CheckAndRemove() EXCLUSIVE_LOCKS_REQUIRED(!cs_mapFulfilledRequests);
+
+    void AddFulfilledRequest(const CService& addr, const std::string& strRequest) EXCLUSIVE_LOCKS_REQUIRED(!cs_mapFulfilledRequests);
+    bool HasFulfilledRequest(const CService& addr, const std::string& strRequest) EXCLUSIVE_LOCKS_REQUIRED(!cs_mapFulfilledRequests);
 
-    void AddFulfilledRequest(const CService& addr, const std::string& strRequest);
-    bool HasFulfilledRequest(const CService& addr, const std::string& strRequest);
+    void RemoveAllFulfilledRequests(const CService& addr) EXCLUSIVE_LOCKS_REQUIRED(!cs_mapFulfilledRequests);
 
-    void RemoveAllFulfilledRequests(const CService& addr);
+    size_t GetPeerCount() const EXCLUSIVE_LOCKS_REQUIRED(!cs_mapFulfilledRequests);
 
-    void DoMaintenance();
+    void DoMaintenance() EXCLUSIVE_LOCKS_REQUIRED(!cs_mapFulfilledRequests);
 };
 
 #endif // BITCOIN_NETFULFILLEDMAN_H
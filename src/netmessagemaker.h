@@ -30,6 +30,8 @@ public:
         return Make(0, std::move(msg_type), std::forward<Args>(args)...);
     }
 
+    int GetVersion() const { return nVersion; }
+
 private:
     const int nVersion;
 };
@@ -6,20 +6,32 @@
 
 #include <chain.h>
 #include <chainparams.h>
+#include <consensus/consensus.h>
 #include <consensus/validation.h>
+#include <crypto/common.h>
+#include <ctpl_stl.h>
 #include <dsnotificationinterface.h>
 #include <evo/deterministicmns.h>
 #include <flatfile.h>
 #include <fs.h>
 #include <masternode/node.h>
 #include <pow.h>
+#include <protocol.h>
 #include <shutdown.h>
 #include <streams.h>
+#include <sync.h>
+#include <util/mappedfile.h>
+#include <util/strencodings.h>
 #include <util/system.h>
 #include <validation.h>
 #include <walletinitinterface.h>
 #include <spork.h>
 
+#include <algorithm>
+#include <cstring>
+#include <list>
+#include <memory>
+
 // From validation. TODO move here
 bool FindBlockPos(FlatFilePos& pos, unsigned int nAddSize, unsigned int nHeight, CChain& active_chain, uint64_t nTime, bool fKnown = false);
 
@@ -46,10 +58,94 @@ static bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos, const CMessa
     return true;
 }
 
+bool g_block_file_mmap{DEFAULT_BLOCK_FILE_MMAP};
+
+namespace {
+/** Read-only mappings of the most recently read block files */
+class BlockFileMappings
+{
+    Mutex m_mutex;
+    //! Most recently used first
+    std::list<std::pair<int, std::shared_ptr<const MappedFile>>> m_files GUARDED_BY(m_mutex);
+
+public:
+    /** A mapping of the block file at least min_size bytes long, nullptr if the file can't be mapped or is shorter */
+    std::shared_ptr<const MappedFile> Get(int file, size_t min_size) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        const auto it = std::find_if(m_files.begin(), m_files.end(), [&](const auto& entry) { return entry.first == file; });
+        if (it != m_files.end()) {
+            if (it->second->Size() >= min_size) {
+                m_files.splice(m_files.begin(), m_files, it);
+                return it->second;
+            }
+            // The file grew since it was mapped
+            m_files.erase(it);
+        }
+        std::shared_ptr<const MappedFile> mapped{MappedFile::Open(GetBlockPosFilename(FlatFilePos(file, 0)))};
+        if (!mapped || mapped->Size() < min_size) return nullptr;
+        m_files.emplace_front(file, mapped);
+        if (m_files.size() > MAX_MAPPED_BLOCK_FILES) m_files.pop_back();
+        return mapped;
+    }
+
+    void Forget(int file) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        m_files.remove_if([&](const auto& entry) { return entry.first == file; });
+    }
+};
+
+BlockFileMappings g_block_file_mappings;
+} // namespace
+
+void UnmapBlockFile(int nFile)
+{
+    g_block_file_mappings.Forget(nFile);
+}
+
+/**
+ * Find the serialized block at pos in a mapping of its block file. Returns the mapping, which has to be held on to
+ * while block_data is used, or nullptr if the block can't be read this way.
+ */
+static std::shared_ptr<const MappedFile> MapBlock(const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start,
+                                                  Span<const unsigned char>& block_data)
+{
+    // A block is stored after the network magic and its size
+    constexpr size_t header_size{CMessageHeader::MESSAGE_START_SIZE + sizeof(uint32_t)};
+    if (pos.IsNull() || pos.nPos < header_size) return nullptr;
+
+    auto file = g_block_file_mappings.Get(pos.nFile, pos.nPos);
+    if (!file) return nullptr;
+    const Span<const unsigned char> header{file->Data().subspan(pos.nPos - header_size, header_size)};
+    if (std::memcmp(header.data(), message_start, CMessageHeader::MESSAGE_START_SIZE) != 0) return nullptr;
+    const uint32_t block_size{ReadLE32(header.data() + CMessageHeader::MESSAGE_START_SIZE)};
+    if (block_size > MaxBlockSize()) return nullptr;
+    if (pos.nPos + block_size > file->Size()) {
+        file = g_block_file_mappings.Get(pos.nFile, pos.nPos + block_size);
+        if (!file) return nullptr;
+    }
+    block_data = file->Data().subspan(pos.nPos, block_size);
+    return file;
+}
+
 bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::Params& consensusParams)
 {
     block.SetNull();
 
+    Span<const unsigned char> block_data;
+    if (const auto file = g_block_file_mmap ? MapBlock(pos, Params().MessageStart(), block_data) : nullptr) {
+        try {
+            SpanReader{SER_DISK, CLIENT_VERSION, block_data, 0} >> block;
+        } catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        }
+        if (!CheckProofOfWork(block.GetHash(), block.nBits, consensusParams)) {
+            return error("ReadBlockFromDisk: Errors in block header at %s", pos.ToString());
+        }
+        return true;
+    }
+
     // Open history file to read
     CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull()) {
@@ -85,6 +181,70 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
     return true;
 }
 
+bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start)
+{
+    Span<const unsigned char> block_data;
+    if (const auto file = g_block_file_mmap ? MapBlock(pos, message_start, block_data) : nullptr) {
+        block.assign(block_data.begin(), block_data.end());
+        return true;
+    }
+
+    if (pos.nPos < 8) {
+        return error("%s: Invalid block position %s", __func__, pos.ToString());
+    }
+    FlatFilePos hpos = pos;
+    hpos.nPos -= 8; // Seek back 8 bytes for meta header
+    CAutoFile filein(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull()) {
+        return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+    }
+
+    try {
+        CMessageHeader::MessageStartChars blk_start;
+        unsigned int blk_size;
+
+        filein >> blk_start >> blk_size;
+
+        if (memcmp(blk_start, message_start, CMessageHeader::MESSAGE_START_SIZE)) {
+            return error("%s: Block magic mismatch for %s: %s versus expected %s", __func__, pos.ToString(),
+                         HexStr(blk_start),
+                         HexStr(message_start));
+        }
+
+        if (blk_size > MAX_SIZE) {
+            return error("%s: Block data is larger than maximum deserialization size for %s: %s versus %s", __func__, pos.ToString(),
+                         blk_size, MAX_SIZE);
+        }
+
+        block.resize(blk_size); // Zeroing of memory is intentional here
+        filein.read(MakeWritableByteSpan(block));
+    } catch (const std::exception& e) {
+        return error("%s: Read from block file failed: %s for %s", __func__, e.what(), pos.ToString());
+    }
+
+    return true;
+}
+
+bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start)
+{
+    const FlatFilePos block_pos{WITH_LOCK(cs_main, return pindex->GetBlockPos())};
+
+    if (!ReadRawBlockFromDisk(block, block_pos, message_start)) {
+        return false;
+    }
+    // The bytes are passed on without being parsed, make sure they start with the header we expect
+    CBlockHeader header;
+    try {
+        SpanReader{SER_DISK, CLIENT_VERSION, block, 0} >> header;
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), block_pos.ToString());
+    }
+    if (header.GetHash() != pindex->GetBlockHash()) {
+        return error("%s: GetHash() doesn't match index for %s at %s", __func__, pindex->ToString(), block_pos.ToString());
+    }
+    return true;
+}
+
 /** Store block on disk. If dbp is non-nullptr, the file is known to already reside on disk */
 FlatFilePos SaveBlockToDisk(const CBlock& block, int nHeight, CChain& active_chain, const CChainParams& chainparams, const FlatFilePos* dbp)
 {
@@ -128,6 +288,16 @@ void ThreadImport(ChainstateManager& chainman, CDeterministicMNManager& dmnman,
     {
         CImportingNow imp;
 
+        // Threads deserializing and checking the blocks of mapped files ahead of their import
+        ctpl::thread_pool import_pool;
+        if (fReindex || !vImportFiles.empty()) {
+            import_pool.resize(std::clamp<int>(args.GetArg("-reindexthreads", DEFAULT_REINDEX_THREADS), 0, MAX_REINDEX_THREADS));
+            RenameThreadPool(import_pool, "reindex");
+        }
+        const auto map_file = [&](const fs::path& path) {
+            return import_pool.size() > 0 && g_block_file_mmap ? MappedFile::Open(path) : nullptr;
+        };
+
         // -reindex
         if (fReindex) {
             int nFile = 0;
@@ -136,12 +306,17 @@ void ThreadImport(ChainstateManager& chainman, CDeterministicMNManager& dmnman,
                 if (!fs::exists(GetBlockPosFilename(pos))) {
                     break; // No block files left to reindex
                 }
-                FILE* file = OpenBlockFile(pos, true);
-                if (!file) {
-                    break; // This error is logged in OpenBlockFile
+                if (const auto mapped = map_file(GetBlockPosFilename(pos))) {
+                    LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
+                    chainman.ActiveChainstate().LoadMappedBlockFile(*mapped, spork_manager, import_pool, &pos);
+                } else {
+                    FILE* file = OpenBlockFile(pos, true);
+                    if (!file) {
+                        break; // This error is logged in OpenBlockFile
+                    }
+                    LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
+                    chainman.ActiveChainstate().LoadExternalBlockFile(file, spork_manager, &pos);
                 }
-                LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
-                chainman.ActiveChainstate().LoadExternalBlockFile(file, spork_manager, &pos);
                 if (ShutdownRequested()) {
                     LogPrintf("Shutdown requested. Exit %s\n", __func__);
                     return;
@@ -157,10 +332,15 @@ void ThreadImport(ChainstateManager& chainman, CDeterministicMNManager& dmnman,
 
         // -loadblock=
         for (const fs::path& path : vImportFiles) {
-            FILE *file = fsbridge::fopen(path, "rb");
-            if (file) {
+            const auto mapped = map_file(path);
+            FILE* file = mapped ? nullptr : fsbridge::fopen(path, "rb");
+            if (mapped || file) {
                 LogPrintf("Importing blocks file %s...\n", path.string());
-                chainman.ActiveChainstate().LoadExternalBlockFile(file, spork_manager);
+                if (mapped) {
+                    chainman.ActiveChainstate().LoadMappedBlockFile(*mapped, spork_manager, import_pool);
+                } else {
+                    chainman.ActiveChainstate().LoadExternalBlockFile(file, spork_manager);
+                }
                 if (ShutdownRequested()) {
                     LogPrintf("Shutdown requested. Exit %s\n", __func__);
                     return;
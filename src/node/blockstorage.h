@@ -28,10 +28,22 @@ struct Params;
 }
 
 static constexpr bool DEFAULT_STOPAFTERBLOCKIMPORT{false};
+/** -blockfilemmap default, on 64 bit systems blocks are read through memory mappings of their files */
+static constexpr bool DEFAULT_BLOCK_FILE_MMAP{sizeof(void*) >= 8};
+/** Number of block files kept mapped for reading */
+static constexpr size_t MAX_MAPPED_BLOCK_FILES{8};
+
+extern bool g_block_file_mmap;
 
 /** Functions for disk access for blocks */
 bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Read the block at pos as it is stored, without deserializing it. The bytes are the block's network serialization */
+bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start);
+/** Like the above, also checks that the block read has the header of the index entry */
+bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start);
+/** Forget the mapping of a block file, before it is truncated or deleted */
+void UnmapBlockFile(int nFile);
 
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
 
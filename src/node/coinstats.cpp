@@ -106,15 +106,10 @@ static void ApplyStats(CCoinsStats& stats, std::nullptr_t, const uint256& hash,
 
 //! Calculate statistics about the unspent transaction output set
 template <typename T>
-static bool GetUTXOStats(CCoinsView* view, BlockManager& blockman, CCoinsStats& stats, T hash_obj, const std::function<void()>& interruption_point, const CBlockIndex* pindex)
+static bool GetUTXOStats(CCoinsViewCursor* pcursor, CCoinsView* view, const CBlockIndex* pindex, CCoinsStats& stats, T hash_obj, const std::function<void()>& interruption_point)
 {
-    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
     assert(pcursor);
 
-    if (!pindex) {
-        LOCK(cs_main);
-        pindex = blockman.LookupBlockIndex(view->GetBestBlock());
-    }
     stats.nHeight = Assert(pindex)->nHeight;
     stats.hashBlock = pindex->GetBlockHash();
 
@@ -158,18 +153,29 @@ static bool GetUTXOStats(CCoinsView* view, BlockManager& blockman, CCoinsStats&
 }
 
 bool GetUTXOStats(CCoinsView* view, BlockManager& blockman, CCoinsStats& stats, const std::function<void()>& interruption_point, const CBlockIndex* pindex)
+{
+    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
+
+    if (!pindex) {
+        LOCK(cs_main);
+        pindex = blockman.LookupBlockIndex(view->GetBestBlock());
+    }
+    return GetUTXOStats(std::move(pcursor), view, pindex, stats, interruption_point);
+}
+
+bool GetUTXOStats(std::unique_ptr<CCoinsViewCursor> pcursor, CCoinsView* view, const CBlockIndex* pindex, CCoinsStats& stats, const std::function<void()>& interruption_point)
 {
     switch (stats.m_hash_type) {
     case(CoinStatsHashType::HASH_SERIALIZED): {
         CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
-        return GetUTXOStats(view, blockman, stats, ss, interruption_point, pindex);
+        return GetUTXOStats(pcursor.get(), view, pindex, stats, ss, interruption_point);
     }
     case(CoinStatsHashType::MUHASH): {
         MuHash3072 muhash;
-        return GetUTXOStats(view, blockman, stats, muhash, interruption_point, pindex);
+        return GetUTXOStats(pcursor.get(), view, pindex, stats, muhash, interruption_point);
     }
     case(CoinStatsHashType::NONE): {
-        return GetUTXOStats(view, blockman, stats, nullptr, interruption_point, pindex);
+        return GetUTXOStats(pcursor.get(), view, pindex, stats, nullptr, interruption_point);
     }
     } // no default case, so the compiler can warn about missing cases
     assert(false);
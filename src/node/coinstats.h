@@ -14,6 +14,7 @@
 
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <optional>
 
 class BlockManager;
@@ -74,6 +75,10 @@ struct CCoinsStats {
 //! Calculate statistics about the unspent transaction output set
 bool GetUTXOStats(CCoinsView* view, BlockManager& blockman, CCoinsStats& stats, const std::function<void()>& interruption_point = {}, const CBlockIndex* pindex = nullptr);
 
+//! Calculate statistics about the unspent transaction output set from a cursor of `view` taken at
+//! `pindex` beforehand, so the set can be hashed without holding the locks that kept it consistent
+bool GetUTXOStats(std::unique_ptr<CCoinsViewCursor> pcursor, CCoinsView* view, const CBlockIndex* pindex, CCoinsStats& stats, const std::function<void()>& interruption_point = {});
+
 uint64_t GetBogoSize(const CScript& script_pub_key);
 
 CDataStream TxOutSer(const COutPoint& outpoint, const Coin& coin);
@@ -0,0 +1,322 @@
+// Copyright (c) 2024 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/txreconciliation.h>
+
+#include <crypto/common.h>
+#include <crypto/sha256.h>
+#include <crypto/siphash.h>
+#include <logging.h>
+#include <random.h>
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+
+namespace {
+/** Static component of the salt used to compute short txids for reconciliation */
+const std::string RECON_SALT_TAG{"Sparks Tx Relay Salting"};
+/** Expected share of either set the other side doesn't have, on top of the set size difference */
+constexpr double RECON_Q{0.25};
+
+/** MurmurHash3's 32 bit finalizer, the ids are salted SipHash outputs already so this only has to spread them */
+uint32_t Mix(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x85ebca6b;
+    x ^= x >> 13;
+    x *= 0xc2b2ae35;
+    x ^= x >> 16;
+    return x;
+}
+
+uint32_t CellHash(uint32_t short_id) { return Mix(short_id ^ 0x5bd1e995); }
+} // anonymous namespace
+
+TxReconSketch::TxReconSketch(size_t cells) : m_cells(cells) {}
+
+size_t TxReconSketch::CellsForCapacity(size_t capacity)
+{
+    // Peeling a three hash table needs ~1.23 cells per id for large differences and
+    // proportionally more for small ones, the constant term covers the latter
+    const size_t cells = capacity + capacity / 2 + 12;
+    return std::min(MAX_SKETCH_CELLS, (cells + 2) / 3 * 3);
+}
+
+void TxReconSketch::Toggle(uint32_t short_id, int32_t count)
+{
+    const size_t part = m_cells.size() / 3;
+    const uint32_t hash = CellHash(short_id);
+    for (size_t i = 0; i < 3; ++i) {
+        Cell& cell = m_cells[i * part + Mix(short_id + uint32_t(i + 1) * 0x9e3779b9) % part];
+        cell.count += count;
+        cell.id_sum ^= short_id;
+        cell.hash_sum ^= hash;
+    }
+}
+
+void TxReconSketch::Add(uint32_t short_id)
+{
+    assert(IsValid());
+    Toggle(short_id, 1);
+}
+
+void TxReconSketch::Subtract(const TxReconSketch& other)
+{
+    assert(m_cells.size() == other.m_cells.size());
+    for (size_t i = 0; i < m_cells.size(); ++i) {
+        m_cells[i].count -= other.m_cells[i].count;
+        m_cells[i].id_sum ^= other.m_cells[i].id_sum;
+        m_cells[i].hash_sum ^= other.m_cells[i].hash_sum;
+    }
+}
+
+bool TxReconSketch::Decode(std::vector<uint32_t>& only_ours, std::vector<uint32_t>& only_theirs) const
+{
+    if (!IsValid()) return false;
+
+    TxReconSketch work{*this};
+    const auto is_pure = [](const Cell& cell) {
+        return (cell.count == 1 || cell.count == -1) && cell.hash_sum == CellHash(cell.id_sum);
+    };
+
+    std::deque<size_t> pure;
+    for (size_t i = 0; i < work.m_cells.size(); ++i) {
+        if (is_pure(work.m_cells[i])) pure.push_back(i);
+    }
+    while (!pure.empty()) {
+        const Cell& cell = work.m_cells[pure.front()];
+        pure.pop_front();
+        // Peeling a neighbour may have emptied or spoiled this cell in the meantime
+        if (!is_pure(cell)) continue;
+        const uint32_t short_id = cell.id_sum;
+        const int32_t count = cell.count;
+        (count > 0 ? only_ours : only_theirs).push_back(short_id);
+        work.Toggle(short_id, -count);
+
+        const size_t part = work.m_cells.size() / 3;
+        for (size_t i = 0; i < 3; ++i) {
+            const size_t index = i * part + Mix(short_id + uint32_t(i + 1) * 0x9e3779b9) % part;
+            if (is_pure(work.m_cells[index])) pure.push_back(index);
+        }
+    }
+
+    return std::all_of(work.m_cells.begin(), work.m_cells.end(), [](const Cell& cell) {
+        return cell.count == 0 && cell.id_sum == 0 && cell.hash_sum == 0;
+    });
+}
+
+uint32_t TxReconciliationTracker::PeerState::ComputeShortID(const uint256& txid) const
+{
+    return static_cast<uint32_t>(SipHashUint256(k0, k1, txid));
+}
+
+TxReconSketch TxReconciliationTracker::PeerState::SketchSnapshot(size_t cells) const
+{
+    TxReconSketch sketch{cells};
+    for (const auto& [short_id, txid] : snapshot) {
+        sketch.Add(short_id);
+    }
+    return sketch;
+}
+
+void TxReconciliationTracker::PeerState::TakeSnapshot(std::vector<uint256>& out)
+{
+    for (const auto& [short_id, txid] : snapshot) {
+        out.push_back(txid);
+    }
+    snapshot.clear();
+    in_progress = false;
+}
+
+/** Move the set into the snapshot, a tx whose short id collides stays in the set for the next round */
+static void StartSnapshot(std::set<uint256>& local_set, std::map<uint32_t, uint256>& snapshot,
+                          const std::function<uint32_t(const uint256&)>& short_id)
+{
+    for (auto it = local_set.begin(); it != local_set.end();) {
+        if (snapshot.emplace(short_id(*it), *it).second) {
+            it = local_set.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+TxReconciliationTracker::TxReconciliationTracker(uint32_t recon_version) : m_recon_version(recon_version) {}
+
+uint64_t TxReconciliationTracker::PreRegisterPeer(NodeId peer_id)
+{
+    const uint64_t local_salt{GetRand(std::numeric_limits<uint64_t>::max())};
+    LOCK(m_mutex);
+    LogPrint(BCLog::NET, "Pre-register peer=%d for transaction reconciliation\n", peer_id);
+    PeerState& state = m_states[peer_id];
+    state = PeerState{};
+    state.local_salt = local_salt;
+    return local_salt;
+}
+
+TxReconciliationTracker::RegisterResult TxReconciliationTracker::RegisterPeer(NodeId peer_id, bool is_peer_inbound,
+                                                                              uint32_t peer_recon_version, uint64_t remote_salt)
+{
+    LOCK(m_mutex);
+    auto it = m_states.find(peer_id);
+    if (it == m_states.end()) return RegisterResult::NOT_FOUND;
+    PeerState& state = it->second;
+    if (state.registered) return RegisterResult::ALREADY_REGISTERED;
+
+    // Versions are backwards compatible, use the lower one; version 0 doesn't exist
+    const uint32_t recon_version{std::min(peer_recon_version, m_recon_version)};
+    if (recon_version < 1) return RegisterResult::PROTOCOL_VIOLATION;
+
+    // Both sides derive the same keys no matter who sent which salt
+    unsigned char salt_hash[CSHA256::OUTPUT_SIZE];
+    unsigned char salt_bytes[8];
+    CSHA256 hasher;
+    hasher.Write(reinterpret_cast<const unsigned char*>(RECON_SALT_TAG.data()), RECON_SALT_TAG.size());
+    WriteLE64(salt_bytes, std::min(state.local_salt, remote_salt));
+    hasher.Write(salt_bytes, sizeof(salt_bytes));
+    WriteLE64(salt_bytes, std::max(state.local_salt, remote_salt));
+    hasher.Write(salt_bytes, sizeof(salt_bytes));
+    hasher.Finalize(salt_hash);
+    state.k0 = ReadLE64(salt_hash);
+    state.k1 = ReadLE64(salt_hash + 8);
+
+    // The side that made the connection initiates reconciliations
+    state.we_initiate = !is_peer_inbound;
+    state.registered = true;
+    LogPrint(BCLog::NET, "Register peer=%d for transaction reconciliation, we %s\n", peer_id,
+             state.we_initiate ? "initiate" : "respond");
+    return RegisterResult::SUCCESS;
+}
+
+std::vector<uint256> TxReconciliationTracker::ForgetPeer(NodeId peer_id)
+{
+    std::vector<uint256> pending;
+    LOCK(m_mutex);
+    auto it = m_states.find(peer_id);
+    if (it == m_states.end()) return pending;
+    it->second.TakeSnapshot(pending);
+    pending.insert(pending.end(), it->second.local_set.begin(), it->second.local_set.end());
+    m_states.erase(it);
+    LogPrint(BCLog::NET, "Forget transaction reconciliation state of peer=%d\n", peer_id);
+    return pending;
+}
+
+bool TxReconciliationTracker::IsPeerRegistered(NodeId peer_id) const
+{
+    LOCK(m_mutex);
+    auto it = m_states.find(peer_id);
+    return it != m_states.end() && it->second.registered;
+}
+
+bool TxReconciliationTracker::AddToSet(NodeId peer_id, const uint256& txid)
+{
+    LOCK(m_mutex);
+    auto it = m_states.find(peer_id);
+    if (it == m_states.end() || !it->second.registered) return false;
+    PeerState& state = it->second;
+    if (state.local_set.size() >= MAX_RECON_SET_SIZE) return false;
+    state.local_set.insert(txid);
+    return true;
+}
+
+std::optional<uint32_t> TxReconciliationTracker::InitiateReconciliation(NodeId peer_id, std::chrono::microseconds now,
+                                                                       std::vector<uint256>& to_flood)
+{
+    LOCK(m_mutex);
+    auto it = m_states.find(peer_id);
+    if (it == m_states.end() || !it->second.registered || !it->second.we_initiate) return std::nullopt;
+    PeerState& state = it->second;
+
+    if (state.in_progress) {
+        if (now - state.request_sent < RECON_RESPONSE_TIMEOUT) return std::nullopt;
+        LogPrint(BCLog::NET, "Transaction reconciliation with peer=%d timed out\n", peer_id);
+        state.TakeSnapshot(to_flood);
+    }
+    if (now < state.next_request) return std::nullopt;
+    state.next_request = now + RECON_REQUEST_INTERVAL;
+
+    StartSnapshot(state.local_set, state.snapshot, [&state](const uint256& txid) { return state.ComputeShortID(txid); });
+    state.in_progress = true;
+    state.request_sent = now;
+    return static_cast<uint32_t>(state.snapshot.size());
+}
+
+std::optional<TxReconSketch> TxReconciliationTracker::RespondToRequest(NodeId peer_id, uint32_t remote_set_size)
+{
+    LOCK(m_mutex);
+    auto it = m_states.find(peer_id);
+    if (it == m_states.end() || !it->second.registered || it->second.we_initiate) return std::nullopt;
+    PeerState& state = it->second;
+
+    if (state.in_progress) {
+        // The initiator gave up on the previous round, its transactions go into this one
+        for (const auto& [short_id, txid] : state.snapshot) {
+            state.local_set.insert(txid);
+        }
+        state.snapshot.clear();
+    }
+    StartSnapshot(state.local_set, state.snapshot, [&state](const uint256& txid) { return state.ComputeShortID(txid); });
+    state.in_progress = true;
+
+    const size_t local_size{state.snapshot.size()};
+    const size_t remote_size{std::min<size_t>(remote_set_size, MAX_RECON_SET_SIZE)};
+    const size_t capacity{std::max(local_size, remote_size) - std::min(local_size, remote_size) +
+                          static_cast<size_t>(RECON_Q * std::min(local_size, remote_size)) + 1};
+    return state.SketchSnapshot(TxReconSketch::CellsForCapacity(capacity));
+}
+
+std::optional<bool> TxReconciliationTracker::ProcessSketch(NodeId peer_id, const TxReconSketch& sketch, std::vector<uint32_t>& to_ask,
+                                                           std::vector<uint256>& to_announce)
+{
+    LOCK(m_mutex);
+    auto it = m_states.find(peer_id);
+    if (it == m_states.end() || !it->second.registered || !it->second.we_initiate || !it->second.in_progress) return std::nullopt;
+    PeerState& state = it->second;
+
+    if (sketch.IsValid()) {
+        TxReconSketch diff{sketch};
+        diff.Subtract(state.SketchSnapshot(sketch.GetCells()));
+        std::vector<uint32_t> only_theirs, only_ours;
+        // Ids only in our sketch must be in our snapshot, anything else means the decode went wrong
+        if (diff.Decode(only_theirs, only_ours) &&
+            std::all_of(only_ours.begin(), only_ours.end(), [&](uint32_t id) { return state.snapshot.count(id); })) {
+            for (const uint32_t id : only_ours) {
+                to_announce.push_back(state.snapshot.at(id));
+            }
+            to_ask = std::move(only_theirs);
+            state.snapshot.clear();
+            state.in_progress = false;
+            LogPrint(BCLog::NET, "Transaction reconciliation with peer=%d succeeded, announcing %d and asking for %d\n",
+                     peer_id, to_announce.size(), to_ask.size());
+            return true;
+        }
+    }
+
+    LogPrint(BCLog::NET, "Transaction reconciliation with peer=%d failed, flooding %d transactions\n", peer_id, state.snapshot.size());
+    state.TakeSnapshot(to_announce);
+    return false;
+}
+
+std::optional<std::vector<uint256>> TxReconciliationTracker::ProcessDiff(NodeId peer_id, bool success, const std::vector<uint32_t>& asked)
+{
+    LOCK(m_mutex);
+    auto it = m_states.find(peer_id);
+    if (it == m_states.end() || !it->second.registered || it->second.we_initiate || !it->second.in_progress) return std::nullopt;
+    PeerState& state = it->second;
+
+    std::vector<uint256> to_announce;
+    if (success) {
+        for (const uint32_t id : asked) {
+            if (auto snap_it = state.snapshot.find(id); snap_it != state.snapshot.end()) {
+                to_announce.push_back(snap_it->second);
+            }
+        }
+        state.snapshot.clear();
+        state.in_progress = false;
+    } else {
+        state.TakeSnapshot(to_announce);
+    }
+    return to_announce;
+}
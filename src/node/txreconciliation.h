@@ -0,0 +1,164 @@
+// Copyright (c) 2024 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_TXRECONCILIATION_H
+#define BITCOIN_NODE_TXRECONCILIATION_H
+
+#include <net.h>
+#include <serialize.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+/** Default for -txreconciliation, relaying transactions to peers through set reconciliation */
+static constexpr bool DEFAULT_TXRECONCILIATION_ENABLE{false};
+/** Supported transaction reconciliation protocol version */
+static constexpr uint32_t TXRECONCILIATION_VERSION{1};
+/** How often we start a reconciliation with each peer we initiate them with */
+static constexpr auto RECON_REQUEST_INTERVAL{4s};
+/** Give up on a reconciliation the peer didn't answer in time, its transactions are flooded instead */
+static constexpr auto RECON_RESPONSE_TIMEOUT{30s};
+/** Transactions waiting to be reconciled with a peer, anything beyond that is flooded to it */
+static constexpr size_t MAX_RECON_SET_SIZE{10000};
+/** Largest sketch we build or accept, in cells */
+static constexpr size_t MAX_SKETCH_CELLS{3 * 1024};
+
+/**
+ * An invertible Bloom lookup table over 32 bit short transaction ids.
+ *
+ * Each id is added to one cell in each of three equally sized partitions. Subtracting the sketch of one
+ * set from the sketch of another leaves only the ids of their symmetric difference, which decodes by
+ * peeling cells holding a single id as long as the difference is not much larger than a third of the
+ * cells. Unlike a BCH sketch (minisketch) it needs about 1.5 cells per difference instead of one, but
+ * encoding and decoding are linear and need no finite field arithmetic.
+ */
+class TxReconSketch
+{
+public:
+    struct Cell {
+        int32_t count{0};
+        uint32_t id_sum{0};
+        uint32_t hash_sum{0};
+
+        SERIALIZE_METHODS(Cell, obj) { READWRITE(obj.count, obj.id_sum, obj.hash_sum); }
+    };
+
+    TxReconSketch() = default;
+    explicit TxReconSketch(size_t cells);
+
+    /** Number of cells for a sketch that decodes a difference of the given size with high probability */
+    static size_t CellsForCapacity(size_t capacity);
+
+    size_t GetCells() const { return m_cells.size(); }
+    bool IsValid() const { return !m_cells.empty() && m_cells.size() % 3 == 0 && m_cells.size() <= MAX_SKETCH_CELLS; }
+
+    void Add(uint32_t short_id);
+    /** Remove the ids of other from this sketch, both must have the same number of cells */
+    void Subtract(const TxReconSketch& other);
+    /** Decode a difference sketch into the ids only added to this one and the ids only subtracted from it */
+    bool Decode(std::vector<uint32_t>& only_ours, std::vector<uint32_t>& only_theirs) const;
+
+    SERIALIZE_METHODS(TxReconSketch, obj) { READWRITE(obj.m_cells); }
+
+private:
+    std::vector<Cell> m_cells;
+
+    void Toggle(uint32_t short_id, int32_t count);
+};
+
+/**
+ * Transaction relay through set reconciliation (Erlay-like, BIP330 inspired).
+ *
+ * Instead of announcing every transaction to every peer, transactions for a reconciling peer are put
+ * into a per-peer set. Periodically the side that made the connection (the initiator) asks the other
+ * side for a sketch of its set, subtracts a sketch of its own set and decodes what only one of them has.
+ * The initiator then announces what only it has and asks for what only the responder has, transactions
+ * both sides already know about are never announced. A failed decode floods both sets instead.
+ *
+ * Peers negotiate it with the NODE_TXRECON service flag and a SENDTXRCNCL message exchanged between
+ * VERSION and VERACK, which also carries the salts for the short transaction ids of the connection.
+ */
+class TxReconciliationTracker
+{
+public:
+    enum class RegisterResult {
+        NOT_FOUND,
+        SUCCESS,
+        ALREADY_REGISTERED,
+        PROTOCOL_VIOLATION,
+    };
+
+    explicit TxReconciliationTracker(uint32_t recon_version);
+
+    /** Generate and remember our salt for a peer, to be sent to it in SENDTXRCNCL */
+    uint64_t PreRegisterPeer(NodeId peer_id) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Complete the registration once the peer's SENDTXRCNCL arrived */
+    RegisterResult RegisterPeer(NodeId peer_id, bool is_peer_inbound, uint32_t peer_recon_version, uint64_t remote_salt)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Forget a peer, returns the transactions that still had to be reconciled with it so they can be flooded */
+    std::vector<uint256> ForgetPeer(NodeId peer_id) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    bool IsPeerRegistered(NodeId peer_id) const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Queue a transaction for reconciliation, false if it has to be flooded (peer not registered, set full) */
+    bool AddToSet(NodeId peer_id, const uint256& txid) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /**
+     * Initiator: if it's time to reconcile with the peer, snapshot our set and return its size for REQTXRCNCL.
+     * A reconciliation the peer didn't answer within RECON_RESPONSE_TIMEOUT is abandoned, its transactions
+     * are returned in to_flood.
+     */
+    std::optional<uint32_t> InitiateReconciliation(NodeId peer_id, std::chrono::microseconds now, std::vector<uint256>& to_flood)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Responder: snapshot our set and sketch it for the initiator's REQTXRCNCL */
+    std::optional<TxReconSketch> RespondToRequest(NodeId peer_id, uint32_t remote_set_size) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /**
+     * Initiator: decode the responder's sketch against our snapshot. On success returns the short ids to ask
+     * the responder for and the transactions to announce to it, on failure all of our snapshot is returned
+     * in to_announce. Returns nullopt if no reconciliation was outstanding.
+     */
+    std::optional<bool> ProcessSketch(NodeId peer_id, const TxReconSketch& sketch, std::vector<uint32_t>& to_ask,
+                                      std::vector<uint256>& to_announce) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /**
+     * Responder: finish the reconciliation, returns the transactions to announce, the asked ones on
+     * success and all of the snapshot on failure. Returns nullopt if no reconciliation was outstanding.
+     */
+    std::optional<std::vector<uint256>> ProcessDiff(NodeId peer_id, bool success, const std::vector<uint32_t>& asked)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    struct PeerState {
+        /* Salt we sent the peer, until its SENDTXRCNCL arrives */
+        uint64_t local_salt{0};
+        bool registered{false};
+        bool we_initiate{false};
+        /* SipHash keys for short ids, derived from both salts */
+        uint64_t k0{0};
+        uint64_t k1{0};
+        /* Transactions waiting for the next reconciliation */
+        std::set<uint256> local_set;
+        /* Transactions of the reconciliation in progress, by short id */
+        std::map<uint32_t, uint256> snapshot;
+        bool in_progress{false};
+        std::chrono::microseconds next_request{0};
+        std::chrono::microseconds request_sent{0};
+
+        uint32_t ComputeShortID(const uint256& txid) const;
+        TxReconSketch SketchSnapshot(size_t cells) const;
+        /* Move the snapshot to out and end the reconciliation */
+        void TakeSnapshot(std::vector<uint256>& out);
+    };
+
+    const uint32_t m_recon_version;
+    mutable Mutex m_mutex;
+    std::unordered_map<NodeId, PeerState> m_states GUARDED_BY(m_mutex);
+};
+
+#endif // BITCOIN_NODE_TXRECONCILIATION_H
@@ -9,6 +9,8 @@
 #include <uint256.h>
 #include <serialize.h>
 
+#include <vector>
+
 //! Metadata describing a serialized version of a UTXO set from which an
 //! assumeutxo CChainState can be constructed.
 class SnapshotMetadata
@@ -22,15 +24,32 @@ public:
     //! during snapshot load to estimate progress of UTXO set reconstruction.
     uint64_t m_coins_count = 0;
 
+    //! The number of EvoDB entries following the coins. Masternode lists, quorum
+    //! and credit pool state can't be rebuilt from the UTXO set alone, so the
+    //! EvoDB as of the base block is shipped along with it.
+    uint64_t m_evodb_count = 0;
+
     SnapshotMetadata() { }
     SnapshotMetadata(
         const uint256& base_blockhash,
         uint64_t coins_count,
+        uint64_t evodb_count,
         unsigned int nchaintx) :
             m_base_blockhash(base_blockhash),
-            m_coins_count(coins_count) { }
+            m_coins_count(coins_count),
+            m_evodb_count(evodb_count) { }
+
+    SERIALIZE_METHODS(SnapshotMetadata, obj) { READWRITE(obj.m_base_blockhash, obj.m_coins_count, obj.m_evodb_count); }
+};
+
+//! A raw EvoDB key/value pair of a snapshot, entries are written in key order
+//! and their hash is committed to in AssumeutxoData::evodb_hash.
+struct SnapshotEvoDBEntry
+{
+    std::vector<unsigned char> key;
+    std::vector<unsigned char> value;
 
-    SERIALIZE_METHODS(SnapshotMetadata, obj) { READWRITE(obj.m_base_blockhash, obj.m_coins_count); }
+    SERIALIZE_METHODS(SnapshotEvoDBEntry, obj) { READWRITE(obj.key, obj.value); }
 };
 
 #endif // BITCOIN_NODE_UTXO_SNAPSHOT_H
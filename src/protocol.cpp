@@ -87,6 +87,11 @@ MAKE_MSG(MNAUTH, "mnauth");
 MAKE_MSG(GETHEADERS2, "getheaders2");
 MAKE_MSG(SENDHEADERS2, "sendheaders2");
 MAKE_MSG(HEADERS2, "headers2");
+MAKE_MSG(SENDCRC32C, "sendcrc32c");
+MAKE_MSG(SENDTXRCNCL, "sendtxrcncl");
+MAKE_MSG(REQTXRCNCL, "reqtxrcncl");
+MAKE_MSG(SKETCH, "sketch");
+MAKE_MSG(RECONCILDIFF, "reconcildiff");
 MAKE_MSG(GETQUORUMROTATIONINFO, "getqrinfo");
 MAKE_MSG(QUORUMROTATIONINFO, "qrinfo");
 }; // namespace NetMsgType
@@ -166,7 +171,12 @@ const static std::string allNetMessageTypes[] = {
     NetMsgType::MNAUTH,
     NetMsgType::GETHEADERS2,
     NetMsgType::SENDHEADERS2,
-    NetMsgType::HEADERS2};
+    NetMsgType::HEADERS2,
+    NetMsgType::SENDCRC32C,
+    NetMsgType::SENDTXRCNCL,
+    NetMsgType::REQTXRCNCL,
+    NetMsgType::SKETCH,
+    NetMsgType::RECONCILDIFF};
 const static std::vector<std::string> allNetMessageTypesVec(std::begin(allNetMessageTypes), std::end(allNetMessageTypes));
 
 /** Message types that are not allowed by blocks-relay-only policy.
@@ -337,6 +347,8 @@ static std::string serviceFlagToStr(size_t bit)
     case NODE_COMPACT_FILTERS: return "COMPACT_FILTERS";
     case NODE_NETWORK_LIMITED: return "NETWORK_LIMITED";
     case NODE_HEADERS_COMPRESSED: return "HEADERS_COMPRESSED";
+    case NODE_P2P_V2:          return "P2P_V2";
+    case NODE_TXRECON:         return "TXRECON";
     // Not using default, so we get warned when a case is missing
     }
 
@@ -293,6 +293,11 @@ extern const char* MNAUTH;
 extern const char* GETHEADERS2;
 extern const char* SENDHEADERS2;
 extern const char* HEADERS2;
+extern const char* SENDCRC32C;
+extern const char* SENDTXRCNCL;
+extern const char* REQTXRCNCL;
+extern const char* SKETCH;
+extern const char* RECONCILDIFF;
 extern const char* GETQUORUMROTATIONINFO;
 extern const char* QUORUMROTATIONINFO;
 };
@@ -324,6 +329,12 @@ enum ServiceFlags : uint64_t {
     NODE_NETWORK_LIMITED = (1 << 10),
     // description will be provided
     NODE_HEADERS_COMPRESSED = (1 << 11),
+    // NODE_P2P_V2 means the node supports the BIP324 v2 encrypted transport. Bit 11, which BIP324
+    // uses for this, is NODE_HEADERS_COMPRESSED here.
+    NODE_P2P_V2 = (1 << 12),
+    // NODE_TXRECON means the node can relay transactions through set reconciliation
+    // (sendtxrcncl, reqtxrcncl, sketch, reconcildiff) instead of announcing each of them
+    NODE_TXRECON = (1 << 13),
 
     // Bits 24-31 are reserved for temporary experiments. Just pick a bit that
     // isn't getting used, or one not being used much, and notify the
@@ -1075,6 +1075,23 @@ static CBlock GetBlockChecked(const CBlockIndex* pblockindex)
     return block;
 }
 
+static std::vector<uint8_t> GetRawBlockChecked(const CBlockIndex* pblockindex)
+{
+    std::vector<uint8_t> data;
+    if (IsBlockPruned(pblockindex)) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Block not available (pruned data)");
+    }
+
+    if (!ReadRawBlockFromDisk(data, pblockindex, Params().MessageStart())) {
+        // Block not found on disk. This could be because we have the block
+        // header in our index but not yet have the block or did not accept the
+        // block.
+        throw JSONRPCError(RPC_MISC_ERROR, "Block not found on disk");
+    }
+
+    return data;
+}
+
 static CBlockUndo GetUndoChecked(const CBlockIndex* pblockindex)
 {
     CBlockUndo blockUndo;
@@ -1253,15 +1270,12 @@ static RPCHelpMan getblock()
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
         }
 
-        block = GetBlockChecked(pblockindex);
-    }
+        if (verbosity <= 0) {
+            // The hex is the block as it is stored, no need to deserialize it
+            return HexStr(GetRawBlockChecked(pblockindex));
+        }
 
-    if (verbosity <= 0)
-    {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-        ssBlock << block;
-        std::string strHex = HexStr(ssBlock);
-        return strHex;
+        block = GetBlockChecked(pblockindex);
     }
 
     LLMQContext& llmq_ctx = EnsureLLMQContext(node);
@@ -2952,6 +2966,8 @@ static RPCHelpMan dumptxoutset()
             RPCResult::Type::OBJ, "", "",
                 {
                     {RPCResult::Type::NUM, "coins_written", "the number of coins written in the snapshot"},
+                    {RPCResult::Type::NUM, "evodb_entries_written", "the number of EvoDB entries written in the snapshot"},
+                    {RPCResult::Type::STR_HEX, "evodb_hash", "the hash of the EvoDB entries, see assumeutxo evodb_hash"},
                     {RPCResult::Type::STR_HEX, "base_hash", "the hash of the base of the snapshot"},
                     {RPCResult::Type::NUM, "base_height", "the height of the base of the snapshot"},
                     {RPCResult::Type::STR, "path", "the absolute path that the snapshot was written to"},
@@ -2992,6 +3008,8 @@ UniValue CreateUTXOSnapshot(NodeContext& node, CChainState& chainstate, CAutoFil
     std::unique_ptr<CCoinsViewCursor> pcursor;
     CCoinsStats stats{CoinStatsHashType::NONE};
     CBlockIndex* tip;
+    std::unique_ptr<CDBIterator> evodb_cursor;
+    uint64_t evodb_count{0};
 
     {
         // We need to lock cs_main to ensure that the coinsdb isn't written to
@@ -3017,9 +3035,19 @@ UniValue CreateUTXOSnapshot(NodeContext& node, CChainState& chainstate, CAutoFil
         pcursor = chainstate.CoinsDB().Cursor();
         tip = chainstate.m_blockman.LookupBlockIndex(stats.hashBlock);
         CHECK_NONFATAL(tip);
+
+        // The EvoDB root transaction was committed by the flush above, so the raw
+        // database holds the masternode, quorum and credit pool state as of `tip`.
+        CHECK_NONFATAL(node.evodb);
+        evodb_cursor.reset(node.evodb->GetRawDB().NewIterator());
     }
 
-    SnapshotMetadata metadata{tip->GetBlockHash(), stats.coins_count, tip->nChainTx};
+    // Best block markers and node-local data like quorum secret key shares aren't part of the snapshot
+    for (evodb_cursor->SeekToFirst(); evodb_cursor->Valid(); evodb_cursor->Next()) {
+        if (IsEvoDBChainStateKey(evodb_cursor->GetKey())) ++evodb_count;
+    }
+
+    SnapshotMetadata metadata{tip->GetBlockHash(), stats.coins_count, evodb_count, tip->nChainTx};
 
     afile << metadata;
 
@@ -3038,10 +3066,27 @@ UniValue CreateUTXOSnapshot(NodeContext& node, CChainState& chainstate, CAutoFil
         pcursor->Next();
     }
 
+    CHashWriter evodb_hasher(SER_GETHASH, 0);
+    SnapshotEvoDBEntry entry;
+
+    for (evodb_cursor->SeekToFirst(); evodb_cursor->Valid(); evodb_cursor->Next()) {
+        if (iter % 5000 == 0) node.rpc_interruption_point();
+        ++iter;
+        const CDataStream key{evodb_cursor->GetKey()};
+        if (!IsEvoDBChainStateKey(key)) continue;
+        const CDataStream value{evodb_cursor->GetValue()};
+        entry.key.assign(UCharCast(key.data()), UCharCast(key.data() + key.size()));
+        entry.value.assign(UCharCast(value.data()), UCharCast(value.data() + value.size()));
+        evodb_hasher << entry;
+        afile << entry;
+    }
+
     afile.fclose();
 
     UniValue result(UniValue::VOBJ);
     result.pushKV("coins_written", stats.coins_count);
+    result.pushKV("evodb_entries_written", evodb_count);
+    result.pushKV("evodb_hash", evodb_hasher.GetHash().ToString());
     result.pushKV("base_hash", tip->GetBlockHash().ToString());
     result.pushKV("base_height", tip->nHeight);
 
@@ -147,6 +147,15 @@ static RPCHelpMan getcoinjoininfo()
                             {RPCResult::Type::NUM, "denomination", "The denomination of the mixing session in " + CURRENCY_UNIT + ""},
                             {RPCResult::Type::STR_HEX, "state", "Current state of the mixing session"},
                             {RPCResult::Type::NUM, "entries_count", "The number of entries in the mixing session"},
+                            {RPCResult::Type::ARR, "sessions", "",
+                            {
+                                {RPCResult::Type::OBJ, "", "",
+                                {
+                                    {RPCResult::Type::NUM, "denomination", "The denomination of the mixing session in " + CURRENCY_UNIT + ""},
+                                    {RPCResult::Type::STR_HEX, "state", "Current state of the mixing session"},
+                                    {RPCResult::Type::NUM, "entries_count", "The number of entries in the mixing session"},
+                                }},
+                            }},
                         }},
                 },
                 RPCExamples{
@@ -8,6 +8,7 @@
 #include <addressindex.h>
 #include <chainparams.h>
 #include <consensus/consensus.h>
+#include <dbwrapper.h>
 #include <deploymentstatus.h>
 #include <evo/mnauth.h>
 #include <httpserver.h>
@@ -99,6 +100,17 @@ static RPCHelpMan mnsync()
                     {RPCResult::Type::NUM, "Attempt", "The attempt"},
                     {RPCResult::Type::BOOL, "IsBlockchainSynced", "true if the blockchain synced"},
                     {RPCResult::Type::BOOL, "IsSynced", "true if synced"},
+                    {RPCResult::Type::BOOL, "Parallel", "true if governance sync may overlap with blockchain sync (-mnsyncparallel)"},
+                    {RPCResult::Type::OBJ, "Governance", "Governance sync progress",
+                    {
+                        {RPCResult::Type::NUM, "StartTime", "The time governance sync started, 0 if it hasn't yet"},
+                        {RPCResult::Type::NUM, "Duration", "Seconds spent syncing governance"},
+                        {RPCResult::Type::NUM, "Requests", "The number of peers governance data was requested from"},
+                        {RPCResult::Type::NUM, "ObjectsReceived", "The number of new governance objects received during sync"},
+                        {RPCResult::Type::NUM, "VotesReceived", "The number of new governance votes received during sync"},
+                        {RPCResult::Type::NUM, "ObjectsPerSecond", "Governance object throughput"},
+                        {RPCResult::Type::NUM, "VotesPerSecond", "Governance vote throughput"},
+                    }},
                 }},
             RPCResult{"for mode = next|reset",
                 RPCResult::Type::STR, "", ""},
@@ -121,6 +133,18 @@ static RPCHelpMan mnsync()
         objStatus.pushKV("Attempt", mn_sync.GetAttempt());
         objStatus.pushKV("IsBlockchainSynced", mn_sync.IsBlockchainSynced());
         objStatus.pushKV("IsSynced", mn_sync.IsSynced());
+        objStatus.pushKV("Parallel", mn_sync.IsParallel());
+
+        const int64_t nDuration = mn_sync.GetGovernanceSyncDuration();
+        UniValue objGovernance(UniValue::VOBJ);
+        objGovernance.pushKV("StartTime", mn_sync.GetGovernanceSyncStartTime());
+        objGovernance.pushKV("Duration", nDuration);
+        objGovernance.pushKV("Requests", mn_sync.GetGovernanceSyncRequests());
+        objGovernance.pushKV("ObjectsReceived", mn_sync.GetGovernanceObjectsReceived());
+        objGovernance.pushKV("VotesReceived", mn_sync.GetGovernanceVotesReceived());
+        objGovernance.pushKV("ObjectsPerSecond", nDuration > 0 ? double(mn_sync.GetGovernanceObjectsReceived()) / nDuration : 0.0);
+        objGovernance.pushKV("VotesPerSecond", nDuration > 0 ? double(mn_sync.GetGovernanceVotesReceived()) / nDuration : 0.0);
+        objStatus.pushKV("Governance", objGovernance);
         return objStatus;
     }
 
@@ -1274,6 +1298,142 @@ static RPCHelpMan getmemoryinfo()
     };
 }
 
+static RPCHelpMan getdbstats()
+{
+    return RPCHelpMan{"getdbstats",
+        "Returns the LevelDB settings and statistics of each open database, and the counters of the operations on it since startup.\n",
+        {},
+        RPCResult{
+            RPCResult::Type::ARR, "", "",
+            {
+                {RPCResult::Type::OBJ, "", "",
+                {
+                    {RPCResult::Type::STR, "name", "The name of the database, as used by -dbprofile"},
+                    {RPCResult::Type::OBJ, "profile", "The LevelDB settings of the database",
+                    {
+                        {RPCResult::Type::NUM, "blockcache", "Share of the database cache used as block cache, in percent"},
+                        {RPCResult::Type::NUM, "blocksize", "Approximate amount of data packed into a block, in bytes"},
+                        {RPCResult::Type::NUM, "bloombits", "Bits per key of the bloom filter, 0 for none"},
+                        {RPCResult::Type::BOOL, "compression", "Whether blocks are compressed"},
+                        {RPCResult::Type::NUM, "maxfilesize", "Size at which a new table file is started, in bytes"},
+                    }},
+                    {RPCResult::Type::NUM, "memory", "Approximate memory usage of LevelDB, in bytes"},
+                    {RPCResult::Type::ARR, "files", "Number of table files at each level",
+                    {
+                        {RPCResult::Type::NUM, "", "Number of table files"},
+                    }},
+                    {RPCResult::Type::STR, "stats", "The compaction statistics reported by LevelDB"},
+                    {RPCResult::Type::ARR, "compaction", "The compaction statistics of each level with files or compactions",
+                    {
+                        {RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::NUM, "level", "The level"},
+                            {RPCResult::Type::NUM, "files", "Number of table files"},
+                            {RPCResult::Type::NUM, "size_mb", "Size of the table files in MB"},
+                            {RPCResult::Type::NUM, "time_sec", "Time spent compacting into the level, in seconds"},
+                            {RPCResult::Type::NUM, "read_mb", "Data read by compactions, in MB"},
+                            {RPCResult::Type::NUM, "write_mb", "Data written by compactions, in MB"},
+                        }},
+                    }},
+                    {RPCResult::Type::NUM, "compaction_time_sec", "Time spent compacting over all levels, in seconds. Writes stall when compactions fall behind"},
+                    {RPCResult::Type::OBJ_DYN, "operations", "Counters of each kind of operation (read, exists, writebatch, seek)",
+                    {
+                        {RPCResult::Type::OBJ, "operation", "",
+                        {
+                            {RPCResult::Type::NUM, "count", "Number of operations"},
+                            {RPCResult::Type::NUM, "total_us", "Time spent in them, in microseconds"},
+                            {RPCResult::Type::NUM, "max_us", "Slowest operation, in microseconds"},
+                            {RPCResult::Type::ARR, "latency_histogram", "Number of operations faster than 10us, 100us, 1ms, 10ms, 100ms, 1s and slower",
+                            {
+                                {RPCResult::Type::NUM, "", "Number of operations"},
+                            }},
+                        }},
+                    }},
+                    {RPCResult::Type::NUM, "read_misses", "Number of reads of keys that don't exist"},
+                    {RPCResult::Type::NUM, "batch_bytes", "Approximate size of all written batches, in bytes"},
+                    {RPCResult::Type::ARR, "batch_size_histogram", "Number of batches smaller than 1KiB, 16KiB, 256KiB, 4MiB, 64MiB and larger",
+                    {
+                        {RPCResult::Type::NUM, "", "Number of batches"},
+                    }},
+                }},
+            }},
+        RPCExamples{
+            HelpExampleCli("getdbstats", "")
+    + HelpExampleRpc("getdbstats", "")
+        },
+    [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    UniValue result(UniValue::VARR);
+    ForEachDBWrapper([&](const CDBWrapper& db) {
+        const DBProfile& profile = db.GetProfile();
+        UniValue obj_profile(UniValue::VOBJ);
+        obj_profile.pushKV("blockcache", profile.block_cache_percent);
+        obj_profile.pushKV("blocksize", (uint64_t)profile.block_size);
+        obj_profile.pushKV("bloombits", profile.bloom_bits);
+        obj_profile.pushKV("compression", profile.compression);
+        obj_profile.pushKV("maxfilesize", (uint64_t)profile.max_file_size);
+
+        UniValue files(UniValue::VARR);
+        for (int level = 0;; ++level) {
+            const auto num_files = db.GetProperty(strprintf("leveldb.num-files-at-level%d", level));
+            if (!num_files) break;
+            files.push_back(LocaleIndependentAtoi<int64_t>(*num_files));
+        }
+
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("name", db.GetName());
+        obj.pushKV("profile", obj_profile);
+        obj.pushKV("memory", (uint64_t)db.DynamicMemoryUsage());
+        obj.pushKV("files", files);
+        const std::string stats{db.GetProperty("leveldb.stats").value_or("")};
+        obj.pushKV("stats", stats);
+
+        UniValue compaction(UniValue::VARR);
+        double compaction_time_sec{0};
+        for (const DBLevelStats& level : ParseDBCompactionStats(stats)) {
+            UniValue obj_level(UniValue::VOBJ);
+            obj_level.pushKV("level", level.level);
+            obj_level.pushKV("files", level.files);
+            obj_level.pushKV("size_mb", level.size_mb);
+            obj_level.pushKV("time_sec", level.time_sec);
+            obj_level.pushKV("read_mb", level.read_mb);
+            obj_level.pushKV("write_mb", level.write_mb);
+            compaction.push_back(obj_level);
+            compaction_time_sec += level.time_sec;
+        }
+        obj.pushKV("compaction", compaction);
+        obj.pushKV("compaction_time_sec", compaction_time_sec);
+
+        const DBMetrics& metrics = db.GetMetrics();
+        UniValue operations(UniValue::VOBJ);
+        for (const auto op : {DBMetrics::Op::READ, DBMetrics::Op::EXISTS, DBMetrics::Op::WRITE_BATCH, DBMetrics::Op::SEEK}) {
+            const DBMetrics::OpStats op_stats{metrics.GetOpStats(op)};
+            UniValue histogram(UniValue::VARR);
+            for (const uint64_t count : op_stats.latency_histogram) {
+                histogram.push_back(count);
+            }
+            UniValue obj_op(UniValue::VOBJ);
+            obj_op.pushKV("count", op_stats.count);
+            obj_op.pushKV("total_us", count_microseconds(op_stats.total));
+            obj_op.pushKV("max_us", count_microseconds(op_stats.max));
+            obj_op.pushKV("latency_histogram", histogram);
+            operations.pushKV(DBMetrics::OpName(op), obj_op);
+        }
+        obj.pushKV("operations", operations);
+        obj.pushKV("read_misses", metrics.GetReadMisses());
+        obj.pushKV("batch_bytes", metrics.GetBatchBytes());
+        UniValue batch_sizes(UniValue::VARR);
+        for (const uint64_t count : metrics.GetBatchSizeHistogram()) {
+            batch_sizes.push_back(count);
+        }
+        obj.pushKV("batch_size_histogram", batch_sizes);
+        result.push_back(obj);
+    });
+    return result;
+},
+    };
+}
+
 static void EnableOrDisableLogCategories(UniValue cats, bool enable) {
     cats = cats.get_array();
     for (unsigned int i = 0; i < cats.size(); ++i) {
@@ -1464,6 +1624,7 @@ static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
   //  --------------------- ------------------------  -----------------------  ----------
     { "control",            "debug",                  &debug,                  {"category"} },
+    { "control",            "getdbstats",             &getdbstats,             {} },
     { "control",            "getmemoryinfo",          &getmemoryinfo,          {"mode"} },
     { "control",            "logging",                &logging,                {"include", "exclude"}},
     { "util",               "validateaddress",        &validateaddress,        {"address"} },
@@ -121,6 +121,8 @@ static RPCHelpMan getpeerinfo()
                     {RPCResult::Type::NUM_TIME, "last_block", "The " + UNIX_EPOCH_TIME + " of the last block received from this peer"},
                     {RPCResult::Type::NUM, "bytessent", "The total bytes sent"},
                     {RPCResult::Type::NUM, "bytesrecv", "The total bytes received"},
+                    {RPCResult::Type::NUM, "bytessent_overhead", "The part of bytessent that was transport overhead (headers, checksums, encryption and handshake)"},
+                    {RPCResult::Type::NUM, "bytesrecv_overhead", "The part of bytesrecv that was transport overhead (headers, checksums, encryption and handshake)"},
                     {RPCResult::Type::NUM_TIME, "conntime", "The " + UNIX_EPOCH_TIME + " of the connection"},
                     {RPCResult::Type::NUM, "timeoffset", "The time offset in seconds"},
                     {RPCResult::Type::NUM, "pingtime", "ping time (if available)"},
@@ -145,6 +147,14 @@ static RPCHelpMan getpeerinfo()
                     {RPCResult::Type::BOOL, "addr_relay_enabled", "Whether we participate in address relay with this peer"},
                     {RPCResult::Type::NUM, "addr_processed", "The total number of addresses processed, excluding those dropped due to rate limiting"},
                     {RPCResult::Type::NUM, "addr_rate_limited", "The total number of addresses dropped due to rate limiting"},
+                    {RPCResult::Type::BOOL, "txreconciliation", "Whether transactions are relayed to this peer through set reconciliation"},
+                    {RPCResult::Type::OBJ, "cmpctblock_reconstruction", "Compact block reconstruction from this peer",
+                    {
+                        {RPCResult::Type::NUM, "blocks", "The number of compact blocks we tried to reconstruct"},
+                        {RPCResult::Type::NUM, "reconstructed", "How many of them were reconstructed without a getblocktxn round trip"},
+                        {RPCResult::Type::NUM, "hint_txn", "The number of their transactions found among the IS-locked and evicted transaction hints"},
+                        {RPCResult::Type::NUM, "hit_rate", "The ratio of reconstructed to received compact blocks"},
+                    }},
                     {RPCResult::Type::BOOL, "whitelisted", /* optional */ true, "Whether the peer is whitelisted with default permissions\n"
                                                                                 "(DEPRECATED, returned only if config option -deprecatedrpc=whitelisted is passed)"},
                     {RPCResult::Type::ARR, "permissions", "Any special permissions that have been granted to this peer",
@@ -166,6 +176,20 @@ static RPCHelpMan getpeerinfo()
                     {RPCResult::Type::STR, "connection_type", "Type of connection: \n" + Join(CONNECTION_TYPE_DOC, ",\n") + ".\n"
                                                                "Please note this output is unlikely to be stable in upcoming releases as we iterate to\n"
                                                                "best capture connection behaviors."},
+                    {RPCResult::Type::OBJ, "sendqueue", "Messages waiting to be sent, by priority class (llmq, normal, bulk)",
+                    {
+                        {RPCResult::Type::OBJ, "class", "",
+                        {
+                            {RPCResult::Type::NUM, "queued_msgs", "Messages waiting for their turn"},
+                            {RPCResult::Type::NUM, "queued_bytes", "Payload bytes of the waiting messages"},
+                            {RPCResult::Type::NUM, "sent_msgs", "Messages of this class that were handed to the transport"},
+                        }},
+                    }},
+                    {RPCResult::Type::STR, "transport_protocol_type", "Type of transport protocol: \n"
+                                                                      "detecting (responder still deciding between v1 and v2),\n"
+                                                                      "v1 (plaintext transport protocol),\n"
+                                                                      "v2 (BIP324 encrypted transport protocol).\n"},
+                    {RPCResult::Type::STR, "session_id", "The session ID for this connection, or \"\" if there is none (\"v2\" transport protocol only).\n"},
                 }},
             }}},
         RPCExamples{
@@ -213,6 +237,8 @@ static RPCHelpMan getpeerinfo()
         obj.pushKV("last_block", count_seconds(stats.m_last_block_time));
         obj.pushKV("bytessent", stats.nSendBytes);
         obj.pushKV("bytesrecv", stats.nRecvBytes);
+        obj.pushKV("bytessent_overhead", stats.nSendOverheadBytes);
+        obj.pushKV("bytesrecv_overhead", stats.nRecvOverheadBytes);
         obj.pushKV("conntime", count_seconds(stats.m_connected));
         obj.pushKV("timeoffset", stats.nTimeOffset);
         if (stats.m_last_ping_time > 0us) {
@@ -254,6 +280,13 @@ static RPCHelpMan getpeerinfo()
             obj.pushKV("addr_relay_enabled", statestats.m_addr_relay_enabled);
             obj.pushKV("addr_processed", statestats.m_addr_processed);
             obj.pushKV("addr_rate_limited", statestats.m_addr_rate_limited);
+            UniValue cmpct(UniValue::VOBJ);
+            cmpct.pushKV("blocks", statestats.m_cmpct_blocks);
+            cmpct.pushKV("reconstructed", statestats.m_cmpct_blocks_reconstructed);
+            cmpct.pushKV("hint_txn", statestats.m_cmpct_hint_txn);
+            cmpct.pushKV("hit_rate", statestats.m_cmpct_blocks == 0 ? 0.0 : (double)statestats.m_cmpct_blocks_reconstructed / statestats.m_cmpct_blocks);
+            obj.pushKV("txreconciliation", statestats.m_txreconciliation);
+            obj.pushKV("cmpctblock_reconstruction", cmpct);
         }
         if (IsDeprecatedRPCEnabled("whitelisted")) {
             // whitelisted is deprecated in v0.21 for removal in v0.22
@@ -279,6 +312,18 @@ static RPCHelpMan getpeerinfo()
         }
         obj.pushKV("bytesrecv_per_msg", recvPerMsgType);
         obj.pushKV("connection_type", ConnectionTypeAsString(stats.m_conn_type));
+        UniValue sendqueue(UniValue::VOBJ);
+        for (size_t i = 0; i < SEND_PRIORITY_COUNT; ++i) {
+            const auto& queue_stats = stats.m_send_queue_stats[i];
+            UniValue queue(UniValue::VOBJ);
+            queue.pushKV("queued_msgs", queue_stats.m_queued_msgs);
+            queue.pushKV("queued_bytes", queue_stats.m_queued_bytes);
+            queue.pushKV("sent_msgs", queue_stats.m_sent_msgs);
+            sendqueue.pushKV(SendPriorityAsString(static_cast<SendPriority>(i)), queue);
+        }
+        obj.pushKV("sendqueue", sendqueue);
+        obj.pushKV("transport_protocol_type", stats.m_transport_type);
+        obj.pushKV("session_id", stats.m_session_id);
 
         ret.push_back(obj);
     }
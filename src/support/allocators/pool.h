@@ -0,0 +1,216 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Copyright (c) 2024 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SUPPORT_ALLOCATORS_POOL_H
+#define BITCOIN_SUPPORT_ALLOCATORS_POOL_H
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * A memory resource similar to std::pmr::unsynchronized_pool_resource, but optimized for node-based containers
+ * that allocate many objects of the same few sizes, like the coins cache.
+ *
+ * Memory is taken from the system in large chunks and carved into blocks which are never given back while the
+ * resource lives. Freed blocks go to a singly linked free list per size class (the list node lives inside the
+ * freed block itself) and are handed out again by the next allocation of that size. Requests larger than
+ * MAX_BLOCK_SIZE_BYTES or with a stricter alignment, like the bucket array of a hash map, are passed through to
+ * ::operator new.
+ *
+ * A resource constructed with pooled=false passes all requests through, which makes a container behave as if
+ * it used std::allocator while keeping its type.
+ *
+ * Not thread safe, like the containers using it.
+ *
+ * @tparam MAX_BLOCK_SIZE_BYTES Largest block that is pooled
+ * @tparam ALIGN_BYTES Alignment of all pooled blocks, the size of a block is rounded up to a multiple of it
+ */
+template <std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+class PoolResource final
+{
+    static_assert(ALIGN_BYTES > 0, "ALIGN_BYTES must be nonzero");
+    static_assert((ALIGN_BYTES & (ALIGN_BYTES - 1)) == 0, "ALIGN_BYTES must be a power of two");
+
+    /** Free list entry, placed into the freed block */
+    struct ListNode {
+        ListNode* m_next;
+
+        explicit ListNode(ListNode* next) : m_next(next) {}
+    };
+    static_assert(std::is_trivially_destructible_v<ListNode>, "Make sure we don't need to manually call a destructor");
+
+    /** Blocks must be able to hold a ListNode and be aligned for it */
+    static constexpr std::size_t ELEM_ALIGN_BYTES = std::max(alignof(ListNode), ALIGN_BYTES);
+    static_assert((ELEM_ALIGN_BYTES & (ELEM_ALIGN_BYTES - 1)) == 0, "ELEM_ALIGN_BYTES must be a power of two");
+    static_assert(sizeof(ListNode) <= ELEM_ALIGN_BYTES, "Units of size ELEM_ALIGN_BYTES need to be able to store a ListNode");
+    static_assert((MAX_BLOCK_SIZE_BYTES & (ELEM_ALIGN_BYTES - 1)) == 0, "MAX_BLOCK_SIZE_BYTES needs to be a multiple of the alignment.");
+
+    const std::size_t m_chunk_size_bytes;
+    const bool m_pooled;
+
+    /** Chunks taken from the system, freed in the destructor */
+    std::list<std::byte*> m_allocated_chunks{};
+
+    /** Free list heads, indexed by block size in units of ELEM_ALIGN_BYTES */
+    std::array<ListNode*, MAX_BLOCK_SIZE_BYTES / ELEM_ALIGN_BYTES + 1> m_free_lists{};
+
+    /** Not yet carved part of the newest chunk */
+    std::byte* m_available_memory_it = nullptr;
+    std::byte* m_available_memory_end = nullptr;
+
+    /** Size class of a request, in units of ELEM_ALIGN_BYTES. Zero sized requests still get a block */
+    [[nodiscard]] static constexpr std::size_t NumElemAlignBytes(std::size_t bytes)
+    {
+        return (bytes + ELEM_ALIGN_BYTES - 1) / ELEM_ALIGN_BYTES + (bytes == 0);
+    }
+
+    [[nodiscard]] bool IsFreeListUsable(std::size_t bytes, std::size_t alignment) const
+    {
+        return m_pooled && alignment <= ELEM_ALIGN_BYTES && bytes <= MAX_BLOCK_SIZE_BYTES;
+    }
+
+    void PlacementAddToList(void* p, ListNode*& node)
+    {
+        node = new (p) ListNode{node};
+    }
+
+    /** Start a new chunk, the rest of the current one becomes a free block of its size */
+    void AllocateChunk()
+    {
+        if (m_available_memory_it != m_available_memory_end) {
+            const std::size_t remaining_available_bytes = std::distance(m_available_memory_it, m_available_memory_end);
+            PlacementAddToList(m_available_memory_it, m_free_lists[remaining_available_bytes / ELEM_ALIGN_BYTES]);
+        }
+
+        void* storage = ::operator new (m_chunk_size_bytes, std::align_val_t{ELEM_ALIGN_BYTES});
+        m_available_memory_it = new (storage) std::byte[m_chunk_size_bytes];
+        m_available_memory_end = m_available_memory_it + m_chunk_size_bytes;
+        m_allocated_chunks.emplace_back(m_available_memory_it);
+    }
+
+public:
+    /** Default chunk size, large enough that the per chunk overhead doesn't matter */
+    static constexpr std::size_t DEFAULT_CHUNK_SIZE_BYTES{262144};
+
+    PoolResource(std::size_t chunk_size_bytes, bool pooled)
+        : m_chunk_size_bytes(NumElemAlignBytes(chunk_size_bytes) * ELEM_ALIGN_BYTES), m_pooled(pooled)
+    {
+        assert(m_chunk_size_bytes >= MAX_BLOCK_SIZE_BYTES);
+    }
+
+    explicit PoolResource(bool pooled = true) : PoolResource(DEFAULT_CHUNK_SIZE_BYTES, pooled) {}
+
+    PoolResource(const PoolResource&) = delete;
+    PoolResource& operator=(const PoolResource&) = delete;
+
+    ~PoolResource()
+    {
+        for (std::byte* chunk : m_allocated_chunks) {
+            std::destroy(chunk, chunk + m_chunk_size_bytes);
+            ::operator delete ((void*)chunk, std::align_val_t{ELEM_ALIGN_BYTES});
+        }
+    }
+
+    void* Allocate(std::size_t bytes, std::size_t alignment)
+    {
+        if (IsFreeListUsable(bytes, alignment)) {
+            const std::size_t num_alignments = NumElemAlignBytes(bytes);
+            if (m_free_lists[num_alignments] != nullptr) {
+                // Reuse a freed block of the same size class
+                return std::exchange(m_free_lists[num_alignments], m_free_lists[num_alignments]->m_next);
+            }
+
+            const std::size_t round_bytes = num_alignments * ELEM_ALIGN_BYTES;
+            if (round_bytes > static_cast<std::size_t>(std::distance(m_available_memory_it, m_available_memory_end))) {
+                AllocateChunk();
+            }
+            return std::exchange(m_available_memory_it, m_available_memory_it + round_bytes);
+        }
+
+        return ::operator new (bytes, std::align_val_t{alignment});
+    }
+
+    void Deallocate(void* p, std::size_t bytes, std::size_t alignment) noexcept
+    {
+        if (IsFreeListUsable(bytes, alignment)) {
+            PlacementAddToList(p, m_free_lists[NumElemAlignBytes(bytes)]);
+        } else {
+            ::operator delete (p, std::align_val_t{alignment});
+        }
+    }
+
+    [[nodiscard]] bool IsPooled() const { return m_pooled; }
+    [[nodiscard]] std::size_t NumAllocatedChunks() const { return m_allocated_chunks.size(); }
+    [[nodiscard]] std::size_t ChunkSizeBytes() const { return m_chunk_size_bytes; }
+};
+
+/**
+ * Allocator handing out memory from a PoolResource, for use with node-based containers.
+ * Copies and rebinds share the resource, which has to outlive the container.
+ */
+template <class T, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES = alignof(T)>
+class PoolAllocator
+{
+    PoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>* m_resource;
+
+    template <typename U, std::size_t M, std::size_t A>
+    friend class PoolAllocator;
+
+public:
+    using value_type = T;
+    using ResourceType = PoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>;
+
+    PoolAllocator(ResourceType* resource) noexcept : m_resource(resource) {}
+
+    PoolAllocator(const PoolAllocator& other) noexcept = default;
+    PoolAllocator& operator=(const PoolAllocator& other) noexcept = default;
+
+    template <class U>
+    PoolAllocator(const PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& other) noexcept : m_resource(other.resource()) {}
+
+    /** Needed by libstdc++'s containers to allocate their nodes and buckets */
+    template <typename U>
+    struct rebind {
+        using other = PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>;
+    };
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(m_resource->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        m_resource->Deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    ResourceType* resource() const noexcept
+    {
+        return m_resource;
+    }
+};
+
+template <class T1, class T2, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+bool operator==(const PoolAllocator<T1, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& a,
+                const PoolAllocator<T2, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& b) noexcept
+{
+    return a.resource() == b.resource();
+}
+
+template <class T1, class T2, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+bool operator!=(const PoolAllocator<T1, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& a,
+                const PoolAllocator<T2, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& b) noexcept
+{
+    return !(a == b);
+}
+
+#endif // BITCOIN_SUPPORT_ALLOCATORS_POOL_H
@@ -300,6 +300,44 @@ BOOST_AUTO_TEST_CASE(EmptyBlockRoundTripTest)
     }
 }
 
+BOOST_AUTO_TEST_CASE(HintTxnRoundTripTest)
+{
+    CTxMemPool pool;
+    TestMemPoolEntryHelper entry;
+    CBlock block(BuildBlockTestCase());
+
+    // vtx[1] is only known as a hint (IS-locked, then evicted), vtx[2] is both hinted and in the mempool
+    std::vector<std::pair<uint256, CTransactionRef>> hint_txn{
+        {block.vtx[1]->GetHash(), block.vtx[1]},
+        {block.vtx[2]->GetHash(), block.vtx[2]},
+        {block.vtx[2]->GetHash(), block.vtx[2]},
+        {uint256(), nullptr},
+    };
+
+    LOCK2(cs_main, pool.cs);
+    pool.addUnchecked(entry.FromTx(block.vtx[2]));
+
+    CBlockHeaderAndShortTxIDs shortIDs{block};
+
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << shortIDs;
+
+    CBlockHeaderAndShortTxIDs shortIDs2;
+    stream >> shortIDs2;
+
+    PartiallyDownloadedBlock partialBlock(&pool);
+    BOOST_CHECK(partialBlock.InitData(shortIDs2, extra_txn, hint_txn) == READ_STATUS_OK);
+    // The same tx hinted twice and also found in the mempool is no short id collision
+    BOOST_CHECK(partialBlock.IsTxAvailable(0));
+    BOOST_CHECK(partialBlock.IsTxAvailable(1));
+    BOOST_CHECK(partialBlock.IsTxAvailable(2));
+    BOOST_CHECK_EQUAL(partialBlock.GetHintCount(), 2U);
+
+    CBlock block2;
+    BOOST_CHECK(partialBlock.FillBlock(block2, {}) == READ_STATUS_OK);
+    BOOST_CHECK_EQUAL(block.GetHash().ToString(), block2.GetHash().ToString());
+}
+
 BOOST_AUTO_TEST_CASE(TransactionsRequestSerializationTest) {
     BlockTransactionsRequest req1;
     req1.blockhash = InsecureRand256();
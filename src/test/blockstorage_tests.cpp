@@ -0,0 +1,138 @@
+// Copyright (c) 2024 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <ctpl_stl.h>
+#include <node/blockstorage.h>
+#include <primitives/block.h>
+#include <streams.h>
+#include <test/util/logging.h>
+#include <test/util/setup_common.h>
+#include <util/mappedfile.h>
+#include <util/strencodings.h>
+#include <validation.h>
+#include <version.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+
+BOOST_FIXTURE_TEST_SUITE(blockstorage_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(mapped_file)
+{
+    const fs::path path{m_args.GetDataDirPath() / "mapped.dat"};
+    BOOST_CHECK(!MappedFile::Open(path));
+
+    {
+        std::ofstream file{path.c_str(), std::ios::binary};
+        file << "mapped";
+    }
+    const auto mapped = MappedFile::Open(path);
+#ifdef WIN32
+    BOOST_CHECK(!mapped);
+#else
+    BOOST_REQUIRE(mapped);
+    BOOST_CHECK_EQUAL(mapped->Size(), 6U);
+    BOOST_CHECK_EQUAL(std::string(mapped->Data().begin(), mapped->Data().end()), "mapped");
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(read_block_mapped)
+{
+    const CBlockIndex* genesis{WITH_LOCK(cs_main, return m_node.chainman->ActiveChain().Genesis())};
+    BOOST_REQUIRE(genesis);
+    const Consensus::Params& params{Params().GetConsensus()};
+    const bool default_mmap{g_block_file_mmap};
+
+    // Both ways of reading a block give the same result
+    for (const bool mmap : {true, false}) {
+        g_block_file_mmap = mmap;
+        CBlock block;
+        BOOST_CHECK(ReadBlockFromDisk(block, genesis, params));
+        BOOST_CHECK_EQUAL(block.GetHash(), genesis->GetBlockHash());
+    }
+
+    // A position not pointing at a block fails either way
+    for (const bool mmap : {true, false}) {
+        g_block_file_mmap = mmap;
+        CBlock block;
+        BOOST_CHECK(!ReadBlockFromDisk(block, FlatFilePos{genesis->nFile, genesis->nDataPos + 1}, params));
+    }
+
+    g_block_file_mmap = default_mmap;
+}
+
+BOOST_AUTO_TEST_CASE(read_raw_block)
+{
+    const CBlockIndex* genesis{WITH_LOCK(cs_main, return m_node.chainman->ActiveChain().Genesis())};
+    BOOST_REQUIRE(genesis);
+    const CChainParams& chainparams{Params()};
+    const bool default_mmap{g_block_file_mmap};
+
+    CDataStream expected{SER_NETWORK, PROTOCOL_VERSION};
+    expected << chainparams.GenesisBlock();
+
+    // The stored bytes are the block's network serialization, however they are read
+    for (const bool mmap : {true, false}) {
+        g_block_file_mmap = mmap;
+        std::vector<uint8_t> block_data;
+        BOOST_CHECK(ReadRawBlockFromDisk(block_data, genesis, chainparams.MessageStart()));
+        BOOST_CHECK_EQUAL(HexStr(block_data), HexStr(expected));
+
+        // Wrong position or network magic
+        BOOST_CHECK(!ReadRawBlockFromDisk(block_data, FlatFilePos{genesis->nFile, genesis->nDataPos + 1}, chainparams.MessageStart()));
+        BOOST_CHECK(!ReadRawBlockFromDisk(block_data, FlatFilePos{genesis->nFile, 4}, chainparams.MessageStart()));
+        const CMessageHeader::MessageStartChars wrong_start{0x01, 0x02, 0x03, 0x04};
+        BOOST_CHECK(!ReadRawBlockFromDisk(block_data, genesis->GetBlockPos(), wrong_start));
+
+        // An index entry pointing at a different block
+        const uint256 other_hash{InsecureRand256()};
+        CBlockIndex other{*genesis};
+        other.phashBlock = &other_hash;
+        BOOST_CHECK(!ReadRawBlockFromDisk(block_data, &other, chainparams.MessageStart()));
+    }
+
+    g_block_file_mmap = default_mmap;
+}
+
+BOOST_AUTO_TEST_CASE(load_mapped_block_file)
+{
+    const CChainParams& chainparams{Params()};
+    const fs::path path{m_args.GetDataDirPath() / "import.dat"};
+    {
+        CAutoFile file{fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION};
+        const uint32_t genesis_size = ::GetSerializeSize(chainparams.GenesisBlock(), CLIENT_VERSION);
+        // Garbage, a block, a block that doesn't deserialize, the block again and a truncated block
+        file << uint32_t{0xdeadbeef};
+        file << chainparams.MessageStart() << genesis_size << chainparams.GenesisBlock();
+        file << chainparams.MessageStart() << uint32_t{100};
+        std::vector<unsigned char> corrupt(100, 0xff);
+        file.write(MakeByteSpan(corrupt));
+        file << chainparams.MessageStart() << genesis_size << chainparams.GenesisBlock();
+        file << chainparams.MessageStart() << uint32_t{1000} << uint32_t{0};
+    }
+
+    const auto mapped = MappedFile::Open(path);
+#ifndef WIN32
+    BOOST_REQUIRE(mapped);
+    ctpl::thread_pool pool{2};
+    {
+        ASSERT_DEBUG_LOG("LoadMappedBlockFile: Deserialize or I/O error");
+        ASSERT_DEBUG_LOG("Loaded 0 blocks from external file");
+        m_node.chainman->ActiveChainstate().LoadMappedBlockFile(*mapped, *m_node.sporkman, pool);
+    }
+#endif
+
+    // The same as the sequential import
+    {
+        ASSERT_DEBUG_LOG("LoadExternalBlockFile: Deserialize or I/O error");
+        ASSERT_DEBUG_LOG("Loaded 0 blocks from external file");
+        m_node.chainman->ActiveChainstate().LoadExternalBlockFile(fsbridge::fopen(path, "rb"), *m_node.sporkman);
+    }
+    BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return m_node.chainman->ActiveChain().Height()), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -146,21 +146,26 @@ typedef CCheckQueue<FailingCheck> Failing_Queue;
 typedef CCheckQueue<UniqueCheck> Unique_Queue;
 typedef CCheckQueue<MemoryCheck> Memory_Queue;
 typedef CCheckQueue<FrozenCleanupCheck> FrozenCleanup_Queue;
+typedef CWorkStealingCheckQueue<FakeCheckCheckCompletion> WorkStealing_Correct_Queue;
+typedef CWorkStealingCheckQueue<FailingCheck> WorkStealing_Failing_Queue;
+typedef CWorkStealingCheckQueue<UniqueCheck> WorkStealing_Unique_Queue;
+typedef CWorkStealingCheckQueue<MemoryCheck> WorkStealing_Memory_Queue;
 
 
 /** This test case checks that the CCheckQueue works properly
  * with each specified size_t Checks pushed.
  */
+template <typename Queue = Correct_Queue>
 static void Correct_Queue_range(std::vector<size_t> range)
 {
-    auto small_queue = std::make_unique<Correct_Queue>(QUEUE_BATCH_SIZE);
+    auto small_queue = std::make_unique<Queue>(QUEUE_BATCH_SIZE);
     small_queue->StartWorkerThreads(SCRIPT_CHECK_THREADS);
     // Make vChecks here to save on malloc (this test can be slow...)
     std::vector<FakeCheckCheckCompletion> vChecks;
     for (const size_t i : range) {
         size_t total = i;
         FakeCheckCheckCompletion::n_calls = 0;
-        CCheckQueueControl<FakeCheckCheckCompletion> control(small_queue.get());
+        CCheckQueueControl<FakeCheckCheckCompletion, Queue> control(small_queue.get());
         while (total) {
             vChecks.resize(std::min(total, (size_t) InsecureRandRange(10)));
             total -= vChecks.size();
@@ -428,4 +433,102 @@ BOOST_AUTO_TEST_CASE(test_CheckQueueControl_Locks)
         }
     }
 }
+/** The work-stealing queue runs every check exactly once, for any number of checks */
+BOOST_AUTO_TEST_CASE(test_WorkStealingCheckQueue_Correct)
+{
+    std::vector<size_t> range{0, 1, 100000};
+    for (size_t i = 2; i < 100000; i += std::max((size_t)1, (size_t)InsecureRandRange(std::min((size_t)1000, ((size_t)100000) - i))))
+        range.push_back(i);
+    Correct_Queue_range<WorkStealing_Correct_Queue>(range);
+
+    auto queue = std::make_unique<WorkStealing_Unique_Queue>(QUEUE_BATCH_SIZE);
+    queue->StartWorkerThreads(SCRIPT_CHECK_THREADS);
+    WITH_LOCK(UniqueCheck::m, UniqueCheck::results.clear());
+    size_t total = 100000;
+    {
+        CCheckQueueControl<UniqueCheck, WorkStealing_Unique_Queue> control(queue.get());
+        while (total) {
+            std::vector<UniqueCheck> vChecks;
+            for (size_t k = 0, r = InsecureRandRange(200); k < r && total; k++)
+                vChecks.emplace_back(--total);
+            control.Add(vChecks);
+        }
+    }
+    {
+        LOCK(UniqueCheck::m);
+        BOOST_REQUIRE_EQUAL(UniqueCheck::results.size(), 100000U);
+        for (size_t i = 0; i < 100000; ++i) {
+            BOOST_REQUIRE_EQUAL(UniqueCheck::results.count(i), 1U);
+        }
+    }
+    queue->StopWorkerThreads();
+
+    // Without worker threads the master does all the work
+    WorkStealing_Correct_Queue lone_queue{QUEUE_BATCH_SIZE};
+    FakeCheckCheckCompletion::n_calls = 0;
+    {
+        CCheckQueueControl<FakeCheckCheckCompletion, WorkStealing_Correct_Queue> control(&lone_queue);
+        std::vector<FakeCheckCheckCompletion> vChecks(1000);
+        control.Add(vChecks);
+        BOOST_REQUIRE(control.Wait());
+    }
+    BOOST_REQUIRE_EQUAL(FakeCheckCheckCompletion::n_calls, 1000U);
+}
+
+/** Failures are caught and don't leak into the next round, checks are destroyed before Wait returns */
+BOOST_AUTO_TEST_CASE(test_WorkStealingCheckQueue_Failure_Memory)
+{
+    auto fail_queue = std::make_unique<WorkStealing_Failing_Queue>(QUEUE_BATCH_SIZE);
+    fail_queue->StartWorkerThreads(SCRIPT_CHECK_THREADS);
+    for (size_t i = 0; i < 1001; ++i) {
+        CCheckQueueControl<FailingCheck, WorkStealing_Failing_Queue> control(fail_queue.get());
+        std::vector<FailingCheck> vChecks;
+        vChecks.resize(i, false);
+        if (i > 0) vChecks[InsecureRandRange(i)] = true;
+        control.Add(vChecks);
+        BOOST_REQUIRE_EQUAL(control.Wait(), i == 0);
+    }
+    fail_queue->StopWorkerThreads();
+
+    auto queue = std::make_unique<WorkStealing_Memory_Queue>(QUEUE_BATCH_SIZE);
+    queue->StartWorkerThreads(SCRIPT_CHECK_THREADS);
+    for (size_t i = 0; i < 1000; ++i) {
+        size_t total = i;
+        {
+            CCheckQueueControl<MemoryCheck, WorkStealing_Memory_Queue> control(queue.get());
+            while (total) {
+                std::vector<MemoryCheck> vChecks;
+                for (size_t k = 0, r = InsecureRandRange(10); k < r && total; k++) {
+                    total--;
+                    vChecks.emplace_back(total == 0 || total == i || total == i/2);
+                }
+                control.Add(vChecks);
+            }
+        }
+        BOOST_REQUIRE_EQUAL(MemoryCheck::fake_allocated_memory, 0U);
+    }
+    queue->StopWorkerThreads();
+}
+
+/** Checks of different types share one queue */
+BOOST_AUTO_TEST_CASE(test_WorkStealingCheckQueue_Mixed)
+{
+    using MixedCheck = CCheckVariant<FakeCheckCheckCompletion, FailingCheck>;
+    CWorkStealingCheckQueue<MixedCheck> queue{QUEUE_BATCH_SIZE};
+    queue.StartWorkerThreads(SCRIPT_CHECK_THREADS);
+    for (const bool fails : {false, true}) {
+        FakeCheckCheckCompletion::n_calls = 0;
+        CCheckQueueControl<MixedCheck, CWorkStealingCheckQueue<MixedCheck>> control(&queue);
+        std::vector<MixedCheck> vChecks;
+        for (int i = 0; i < 1000; ++i) {
+            vChecks.emplace_back(FakeCheckCheckCompletion{});
+            vChecks.emplace_back(FailingCheck{fails && i == 500});
+        }
+        vChecks.emplace_back();
+        control.Add(vChecks);
+        BOOST_REQUIRE_EQUAL(control.Wait(), !fails);
+        if (!fails) BOOST_REQUIRE_EQUAL(FakeCheckCheckCompletion::n_calls, 1000U);
+    }
+    queue.StopWorkerThreads();
+}
 BOOST_AUTO_TEST_SUITE_END()
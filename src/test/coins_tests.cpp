@@ -274,6 +274,67 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
     SimulationTest(&db_base, true);
 }
 
+BOOST_AUTO_TEST_CASE(coins_db_incremental_flush)
+{
+    CCoinsViewDB db{"test", /*nCacheSize*/ 1 << 23, /*fMemory*/ true, /*fWipe*/ false};
+    const uint256 block1{InsecureRand256()}, block2{InsecureRand256()};
+
+    std::vector<COutPoint> outpoints;
+    {
+        CCoinsViewCache cache{&db};
+        for (uint32_t i = 0; i < 1000; ++i) {
+            outpoints.emplace_back(InsecureRand256(), i);
+            cache.AddCoin(outpoints.back(), Coin{CTxOut{i + 1, CScript() << OP_TRUE}, 1, false}, false);
+        }
+        cache.SetBestBlock(block1);
+        BOOST_CHECK(cache.Flush());
+    }
+    BOOST_CHECK(!db.HasPending());
+
+    CCoinsViewCache cache{&db};
+    cache.SpendCoin(outpoints[0]);
+    const COutPoint added{InsecureRand256(), 0};
+    cache.AddCoin(added, Coin{CTxOut{1, CScript() << OP_TRUE}, 2, false}, false);
+    cache.SetBestBlock(block2);
+    db.DeferNextWrite();
+    BOOST_CHECK(cache.Flush());
+
+    // Nothing is written yet, the database is marked as in transition and lookups see the pending coins
+    BOOST_CHECK(db.HasPending());
+    BOOST_CHECK(db.GetHeadBlocks() == std::vector<uint256>({block2, block1}));
+    BOOST_CHECK(db.GetBestBlock() == block2);
+    BOOST_CHECK(!db.HaveCoin(outpoints[0]));
+    BOOST_CHECK(db.HaveCoin(added));
+    BOOST_CHECK(db.HaveCoin(outpoints[1]));
+    BOOST_CHECK_GT(db.PendingDynamicMemoryUsage(), 0U);
+
+    // A chunk writes part of them, the last one marks the database consistent again
+    BOOST_CHECK(db.WritePending(1));
+    BOOST_CHECK(db.HasPending());
+    BOOST_CHECK(db.WritePending(0));
+    BOOST_CHECK(!db.HasPending());
+    BOOST_CHECK(db.GetHeadBlocks().empty());
+    BOOST_CHECK(db.GetBestBlock() == block2);
+    BOOST_CHECK(!db.HaveCoin(outpoints[0]));
+    BOOST_CHECK(db.HaveCoin(added));
+
+    // A regular flush completes a pending one first
+    cache.SpendCoin(added);
+    cache.SetBestBlock(block1);
+    db.DeferNextWrite();
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(db.HasPending());
+    CCoinsViewCache cache2{&db};
+    cache2.SpendCoin(outpoints[1]);
+    cache2.SetBestBlock(block2);
+    BOOST_CHECK(cache2.Flush());
+    BOOST_CHECK(!db.HasPending());
+    BOOST_CHECK(db.GetHeadBlocks().empty());
+    BOOST_CHECK(db.GetBestBlock() == block2);
+    BOOST_CHECK(!db.HaveCoin(added));
+    BOOST_CHECK(!db.HaveCoin(outpoints[1]));
+}
+
 // Store of all necessary tx and undo data for next test
 typedef std::map<COutPoint, std::tuple<CTransaction,CTxUndo,Coin>> UtxoData;
 UtxoData utxoData;
@@ -610,7 +671,8 @@ void GetCoinsMapEntry(const CCoinsMap& map, CAmount& value, char& flags)
 
 void WriteCoinsViewEntry(CCoinsView& view, CAmount value, char flags)
 {
-    CCoinsMap map;
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map{0, CCoinsMap::hasher{}, CCoinsMap::key_equal{}, &resource};
     InsertCoinsMapEntry(map, value, flags);
     BOOST_CHECK(view.BatchWrite(map, {}));
 }
@@ -879,4 +941,29 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_cache_fetched_coin)
+{
+    CCoinsView root;
+    CCoinsViewCache parent{&root};
+    CCoinsViewCache cache{&parent};
+    const COutPoint outpoint{InsecureRand256(), 0};
+    const Coin coin{CTxOut{1, CScript() << OP_TRUE}, 1, false};
+
+    cache.CacheFetchedCoin(outpoint, Coin{coin});
+    BOOST_CHECK(cache.HaveCoinInCache(outpoint));
+    BOOST_CHECK(cache.AccessCoin(outpoint).out == coin.out);
+    BOOST_CHECK_GT(cache.DynamicMemoryUsage(), 0U);
+
+    // A fetched coin isn't dirty, flushing leaves nothing in the parent
+    cache.SetBestBlock(InsecureRand256());
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(!parent.HaveCoinInCache(outpoint));
+
+    // An outpoint that is cached already keeps its entry
+    cache.CacheFetchedCoin(outpoint, Coin{coin});
+    BOOST_CHECK(cache.SpendCoin(outpoint));
+    cache.CacheFetchedCoin(outpoint, Coin{coin});
+    BOOST_CHECK(!cache.HaveCoin(outpoint));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
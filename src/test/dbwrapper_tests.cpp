@@ -6,9 +6,12 @@
 #include <random.h>
 #include <test/util/setup_common.h>
 #include <uint256.h>
+#include <util/settings.h>
 
 #include <memory>
 
+#include <univalue.h>
+
 #include <boost/test/unit_test.hpp>
 
 // Test if a string consists entirely of null characters
@@ -412,5 +415,125 @@ BOOST_AUTO_TEST_CASE(unicodepath)
     BOOST_CHECK(fs::exists(lockPath));
 }
 
+BOOST_AUTO_TEST_CASE(dbwrapper_profiles)
+{
+    ArgsManager args;
+    args.AddArg("-dbprofile", "", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    const auto read_profiles = [&](std::vector<const char*> argv, std::map<std::string, DBProfile>& profiles, std::string& error) {
+        argv.insert(argv.begin(), "dummy");
+        BOOST_REQUIRE(args.ParseParameters(argv.size(), argv.data(), error));
+        profiles.clear();
+        return ReadDBProfiles(args, profiles, error);
+    };
+
+    std::map<std::string, DBProfile> profiles;
+    std::string error;
+    BOOST_CHECK(read_profiles({"-dbprofile=evodb:blockcache=75,bloombits=0", "-dbprofile=isdb:compression=1", "-dbprofile=evodb:maxfilesize=4194304"}, profiles, error));
+    BOOST_CHECK_EQUAL(profiles.size(), 2U);
+    BOOST_CHECK_EQUAL(profiles["evodb"].block_cache_percent, 75);
+    BOOST_CHECK_EQUAL(profiles["evodb"].bloom_bits, 0);
+    BOOST_CHECK_EQUAL(profiles["evodb"].max_file_size, 4U << 20);
+    BOOST_CHECK_EQUAL(profiles["evodb"].block_size, DBProfile{}.block_size);
+    BOOST_CHECK(profiles["isdb"].compression);
+
+    BOOST_CHECK(!read_profiles({"-dbprofile=evodb"}, profiles, error));
+    BOOST_CHECK(!read_profiles({"-dbprofile=:blocksize=8192"}, profiles, error));
+    BOOST_CHECK(!read_profiles({"-dbprofile=evodb:blocksize"}, profiles, error));
+    BOOST_CHECK(!read_profiles({"-dbprofile=evodb:blocksize=x"}, profiles, error));
+    BOOST_CHECK(!read_profiles({"-dbprofile=evodb:blockcache=95"}, profiles, error));
+    BOOST_CHECK(!read_profiles({"-dbprofile=evodb:cachesize=1"}, profiles, error));
+
+    // A database picks up the profile of its name and can be found while open
+    gArgs.ForceSetArg("-dbprofile", "profiled:blockcache=75,bloombits=0,blocksize=16384");
+    {
+        CDBWrapper dbw(m_args.GetDataDirPath() / "profiled", 1 << 20);
+        BOOST_CHECK_EQUAL(dbw.GetProfile().block_cache_percent, 75);
+        BOOST_CHECK_EQUAL(dbw.GetProfile().bloom_bits, 0);
+        BOOST_CHECK_EQUAL(dbw.GetProfile().block_size, 16384U);
+
+        const uint256 in = InsecureRand256();
+        uint256 res;
+        BOOST_CHECK(dbw.Write(uint8_t{'k'}, in));
+        BOOST_CHECK(dbw.Read(uint8_t{'k'}, res));
+        BOOST_CHECK(res == in);
+        BOOST_CHECK(dbw.GetProperty("leveldb.stats"));
+        BOOST_CHECK(!dbw.GetProperty("leveldb.nonexistent"));
+
+        bool found{false};
+        ForEachDBWrapper([&](const CDBWrapper& db) { found |= &db == &dbw && db.GetName() == "profiled"; });
+        BOOST_CHECK(found);
+    }
+    gArgs.LockSettings([](util::Settings& settings) { settings.forced_settings.erase("dbprofile"); });
+    bool found{false};
+    ForEachDBWrapper([&](const CDBWrapper& db) { found |= db.GetName() == "profiled"; });
+    BOOST_CHECK(!found);
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_metrics)
+{
+    CDBWrapper dbw(m_args.GetDataDirPath() / "dbwrapper_metrics", 1 << 20, /*fMemory=*/true, /*fWipe=*/false);
+    const DBMetrics& metrics = dbw.GetMetrics();
+    // Opening the database already looks up the obfuscation key
+    const uint64_t reads{metrics.GetOpStats(DBMetrics::Op::READ).count};
+    const uint64_t read_misses{metrics.GetReadMisses()};
+    const uint256 in = InsecureRand256();
+    uint256 res;
+
+    CDBBatch batch(dbw);
+    batch.Write(uint8_t{'k'}, in);
+    const size_t batch_size{batch.SizeEstimate()};
+    BOOST_CHECK(dbw.WriteBatch(batch));
+    BOOST_CHECK(dbw.Read(uint8_t{'k'}, res));
+    BOOST_CHECK(!dbw.Read(uint8_t{'m'}, res));
+    BOOST_CHECK(dbw.Exists(uint8_t{'k'}));
+    std::unique_ptr<CDBIterator> it(dbw.NewIterator());
+    it->Seek(uint8_t{'k'});
+    it->SeekToFirst();
+
+    BOOST_CHECK_EQUAL(metrics.GetOpStats(DBMetrics::Op::READ).count, reads + 2);
+    BOOST_CHECK_EQUAL(metrics.GetOpStats(DBMetrics::Op::EXISTS).count, 1U);
+    BOOST_CHECK_EQUAL(metrics.GetOpStats(DBMetrics::Op::WRITE_BATCH).count, 1U);
+    BOOST_CHECK_EQUAL(metrics.GetOpStats(DBMetrics::Op::SEEK).count, 2U);
+    BOOST_CHECK_EQUAL(metrics.GetReadMisses(), read_misses + 1);
+    BOOST_CHECK_EQUAL(metrics.GetBatchBytes(), batch_size);
+    BOOST_CHECK_EQUAL(metrics.GetBatchSizeHistogram()[0], 1U);
+
+    // Operations land in the bucket of their latency, the slowest one is kept
+    DBMetrics local;
+    local.RecordOperation(DBMetrics::Op::READ, std::chrono::microseconds{5});
+    local.RecordOperation(DBMetrics::Op::READ, std::chrono::microseconds{10});
+    local.RecordOperation(DBMetrics::Op::READ, std::chrono::microseconds{2000000});
+    const DBMetrics::OpStats stats{local.GetOpStats(DBMetrics::Op::READ)};
+    BOOST_CHECK_EQUAL(stats.count, 3U);
+    BOOST_CHECK_EQUAL(count_microseconds(stats.total), 2000015);
+    BOOST_CHECK_EQUAL(count_microseconds(stats.max), 2000000);
+    BOOST_CHECK_EQUAL(stats.latency_histogram[0], 1U);
+    BOOST_CHECK_EQUAL(stats.latency_histogram[1], 1U);
+    BOOST_CHECK_EQUAL(stats.latency_histogram.back(), 1U);
+    local.RecordBatch(100 << 20);
+    BOOST_CHECK_EQUAL(local.GetBatchSizeHistogram().back(), 1U);
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_compaction_stats)
+{
+    const std::string stats{
+        "                               Compactions\n"
+        "Level  Files Size(MB) Time(sec) Read(MB) Write(MB)\n"
+        "--------------------------------------------------\n"
+        "  0        2        1         0        0         1\n"
+        "  2       14       25        12       30        28\n"};
+    const std::vector<DBLevelStats> levels{ParseDBCompactionStats(stats)};
+    BOOST_REQUIRE_EQUAL(levels.size(), 2U);
+    BOOST_CHECK_EQUAL(levels[0].level, 0);
+    BOOST_CHECK_EQUAL(levels[0].files, 2);
+    BOOST_CHECK_EQUAL(levels[1].level, 2);
+    BOOST_CHECK_EQUAL(levels[1].files, 14);
+    BOOST_CHECK_EQUAL(levels[1].size_mb, 25);
+    BOOST_CHECK_EQUAL(levels[1].time_sec, 12);
+    BOOST_CHECK_EQUAL(levels[1].read_mb, 30);
+    BOOST_CHECK_EQUAL(levels[1].write_mb, 28);
+
+    BOOST_CHECK(ParseDBCompactionStats("").empty());
+}
 
 BOOST_AUTO_TEST_SUITE_END()
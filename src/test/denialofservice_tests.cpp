@@ -8,20 +8,27 @@
 #include <chainparams.h>
 #include <evo/deterministicmns.h>
 #include <llmq/context.h>
+#include <llmq/instantsend.h>
+#include <masternode/meta.h>
 #include <net.h>
 #include <net_processing.h>
+#include <netmessagemaker.h>
 #include <pubkey.h>
 #include <script/sign.h>
 #include <script/signingprovider.h>
 #include <script/standard.h>
+#include <test/util/logging.h>
 #include <test/util/net.h>
 #include <test/util/setup_common.h>
+#include <util/settings.h>
 #include <util/string.h>
 #include <util/system.h>
 #include <util/time.h>
 #include <validation.h>
 #include <governance/governance.h>
 
+#include <univalue.h>
+
 #include <array>
 #include <stdint.h>
 
@@ -412,6 +419,65 @@ BOOST_AUTO_TEST_CASE(peer_discouragement)
     connman->ClearTestNodes();
 }
 
+BOOST_AUTO_TEST_CASE(message_workers)
+{
+    const CChainParams& chainparams = Params();
+    auto connman = std::make_unique<ConnmanTestMsg>(0x1337, 0x1337, *m_node.addrman);
+    gArgs.ForceSetArg("-msghandlerthreads", "2");
+    auto peerLogic = PeerManager::make(chainparams, *connman, *m_node.addrman, nullptr, *m_node.scheduler,
+                                       *m_node.chainman, *m_node.mempool, *m_node.mn_metaman, *m_node.mn_sync,
+                                       *m_node.govman, *m_node.sporkman, /* mn_activeman = */ nullptr, m_node.dmnman,
+                                       m_node.cj_ctx, m_node.llmq_ctx, /* ignore_incoming_txs = */ false);
+    gArgs.LockSettings([](util::Settings& settings) { settings.forced_settings.erase("msghandlerthreads"); });
+    std::atomic<bool> interrupt{false};
+    // Every message passes CMNAuth::ProcessMessage, which needs a loaded masternode cache
+    BOOST_REQUIRE(m_node.mn_metaman->LoadCache(/* load_cache = */ false));
+
+    CNode* node = new CNode{id++,
+                            NODE_NETWORK,
+                            /*sock=*/nullptr,
+                            CAddress{ip(0xa0b0c001), NODE_NONE},
+                            /*nKeyedNetGroupIn=*/0,
+                            /*nLocalHostNonceIn=*/0,
+                            CAddress(),
+                            /*addrNameIn=*/"",
+                            ConnectionType::INBOUND,
+                            /*inbound_onion=*/false};
+    node->SetCommonVersion(PROTOCOL_VERSION);
+    peerLogic->InitializeNode(node);
+    node->nVersion = PROTOCOL_VERSION;
+    node->fSuccessfullyConnected = true;
+    connman->AddTestNode(*node);
+
+    const auto on_worker = [](const std::string* line) { return line == nullptr || line->find("msgproc-") != std::string::npos; };
+    const auto on_handler = [](const std::string* line) { return line == nullptr || line->find("msgproc-") == std::string::npos; };
+    const CNetMsgMaker msg_maker{PROTOCOL_VERSION};
+    {
+        // An islock goes to a worker, the handler leaves the peer alone until the worker is done
+        DebugLogHelper log_islock{"received: isdlock", on_worker};
+        CSerializedNetMsg msg_islock{msg_maker.Make(NetMsgType::ISDLOCK, llmq::CInstantSendLock{})};
+        BOOST_CHECK(connman->ReceiveMsgFrom(*node, msg_islock));
+        peerLogic->ProcessMessages(node, interrupt);
+
+        // Waits for the queued islock
+        peerLogic->StopMessageWorkers();
+    }
+    {
+        // Messages that need cs_main stay on the message handler thread, as does everything once the workers are stopped
+        DebugLogHelper log_ping{"received: ping", on_handler};
+        DebugLogHelper log_islock{"received: isdlock", on_handler};
+        CSerializedNetMsg msg_islock{msg_maker.Make(NetMsgType::ISDLOCK, llmq::CInstantSendLock{})};
+        BOOST_CHECK(connman->ReceiveMsgFrom(*node, msg_islock));
+        peerLogic->ProcessMessages(node, interrupt);
+        CSerializedNetMsg msg_ping{msg_maker.Make(NetMsgType::PING, uint64_t{1})};
+        BOOST_CHECK(connman->ReceiveMsgFrom(*node, msg_ping));
+        peerLogic->ProcessMessages(node, interrupt);
+    }
+
+    peerLogic->FinalizeNode(*node);
+    connman->ClearTestNodes();
+}
+
 BOOST_AUTO_TEST_CASE(DoS_bantime)
 {
     const CChainParams& chainparams = Params();
@@ -70,6 +70,13 @@ ssize_t FuzzedSock::Send(const void* data, size_t len, int flags) const
     return r;
 }
 
+ssize_t FuzzedSock::SendMany(const std::vector<Span<const unsigned char>>& buffers, int flags) const
+{
+    // a partial send of the first buffer is as valid as a complete one
+    if (buffers.empty()) return 0;
+    return Send(buffers.front().data(), buffers.front().size(), flags);
+}
+
 ssize_t FuzzedSock::Recv(void* buf, size_t len, int flags) const
 {
     // Have a permanent error at recv_errnos[0] because when the fuzzed data is exhausted
@@ -5,6 +5,7 @@
 #include <test/util/setup_common.h>
 
 #include <chainparams.h>
+#include <crc32c/crc32c.h>
 #include <string>
 #include <boost/test/unit_test.hpp>
 #include <hash.h>
@@ -18,6 +19,7 @@
 #include <serialize.h>
 #include <span.h>
 #include <streams.h>
+#include <test/util/net.h>
 #include <test/util/validation.h>
 #include <timedata.h>
 #include <util/strencodings.h>
@@ -918,4 +920,351 @@ BOOST_AUTO_TEST_CASE(initial_advertise_from_version_message)
     TestOnlyResetTimeData();
 }
 
+/** Mock socket that accepts at most a given number of bytes per call and records everything sent */
+class ThrottledSock : public StaticContentsSock
+{
+public:
+    explicit ThrottledSock(size_t max_bytes_per_call) : StaticContentsSock{""}, m_max_bytes_per_call{max_bytes_per_call} {}
+
+    ssize_t SendMany(const std::vector<Span<const unsigned char>>& buffers, int) const override
+    {
+        ++m_calls;
+        size_t sent{0};
+        for (const auto& buffer : buffers) {
+            const size_t len{std::min(buffer.size(), m_max_bytes_per_call - sent)};
+            m_sent.insert(m_sent.end(), buffer.begin(), buffer.begin() + len);
+            sent += len;
+            if (sent == m_max_bytes_per_call) break;
+        }
+        return sent;
+    }
+
+    const size_t m_max_bytes_per_call;
+    mutable std::vector<unsigned char> m_sent;
+    mutable int m_calls{0};
+};
+
+BOOST_AUTO_TEST_CASE(socket_send_data_scatter_gather)
+{
+    ConnmanTestMsg connman{0x1337, 0x1337, *m_node.addrman};
+    const CNetMsgMaker msg_maker{PROTOCOL_VERSION};
+
+    // 24 bytes of header each, payloads of 0, 100 and 1000 bytes
+    const auto make_msgs = [&] {
+        std::vector<CSerializedNetMsg> msgs;
+        msgs.push_back(msg_maker.Make(NetMsgType::VERACK));
+        msgs.push_back(msg_maker.Make(NetMsgType::PING, std::vector<unsigned char>(99, 0x01)));
+        msgs.push_back(msg_maker.Make(NetMsgType::PONG, std::vector<unsigned char>(997, 0x02)));
+        return msgs;
+    };
+    std::vector<unsigned char> expected;
+    for (auto& msg : make_msgs()) {
+        std::vector<unsigned char> header;
+        V1TransportSerializer{}.prepareForTransport(msg, header);
+        expected.insert(expected.end(), header.begin(), header.end());
+        expected.insert(expected.end(), msg.data.begin(), msg.data.end());
+    }
+    BOOST_CHECK_EQUAL(expected.size(), 3 * CMessageHeader::HEADER_SIZE + 1100);
+
+    // One shared payload queued for two nodes, then flushed with differently sized writes
+    CSharedNetMsg shared{msg_maker.Make(NetMsgType::PONG, std::vector<unsigned char>(997, 0x02))};
+    NodeId id{0};
+    for (const size_t max_bytes_per_call : {size_t{1000000}, size_t{50}}) {
+        auto sock = std::make_shared<ThrottledSock>(max_bytes_per_call);
+        CNode node{/*id=*/id++,
+                   /*nLocalServicesIn=*/NODE_NETWORK,
+                   /*sock=*/sock,
+                   /*addrIn=*/CAddress{},
+                   /*nKeyedNetGroupIn=*/0,
+                   /*nLocalHostNonceIn=*/0,
+                   /*addrBindIn=*/CAddress{},
+                   /*addrNameIn=*/std::string{},
+                   /*conn_type_in=*/ConnectionType::OUTBOUND_FULL_RELAY,
+                   /*inbound_onion=*/false};
+        auto msgs = make_msgs();
+        connman.PushMessage(&node, std::move(msgs[0]));
+        connman.PushMessage(&node, std::move(msgs[1]));
+        connman.PushMessage(&node, shared);
+
+        size_t sent{0};
+        while (sent < expected.size()) {
+            node.fCanSendData = true;
+            const size_t bytes{connman.SendQueuedData(node)};
+            BOOST_REQUIRE(bytes > 0);
+            sent += bytes;
+        }
+        BOOST_CHECK_EQUAL(sent, expected.size());
+        BOOST_CHECK(sock->m_sent == expected);
+        BOOST_CHECK_EQUAL(WITH_LOCK(node.cs_vSend, return node.vSendMsg.size()), 0U);
+        if (max_bytes_per_call > expected.size()) {
+            // all five buffers went out in a single call
+            BOOST_CHECK_EQUAL(sock->m_calls, 1);
+        }
+    }
+    // nothing holds on to the shared payload anymore besides us
+    BOOST_CHECK_EQUAL(shared.data.use_count(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(send_queue_priorities)
+{
+    ConnmanTestMsg connman{0x1337, 0x1337, *m_node.addrman};
+    const CNetMsgMaker msg_maker{PROTOCOL_VERSION};
+    auto sock = std::make_shared<ThrottledSock>(1000000);
+    CNode node{/*id=*/0,
+               /*nLocalServicesIn=*/NODE_NETWORK,
+               /*sock=*/sock,
+               /*addrIn=*/CAddress{},
+               /*nKeyedNetGroupIn=*/0,
+               /*nLocalHostNonceIn=*/0,
+               /*addrBindIn=*/CAddress{},
+               /*addrNameIn=*/std::string{},
+               /*conn_type_in=*/ConnectionType::INBOUND,
+               /*inbound_onion=*/false};
+
+    // The first block fills the send window, everything after it waits in the queues
+    connman.PushMessage(&node, msg_maker.Make(NetMsgType::BLOCK, std::vector<unsigned char>(100000, 0x01)));
+    connman.PushMessage(&node, msg_maker.Make(NetMsgType::BLOCK, std::vector<unsigned char>(100000, 0x02)));
+    connman.PushMessage(&node, msg_maker.Make(NetMsgType::PING, uint64_t{1}));
+    connman.PushMessage(&node, msg_maker.Make(NetMsgType::ISDLOCK, std::vector<unsigned char>(200, 0x03)));
+    connman.PushMessage(&node, msg_maker.Make(NetMsgType::QSIGSHARE, std::vector<unsigned char>(100, 0x04)));
+    BOOST_CHECK_EQUAL(node.nSendMsgSize, 2U + 4U);
+
+    CNodeStats stats;
+    node.CopyStats(stats);
+    const auto& llmq_stats = stats.m_send_queue_stats[static_cast<size_t>(SendPriority::LLMQ)];
+    BOOST_CHECK_EQUAL(llmq_stats.m_queued_msgs, 2U);
+    BOOST_CHECK_EQUAL(llmq_stats.m_queued_bytes, 200U + 1U + 100U + 1U);
+    BOOST_CHECK_EQUAL(stats.m_send_queue_stats[static_cast<size_t>(SendPriority::NORMAL)].m_queued_msgs, 1U);
+    const auto& bulk_stats = stats.m_send_queue_stats[static_cast<size_t>(SendPriority::BULK)];
+    BOOST_CHECK_EQUAL(bulk_stats.m_queued_msgs, 1U);
+    BOOST_CHECK_EQUAL(bulk_stats.m_sent_msgs, 1U);
+
+    node.fCanSendData = true;
+    connman.SendQueuedData(node);
+    BOOST_CHECK_EQUAL(node.nSendMsgSize, 0U);
+
+    // The block that was already going out is finished, then the queues are drained in priority order
+    std::vector<std::string> sent_types;
+    Span<const unsigned char> sent{sock->m_sent};
+    while (!sent.empty()) {
+        CDataStream stream{sent.first(CMessageHeader::HEADER_SIZE), SER_NETWORK, PROTOCOL_VERSION};
+        CMessageHeader hdr;
+        stream >> hdr;
+        sent_types.push_back(hdr.GetCommand());
+        sent = sent.subspan(CMessageHeader::HEADER_SIZE + hdr.nMessageSize);
+    }
+    const std::vector<std::string> expected_types{NetMsgType::BLOCK, NetMsgType::ISDLOCK, NetMsgType::QSIGSHARE,
+                                                  NetMsgType::PING, NetMsgType::BLOCK};
+    BOOST_CHECK(sent_types == expected_types);
+}
+
+BOOST_AUTO_TEST_CASE(send_queue_reply_order)
+{
+    ConnmanTestMsg connman{0x1337, 0x1337, *m_node.addrman};
+    const CNetMsgMaker msg_maker{PROTOCOL_VERSION};
+    auto sock = std::make_shared<ThrottledSock>(1000000);
+    CNode node{/*id=*/0,
+               /*nLocalServicesIn=*/NODE_NETWORK,
+               /*sock=*/sock,
+               /*addrIn=*/CAddress{},
+               /*nKeyedNetGroupIn=*/0,
+               /*nLocalHostNonceIn=*/0,
+               /*addrBindIn=*/CAddress{},
+               /*addrNameIn=*/std::string{},
+               /*conn_type_in=*/ConnectionType::INBOUND,
+               /*inbound_onion=*/false};
+
+    // A merkleblock reply waits behind a block, the matched tx and its islock are queued in the merkleblock's
+    // class and the continuation inv in the block's, so none of them overtakes what it belongs to
+    connman.PushMessage(&node, msg_maker.Make(NetMsgType::BLOCK, std::vector<unsigned char>(100000, 0x01)));
+    connman.PushMessage(&node, msg_maker.Make(NetMsgType::MERKLEBLOCK, std::vector<unsigned char>(1000, 0x02)));
+    connman.PushMessage(&node, msg_maker.Make(NetMsgType::TX, std::vector<unsigned char>(200, 0x03)), SendPriority::BULK);
+    connman.PushMessage(&node, msg_maker.Make(NetMsgType::ISDLOCK, std::vector<unsigned char>(200, 0x04)), SendPriority::BULK);
+    connman.PushMessage(&node, msg_maker.Make(NetMsgType::BLOCK, std::vector<unsigned char>(1000, 0x05)));
+    connman.PushMessage(&node, msg_maker.Make(NetMsgType::INV, std::vector<unsigned char>(37, 0x06)), SendPriority::BULK);
+    // Unrelated messages still go first
+    connman.PushMessage(&node, msg_maker.Make(NetMsgType::PING, uint64_t{1}));
+
+    node.fCanSendData = true;
+    connman.SendQueuedData(node);
+    BOOST_CHECK_EQUAL(node.nSendMsgSize, 0U);
+
+    std::vector<std::string> sent_types;
+    Span<const unsigned char> sent{sock->m_sent};
+    while (!sent.empty()) {
+        CDataStream stream{sent.first(CMessageHeader::HEADER_SIZE), SER_NETWORK, PROTOCOL_VERSION};
+        CMessageHeader hdr;
+        stream >> hdr;
+        sent_types.push_back(hdr.GetCommand());
+        sent = sent.subspan(CMessageHeader::HEADER_SIZE + hdr.nMessageSize);
+    }
+    const std::vector<std::string> expected_types{NetMsgType::BLOCK, NetMsgType::PING, NetMsgType::MERKLEBLOCK,
+                                                  NetMsgType::TX, NetMsgType::ISDLOCK, NetMsgType::BLOCK, NetMsgType::INV};
+    BOOST_CHECK(sent_types == expected_types);
+}
+
+BOOST_AUTO_TEST_CASE(v1_transport_crc32c_checksums)
+{
+    const CNetMsgMaker msg_maker{PROTOCOL_VERSION};
+    const V1TransportSerializer serializer;
+    V1TransportDeserializer deserializer{Params(), /*node_id=*/0, SER_NETWORK, PROTOCOL_VERSION};
+
+    const auto frame = [&](CSerializedNetMsg msg) {
+        CSharedNetMsg shared{std::move(msg), serializer.UsesPayloadHash()};
+        std::vector<unsigned char> bytes;
+        serializer.prepareForTransport(shared, bytes);
+        bytes.insert(bytes.end(), shared.data->begin(), shared.data->end());
+        return bytes;
+    };
+    const auto receive = [&](const std::vector<unsigned char>& bytes, bool& reject) {
+        Span<const uint8_t> msg_bytes{bytes};
+        while (!msg_bytes.empty()) {
+            BOOST_REQUIRE(deserializer.Read(msg_bytes) >= 0);
+        }
+        BOOST_REQUIRE(deserializer.Complete());
+        return deserializer.GetMessage(GetTime<std::chrono::microseconds>(), reject);
+    };
+    bool reject{false};
+
+    // Everything up to and including sendcrc32c carries the double SHA256 checksum
+    BOOST_CHECK(serializer.UsesPayloadHash());
+    const std::vector<unsigned char> ping{frame(msg_maker.Make(NetMsgType::PING, uint64_t{1}))};
+    BOOST_CHECK(std::equal(ping.begin() + 20, ping.begin() + 24, Hash(Span{ping}.subspan(24)).begin()));
+    receive(ping, reject);
+    BOOST_CHECK(!reject);
+    receive(frame(msg_maker.Make(NetMsgType::SENDCRC32C)), reject);
+    BOOST_CHECK(!reject);
+
+    // after it, on both ends, CRC32C
+    BOOST_CHECK(!serializer.UsesPayloadHash());
+    std::vector<unsigned char> pong{frame(msg_maker.Make(NetMsgType::PONG, uint64_t{2}))};
+    BOOST_CHECK_EQUAL(ReadLE32(&pong[20]), crc32c::Crc32c(&pong[24], pong.size() - 24));
+    CNetMessage msg{receive(pong, reject)};
+    BOOST_CHECK(!reject);
+    BOOST_CHECK_EQUAL(msg.m_type, NetMsgType::PONG);
+
+    pong.back() ^= 0x01;
+    receive(pong, reject);
+    BOOST_CHECK(reject);
+}
+
+BOOST_AUTO_TEST_CASE(v2_transport_roundtrip)
+{
+    const CChainParams& params{Params()};
+    V2Transport initiator{params, /*node_id=*/0, /*initiator=*/true};
+    V2Transport responder{params, /*node_id=*/1, /*initiator=*/false};
+    BOOST_CHECK_EQUAL(initiator.GetTransportType(), "detecting");
+
+    // Messages pushed before the handshake finished are queued and sent in order afterwards
+    const std::vector<unsigned char> ping_payload(8, 0x42);
+    const std::vector<unsigned char> dsq_payload(150, 0x07);
+    BOOST_CHECK(initiator.PushMessage(NetMsgType::PING, ping_payload));
+    BOOST_CHECK(initiator.PushMessage(NetMsgType::DSQUEUE, dsq_payload));
+    BOOST_CHECK(responder.PushMessage(NetMsgType::ISDLOCK, {}));
+
+    std::vector<std::pair<std::string, std::vector<unsigned char>>> received_by_responder, received_by_initiator;
+    const auto deliver = [](V2Transport& from, V2Transport& to, auto& received) {
+        std::vector<unsigned char> bytes;
+        if (!from.GetBytesToSend(bytes)) return false;
+        Span<const uint8_t> msg_bytes{bytes};
+        while (!msg_bytes.empty()) {
+            BOOST_REQUIRE(to.Read(msg_bytes) >= 0);
+            if (to.Complete()) {
+                bool reject{false};
+                CNetMessage msg{to.GetMessage(GetTime<std::chrono::microseconds>(), reject)};
+                BOOST_CHECK(!reject);
+                received.emplace_back(msg.m_type, std::vector<unsigned char>(UCharCast(msg.m_recv.data()), UCharCast(msg.m_recv.data()) + msg.m_recv.size()));
+            }
+        }
+        return true;
+    };
+    // key + garbage from the initiator, key + garbage + terminator + version from the responder, and so on
+    for (int i = 0; i < 4; ++i) {
+        deliver(initiator, responder, received_by_responder);
+        deliver(responder, initiator, received_by_initiator);
+    }
+    BOOST_CHECK_EQUAL(initiator.GetTransportType(), "v2");
+    BOOST_CHECK_EQUAL(responder.GetTransportType(), "v2");
+    BOOST_CHECK_EQUAL(initiator.GetSessionID(), responder.GetSessionID());
+    BOOST_CHECK_EQUAL(initiator.GetSessionID().size(), 64U);
+
+    // ping has a short id, dsq is sent with its full message type
+    BOOST_REQUIRE_EQUAL(received_by_responder.size(), 2U);
+    BOOST_CHECK_EQUAL(received_by_responder[0].first, NetMsgType::PING);
+    BOOST_CHECK(received_by_responder[0].second == ping_payload);
+    BOOST_CHECK_EQUAL(received_by_responder[1].first, NetMsgType::DSQUEUE);
+    BOOST_CHECK(received_by_responder[1].second == dsq_payload);
+    BOOST_REQUIRE_EQUAL(received_by_initiator.size(), 1U);
+    BOOST_CHECK_EQUAL(received_by_initiator[0].first, NetMsgType::ISDLOCK);
+
+    // Once the handshake is done messages are encrypted right away
+    BOOST_CHECK(responder.PushMessage(NetMsgType::PONG, ping_payload));
+    BOOST_CHECK(deliver(responder, initiator, received_by_initiator));
+    BOOST_REQUIRE_EQUAL(received_by_initiator.size(), 2U);
+    BOOST_CHECK_EQUAL(received_by_initiator[1].first, NetMsgType::PONG);
+    BOOST_CHECK(received_by_initiator[1].second == ping_payload);
+
+    // A flipped bit fails authentication
+    BOOST_CHECK(initiator.PushMessage(NetMsgType::PING, ping_payload));
+    std::vector<unsigned char> bytes;
+    BOOST_REQUIRE(initiator.GetBytesToSend(bytes));
+    bytes.back() ^= 0x01;
+    Span<const uint8_t> msg_bytes{bytes};
+    BOOST_CHECK_EQUAL(responder.Read(msg_bytes), -1);
+}
+
+BOOST_AUTO_TEST_CASE(v2_transport_v1_fallback)
+{
+    const CChainParams& params{Params()};
+    auto transport = std::make_shared<V2Transport>(params, /*node_id=*/0, /*initiator=*/false);
+    V2TransportDeserializer deserializer{transport, params, /*node_id=*/0, SER_NETWORK, INIT_PROTO_VERSION};
+    const V2TransportSerializer serializer{transport};
+
+    // Our reply is queued while the responder can't tell v1 from v2 yet
+    const CNetMsgMaker msg_maker{INIT_PROTO_VERSION};
+    std::vector<CSharedNetData> buffers;
+    serializer.prepareForWire(CSharedNetMsg{msg_maker.Make(NetMsgType::VERACK)}, buffers);
+    BOOST_CHECK(buffers.empty());
+
+    // A v1 peer starts with a version message, fed in two chunks that split the detection prefix
+    CSerializedNetMsg version{msg_maker.Make(NetMsgType::VERSION, std::vector<unsigned char>(100, 0x01))};
+    std::vector<unsigned char> bytes;
+    V1TransportSerializer{}.prepareForTransport(version, bytes);
+    bytes.insert(bytes.end(), version.data.begin(), version.data.end());
+    Span<const uint8_t> msg_bytes{bytes};
+    Span<const uint8_t> first_chunk{msg_bytes.first(10)};
+    BOOST_CHECK_EQUAL(deserializer.Read(first_chunk), 10);
+    BOOST_CHECK_EQUAL(transport->GetTransportType(), "detecting");
+    msg_bytes = msg_bytes.subspan(10);
+    while (!msg_bytes.empty()) {
+        BOOST_REQUIRE(deserializer.Read(msg_bytes) >= 0);
+    }
+    BOOST_REQUIRE(deserializer.Complete());
+    bool reject{false};
+    CNetMessage msg{deserializer.GetMessage(GetTime<std::chrono::microseconds>(), reject)};
+    BOOST_CHECK(!reject);
+    BOOST_CHECK_EQUAL(msg.m_type, NetMsgType::VERSION);
+    // The payload is the vector with its compact size length prefix
+    BOOST_CHECK_EQUAL(msg.m_message_size, 101U);
+    BOOST_CHECK_EQUAL(msg.m_message_size, version.data.size());
+    BOOST_CHECK_EQUAL(HexStr(MakeUCharSpan(msg.m_recv)), HexStr(version.data));
+    BOOST_CHECK_EQUAL(transport->GetTransportType(), "v1");
+
+    // The queued verack and anything after it goes out with v1 framing
+    serializer.prepareForWire(CSharedNetMsg{msg_maker.Make(NetMsgType::PING, uint64_t{7})}, buffers);
+    std::vector<unsigned char> sent;
+    for (const auto& buffer : buffers) sent.insert(sent.end(), buffer->begin(), buffer->end());
+    std::vector<unsigned char> expected;
+    std::vector<CSerializedNetMsg> msgs;
+    msgs.push_back(msg_maker.Make(NetMsgType::VERACK));
+    msgs.push_back(msg_maker.Make(NetMsgType::PING, uint64_t{7}));
+    for (auto& msg : msgs) {
+        std::vector<unsigned char> header;
+        V1TransportSerializer{}.prepareForTransport(msg, header);
+        expected.insert(expected.end(), header.begin(), header.end());
+        expected.insert(expected.end(), msg.data.begin(), msg.data.end());
+    }
+    BOOST_CHECK(sent == expected);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
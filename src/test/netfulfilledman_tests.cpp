@@ -0,0 +1,213 @@
+// Copyright (c) 2023 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <test/util/setup_common.h>
+
+#include <chainparams.h>
+#include <clientversion.h>
+#include <netbase.h>
+#include <netfulfilledman.h>
+#include <streams.h>
+#include <util/time.h>
+#include <version.h>
+
+#include <map>
+#include <set>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(netfulfilledman_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(netfulfilledman_expiry)
+{
+    const int64_t expire_time = Params().FulfilledRequestExpireTime();
+    const CService addr1 = LookupNumeric("1.2.3.4", 1234);
+    const CService addr2 = LookupNumeric("5.6.7.8", 1234);
+
+    SetMockTime(1000000);
+    CNetFulfilledRequestManager netfulfilledman;
+
+    BOOST_CHECK(!netfulfilledman.HasFulfilledRequest(addr1, "full-sync"));
+    netfulfilledman.AddFulfilledRequest(addr1, "full-sync");
+    netfulfilledman.AddFulfilledRequest(addr1, "spork-sync");
+    netfulfilledman.AddFulfilledRequest(addr2, "full-sync");
+    BOOST_CHECK(netfulfilledman.HasFulfilledRequest(addr1, "full-sync"));
+    BOOST_CHECK(netfulfilledman.HasFulfilledRequest(addr1, "spork-sync"));
+    BOOST_CHECK(!netfulfilledman.HasFulfilledRequest(addr1, "governance-sync"));
+    BOOST_CHECK(netfulfilledman.HasFulfilledRequest(addr2, "full-sync"));
+    BOOST_CHECK(!netfulfilledman.HasFulfilledRequest(addr2, "spork-sync"));
+    BOOST_CHECK_EQUAL(netfulfilledman.GetPeerCount(), 2U);
+
+    // Refreshing a request pushes its expiry back
+    SetMockTime(1000000 + expire_time / 2);
+    netfulfilledman.AddFulfilledRequest(addr1, "full-sync");
+
+    SetMockTime(1000000 + expire_time);
+    netfulfilledman.CheckAndRemove();
+    BOOST_CHECK(netfulfilledman.HasFulfilledRequest(addr1, "full-sync"));
+    BOOST_CHECK(!netfulfilledman.HasFulfilledRequest(addr1, "spork-sync"));
+    BOOST_CHECK(!netfulfilledman.HasFulfilledRequest(addr2, "full-sync"));
+    BOOST_CHECK_EQUAL(netfulfilledman.GetPeerCount(), 1U);
+
+    SetMockTime(1000000 + expire_time / 2 + expire_time);
+    netfulfilledman.CheckAndRemove();
+    BOOST_CHECK(!netfulfilledman.HasFulfilledRequest(addr1, "full-sync"));
+    BOOST_CHECK_EQUAL(netfulfilledman.GetPeerCount(), 0U);
+
+    netfulfilledman.AddFulfilledRequest(addr2, "full-sync");
+    netfulfilledman.RemoveAllFulfilledRequests(addr2);
+    BOOST_CHECK(!netfulfilledman.HasFulfilledRequest(addr2, "full-sync"));
+    BOOST_CHECK_EQUAL(netfulfilledman.GetPeerCount(), 0U);
+
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_CASE(netfulfilledman_serialization)
+{
+    const CService addr1 = LookupNumeric("1.2.3.4", 1234);
+    const CService addr2 = LookupNumeric("5.6.7.8", 1234);
+
+    SetMockTime(1000000);
+    CNetFulfilledRequestManager netfulfilledman;
+    netfulfilledman.AddFulfilledRequest(addr1, "full-sync");
+    netfulfilledman.AddFulfilledRequest(addr2, "governance-sync");
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << static_cast<const NetFulfilledRequestStore&>(netfulfilledman);
+
+    // On-disk format is the legacy nested map
+    std::map<CService, std::map<std::string, int64_t>> mapLegacy;
+    CDataStream ss_copy{ss};
+    ss_copy >> mapLegacy;
+    BOOST_CHECK_EQUAL(mapLegacy.size(), 2U);
+
+    CNetFulfilledRequestManager netfulfilledman2;
+    ss >> static_cast<NetFulfilledRequestStore&>(netfulfilledman2);
+    BOOST_CHECK(netfulfilledman2.HasFulfilledRequest(addr1, "full-sync"));
+    BOOST_CHECK(netfulfilledman2.HasFulfilledRequest(addr2, "governance-sync"));
+    BOOST_CHECK(!netfulfilledman2.HasFulfilledRequest(addr2, "full-sync"));
+
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_CASE(netfulfilledman_wheel)
+{
+    // Compare the timing wheel against a brute force expiry for delays covering all wheel levels
+    NetFulfilledExpiryWheel wheel;
+    const CService addr = LookupNumeric("1.2.3.4", 1234);
+    int64_t now{1000000};
+    wheel.Advance(now, [](const auto&) {});
+
+    std::multiset<int64_t> expected;
+    std::multiset<int64_t> expired;
+    for (int i = 0; i < 2000; ++i) {
+        const int64_t delay = 1 + InsecureRandRange(i % 4 == 0 ? 200000 : 3000);
+        wheel.Insert({addr, 0, now + delay});
+        expected.insert(now + delay);
+    }
+    BOOST_CHECK_EQUAL(wheel.Size(), expected.size());
+
+    while (!expected.empty()) {
+        now += 1 + InsecureRandRange(500);
+        wheel.Advance(now, [&](const auto& item) {
+            BOOST_CHECK(item.expire <= now);
+            expired.insert(item.expire);
+        });
+        while (!expected.empty() && *expected.begin() <= now) {
+            BOOST_CHECK(expired.count(*expected.begin()));
+            expired.erase(expired.find(*expected.begin()));
+            expected.erase(expected.begin());
+        }
+        BOOST_CHECK(expired.empty());
+        BOOST_CHECK_EQUAL(wheel.Size(), expected.size());
+    }
+
+    // Jumps larger than the wheel span
+    wheel.Insert({addr, 0, now + 10});
+    wheel.Insert({addr, 0, now + 10000000});
+    size_t count{0};
+    wheel.Advance(now + 1000000, [&](const auto&) { ++count; });
+    BOOST_CHECK_EQUAL(count, 1U);
+    BOOST_CHECK_EQUAL(wheel.Size(), 1U);
+}
+
+BOOST_AUTO_TEST_CASE(netfulfilledman_wheel_boundaries)
+{
+    // Items due right at or next to the edges of a level 0 slot, a level 1 revolution and the overflow
+    // fire exactly at their expiry time when the wheel is advanced one second at a time
+    NetFulfilledExpiryWheel wheel;
+    const CService addr = LookupNumeric("1.2.3.4", 1234);
+    const int64_t start{65536 * 20 - 3};
+    wheel.Advance(start, [](const auto&) {});
+
+    std::multiset<int64_t> expected;
+    for (const int64_t delay : {1, 3, 4, 255, 256, 257, 259, 65535, 65536, 65537, 65539, 131072, 140000}) {
+        wheel.Insert({addr, 0, start + delay});
+        expected.insert(start + delay);
+    }
+    // The same item queued twice fires twice
+    wheel.Insert({addr, 0, start + 256});
+    expected.insert(start + 256);
+
+    for (int64_t now = start + 1; now <= start + 140000; ++now) {
+        wheel.Advance(now, [&](const auto& item) {
+            BOOST_CHECK_EQUAL(item.expire, now);
+            expected.erase(expected.find(item.expire));
+        });
+        BOOST_CHECK_EQUAL(wheel.Size(), expected.size());
+    }
+    BOOST_CHECK(expected.empty());
+}
+
+BOOST_AUTO_TEST_CASE(netfulfilledman_readd)
+{
+    // Mainnet requests expire after an hour, so they start out on level 1 of the wheel
+    const int64_t expire_time = Params().FulfilledRequestExpireTime();
+    BOOST_REQUIRE_GT(expire_time, 256);
+    const CService addr1 = LookupNumeric("1.2.3.4", 1234);
+    const CService addr2 = LookupNumeric("5.6.7.8", 1234);
+    const int64_t start{65536 * 20 - 100};
+
+    SetMockTime(start);
+    CNetFulfilledRequestManager netfulfilledman;
+    netfulfilledman.AddFulfilledRequest(addr1, "full-sync");
+    netfulfilledman.AddFulfilledRequest(addr2, "full-sync");
+
+    // Refresh addr1 once its new expiry falls into another slot, the stale wheel entry must not remove it
+    SetMockTime(start + 300);
+    netfulfilledman.AddFulfilledRequest(addr1, "full-sync");
+    // addr2 is removed and added again, its old wheel entry stays behind as well
+    netfulfilledman.RemoveAllFulfilledRequests(addr2);
+    BOOST_CHECK(!netfulfilledman.HasFulfilledRequest(addr2, "full-sync"));
+    netfulfilledman.AddFulfilledRequest(addr2, "full-sync");
+
+    SetMockTime(start + expire_time);
+    netfulfilledman.CheckAndRemove();
+    BOOST_CHECK(netfulfilledman.HasFulfilledRequest(addr1, "full-sync"));
+    BOOST_CHECK(netfulfilledman.HasFulfilledRequest(addr2, "full-sync"));
+    BOOST_CHECK_EQUAL(netfulfilledman.GetPeerCount(), 2U);
+
+    SetMockTime(start + 300 + expire_time - 1);
+    netfulfilledman.CheckAndRemove();
+    BOOST_CHECK_EQUAL(netfulfilledman.GetPeerCount(), 2U);
+
+    SetMockTime(start + 300 + expire_time);
+    netfulfilledman.CheckAndRemove();
+    BOOST_CHECK(!netfulfilledman.HasFulfilledRequest(addr1, "full-sync"));
+    BOOST_CHECK(!netfulfilledman.HasFulfilledRequest(addr2, "full-sync"));
+    BOOST_CHECK_EQUAL(netfulfilledman.GetPeerCount(), 0U);
+
+    // An expired request can be added again and expires on its new schedule
+    netfulfilledman.AddFulfilledRequest(addr1, "full-sync");
+    SetMockTime(start + 300 + 2 * expire_time - 1);
+    netfulfilledman.CheckAndRemove();
+    BOOST_CHECK(netfulfilledman.HasFulfilledRequest(addr1, "full-sync"));
+    SetMockTime(start + 300 + 2 * expire_time);
+    netfulfilledman.CheckAndRemove();
+    BOOST_CHECK_EQUAL(netfulfilledman.GetPeerCount(), 0U);
+
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,85 @@
+// Copyright (c) 2024 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coins.h>
+#include <memusage.h>
+#include <support/allocators/pool.h>
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(pool_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(basic_allocating)
+{
+    PoolResource<8, 8> resource{/*chunk_size_bytes=*/1024, /*pooled=*/true};
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 0U);
+
+    // First allocation takes a chunk
+    void* block = resource.Allocate(8, 1);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+
+    // A freed block is handed out again for the same size class
+    resource.Deallocate(block, 8, 1);
+    void* reused = resource.Allocate(7, 1);
+    BOOST_CHECK(reused == block);
+
+    // Blocks are carved from the chunk until it is used up
+    std::vector<void*> blocks{reused};
+    for (size_t i = 1; i < 1024 / 8; ++i) {
+        blocks.push_back(resource.Allocate(8, 8));
+    }
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+    blocks.push_back(resource.Allocate(8, 8));
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2U);
+
+    // Too large or too strictly aligned requests don't touch the pool
+    void* large = resource.Allocate(16, 8);
+    void* aligned = resource.Allocate(8, 16);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2U);
+    resource.Deallocate(large, 16, 8);
+    resource.Deallocate(aligned, 8, 16);
+
+    for (void* p : blocks) resource.Deallocate(p, 8, 8);
+}
+
+BOOST_AUTO_TEST_CASE(passthrough)
+{
+    PoolResource<8, 8> resource{/*pooled=*/false};
+    BOOST_CHECK(!resource.IsPooled());
+    void* block = resource.Allocate(8, 8);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 0U);
+    resource.Deallocate(block, 8, 8);
+}
+
+BOOST_AUTO_TEST_CASE(coins_map_usage)
+{
+    for (const bool pooled : {true, false}) {
+        CCoinsMapMemoryResource resource{pooled};
+        CCoinsMap map{0, SaltedOutpointHasher{}, CCoinsMap::key_equal{}, &resource};
+        const size_t empty_usage{memusage::DynamicUsage(map)};
+
+        for (uint32_t i = 0; i < 10000; ++i) {
+            map.emplace(COutPoint{InsecureRand256(), i}, CCoinsCacheEntry{});
+        }
+        const size_t full_usage{memusage::DynamicUsage(map)};
+        // At least the nodes themselves are accounted for, pooled or not
+        BOOST_CHECK_GT(full_usage, empty_usage + 10000 * sizeof(CCoinsMap::value_type));
+        BOOST_CHECK_EQUAL(resource.NumAllocatedChunks() > 0, pooled);
+
+        // Pooled memory is kept for reuse, erasing and inserting again doesn't grow it
+        const size_t chunks{resource.NumAllocatedChunks()};
+        map.clear();
+        for (uint32_t i = 0; i < 10000; ++i) {
+            map.emplace(COutPoint{InsecureRand256(), i}, CCoinsCacheEntry{});
+        }
+        BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), chunks);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,126 @@
+// Copyright (c) 2024 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/txreconciliation.h>
+
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+
+BOOST_FIXTURE_TEST_SUITE(txreconciliation_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(sketch_decode)
+{
+    std::vector<uint32_t> common, only_a, only_b;
+    for (int i = 0; i < 500; ++i) common.push_back(InsecureRand32());
+    for (int i = 0; i < 30; ++i) only_a.push_back(InsecureRand32());
+    for (int i = 0; i < 20; ++i) only_b.push_back(InsecureRand32());
+
+    const size_t cells = TxReconSketch::CellsForCapacity(only_a.size() + only_b.size());
+    TxReconSketch a{cells}, b{cells};
+    for (const uint32_t id : common) {
+        a.Add(id);
+        b.Add(id);
+    }
+    for (const uint32_t id : only_a) a.Add(id);
+    for (const uint32_t id : only_b) b.Add(id);
+
+    // Survives the trip over the wire
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << b;
+    TxReconSketch b2;
+    ss >> b2;
+    BOOST_CHECK_EQUAL(b2.GetCells(), cells);
+
+    a.Subtract(b2);
+    std::vector<uint32_t> decoded_a, decoded_b;
+    BOOST_CHECK(a.Decode(decoded_a, decoded_b));
+    std::sort(only_a.begin(), only_a.end());
+    std::sort(only_b.begin(), only_b.end());
+    std::sort(decoded_a.begin(), decoded_a.end());
+    std::sort(decoded_b.begin(), decoded_b.end());
+    BOOST_CHECK(decoded_a == only_a);
+    BOOST_CHECK(decoded_b == only_b);
+
+    // A difference far beyond the capacity doesn't decode
+    TxReconSketch small{TxReconSketch::CellsForCapacity(1)};
+    for (int i = 0; i < 100; ++i) small.Add(InsecureRand32());
+    decoded_a.clear();
+    decoded_b.clear();
+    BOOST_CHECK(!small.Decode(decoded_a, decoded_b));
+}
+
+BOOST_AUTO_TEST_CASE(reconciliation_round)
+{
+    // Node 1 connected to node 0: node 1 initiates, node 0 responds
+    TxReconciliationTracker responder{TXRECONCILIATION_VERSION}, initiator{TXRECONCILIATION_VERSION};
+    const NodeId to_initiator{1}, to_responder{0};
+
+    BOOST_CHECK(!responder.AddToSet(to_initiator, InsecureRand256()));
+    const uint64_t salt_r = responder.PreRegisterPeer(to_initiator);
+    const uint64_t salt_i = initiator.PreRegisterPeer(to_responder);
+    BOOST_CHECK(!responder.IsPeerRegistered(to_initiator));
+    BOOST_CHECK(responder.RegisterPeer(to_initiator, /*is_peer_inbound=*/true, TXRECONCILIATION_VERSION, salt_i) == TxReconciliationTracker::RegisterResult::SUCCESS);
+    BOOST_CHECK(initiator.RegisterPeer(to_responder, /*is_peer_inbound=*/false, TXRECONCILIATION_VERSION + 1, salt_r) == TxReconciliationTracker::RegisterResult::SUCCESS);
+    BOOST_CHECK(initiator.RegisterPeer(to_responder, false, TXRECONCILIATION_VERSION, salt_r) == TxReconciliationTracker::RegisterResult::ALREADY_REGISTERED);
+    BOOST_CHECK(initiator.RegisterPeer(7, false, TXRECONCILIATION_VERSION, salt_r) == TxReconciliationTracker::RegisterResult::NOT_FOUND);
+
+    std::vector<uint256> common, only_r, only_i;
+    for (int i = 0; i < 200; ++i) common.push_back(InsecureRand256());
+    for (int i = 0; i < 5; ++i) only_r.push_back(InsecureRand256());
+    for (int i = 0; i < 7; ++i) only_i.push_back(InsecureRand256());
+    for (const auto& txid : common) {
+        BOOST_CHECK(responder.AddToSet(to_initiator, txid));
+        BOOST_CHECK(initiator.AddToSet(to_responder, txid));
+    }
+    for (const auto& txid : only_r) BOOST_CHECK(responder.AddToSet(to_initiator, txid));
+    for (const auto& txid : only_i) BOOST_CHECK(initiator.AddToSet(to_responder, txid));
+
+    std::vector<uint256> to_flood;
+    // Only the initiator starts reconciliations, and only one at a time
+    BOOST_CHECK(!responder.InitiateReconciliation(to_initiator, 1s, to_flood));
+    const auto set_size = initiator.InitiateReconciliation(to_responder, 1s, to_flood);
+    BOOST_REQUIRE(set_size);
+    BOOST_CHECK_EQUAL(*set_size, common.size() + only_i.size());
+    BOOST_CHECK(!initiator.InitiateReconciliation(to_responder, 2s, to_flood));
+    BOOST_CHECK(!initiator.RespondToRequest(to_responder, 0));
+
+    const auto sketch = responder.RespondToRequest(to_initiator, *set_size);
+    BOOST_REQUIRE(sketch);
+
+    std::vector<uint32_t> to_ask;
+    std::vector<uint256> announced_by_initiator;
+    const auto success = initiator.ProcessSketch(to_responder, *sketch, to_ask, announced_by_initiator);
+    BOOST_REQUIRE(success);
+    BOOST_CHECK(*success);
+    BOOST_CHECK_EQUAL(to_ask.size(), only_r.size());
+    std::sort(announced_by_initiator.begin(), announced_by_initiator.end());
+    std::sort(only_i.begin(), only_i.end());
+    BOOST_CHECK(announced_by_initiator == only_i);
+
+    const auto announced_by_responder = responder.ProcessDiff(to_initiator, *success, to_ask);
+    BOOST_REQUIRE(announced_by_responder);
+    std::vector<uint256> sorted_r{*announced_by_responder};
+    std::sort(sorted_r.begin(), sorted_r.end());
+    std::sort(only_r.begin(), only_r.end());
+    BOOST_CHECK(sorted_r == only_r);
+    // The round is over
+    BOOST_CHECK(!responder.ProcessDiff(to_initiator, true, {}));
+
+    // An unanswered round is abandoned and its transactions are flooded
+    initiator.AddToSet(to_responder, InsecureRand256());
+    BOOST_CHECK(!initiator.InitiateReconciliation(to_responder, 2s, to_flood));
+    BOOST_CHECK(initiator.InitiateReconciliation(to_responder, 1s + RECON_REQUEST_INTERVAL, to_flood));
+    BOOST_CHECK(to_flood.empty());
+    BOOST_CHECK(initiator.InitiateReconciliation(to_responder, 1s + RECON_REQUEST_INTERVAL + RECON_RESPONSE_TIMEOUT, to_flood));
+    BOOST_CHECK_EQUAL(to_flood.size(), 1U);
+
+    initiator.AddToSet(to_responder, InsecureRand256());
+    BOOST_CHECK_EQUAL(initiator.ForgetPeer(to_responder).size(), 1U);
+    BOOST_CHECK(!initiator.IsPeerRegistered(to_responder));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
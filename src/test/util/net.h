@@ -47,6 +47,12 @@ struct ConnmanTestMsg : public CConnman {
 
     void ProcessMessagesOnce(CNode& node) { m_msgproc->ProcessMessages(&node, flagInterruptMsgProc); }
 
+    size_t SendQueuedData(CNode& node)
+    {
+        LOCK(node.cs_vSend);
+        return SocketSendData(node);
+    }
+
     void NodeReceiveMsgBytes(CNode& node, Span<const uint8_t> msg_bytes, bool& complete) const;
 
     bool ReceiveMsgFrom(CNode& node, CSerializedNetMsg& ser_msg) const;
@@ -122,6 +128,13 @@ public:
 
     ssize_t Send(const void*, size_t len, int) const override { return len; }
 
+    ssize_t SendMany(const std::vector<Span<const unsigned char>>& buffers, int) const override
+    {
+        size_t len{0};
+        for (const auto& buffer : buffers) len += buffer.size();
+        return len;
+    }
+
     ssize_t Recv(void* buf, size_t len, int flags) const override
     {
         const size_t consume_bytes{std::min(len, m_contents.size() - m_consumed)};
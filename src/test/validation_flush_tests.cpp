@@ -22,6 +22,9 @@ BOOST_FIXTURE_TEST_SUITE(validation_flush_tests, BasicTestingSetup)
 //!
 BOOST_AUTO_TEST_CASE(getcoinscachesizestate)
 {
+    // The byte counts below are those of a cache allocating each coin on its own
+    const bool coins_cache_pool{g_coins_cache_pool.exchange(false)};
+
     CTxMemPool mempool;
     BlockManager blockman{};
     CChainState chainstate(&mempool, blockman, *m_node.evodb, m_node.chain_helper, llmq::chainLocksHandler, llmq::quorumInstantSendManager, *m_node.sporkman);
@@ -79,6 +82,7 @@ BOOST_AUTO_TEST_CASE(getcoinscachesizestate)
             CoinsCacheSizeState::CRITICAL);
 
         BOOST_TEST_MESSAGE("Exiting cache flush tests early due to unsupported arch");
+        g_coins_cache_pool = coins_cache_pool;
         return;
     }
 
@@ -151,8 +155,8 @@ BOOST_AUTO_TEST_CASE(getcoinscachesizestate)
             CoinsCacheSizeState::OK);
     }
 
-    // Flushing the view doesn't take us back to OK because cacheCoins has
-    // preallocated memory that doesn't get reclaimed even after flush.
+    // Flushing the view takes us back to OK because the cache reallocates
+    // cacheCoins, giving back the memory it had preallocated.
 
     BOOST_CHECK_EQUAL(
         chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, 0),
@@ -164,7 +168,42 @@ BOOST_AUTO_TEST_CASE(getcoinscachesizestate)
 
     BOOST_CHECK_EQUAL(
         chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, 0),
-        CoinsCacheSizeState::CRITICAL);
+        CoinsCacheSizeState::OK);
+
+    g_coins_cache_pool = coins_cache_pool;
+}
+
+//! With a pooled coins cache the first coin allocates a whole chunk, which is accounted for.
+BOOST_AUTO_TEST_CASE(getcoinscachesizestate_pooled)
+{
+    const bool coins_cache_pool{g_coins_cache_pool.exchange(true)};
+
+    CTxMemPool mempool;
+    BlockManager blockman{};
+    CChainState chainstate(&mempool, blockman, *m_node.evodb, m_node.chain_helper, llmq::chainLocksHandler, llmq::quorumInstantSendManager, *m_node.sporkman);
+    chainstate.InitCoinsDB(/*cache_size_bytes*/ 1 << 10, /*in_memory*/ true, /*should_wipe*/ false);
+    WITH_LOCK(::cs_main, chainstate.InitCoinsCache(1 << 10));
+
+    LOCK(::cs_main);
+    auto& view = chainstate.CoinsTip();
+    constexpr size_t CHUNK_SIZE_BYTES{CCoinsMapMemoryResource::DEFAULT_CHUNK_SIZE_BYTES};
+
+    BOOST_CHECK_EQUAL(chainstate.GetCoinsCacheSizeState(1024, /*max_mempool_size_bytes*/ 0), CoinsCacheSizeState::OK);
+
+    Coin coin;
+    coin.nHeight = 1;
+    coin.out.nValue = 1;
+    view.AddCoin(COutPoint{InsecureRand256(), 0}, std::move(coin), false);
+    BOOST_CHECK_GE(view.DynamicMemoryUsage(), CHUNK_SIZE_BYTES);
+    BOOST_CHECK_EQUAL(chainstate.GetCoinsCacheSizeState(1024, /*max_mempool_size_bytes*/ 0), CoinsCacheSizeState::CRITICAL);
+    BOOST_CHECK_EQUAL(chainstate.GetCoinsCacheSizeState(2 * CHUNK_SIZE_BYTES, /*max_mempool_size_bytes*/ 0), CoinsCacheSizeState::OK);
+
+    // The chunk is given back when the cache is flushed
+    view.SetBestBlock(InsecureRand256());
+    BOOST_CHECK(view.Flush());
+    BOOST_CHECK_LT(view.DynamicMemoryUsage(), CHUNK_SIZE_BYTES);
+
+    g_coins_cache_pool = coins_cache_pool;
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -62,14 +62,36 @@ void CCoinsViewDB::ResizeCache(size_t new_cache_size)
 }
 
 bool CCoinsViewDB::GetCoin(const COutPoint &outpoint, Coin &coin) const {
+    {
+        LOCK(m_pending_mutex);
+        if (const auto it = m_pending.find(outpoint); it != m_pending.end()) {
+            if (it->second.IsSpent()) return false;
+            coin = it->second;
+            return true;
+        }
+    }
     return m_db->Read(CoinEntry(&outpoint), coin);
 }
 
 bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const {
+    {
+        LOCK(m_pending_mutex);
+        if (const auto it = m_pending.find(outpoint); it != m_pending.end()) {
+            return !it->second.IsSpent();
+        }
+    }
     return m_db->Exists(CoinEntry(&outpoint));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const {
+    {
+        LOCK(m_pending_mutex);
+        if (!m_pending_block.IsNull()) return m_pending_block;
+    }
+    return ReadBestBlock();
+}
+
+uint256 CCoinsViewDB::ReadBestBlock() const {
     uint256 hashBestChain;
     if (!m_db->Read(DB_BEST_BLOCK, hashBestChain))
         return uint256();
@@ -85,6 +107,10 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
 }
 
 bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    LOCK(m_pending_mutex);
+    // The database can only be in transition to one block, finish an incremental flush first.
+    if (!WritePendingLocked(0)) return false;
+
     CDBBatch batch(*m_db);
     size_t count = 0;
     size_t changed = 0;
@@ -92,7 +118,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     int crash_simulate = gArgs.GetArg("-dbcrashratio", 0);
     assert(!hashBlock.IsNull());
 
-    uint256 old_tip = GetBestBlock();
+    uint256 old_tip = ReadBestBlock();
     if (old_tip.IsNull()) {
         // We may be in the middle of replaying.
         std::vector<uint256> old_heads = GetHeadBlocks();
@@ -109,6 +135,24 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     batch.Erase(DB_BEST_BLOCK);
     batch.Write(DB_HEAD_BLOCKS, Vector(hashBlock, old_tip));
 
+    if (std::exchange(m_defer_next_write, false)) {
+        // Only mark the transition now, WritePending() writes the coins and marks the end of it.
+        if (!m_db->WriteBatch(batch)) return false;
+        for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+            if (it->second.flags & CCoinsCacheEntry::DIRTY) {
+                m_pending_coins_usage += it->second.coin.DynamicMemoryUsage();
+                m_pending.emplace(it->first, std::move(it->second.coin));
+                changed++;
+            }
+            count++;
+            it = mapCoins.erase(it);
+        }
+        m_pending_block = hashBlock;
+        LogPrint(BCLog::COINDB, "Deferred writing %u changed transaction outputs (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
+        // With nothing to write this completes the transition right away.
+        return m_pending.empty() ? WritePendingLocked(0) : true;
+    }
+
     for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
             CoinEntry entry(&it->first);
@@ -145,6 +189,73 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     return ret;
 }
 
+void CCoinsViewDB::DeferNextWrite()
+{
+    LOCK(m_pending_mutex);
+    m_defer_next_write = true;
+}
+
+bool CCoinsViewDB::WritePending(size_t max_bytes)
+{
+    LOCK(m_pending_mutex);
+    return WritePendingLocked(max_bytes);
+}
+
+bool CCoinsViewDB::WritePendingLocked(size_t max_bytes)
+{
+    if (m_pending_block.IsNull()) return true;
+
+    CDBBatch batch(*m_db);
+    const size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    size_t written_bytes = 0;
+    size_t written = 0;
+    // Pending coins are only erased under the lock after their batch is written, so lookups never miss them.
+    for (auto it = m_pending.begin(); it != m_pending.end() && (max_bytes == 0 || written_bytes + batch.SizeEstimate() < max_bytes);) {
+        CoinEntry entry(&it->first);
+        if (it->second.IsSpent()) {
+            batch.Erase(entry);
+        } else {
+            batch.Write(entry, it->second);
+        }
+        m_pending_coins_usage -= it->second.DynamicMemoryUsage();
+        it = m_pending.erase(it);
+        written++;
+        if (batch.SizeEstimate() > batch_size) {
+            LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
+            written_bytes += batch.SizeEstimate();
+            if (!m_db->WriteBatch(batch)) return false;
+            batch.Clear();
+        }
+    }
+
+    const bool complete = m_pending.empty();
+    if (complete) {
+        // In the last batch, mark the database as consistent with the flushed block again.
+        batch.Erase(DB_HEAD_BLOCKS);
+        batch.Write(DB_BEST_BLOCK, m_pending_block);
+    }
+    if (!m_db->WriteBatch(batch)) return false;
+    LogPrint(BCLog::COINDB, "Committed %u deferred transaction outputs to coin database, %u left\n", (unsigned int)written, (unsigned int)m_pending.size());
+    if (complete) {
+        m_pending_block.SetNull();
+        // Give the bucket array back as well
+        m_pending.rehash(0);
+    }
+    return true;
+}
+
+bool CCoinsViewDB::HasPending() const
+{
+    LOCK(m_pending_mutex);
+    return !m_pending_block.IsNull();
+}
+
+size_t CCoinsViewDB::PendingDynamicMemoryUsage() const
+{
+    LOCK(m_pending_mutex);
+    return memusage::DynamicUsage(m_pending) + m_pending_coins_usage;
+}
+
 size_t CCoinsViewDB::EstimateSize() const
 {
     return m_db->EstimateSize(DB_COIN, uint8_t(DB_COIN + 1));
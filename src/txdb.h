@@ -11,10 +11,12 @@
 #include <chain.h>
 #include <primitives/block.h>
 #include <spentindex.h>
+#include <sync.h>
 #include <timestampindex.h>
 
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -26,6 +28,8 @@ class uint256;
 static const int64_t nDefaultDbCache = 300;
 //! -dbbatchsize default (bytes)
 static const int64_t nDefaultDbBatchSize = 16 << 20;
+//! -incrementalflush default (MiB), 0 writes the whole coins cache at once
+static const int64_t DEFAULT_INCREMENTAL_FLUSH = 0;
 //! max. -dbcache (MiB)
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache (MiB)
@@ -51,6 +55,18 @@ protected:
     std::unique_ptr<CDBWrapper> m_db;
     fs::path m_ldb_path;
     bool m_is_memory;
+
+    mutable Mutex m_pending_mutex;
+    //! Coins handed over by a deferred BatchWrite() that are not written yet
+    std::unordered_map<COutPoint, Coin, SaltedOutpointHasher> m_pending GUARDED_BY(m_pending_mutex);
+    //! Block the pending coins belong to, null if nothing is pending
+    uint256 m_pending_block GUARDED_BY(m_pending_mutex);
+    //! Memory held by the scripts of the pending coins
+    size_t m_pending_coins_usage GUARDED_BY(m_pending_mutex){0};
+    bool m_defer_next_write GUARDED_BY(m_pending_mutex){false};
+
+    uint256 ReadBestBlock() const;
+    bool WritePendingLocked(size_t max_bytes) EXCLUSIVE_LOCKS_REQUIRED(m_pending_mutex);
 public:
     /**
      * @param[in] ldb_path    Location in the filesystem where leveldb data will be stored.
@@ -63,8 +79,22 @@ public:
     uint256 GetBestBlock() const override;
     std::vector<uint256> GetHeadBlocks() const override;
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    //! Only sees coins that are written, a pending incremental flush has to be completed first
     std::unique_ptr<CCoinsViewCursor> Cursor() const override;
 
+    /**
+     * Let the next BatchWrite() take over the dirty coins instead of writing them, for WritePending() to
+     * write them in bounded chunks while the caller carries on. Until the last chunk is written the
+     * database is marked as being in transition to the flushed block, exactly like during an interrupted
+     * BatchWrite(), so a crash is recovered by ReplayBlocks. Lookups see the pending coins, and any other
+     * BatchWrite() writes all of them first.
+     */
+    void DeferNextWrite() EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+    //! Write pending coins until about max_bytes were written, all of them if max_bytes is 0
+    bool WritePending(size_t max_bytes) EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+    bool HasPending() const EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+    size_t PendingDynamicMemoryUsage() const EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
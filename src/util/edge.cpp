@@ -15,6 +15,190 @@
 #include <sys/event.h>
 #endif
 
+#ifdef USE_IO_URING
+#include <sync.h>
+
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+/* Size of the submission queue, a full queue is flushed to the kernel before queueing more */
+constexpr unsigned URING_ENTRIES{256};
+/* user_data carries the socket in the low 32 bits and a registration generation above it */
+constexpr uint64_t URING_FD_MASK{0xffffffff};
+/* Set on the user_data of poll removals, their completions are not socket events */
+constexpr uint64_t URING_TAG_REMOVE{1ULL << 63};
+} // anonymous namespace
+
+struct EdgeTriggeredEvents::IOUring
+{
+    struct Registration {
+        /* user_data of the armed poll, unique per registration so stale completions can be told apart */
+        uint64_t user_data;
+        /* Multishot polls behave like EPOLLET, one-shot polls are re-armed after every completion
+         * which makes them level-triggered like the epoll registration of pipes and listening sockets */
+        bool multishot;
+    };
+
+    int fd{-1};
+    void* sq_ring{MAP_FAILED};
+    size_t sq_ring_size{0};
+    void* cq_ring{MAP_FAILED};
+    size_t cq_ring_size{0};
+    void* sqes_ptr{MAP_FAILED};
+    size_t sqes_size{0};
+
+    unsigned* sq_head{nullptr};
+    unsigned* sq_tail{nullptr};
+    unsigned* sq_array{nullptr};
+    unsigned sq_mask{0};
+    unsigned sq_entries{0};
+    io_uring_sqe* sqes{nullptr};
+
+    unsigned* cq_head{nullptr};
+    unsigned* cq_tail{nullptr};
+    unsigned cq_mask{0};
+    io_uring_cqe* cqes{nullptr};
+
+    /* Serializes writers of the submission queue, completions are only reaped by the socket handler */
+    Mutex m_mutex;
+    std::unordered_map<int, Registration> m_registered GUARDED_BY(m_mutex);
+    uint64_t m_generation GUARDED_BY(m_mutex){0};
+    /* Entries queued but not yet handed to the kernel */
+    unsigned m_queued GUARDED_BY(m_mutex){0};
+
+    ~IOUring()
+    {
+        if (sqes_ptr != MAP_FAILED) munmap(sqes_ptr, sqes_size);
+        if (cq_ring != MAP_FAILED) munmap(cq_ring, cq_ring_size);
+        if (sq_ring != MAP_FAILED) munmap(sq_ring, sq_ring_size);
+    }
+
+    bool Init(int ring_fd, const io_uring_params& params)
+    {
+        fd = ring_fd;
+        sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+
+        sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        cq_ring = mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        sqes_ptr = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqes_ptr == MAP_FAILED) return false;
+
+        auto* sq = static_cast<char*>(sq_ring);
+        sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_entries = params.sq_entries;
+        sqes = static_cast<io_uring_sqe*>(sqes_ptr);
+
+        auto* cq = static_cast<char*>(cq_ring);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    /* Hand all queued entries to the kernel, this doesn't wait for any of them to complete */
+    bool Submit() EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        while (m_queued > 0) {
+            const long ret = syscall(__NR_io_uring_enter, fd, m_queued, 0, 0, nullptr, 0);
+            if (ret < 0 && errno == EINTR) continue;
+            if (ret <= 0) return false;
+            m_queued -= std::min<unsigned>(m_queued, ret);
+        }
+        return true;
+    }
+
+    /* Claim the next free submission entry, zeroed, flushing the queue first if it's full */
+    io_uring_sqe* NextSqe() EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        const unsigned tail = *sq_tail;
+        if (tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries && !Submit()) return nullptr;
+        io_uring_sqe* sqe = &sqes[tail & sq_mask];
+        memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    /* Publish the entry returned by the last NextSqe() call */
+    void Commit() EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        const unsigned tail = *sq_tail;
+        sq_array[tail & sq_mask] = tail & sq_mask;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+        ++m_queued;
+    }
+
+    bool QueuePoll(int entity, const Registration& reg) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        io_uring_sqe* sqe = NextSqe();
+        if (sqe == nullptr) return false;
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = entity;
+        sqe->poll32_events = reg.multishot ? (POLLIN | POLLOUT | POLLERR | POLLHUP) : POLLIN;
+        sqe->len = reg.multishot ? IORING_POLL_ADD_MULTI : 0;
+        sqe->user_data = reg.user_data;
+        Commit();
+        return true;
+    }
+
+    bool QueueRemove(const Registration& reg) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        io_uring_sqe* sqe = NextSqe();
+        if (sqe == nullptr) return false;
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = reg.user_data;
+        sqe->user_data = reg.user_data | URING_TAG_REMOVE;
+        Commit();
+        return true;
+    }
+
+    bool Register(int entity, bool multishot) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        const Registration reg{(++m_generation << 32) | (static_cast<uint64_t>(entity) & URING_FD_MASK), multishot};
+        if (!m_registered.emplace(entity, reg).second) {
+            errno = EEXIST;
+            return false;
+        }
+        if (!QueuePoll(entity, reg) || !Submit()) {
+            m_registered.erase(entity);
+            return false;
+        }
+        return true;
+    }
+
+    bool Unregister(int entity) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        const auto it = m_registered.find(entity);
+        if (it == m_registered.end()) {
+            errno = ENOENT;
+            return false;
+        }
+        const Registration reg{it->second};
+        m_registered.erase(it);
+        // Submitted right away and under the lock, the poll must be gone before the caller closes the socket
+        return QueueRemove(reg) && Submit();
+    }
+};
+#else
+struct EdgeTriggeredEvents::IOUring {};
+#endif /* USE_IO_URING */
+
 EdgeTriggeredEvents::EdgeTriggeredEvents(SocketEventsMode events_mode)
     : m_mode(events_mode)
 {
@@ -42,6 +226,37 @@ EdgeTriggeredEvents::EdgeTriggeredEvents(SocketEventsMode events_mode)
         LogPrintf("Attempting to initialize EdgeTriggeredEvents for kqueue without support compiled in!\n");
         return;
 #endif /* USE_KQUEUE */
+    } else if (m_mode == SocketEventsMode::IOUring) {
+#ifdef USE_IO_URING
+        io_uring_params params{};
+        m_fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+        if (m_fd == -1) {
+            LogPrintf("Unable to initialize EdgeTriggeredEvents, io_uring_setup returned -1 with error %s\n",
+                      NetworkErrorString(WSAGetLastError()));
+            return;
+        }
+        // Multishot polls and waiting with a timeout (IORING_FEAT_EXT_ARG) arrived by Linux 5.13, which is
+        // also the release that introduced IORING_FEAT_RSRC_TAGS, so use the latter to detect the former
+        auto uring = std::make_unique<IOUring>();
+        if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_RSRC_TAGS)) {
+            LogPrintf("Unable to initialize EdgeTriggeredEvents, io_uring lacks multishot poll support (Linux 5.13+ required)\n");
+            close(m_fd);
+            m_fd = -1;
+            return;
+        }
+        if (!uring->Init(m_fd, params)) {
+            LogPrintf("Unable to initialize EdgeTriggeredEvents, mapping io_uring rings failed with error %s\n",
+                      NetworkErrorString(WSAGetLastError()));
+            uring.reset();
+            close(m_fd);
+            m_fd = -1;
+            return;
+        }
+        m_uring = std::move(uring);
+#else
+        LogPrintf("Attempting to initialize EdgeTriggeredEvents for io_uring without support compiled in!\n");
+        return;
+#endif /* USE_IO_URING */
     } else {
         assert(false);
     }
@@ -51,14 +266,14 @@ EdgeTriggeredEvents::EdgeTriggeredEvents(SocketEventsMode events_mode)
 EdgeTriggeredEvents::~EdgeTriggeredEvents()
 {
     if (m_valid) {
-#if defined(USE_KQUEUE) || defined(USE_EPOLL)
+#if defined(USE_KQUEUE) || defined(USE_EPOLL) || defined(USE_IO_URING)
         if (close(m_fd) != 0) {
             LogPrintf("Destroying EdgeTriggeredEvents instance, close() failed for m_fd = %d with error %s\n", m_fd,
                       NetworkErrorString(WSAGetLastError()));
         }
 #else
         assert(false);
-#endif /* defined(USE_KQUEUE) || defined(USE_EPOLL) */
+#endif /* defined(USE_KQUEUE) || defined(USE_EPOLL) || defined(USE_IO_URING) */
     }
 }
 
@@ -91,6 +306,16 @@ bool EdgeTriggeredEvents::RegisterEntity(int entity, const std::string& entity_n
 #else
         assert(false);
 #endif /* USE_KQUEUE */
+    } else if (m_mode == SocketEventsMode::IOUring) {
+#ifdef USE_IO_URING
+        if (!m_uring->Register(entity, /*multishot=*/false)) {
+            LogPrintf("Failed to add %s to io_uring fd (poll submission returned error %s)\n", entity_name,
+                      NetworkErrorString(WSAGetLastError()));
+            return false;
+        }
+#else
+        assert(false);
+#endif /* USE_IO_URING */
     } else {
         assert(false);
     }
@@ -123,6 +348,16 @@ bool EdgeTriggeredEvents::UnregisterEntity(int entity, const std::string& entity
 #else
         assert(false);
 #endif /* USE_KQUEUE */
+    } else if (m_mode == SocketEventsMode::IOUring) {
+#ifdef USE_IO_URING
+        if (!m_uring->Unregister(entity)) {
+            LogPrintf("Failed to remove %s from io_uring fd (poll removal returned error %s)\n", entity_name,
+                      NetworkErrorString(WSAGetLastError()));
+            return false;
+        }
+#else
+        assert(false);
+#endif /* USE_IO_URING */
     } else {
         assert(false);
     }
@@ -194,6 +429,17 @@ bool EdgeTriggeredEvents::RegisterEvents(SOCKET socket) const
 #else
         assert(false);
 #endif /* USE_KQUEUE */
+    } else if (m_mode == SocketEventsMode::IOUring) {
+#ifdef USE_IO_URING
+        // Multishot poll keeps reporting readiness changes like EPOLLET, so sockets still have to be drained
+        if (!m_uring->Register(socket, /*multishot=*/true)) {
+            LogPrintf("Failed to register events for socket -- io_uring poll on %d for socket %d returned error: %s\n",
+                      m_fd, socket, NetworkErrorString(WSAGetLastError()));
+            return false;
+        }
+#else
+        assert(false);
+#endif /* USE_IO_URING */
     } else {
         assert(false);
     }
@@ -232,8 +478,76 @@ bool EdgeTriggeredEvents::UnregisterEvents(SOCKET socket) const
 #else
         assert(false);
 #endif /* USE_KQUEUE */
+    } else if (m_mode == SocketEventsMode::IOUring) {
+#ifdef USE_IO_URING
+        if (!m_uring->Unregister(socket)) {
+            LogPrintf("Failed to unregister events for socket -- io_uring poll removal on %d for socket %d returned error: %s\n",
+                      m_fd, socket, NetworkErrorString(WSAGetLastError()));
+            return false;
+        }
+#else
+        assert(false);
+#endif /* USE_IO_URING */
     } else {
         assert(false);
     }
     return true;
 }
+
+bool EdgeTriggeredEvents::WaitEvents(std::vector<std::pair<SOCKET, uint32_t>>& events, std::chrono::milliseconds timeout) const
+{
+    assert(m_valid && m_mode == SocketEventsMode::IOUring);
+
+#ifdef USE_IO_URING
+    IOUring& uring = *m_uring;
+    if (timeout.count() > 0 && __atomic_load_n(uring.cq_tail, __ATOMIC_ACQUIRE) == *uring.cq_head) {
+        __kernel_timespec ts{};
+        ts.tv_sec = timeout.count() / 1000;
+        ts.tv_nsec = (timeout.count() % 1000) * 1000000;
+        io_uring_getevents_arg arg{};
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+        // Only waits, submissions are always made under m_mutex by whoever queued them
+        if (syscall(__NR_io_uring_enter, m_fd, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg)) < 0 &&
+            errno != ETIME && errno != EINTR && errno != EBUSY) {
+            LogPrintf("Failed to wait for io_uring completions -- io_uring_enter(%d, ...) returned error: %s\n",
+                      m_fd, NetworkErrorString(WSAGetLastError()));
+            return false;
+        }
+    }
+
+    // Completions are only consumed here, by the socket handler thread of the owning shard
+    std::vector<uint64_t> finished;
+    unsigned head = *uring.cq_head;
+    const unsigned tail = __atomic_load_n(uring.cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+        const io_uring_cqe& cqe = uring.cqes[head & uring.cq_mask];
+        if (cqe.user_data & URING_TAG_REMOVE) continue;
+        if (cqe.res == -ECANCELED) continue;
+        const SOCKET socket = static_cast<SOCKET>(cqe.user_data & URING_FD_MASK);
+        events.emplace_back(socket, cqe.res < 0 ? uint32_t{POLLERR} : static_cast<uint32_t>(cqe.res));
+        if (!(cqe.flags & IORING_CQE_F_MORE)) finished.push_back(cqe.user_data);
+    }
+    __atomic_store_n(uring.cq_head, head, __ATOMIC_RELEASE);
+
+    if (!finished.empty()) {
+        LOCK(uring.m_mutex);
+        for (const uint64_t user_data : finished) {
+            // Re-arm one-shot polls and multishot polls the kernel terminated, unless the socket was
+            // unregistered (and possibly its descriptor reused) in the meantime
+            const auto it = uring.m_registered.find(static_cast<int>(user_data & URING_FD_MASK));
+            if (it == uring.m_registered.end() || it->second.user_data != user_data) continue;
+            if (!uring.QueuePoll(it->first, it->second)) return false;
+        }
+        if (!uring.Submit()) {
+            LogPrintf("Failed to re-arm io_uring polls -- io_uring_enter(%d, ...) returned error: %s\n",
+                      m_fd, NetworkErrorString(WSAGetLastError()));
+            return false;
+        }
+    }
+    return true;
+#else
+    assert(false);
+    return false;
+#endif /* USE_IO_URING */
+}
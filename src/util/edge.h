@@ -8,14 +8,18 @@
 #include <compat.h>
 
 #include <assert.h>
+#include <chrono>
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 enum class SocketEventsMode : int8_t;
 
 /**
  * A manager for abstracting logic surrounding edge-triggered socket events
- * modes like kqueue and epoll.
+ * modes like kqueue, epoll and io_uring.
  */
 class EdgeTriggeredEvents
 {
@@ -36,6 +40,9 @@ public:
     /* Unregister events for socket */
     bool UnregisterEvents(SOCKET socket) const;
 
+    /* io_uring only: wait up to timeout for poll completions, returns pairs of socket and poll(2) style revents */
+    bool WaitEvents(std::vector<std::pair<SOCKET, uint32_t>>& events, std::chrono::milliseconds timeout) const;
+
 private:
     friend class WakeupPipe;
     /* Register wakeup pipe with EdgeTriggeredEvents instance */
@@ -47,6 +54,9 @@ private:
     bool RegisterEntity(int entity, const std::string& entity_name) const;
     bool UnregisterEntity(int entity, const std::string& entity_name) const;
 
+    /* Submission and completion rings of an io_uring instance */
+    struct IOUring;
+
 private:
     /* Flag set if pipe has been registered with instance */
     bool m_pipe_registered{false};
@@ -56,6 +66,8 @@ private:
     SocketEventsMode m_mode;
     /* File descriptor used to interact with events mode */
     int m_fd{-1};
+    /* Rings mapped from m_fd, io_uring mode only */
+    std::unique_ptr<IOUring> m_uring;
 };
 
 #endif /* BITCOIN_UTIL_EDGE_H */
@@ -0,0 +1,44 @@
+// Copyright (c) 2024 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <util/mappedfile.h>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::unique_ptr<const MappedFile> MappedFile::Open(const fs::path& path)
+{
+#ifdef WIN32
+    return nullptr;
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return nullptr;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return nullptr;
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    void* addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        return nullptr;
+    }
+    return std::unique_ptr<const MappedFile>(new MappedFile(static_cast<const unsigned char*>(addr), size));
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef WIN32
+    ::munmap(const_cast<unsigned char*>(m_data), m_size);
+#endif
+}
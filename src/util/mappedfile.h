@@ -0,0 +1,42 @@
+// Copyright (c) 2024 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_UTIL_MAPPEDFILE_H
+#define BITCOIN_UTIL_MAPPEDFILE_H
+
+#include <fs.h>
+#include <span.h>
+
+#include <cstddef>
+#include <memory>
+
+/**
+ * A read-only memory mapping of a whole file, as large as the file was when it was mapped.
+ *
+ * The mapping is shared with the page cache, so data appended to the file later shows up in the
+ * mapped range once written, but the range itself doesn't grow. Reading parts of the range the
+ * file was truncated away from is fatal (SIGBUS), so callers only touch data they know to exist.
+ * Not available on Windows, where Open() always fails.
+ */
+class MappedFile
+{
+public:
+    /** Map the file at path, nullptr if it can't be opened or mapped, or is empty */
+    static std::unique_ptr<const MappedFile> Open(const fs::path& path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    Span<const unsigned char> Data() const { return {m_data, m_size}; }
+    size_t Size() const { return m_size; }
+
+private:
+    MappedFile(const unsigned char* data, size_t size) : m_data(data), m_size(size) {}
+
+    const unsigned char* const m_data;
+    const size_t m_size;
+};
+
+#endif // BITCOIN_UTIL_MAPPEDFILE_H
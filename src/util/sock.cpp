@@ -19,6 +19,10 @@
 #include <locale>
 #endif
 
+#ifndef WIN32
+#include <sys/uio.h>
+#endif
+
 #ifdef USE_POLL
 #include <poll.h>
 #endif
@@ -64,6 +68,24 @@ ssize_t Sock::Send(const void* data, size_t len, int flags) const
     return send(m_socket, static_cast<const char*>(data), len, flags);
 }
 
+ssize_t Sock::SendMany(const std::vector<Span<const unsigned char>>& buffers, int flags) const
+{
+    if (buffers.empty()) return 0;
+#ifdef WIN32
+    return Send(buffers.front().data(), buffers.front().size(), flags);
+#else
+    std::vector<iovec> iov(buffers.size());
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        iov[i].iov_base = const_cast<unsigned char*>(buffers[i].data());
+        iov[i].iov_len = buffers[i].size();
+    }
+    msghdr msg{};
+    msg.msg_iov = iov.data();
+    msg.msg_iovlen = iov.size();
+    return sendmsg(m_socket, &msg, flags);
+#endif
+}
+
 ssize_t Sock::Recv(void* buf, size_t len, int flags) const
 {
     return recv(m_socket, static_cast<char*>(buf), len, flags);
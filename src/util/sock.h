@@ -6,12 +6,14 @@
 #define BITCOIN_UTIL_SOCK_H
 
 #include <compat.h>
+#include <span.h>
 #include <threadinterrupt.h>
 #include <util/time.h>
 
 #include <chrono>
 #include <memory>
 #include <string>
+#include <vector>
 
 /**
  * Maximum time to wait for I/O readiness.
@@ -24,6 +26,7 @@ enum class SocketEventsMode : int8_t {
     Poll = 1,
     EPoll = 2,
     KQueue = 3,
+    IOUring = 4,
 
     Unknown = -1
 };
@@ -46,6 +49,10 @@ static std::string SEMToString(const SocketEventsMode val)
         case (SocketEventsMode::KQueue):
             return "kqueue";
 #endif /* USE_KQUEUE */
+#ifdef USE_IO_URING
+        case (SocketEventsMode::IOUring):
+            return "iouring";
+#endif /* USE_IO_URING */
         default:
             return "unknown";
     };
@@ -64,6 +71,9 @@ static SocketEventsMode SEMFromString(const std::string str)
 #ifdef USE_KQUEUE
     else if (str == "kqueue") { return SocketEventsMode::KQueue; }
 #endif /* USE_KQUEUE */
+#ifdef USE_IO_URING
+    else if (str == "iouring") { return SocketEventsMode::IOUring; }
+#endif /* USE_IO_URING */
     else { return SocketEventsMode::Unknown; }
 }
 
@@ -133,6 +143,13 @@ public:
      */
     [[nodiscard]] virtual ssize_t Send(const void* data, size_t len, int flags) const;
 
+    /**
+     * sendmsg(2) wrapper, sends the buffers in order with a single system call. Where sendmsg(2) is
+     * not available only the first buffer is sent, callers have to cope with partial sends anyway.
+     * Code that uses this wrapper can be unit tested if this method is overridden by a mock Sock implementation.
+     */
+    [[nodiscard]] virtual ssize_t SendMany(const std::vector<Span<const unsigned char>>& buffers, int flags) const;
+
     /**
      * recv(2) wrapper. Equivalent to `recv(this->Get(), buf, len, flags);`. Code that uses this
      * wrapper can be unit tested if this method is overridden by a mock Sock implementation.
@@ -16,6 +16,8 @@
 #include <consensus/tx_check.h>
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
+#include <crypto/common.h>
+#include <ctpl_stl.h>
 #include <cuckoocache.h>
 #include <deploymentstatus.h>
 #include <flatfile.h>
@@ -46,6 +48,7 @@
 #include <undo.h>
 #include <util/check.h> // For NDEBUG compile time check
 #include <util/hasher.h>
+#include <util/mappedfile.h>
 #include <util/strencodings.h>
 #include <util/translation.h>
 #include <util/system.h>
@@ -68,7 +71,9 @@
 
 #include <statsd_client.h>
 
+#include <algorithm>
 #include <deque>
+#include <future>
 #include <numeric>
 #include <optional>
 #include <string>
@@ -1312,6 +1317,7 @@ CChainState::CChainState(CTxMemPool* mempool,
       m_evoDb(evoDb),
       m_blockman(blockman),
       m_spork_manager(spork_manager),
+      m_evodb_best_block_key(from_snapshot_blockhash ? EVODB_SNAPSHOT_BEST_BLOCK : EVODB_BEST_BLOCK),
       m_from_snapshot_blockhash(from_snapshot_blockhash) {}
 
 void CChainState::InitCoinsDB(
@@ -1771,7 +1777,7 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
     assert(m_chain_helper);
 
     bool fDIP0003Active = pindex->nHeight >= Params().GetConsensus().DIP0003Height;
-    if (fDIP0003Active && !m_evoDb.VerifyBestBlock(pindex->GetBlockHash())) {
+    if (fDIP0003Active && !m_evoDb.VerifyBestBlock(pindex->GetBlockHash(), m_evodb_best_block_key)) {
         // Nodes that upgraded after DIP3 activation will have to reindex to ensure evodb consistency
         AbortNode("Found EvoDB inconsistency, you must reindex to continue");
         return DISCONNECT_FAILED;
@@ -1911,9 +1917,9 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
 
     // move best block pointer to prevout block
     view.SetBestBlock(pindex->pprev->GetBlockHash());
-    m_evoDb.WriteBestBlock(pindex->pprev->GetBlockHash());
+    m_evoDb.WriteBestBlock(pindex->pprev->GetBlockHash(), m_evodb_best_block_key);
 
-    if (mnlist_updates_opt.has_value()) {
+    if (mnlist_updates_opt.has_value() && !m_background_validation) {
         auto mnlu = mnlist_updates_opt.value();
         GetMainSignals().NotifyMasternodeListChanged(true, mnlu.old_list, mnlu.diff);
         uiInterface.NotifyMasternodeListChanged(mnlu.new_list, pindex->pprev);
@@ -1938,6 +1944,8 @@ static void FlushBlockFile(bool fFinalize = false, bool finalize_undo = false)
 {
     LOCK(cs_LastBlockFile);
     FlatFilePos block_pos_old(nLastBlockFile, vinfoBlockFile[nLastBlockFile].nSize);
+    // Finalizing truncates the file, a mapping reaching past the new end must not be read from anymore
+    if (fFinalize) UnmapBlockFile(nLastBlockFile);
     if (!BlockFileSeq().Flush(block_pos_old, fFinalize)) {
         AbortNode("Flushing block file to disk failed. This is likely the result of an I/O error.");
     }
@@ -1975,7 +1983,7 @@ static bool WriteUndoDataForBlock(const CBlockUndo& blockundo, BlockValidationSt
     return true;
 }
 
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+static CWorkStealingCheckQueue<CScriptCheck> scriptcheckqueue(128);
 
 void StartScriptCheckWorkerThreads(int threads_num)
 {
@@ -1987,6 +1995,73 @@ void StopScriptCheckWorkerThreads()
     scriptcheckqueue.StopWorkerThreads();
 }
 
+static ctpl::thread_pool g_input_prefetch_pool;
+
+void StartInputPrefetchThreads(int threads_num)
+{
+    g_input_prefetch_pool.resize(threads_num);
+    RenameThreadPool(g_input_prefetch_pool, "prefetch");
+}
+
+void StopInputPrefetchThreads()
+{
+    g_input_prefetch_pool.clear_queue();
+    g_input_prefetch_pool.stop(true);
+}
+
+/**
+ * Read the coins spent by a block that aren't cached yet from the database on the prefetch threads and add them to
+ * the cache, so ConnectBlock doesn't wait for one cold read after the other. Coins that can't be read are left to
+ * ConnectBlock, which deals with missing ones and read errors as before.
+ */
+static void PrefetchBlockInputs(const CBlock& block, CCoinsViewCache& cache, const CCoinsView& db)
+{
+    const int threads = g_input_prefetch_pool.size();
+    if (threads == 0) return;
+
+    std::unordered_set<uint256, SaltedTxidHasher> block_txids;
+    block_txids.reserve(block.vtx.size());
+    for (const auto& tx : block.vtx) {
+        block_txids.insert(tx->GetHash());
+    }
+    std::vector<COutPoint> missing;
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase()) continue;
+        for (const CTxIn& txin : tx->vin) {
+            if (block_txids.count(txin.prevout.hash) == 0 && !cache.HaveCoinInCache(txin.prevout)) {
+                missing.push_back(txin.prevout);
+            }
+        }
+    }
+    if (missing.size() < MIN_PREFETCH_INPUTS) return;
+
+    const size_t per_thread = (missing.size() + threads - 1) / threads;
+    std::vector<std::future<std::vector<std::pair<COutPoint, Coin>>>> futures;
+    for (size_t begin = 0; begin < missing.size(); begin += per_thread) {
+        const size_t end = std::min(begin + per_thread, missing.size());
+        futures.push_back(g_input_prefetch_pool.push([&missing, &db, begin, end](int) {
+            std::vector<std::pair<COutPoint, Coin>> fetched;
+            fetched.reserve(end - begin);
+            try {
+                for (size_t i = begin; i < end; ++i) {
+                    Coin coin;
+                    if (db.GetCoin(missing[i], coin)) {
+                        fetched.emplace_back(missing[i], std::move(coin));
+                    }
+                }
+            } catch (const std::exception&) {
+                // ConnectBlock reads the rest and reports the failure
+            }
+            return fetched;
+        }));
+    }
+    for (auto& future : futures) {
+        for (auto& [outpoint, coin] : future.get()) {
+            cache.CacheFetchedCoin(outpoint, std::move(coin));
+        }
+    }
+}
+
 bool GetBlockHash(const CChain& active_chain, uint256& hashRet, int nBlockHeight)
 {
     LOCK(cs_main);
@@ -2135,7 +2210,7 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
 
     if (pindex->pprev) {
         bool fDIP0003Active = pindex->nHeight >= m_params.GetConsensus().DIP0003Height;
-        if (fDIP0003Active && !m_evoDb.VerifyBestBlock(pindex->pprev->GetBlockHash())) {
+        if (fDIP0003Active && !m_evoDb.VerifyBestBlock(pindex->pprev->GetBlockHash(), m_evodb_best_block_key)) {
             // Nodes that upgraded after DIP3 activation will have to reindex to ensure evodb consistency
             return AbortNode(state, "Found EvoDB inconsistency, you must reindex to continue");
         }
@@ -2251,7 +2326,7 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
     // in multiple threads). Preallocate the vector size so a new allocation
     // doesn't invalidate pointers into the vector, and keep txsdata in scope
     // for as long as `control`.
-    CCheckQueueControl<CScriptCheck> control(fScriptChecks && g_parallel_script_checks ? &scriptcheckqueue : nullptr);
+    CCheckQueueControl<CScriptCheck, CWorkStealingCheckQueue<CScriptCheck>> control(fScriptChecks && g_parallel_script_checks ? &scriptcheckqueue : nullptr);
     std::vector<PrecomputedTransactionData> txsdata(block.vtx.size());
 
     std::vector<int> prevheights;
@@ -2527,9 +2602,9 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
     assert(pindex->phashBlock);
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
-    m_evoDb.WriteBestBlock(pindex->GetBlockHash());
+    m_evoDb.WriteBestBlock(pindex->GetBlockHash(), m_evodb_best_block_key);
 
-    if (mnlist_updates_opt.has_value()) {
+    if (mnlist_updates_opt.has_value() && !m_background_validation) {
         auto mnlu = mnlist_updates_opt.value();
         GetMainSignals().NotifyMasternodeListChanged(false, mnlu.old_list, mnlu.diff);
         uiInterface.NotifyMasternodeListChanged(mnlu.new_list, pindex);
@@ -2592,6 +2667,7 @@ bool CChainState::FlushStateToDisk(
 
     const size_t coins_count = CoinsTip().GetCacheSize();
     const size_t coins_mem_usage = CoinsTip().DynamicMemoryUsage();
+    const size_t incremental_flush_bytes = std::max<int64_t>(0, gArgs.GetArg("-incrementalflush", DEFAULT_INCREMENTAL_FLUSH)) << 20;
 
     try {
     {
@@ -2688,12 +2764,29 @@ bool CChainState::FlushStateToDisk(
             }
             nLastWrite = nNow;
         }
+        // Write the next chunk of an incremental flush, the rest waits for the following calls.
+        if (!fDoFullFlush && CoinsDB().HasPending()) {
+            LOG_TIME_MILLIS_WITH_CATEGORY("write coins chunk to disk", BCLog::BENCHMARK);
+            if (!CoinsDB().WritePending(incremental_flush_bytes)) {
+                return AbortNode(state, "Failed to write to coin database");
+            }
+        }
         // Flush best chain related state. This can only be done if the blocks / block index write was also done.
         if (fDoFullFlush && !CoinsTip().GetBestBlock().IsNull()) {
             {
                 LOG_TIME_SECONDS(strprintf("write coins cache to disk (%d coins, %.2fkB)",
                     coins_count, coins_mem_usage / 1000));
 
+                // Unless the caller needs the coins on disk now, hand them to the database to be written in
+                // chunks by the next calls. That's only done when the database transitions along the active
+                // chain (ReplayBlocks can then skip EvoDB, which is committed below) and the blocks needed to
+                // replay it can't be pruned meanwhile.
+                const CBlockIndex* pindexDB = m_blockman.LookupBlockIndex(CoinsDB().GetBestBlock());
+                if (incremental_flush_bytes > 0 && mode != FlushStateMode::ALWAYS && !fPruneMode &&
+                    pindexDB != nullptr && m_chain.Contains(pindexDB)) {
+                    CoinsDB().DeferNextWrite();
+                }
+
                 // Typical Coin structures on disk are around 48 bytes in size.
                 // Pushing a new one to the database can cause it to be written
                 // twice (once in the log, and once in the tables). This is already
@@ -2716,7 +2809,7 @@ bool CChainState::FlushStateToDisk(
             full_flush_completed = true;
         }
     }
-    if (full_flush_completed) {
+    if (full_flush_completed && !m_background_validation) {
         // Update best block in wallet (so we can detect restored wallets).
         GetMainSignals().ChainStateFlushed(m_chain.GetLocator());
     }
@@ -2768,7 +2861,7 @@ void CChainState::UpdateTip(const CBlockIndex* pindexNew)
         m_mempool->AddTransactionsUpdated(1);
     }
 
-    {
+    if (!m_background_validation) {
         LOCK(g_best_block_mutex);
         g_best_block = pindexNew->GetBlockHash();
         g_best_block_cv.notify_all();
@@ -2860,11 +2953,12 @@ bool CChainState::DisconnectTip(BlockValidationState& state, DisconnectedBlockTr
     UpdateTip(pindexDelete->pprev);
     // Let wallets know transactions went from 1-confirmed to
     // 0-confirmed or conflicted:
-    GetMainSignals().BlockDisconnected(pblock, pindexDelete);
+    if (!m_background_validation) GetMainSignals().BlockDisconnected(pblock, pindexDelete);
     return true;
 }
 
 static int64_t nTimeReadFromDisk = 0;
+static int64_t nTimePrefetch = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
@@ -2940,6 +3034,10 @@ bool CChainState::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew
     int64_t nTime3;
     LogPrint(BCLog::BENCHMARK, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
     {
+        PrefetchBlockInputs(blockConnecting, CoinsTip(), CoinsDB());
+        int64_t nTime2_1 = GetTimeMicros(); nTimePrefetch += nTime2_1 - nTime2;
+        LogPrint(BCLog::BENCHMARK, "    - Prefetch inputs: %.2fms [%.2fs]\n", (nTime2_1 - nTime2) * MILLI, nTimePrefetch * MICRO);
+
         auto dbTx = m_evoDb.BeginTransaction();
 
         CCoinsViewCache view(&CoinsTip());
@@ -3253,7 +3351,7 @@ bool CChainState::ActivateBestChain(BlockValidationState& state, CSporkManager&
 
                 for (const PerBlockConnectTrace& trace : connectTrace.GetBlocksConnected()) {
                     assert(trace.pblock && trace.pindex);
-                    GetMainSignals().BlockConnected(trace.pblock, trace.pindex);
+                    if (!m_background_validation) GetMainSignals().BlockConnected(trace.pblock, trace.pindex);
                 }
             } while (!m_chain.Tip() || (starting_tip && CBlockIndexWorkComparator()(m_chain.Tip(), starting_tip)));
             if (!blocks_connected) return true;
@@ -3263,7 +3361,7 @@ bool CChainState::ActivateBestChain(BlockValidationState& state, CSporkManager&
 
             // Notify external listeners about the new tip.
             // Enqueue while holding cs_main to ensure that UpdatedBlockTip is called in the order in which blocks are connected
-            if (pindexFork != pindexNewTip) {
+            if (pindexFork != pindexNewTip && !m_background_validation) {
                 // Notify ValidationInterface subscribers
                 GetMainSignals().SynchronousUpdatedBlockTip(pindexNewTip, pindexFork, fInitialDownload);
                 GetMainSignals().UpdatedBlockTip(pindexNewTip, pindexFork, fInitialDownload);
@@ -4319,6 +4417,8 @@ bool ChainstateManager::ProcessNewBlock(const CChainParams& chainparams, const s
     if (!ActiveChainstate().ActivateBestChain(state, spork_manager, pblock))
         return error("%s: ActivateBestChain failed: %s", __func__, state.ToString());
 
+    ActivateBackgroundChainstate(spork_manager);
+
     LogPrintf("%s : ACCEPTED\n", __func__);
     return true;
 }
@@ -4431,6 +4531,7 @@ void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
 {
     for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         FlatFilePos pos(*it, 0);
+        UnmapBlockFile(*it);
         fs::remove(BlockFileSeq().FileName(pos));
         fs::remove(UndoFileSeq().FileName(pos));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -4873,7 +4974,7 @@ bool CVerifyDB::VerifyDB(
 }
 
 /** Apply the effects of a block on the utxo cache, ignoring that it may already have been applied. */
-bool CChainState::RollforwardBlock(const CBlockIndex* pindex, CCoinsViewCache& inputs)
+bool CChainState::RollforwardBlock(const CBlockIndex* pindex, CCoinsViewCache& inputs, bool fProcessSpecialTxs)
 {
     assert(m_chain_helper);
 
@@ -4886,7 +4987,7 @@ bool CChainState::RollforwardBlock(const CBlockIndex* pindex, CCoinsViewCache& i
     // MUST process special txes before updating UTXO to ensure consistency between mempool and block processing
     BlockValidationState state;
     std::optional<MNListUpdates> mnlist_updates_opt{std::nullopt};
-    if (!m_chain_helper->special_tx->ProcessSpecialTxsInBlock(block, pindex, inputs, false /*fJustCheck*/, false /*fScriptChecks*/, state, mnlist_updates_opt)) {
+    if (fProcessSpecialTxs && !m_chain_helper->special_tx->ProcessSpecialTxsInBlock(block, pindex, inputs, false /*fJustCheck*/, false /*fScriptChecks*/, state, mnlist_updates_opt)) {
         return error("RollforwardBlock(Sparks): ProcessSpecialTxsInBlock for block %s failed with %s",
             pindex->GetBlockHash().ToString(), state.ToString());
     }
@@ -4995,6 +5096,7 @@ bool CChainState::ReplayBlocks()
     const CBlockIndex* pindexOld = nullptr;  // Old tip during the interrupted flush.
     const CBlockIndex* pindexNew;            // New tip during the interrupted flush.
     const CBlockIndex* pindexFork = nullptr; // Latest block common to both the old and the new tip.
+    bool fEvoDbAtNew = false;                // Special transactions of the replayed blocks are in EvoDB already.
 
     if (m_blockman.m_block_index.count(hashHeads[0]) == 0) {
         return error("ReplayBlocks(): reorganization to unknown block requested");
@@ -5008,8 +5110,10 @@ bool CChainState::ReplayBlocks()
         pindexOld = m_blockman.m_block_index[hashHeads[1]];
         pindexFork = LastCommonAncestor(pindexOld, pindexNew);
         assert(pindexFork != nullptr);
+        // An interrupted incremental flush only moves forward and has EvoDB committed at the new tip already
+        fEvoDbAtNew = pindexFork == pindexOld && m_evoDb.VerifyBestBlock(pindexNew->GetBlockHash(), m_evodb_best_block_key);
         const bool fDIP0003Active = pindexOld->nHeight >= m_params.GetConsensus().DIP0003Height;
-        if (fDIP0003Active && !m_evoDb.VerifyBestBlock(pindexOld->GetBlockHash())) {
+        if (fDIP0003Active && !fEvoDbAtNew && !m_evoDb.VerifyBestBlock(pindexOld->GetBlockHash(), m_evodb_best_block_key)) {
             return error("ReplayBlocks(Sparks): Found EvoDB inconsistency");
         }
     }
@@ -5042,11 +5146,11 @@ bool CChainState::ReplayBlocks()
         const CBlockIndex* pindex = pindexNew->GetAncestor(nHeight);
         LogPrintf("Rolling forward %s (%i)\n", pindex->GetBlockHash().ToString(), nHeight);
         uiInterface.ShowProgress(_("Replaying blocks…").translated, (int) ((nHeight - nForkHeight) * 100.0 / (pindexNew->nHeight - nForkHeight)) , false);
-        if (!RollforwardBlock(pindex, cache)) return false;
+        if (!RollforwardBlock(pindex, cache, /*fProcessSpecialTxs=*/!fEvoDbAtNew)) return false;
     }
 
     cache.SetBestBlock(pindexNew->GetBlockHash());
-    m_evoDb.WriteBestBlock(pindexNew->GetBlockHash());
+    m_evoDb.WriteBestBlock(pindexNew->GetBlockHash(), m_evodb_best_block_key);
     bool flushed = cache.Flush();
     assert(flushed);
     dbTx->Commit();
@@ -5158,10 +5262,78 @@ bool CChainState::LoadGenesisBlock()
     return true;
 }
 
+/** Disk positions of blocks with unknown parent found by the block import, by parent hash (only used for reindex) */
+static std::multimap<uint256, FlatFilePos> mapBlocksUnknownParent;
+
+bool CChainState::ProcessImportedBlock(const std::shared_ptr<CBlock>& pblock, const uint256& hash, CSporkManager& spork_manager, FlatFilePos* dbp, int& nLoaded)
+{
+    const CBlock& block = *pblock;
+    {
+        LOCK(cs_main);
+        // detect out of order blocks, and store them for later
+        if (hash != m_params.GetConsensus().hashGenesisBlock && !m_blockman.LookupBlockIndex(block.hashPrevBlock)) {
+            LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
+                    block.hashPrevBlock.ToString());
+            if (dbp)
+                mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
+            return true;
+        }
+
+        // process in case the block isn't known yet
+        CBlockIndex* pindex = m_blockman.LookupBlockIndex(hash);
+        if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
+          BlockValidationState state;
+          if (AcceptBlock(pblock, state, nullptr, true, dbp, nullptr)) {
+              nLoaded++;
+          }
+          if (state.IsError()) {
+              return false;
+          }
+        } else if (hash != m_params.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
+            LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
+        }
+    }
+
+    // Activate the genesis block so normal node progress can continue
+    if (hash == m_params.GetConsensus().hashGenesisBlock) {
+        BlockValidationState state;
+        if (!ActivateBestChain(state, spork_manager, nullptr)) {
+            return false;
+        }
+    }
+
+    NotifyHeaderTip(*this);
+
+    // Recursively process earlier encountered successors of this block
+    std::deque<uint256> queue;
+    queue.push_back(hash);
+    while (!queue.empty()) {
+        uint256 head = queue.front();
+        queue.pop_front();
+        std::pair<std::multimap<uint256, FlatFilePos>::iterator, std::multimap<uint256, FlatFilePos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
+        while (range.first != range.second) {
+            std::multimap<uint256, FlatFilePos>::iterator it = range.first;
+            std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
+            if (ReadBlockFromDisk(*pblockrecursive, it->second, m_params.GetConsensus())) {
+                LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
+                        head.ToString());
+                LOCK(cs_main);
+                BlockValidationState dummy;
+                if (AcceptBlock(pblockrecursive, dummy, nullptr, true, &it->second, nullptr)) {
+                    nLoaded++;
+                    queue.push_back(pblockrecursive->GetHash());
+                }
+            }
+            range.first++;
+            mapBlocksUnknownParent.erase(it);
+            NotifyHeaderTip(*this);
+        }
+    }
+    return true;
+}
+
 void CChainState::LoadExternalBlockFile(FILE* fileIn, CSporkManager& spork_manager, FlatFilePos* dbp)
 {
-    // Map of disk positions for blocks with unknown parent (only used for reindex)
-    static std::multimap<uint256, FlatFilePos> mapBlocksUnknownParent;
     int64_t nStart = GetTimeMillis();
 
     int nLoaded = 0;
@@ -5205,75 +5377,120 @@ void CChainState::LoadExternalBlockFile(FILE* fileIn, CSporkManager& spork_manag
                 blkdat >> block;
                 nRewind = blkdat.GetPos();
 
-                uint256 hash = block.GetHash();
-                {
-                    LOCK(cs_main);
-                    // detect out of order blocks, and store them for later
-                    if (hash != m_params.GetConsensus().hashGenesisBlock && !m_blockman.LookupBlockIndex(block.hashPrevBlock)) {
-                        LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
-                                block.hashPrevBlock.ToString());
-                        if (dbp)
-                            mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
-                        continue;
-                    }
-
-                    // process in case the block isn't known yet
-                    CBlockIndex* pindex = m_blockman.LookupBlockIndex(hash);
-                    if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
-                      BlockValidationState state;
-                      if (AcceptBlock(pblock, state, nullptr, true, dbp, nullptr)) {
-                          nLoaded++;
-                      }
-                      if (state.IsError()) {
-                          break;
-                      }
-                    } else if (hash != m_params.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
-                        LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
-                    }
+                if (!ProcessImportedBlock(pblock, block.GetHash(), spork_manager, dbp, nLoaded)) {
+                    break;
                 }
+            } catch (const std::exception& e) {
+                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+            }
+        }
+    } catch (const std::runtime_error& e) {
+        AbortNode(std::string("System error: ") + e.what());
+    }
+    LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, GetTimeMillis() - nStart);
+}
 
-                // Activate the genesis block so normal node progress can continue
-                if (hash == m_params.GetConsensus().hashGenesisBlock) {
-                    BlockValidationState state;
-                    if (!ActivateBestChain(state, spork_manager, nullptr)) {
-                        break;
-                    }
+/** Blocks LoadMappedBlockFile has handed to its threads but not accepted yet */
+static constexpr size_t MAX_IMPORT_BLOCKS_IN_FLIGHT{1024};
+/** Serialized size of the blocks LoadMappedBlockFile has handed to its threads but not accepted yet */
+static constexpr size_t MAX_IMPORT_BYTES_IN_FLIGHT{64 << 20};
+
+void CChainState::LoadMappedBlockFile(const MappedFile& file, CSporkManager& spork_manager, ctpl::thread_pool& pool, FlatFilePos* dbp)
+{
+    assert(pool.size() > 0);
+    int64_t nStart = GetTimeMillis();
+
+    struct ParsedBlock {
+        std::shared_ptr<CBlock> block;
+        uint256 hash;
+    };
+    struct InFlight {
+        //! Position of the network magic in front of the block
+        uint64_t header_pos;
+        uint64_t block_pos;
+        uint32_t size;
+        std::future<ParsedBlock> parsed;
+    };
+    std::deque<InFlight> in_flight;
+    size_t bytes_in_flight{0};
+    // The threads read from the mapping, wait for all of them before it can go away
+    const auto drain = [&] {
+        for (const InFlight& entry : in_flight) entry.parsed.wait();
+        in_flight.clear();
+        bytes_in_flight = 0;
+    };
+
+    const Span<const unsigned char> data{file.Data()};
+    const unsigned char* const message_start{m_params.MessageStart()};
+    const unsigned int nMaxBlockSize = MaxBlockSize();
+    const Consensus::Params& consensus_params{m_params.GetConsensus()};
+    uint64_t scan_pos{0};
+    bool scan_done{false};
+
+    int nLoaded = 0;
+    try {
+        while (!ShutdownRequested()) {
+            // Locate blocks and hand them to the threads, as far ahead as the limits allow
+            while (!scan_done && in_flight.size() < MAX_IMPORT_BLOCKS_IN_FLIGHT && bytes_in_flight < MAX_IMPORT_BYTES_IN_FLIGHT) {
+                const auto found{std::search(data.begin() + scan_pos, data.end(), message_start, message_start + CMessageHeader::MESSAGE_START_SIZE)};
+                const uint64_t header_pos = found - data.begin();
+                if (header_pos + CMessageHeader::MESSAGE_START_SIZE + sizeof(uint32_t) > data.size()) {
+                    // no valid block header found; don't complain
+                    scan_done = true;
+                    break;
+                }
+                scan_pos = header_pos + 1; // start one byte further next time, in case of failure
+                const uint32_t nSize{ReadLE32(&data[header_pos + CMessageHeader::MESSAGE_START_SIZE])};
+                const uint64_t nBlockPos{header_pos + CMessageHeader::MESSAGE_START_SIZE + sizeof(uint32_t)};
+                if (nSize < 80 || nSize > nMaxBlockSize || nBlockPos + nSize > data.size()) {
+                    continue;
                 }
+                scan_pos = nBlockPos + nSize;
+
+                const Span<const unsigned char> block_data{data.subspan(nBlockPos, nSize)};
+                in_flight.push_back({header_pos, nBlockPos, nSize, pool.push([block_data, &consensus_params](int) {
+                    ParsedBlock parsed{std::make_shared<CBlock>(), uint256()};
+                    SpanReader{SER_DISK, CLIENT_VERSION, block_data, 0} >> *parsed.block;
+                    parsed.hash = parsed.block->GetHash();
+                    // Context-free checks, AcceptBlock doesn't repeat them for a block that passed (CBlock::fChecked)
+                    BlockValidationState state;
+                    CheckBlock(*parsed.block, state, consensus_params);
+                    return parsed;
+                })});
+                bytes_in_flight += nSize;
+            }
+            if (in_flight.empty()) break;
 
-                NotifyHeaderTip(*this);
-
-                // Recursively process earlier encountered successors of this block
-                std::deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, FlatFilePos>::iterator, std::multimap<uint256, FlatFilePos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, FlatFilePos>::iterator it = range.first;
-                        std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
-                        if (ReadBlockFromDisk(*pblockrecursive, it->second, m_params.GetConsensus())) {
-                            LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
-                                    head.ToString());
-                            LOCK(cs_main);
-                            BlockValidationState dummy;
-                            if (AcceptBlock(pblockrecursive, dummy, nullptr, true, &it->second, nullptr)) {
-                                nLoaded++;
-                                queue.push_back(pblockrecursive->GetHash());
-                            }
-                        }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
-                        NotifyHeaderTip(*this);
-                    }
+            InFlight next{std::move(in_flight.front())};
+            in_flight.pop_front();
+            bytes_in_flight -= next.size;
+            ParsedBlock parsed;
+            try {
+                parsed = next.parsed.get();
+            } catch (const std::exception& e) {
+                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+                // Look for a block inside the one that failed, the blocks located after it are located again
+                drain();
+                scan_pos = next.header_pos + 1;
+                scan_done = false;
+                continue;
+            }
+
+            try {
+                if (dbp)
+                    dbp->nPos = next.block_pos;
+                if (!ProcessImportedBlock(parsed.block, parsed.hash, spork_manager, dbp, nLoaded)) {
+                    break;
                 }
             } catch (const std::exception& e) {
                 LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
             }
         }
     } catch (const std::runtime_error& e) {
+        drain();
         AbortNode(std::string("System error: ") + e.what());
     }
+    drain();
     LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, GetTimeMillis() - nStart);
 }
 
@@ -5831,6 +6048,11 @@ bool ChainstateManager::ActivateSnapshot(
         const bool chaintip_loaded = m_snapshot_chainstate->LoadChainTip();
         assert(chaintip_loaded);
 
+        // The previous chainstate keeps validating the blocks below the snapshot base in the
+        // background, the mempool and the notifications move over to the snapshot chainstate.
+        m_active_chainstate->m_background_validation = true;
+        m_snapshot_chainstate->m_mempool = m_active_chainstate->m_mempool;
+        m_active_chainstate->m_mempool = nullptr;
         m_active_chainstate = m_snapshot_chainstate.get();
 
         LogPrintf("[snapshot] successfully activated snapshot %s\n", base_blockhash.ToString());
@@ -5842,6 +6064,49 @@ bool ChainstateManager::ActivateSnapshot(
     return true;
 }
 
+//! Read the EvoDB entries following the coins of a UTXO snapshot and hash them. If
+//! `db` is given the chain state entries it doesn't have yet are also written to it,
+//! in batches of about `EVODB_SNAPSHOT_BATCH_SIZE` bytes.
+static bool ReadSnapshotEvoDB(CAutoFile& coins_file, uint64_t count, CDBWrapper* db, uint256& hash)
+{
+    static constexpr size_t EVODB_SNAPSHOT_BATCH_SIZE{16 << 20};
+
+    CHashWriter hasher(SER_GETHASH, 0);
+    std::optional<CDBBatch> batch;
+    if (db) batch.emplace(*db);
+    SnapshotEvoDBEntry entry;
+
+    for (uint64_t i = 0; i < count; ++i) {
+        try {
+            coins_file >> entry;
+        } catch (const std::ios_base::failure&) {
+            LogPrintf("[snapshot] bad snapshot format or truncated snapshot after deserializing %d EvoDB entries\n", i);
+            return false;
+        }
+        hasher << entry;
+
+        if (batch) {
+            // Entries the background chainstate wrote already are left alone, they describe the same blocks
+            const CDataStream key{entry.key, SER_DISK, CLIENT_VERSION};
+            if (IsEvoDBChainStateKey(key) && !db->Exists(key)) {
+                batch->Write(key, CDataStream{entry.value, SER_DISK, CLIENT_VERSION});
+            }
+            if (batch->SizeEstimate() > EVODB_SNAPSHOT_BATCH_SIZE) {
+                if (!db->WriteBatch(*batch)) return false;
+                batch->Clear();
+            }
+        }
+        if (i % 120000 == 0 && ShutdownRequested()) {
+            return false;
+        }
+    }
+    if (batch && !db->WriteBatch(*batch, /*fSync=*/true)) {
+        return false;
+    }
+    hash = hasher.GetHash();
+    return true;
+}
+
 bool ChainstateManager::PopulateAndValidateSnapshot(
     CChainState& snapshot_chainstate,
     CAutoFile& coins_file,
@@ -5947,6 +6212,19 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
     // method.
     coins_cache.SetBestBlock(base_blockhash);
 
+    // Check the EvoDB entries against the assumeutxo value first, they are only
+    // written to the shared EvoDB once the coins are known to be good as well.
+    const long evodb_pos{std::ftell(coins_file.Get())};
+    uint256 evodb_hash;
+    if (evodb_pos < 0 || !ReadSnapshotEvoDB(coins_file, metadata.m_evodb_count, /*db=*/nullptr, evodb_hash)) {
+        return false;
+    }
+    if (evodb_hash != au_data.evodb_hash) {
+        LogPrintf("[snapshot] bad snapshot EvoDB hash: expected %s, got %s\n",
+            au_data.evodb_hash.ToString(), evodb_hash.ToString());
+        return false;
+    }
+
     bool out_of_coins{false};
     try {
         coins_file >> outpoint;
@@ -5990,11 +6268,30 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
         return false;
     }
 
+    // Masternode lists, quorums and the credit pool as of the base block. Anything
+    // pending in the EvoDB transactions is committed first so the entries the background
+    // chainstate already has are known; entries for blocks both chains share are identical.
+    // The snapshot chainstate tracks its best block under its own key, so it never moves
+    // the one of the background chainstate, see EVODB_SNAPSHOT_BEST_BLOCK.
+    CEvoDB& evodb = snapshot_chainstate.m_evoDb;
+    if (!WITH_LOCK(::cs_main, return evodb.CommitRootTransaction()) ||
+        std::fseek(coins_file.Get(), evodb_pos, SEEK_SET) != 0 ||
+        !ReadSnapshotEvoDB(coins_file, metadata.m_evodb_count, &evodb.GetRawDB(), evodb_hash)) {
+        LogPrintf("[snapshot] failed to write EvoDB entries\n");
+        return false;
+    }
+    LogPrintf("[snapshot] loaded %d EvoDB entries from snapshot %s\n",
+        metadata.m_evodb_count, base_blockhash.ToString());
+
     snapshot_chainstate.m_chain.SetTip(snapshot_start_block);
 
     // The remainder of this function requires modifying data protected by cs_main.
     LOCK(::cs_main);
 
+    auto dbTx = evodb.BeginTransaction();
+    evodb.WriteBestBlock(base_blockhash, EVODB_SNAPSHOT_BEST_BLOCK);
+    dbTx->Commit();
+
     // Fake various pieces of CBlockIndex state:
     CBlockIndex* index = nullptr;
     for (int i = 0; i <= snapshot_chainstate.m_chain.Height(); ++i) {
@@ -6018,6 +6315,105 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
     return true;
 }
 
+void ChainstateManager::ActivateBackgroundChainstate(CSporkManager& spork_manager)
+{
+    AssertLockNotHeld(::cs_main);
+
+    CChainState* background{nullptr};
+    {
+        LOCK(::cs_main);
+        if (m_snapshot_validated || !m_snapshot_chainstate || !m_ibd_chainstate) return;
+
+        CBlockIndex* base = m_blockman.LookupBlockIndex(*Assert(m_snapshot_chainstate->m_from_snapshot_blockhash));
+        const CBlockIndex* tip = m_ibd_chainstate->m_chain.Tip();
+        if (!base || !tip || base->GetAncestor(tip->nHeight) != tip) return;
+
+        // Blocks below the snapshot base have less work than the active tip, so they never become
+        // candidates of the background chainstate on their own. Offer it the furthest block towards
+        // the base it can connect without gaps.
+        CBlockIndex* candidate{nullptr};
+        for (int height = tip->nHeight + 1; height <= base->nHeight; ++height) {
+            CBlockIndex* pindex = base->GetAncestor(height);
+            if (!(pindex->nStatus & BLOCK_HAVE_DATA) || !pindex->IsValid(BLOCK_VALID_TRANSACTIONS)) break;
+            candidate = pindex;
+        }
+        if (candidate) {
+            m_ibd_chainstate->setBlockIndexCandidates.insert(candidate);
+            background = m_ibd_chainstate.get();
+        }
+    }
+
+    if (background) {
+        BlockValidationState state;
+        if (!background->ActivateBestChain(state, spork_manager, nullptr)) {
+            LogPrintf("[snapshot] failed to connect blocks of the background chainstate: %s\n", state.ToString());
+            return;
+        }
+    }
+
+    MaybeCompleteSnapshotValidation();
+}
+
+bool ChainstateManager::MaybeCompleteSnapshotValidation()
+{
+    AssertLockNotHeld(::cs_main);
+    TRY_LOCK(m_snapshot_validation_mutex, lock);
+    if (!lock) return false;
+
+    uint256 base_blockhash;
+    const CBlockIndex* ibd_tip{nullptr};
+    CCoinsViewDB* ibd_coins_db{nullptr};
+    std::unique_ptr<CCoinsViewCursor> cursor;
+    {
+        LOCK(::cs_main);
+        if (m_snapshot_validated) return true;
+        if (!m_snapshot_chainstate || !m_ibd_chainstate) return false;
+
+        base_blockhash = *Assert(m_snapshot_chainstate->m_from_snapshot_blockhash);
+        ibd_tip = m_ibd_chainstate->m_chain.Tip();
+        if (!ibd_tip || ibd_tip->GetBlockHash() != base_blockhash) return false;
+
+        LogPrintf("[snapshot] background chainstate reached snapshot base %s, validating\n", base_blockhash.ToString());
+        m_ibd_chainstate->ForceFlushStateToDisk();
+        // The cursor iterates over a snapshot of the coins database, the hashing below doesn't need cs_main
+        ibd_coins_db = &m_ibd_chainstate->CoinsDB();
+        cursor = ibd_coins_db->Cursor();
+    }
+
+    // The snapshot was only accepted if its height has an assumeutxo value.
+    const AssumeutxoData& au_data = *Assert(ExpectedAssumeutxo(ibd_tip->nHeight, ::Params()));
+
+    CCoinsStats stats{CoinStatsHashType::HASH_SERIALIZED};
+    auto breakpoint_fnc = [] { /* TODO insert breakpoint here? */ };
+    if (!GetUTXOStats(std::move(cursor), ibd_coins_db, ibd_tip, stats, breakpoint_fnc)) {
+        LogPrintf("[snapshot] failed to generate coins stats of the background chainstate\n");
+        return false;
+    }
+
+    if (AssumeutxoHash{stats.hashSerialized} != au_data.hash_serialized) {
+        LogPrintf("[snapshot] !!! background validation of snapshot %s failed: expected %s, got %s\n",
+            base_blockhash.ToString(), au_data.hash_serialized.ToString(), stats.hashSerialized.ToString());
+        AbortNode(strprintf("The UTXO snapshot %s is invalid, the chain built on top of it can't be trusted. "
+                            "Remove the snapshot chainstate and restart.", base_blockhash.ToString()));
+        return false;
+    }
+
+    LOCK(::cs_main);
+    // The snapshot chainstate is the validated one from now on, its EvoDB best block becomes the
+    // regular one. The EvoDB entries of the blocks below the base were written by the background
+    // chainstate meanwhile.
+    CEvoDB& evodb = m_snapshot_chainstate->m_evoDb;
+    auto dbTx = evodb.BeginTransaction();
+    evodb.WriteBestBlock(m_snapshot_chainstate->m_chain.Tip()->GetBlockHash());
+    evodb.Erase(EVODB_SNAPSHOT_BEST_BLOCK);
+    dbTx->Commit();
+    m_snapshot_chainstate->m_evodb_best_block_key = EVODB_BEST_BLOCK;
+
+    LogPrintf("[snapshot] snapshot %s validated by the background chainstate\n", base_blockhash.ToString());
+    m_snapshot_validated = true;
+    return true;
+}
+
 CChainState& ChainstateManager::ActiveChainstate() const
 {
     LOCK(::cs_main);
@@ -38,12 +38,16 @@
 #include <utility>
 #include <vector>
 
+namespace ctpl {
+class thread_pool;
+} // namespace ctpl
 namespace llmq {
 class CChainLocksHandler;
 class CInstantSendManager;
 } // namespace llmq
 
 class CEvoDB;
+class MappedFile;
 
 class CChainState;
 class CBlockIndex;
@@ -70,6 +74,10 @@ static const unsigned int DEFAULT_MIN_RELAY_TX_FEE = 1000;
 // static const CAmount HIGH_TX_FEE_PER_KB = 0.01 * COIN;
 // //! -maxtxfee will warn if called with a higher fee than this amount (in sprites)
 // static const CAmount HIGH_MAX_TX_FEE = 100 * HIGH_TX_FEE_PER_KB;
+/** -reindexthreads default, threads deserializing and checking blocks during -reindex and -loadblock */
+static const int DEFAULT_REINDEX_THREADS = 4;
+/** Maximum number of threads deserializing and checking blocks during -reindex and -loadblock */
+static const int MAX_REINDEX_THREADS = 16;
 /** Default for -limitancestorcount, max number of in-mempool ancestors */
 static const unsigned int DEFAULT_ANCESTOR_LIMIT = 25;
 /** Default for -limitancestorsize, maximum kilobytes of tx + all in-mempool ancestors */
@@ -89,9 +97,15 @@ static const unsigned int DEFAULT_MEMPOOL_EXPIRY = 336;
 /** The maximum size of a blk?????.dat file (since 0.8) */
 static const unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
 /** Maximum number of dedicated script-checking threads allowed */
-static const int MAX_SCRIPTCHECK_THREADS = 15;
+static const int MAX_SCRIPTCHECK_THREADS = 31;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** -prefetchthreads default, threads reading the coins spent by a block ahead of ConnectBlock */
+static const int DEFAULT_PREFETCH_THREADS = 4;
+/** Maximum number of input prefetch threads */
+static const int MAX_PREFETCH_THREADS = 16;
+/** Blocks spending fewer uncached coins than this are not prefetched */
+static const size_t MIN_PREFETCH_INPUTS = 16;
 /** Number of headers sent in one getheaders result. We rely on the assumption that if a peer sends
  *  less than this number, we reached its tip. Changing this value is a protocol upgrade. */
 static const unsigned int MAX_HEADERS_RESULTS = 2000;
@@ -195,6 +209,10 @@ void UnloadBlockIndex(CTxMemPool* mempool, ChainstateManager& chainman);
 void StartScriptCheckWorkerThreads(int threads_num);
 /** Stop all of the script checking worker threads */
 void StopScriptCheckWorkerThreads();
+/** Run the threads reading the coins spent by a block ahead of ConnectBlock */
+void StartInputPrefetchThreads(int threads_num);
+/** Stop the input prefetch threads */
+void StopInputPrefetchThreads();
 
 CTransactionRef GetTransaction(const CBlockIndex* const block_index, const CTxMemPool* const mempool, const uint256& hash, const Consensus::Params& consensusParams, uint256& hashBlock);
 
@@ -668,6 +686,13 @@ protected:
     CSporkManager& m_spork_manager;
     CEvoDB& m_evoDb;
 
+    //! The EvoDB key this chainstate keeps its best block under, see EVODB_SNAPSHOT_BEST_BLOCK.
+    std::string m_evodb_best_block_key GUARDED_BY(::cs_main);
+
+    //! Whether this chainstate validates the blocks below a snapshot base in the background.
+    //! Its blocks are neither announced to the validation interface nor to the UI then.
+    bool m_background_validation GUARDED_BY(::cs_main){false};
+
 public:
     //! Reference to a BlockManager instance which itself is shared across all
     //! CChainState instances.
@@ -764,6 +789,11 @@ public:
 
     /** Import blocks from an external file */
     void LoadExternalBlockFile(FILE* fileIn, CSporkManager& spork_manager, FlatFilePos* dbp = nullptr);
+    /**
+     * Import blocks from a memory mapped block file. Blocks are deserialized, hashed and checked on the
+     * threads of pool ahead of being accepted in file order on the calling thread.
+     */
+    void LoadMappedBlockFile(const MappedFile& file, CSporkManager& spork_manager, ctpl::thread_pool& pool, FlatFilePos* dbp = nullptr);
 
     /**
      * Update the on-disk chain state.
@@ -874,7 +904,7 @@ private:
     CBlockIndex* FindMostWorkChain() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     void ReceivedBlockTransactions(const CBlock& block, CBlockIndex* pindexNew, const FlatFilePos& pos) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
-    bool RollforwardBlock(const CBlockIndex* pindex, CCoinsViewCache& inputs) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    bool RollforwardBlock(const CBlockIndex* pindex, CCoinsViewCache& inputs, bool fProcessSpecialTxs = true) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     //! Mark a block as conflicting
     bool MarkConflictingBlock(BlockValidationState& state, CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -888,6 +918,9 @@ private:
 
     bool LoadBlockIndexDB() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+    /** Accept a block read from a block file and the blocks found earlier that were waiting for it, false if the import has to stop */
+    bool ProcessImportedBlock(const std::shared_ptr<CBlock>& pblock, const uint256& hash, CSporkManager& spork_manager, FlatFilePos* dbp, int& nLoaded);
+
     //! Indirection necessary to make lock annotations work with an optional mempool.
     RecursiveMutex* MempoolMutex() const LOCK_RETURNED(m_mempool->cs)
     {
@@ -995,7 +1028,11 @@ private:
 
     //! If true, the assumed-valid chainstate has been fully validated
     //! by the background validation chainstate.
-    bool m_snapshot_validated{false};
+    std::atomic<bool> m_snapshot_validated{false};
+
+    //! Held while the background chainstate is hashed, so only one caller of
+    //! MaybeCompleteSnapshotValidation() does that.
+    Mutex m_snapshot_validation_mutex;
 
     //! Internal helper for ActivateSnapshot().
     [[nodiscard]] bool PopulateAndValidateSnapshot(
@@ -1077,6 +1114,20 @@ public:
     //! Is there a snapshot in use and has it been fully validated?
     bool IsSnapshotValidated() const { return m_snapshot_validated; }
 
+    //! Once the background validation chainstate has reached the snapshot base
+    //! block, check that the UTXO set it built hashes to the assumeutxo value the
+    //! snapshot was accepted with. A mismatch means the snapshot was bad and
+    //! aborts the node. The coins are hashed without holding cs_main, from a
+    //! cursor taken right after flushing the background chainstate.
+    //!
+    //! @returns true if the snapshot is (now) validated.
+    bool MaybeCompleteSnapshotValidation() LOCKS_EXCLUDED(::cs_main) EXCLUSIVE_LOCKS_REQUIRED(!m_snapshot_validation_mutex);
+
+    //! Connect the blocks below the snapshot base that were stored for the
+    //! background validation chainstate so far, then try to complete the
+    //! snapshot validation. Called by ProcessNewBlock().
+    void ActivateBackgroundChainstate(CSporkManager& spork_manager) LOCKS_EXCLUDED(::cs_main) EXCLUSIVE_LOCKS_REQUIRED(!m_snapshot_validation_mutex);
+
     //! @returns true if this chainstate is being used to validate an active
     //!          snapshot in the background.
     bool IsBackgroundIBD(CChainState* chainstate) const;
@@ -1110,7 +1161,7 @@ public:
      * @param[out]  fNewBlock A boolean which is set to indicate if the block was first received via this call
      * @returns     If the block was processed, independently of block validity
      */
-    bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<const CBlock> pblock, CSporkManager& spork_manager, bool fForceProcessing, bool* fNewBlock) LOCKS_EXCLUDED(cs_main);
+    bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<const CBlock> pblock, CSporkManager& spork_manager, bool fForceProcessing, bool* fNewBlock) LOCKS_EXCLUDED(cs_main) EXCLUSIVE_LOCKS_REQUIRED(!m_snapshot_validation_mutex);
 
     /**
      * Process incoming block headers.
@@ -11,7 +11,7 @@
  */
 
 
-static const int PROTOCOL_VERSION = 70224;
+static const int PROTOCOL_VERSION = 70225;
 
 //! initial proto version, to be increased after version/verack negotiation
 static const int INIT_PROTO_VERSION = 209;
@@ -55,6 +55,9 @@ static const int MNLISTDIFF_CHAINLOCKS_PROTO_VERSION = 70223;
 //! Legacy ISLOCK messages and a corresponding INV were dropped in this version
 static const int NO_LEGACY_ISLOCK_PROTO_VERSION = 70223;
 
+//! SENDCRC32C, CRC32C message checksums between masternodes, was introduced in this version
+static const int CRC32C_CHECKSUM_PROTO_VERSION = 70225;
+
 // Make sure that none of the values above collide with `ADDRV2_FORMAT`.
 
 #endif // BITCOIN_VERSION_H
\ No newline at end of file
@@ -10,11 +10,17 @@
 #include <coinjoin/context.h>
 #include <coinjoin/options.h>
 #include <coinjoin/util.h>
+#include <llmq/chainlocks.h>
+#include <llmq/context.h>
+#include <masternode/sync.h>
+#include <netfulfilledman.h>
 #include <node/context.h>
 #include <util/translation.h>
 #include <validation.h>
 #include <wallet/wallet.h>
 
+#include <list>
+
 #include <boost/test/unit_test.hpp>
 
 BOOST_FIXTURE_TEST_SUITE(coinjoin_tests, BasicTestingSetup)
@@ -124,6 +130,189 @@ BOOST_AUTO_TEST_CASE(coinjoin_accept_tests)
     // CMutableTransaction custom_cmt()
 }
 
+class CCoinJoinBaseManagerTest : public CCoinJoinBaseManager
+{
+public:
+    bool AddQueue(const CCoinJoinQueue& dsq) { LOCK(cs_vecqueue); return AddQueueLocked(dsq); }
+    bool HasQueue(const COutPoint& outpoint, bool fReady, int nDenom) { LOCK(cs_vecqueue); return FindQueueLocked(outpoint, fReady, nDenom) != nullptr; }
+    bool HasQueueFromMasternode(const COutPoint& outpoint) { LOCK(cs_vecqueue); return HasQueueFromMasternodeLocked(outpoint); }
+    void Check() { CheckQueue(); }
+};
+
+BOOST_AUTO_TEST_CASE(coinjoin_queue_index_tests)
+{
+    CCoinJoinBaseManagerTest manager;
+    const int64_t now = GetAdjustedTime();
+    const COutPoint mn1{uint256::ONE, 0};
+    const COutPoint mn2{uint256::ONE, 1};
+    const COutPoint mn3{uint256::ONE, 2};
+
+    BOOST_CHECK(manager.AddQueue(CCoinJoinQueue(1, mn1, uint256(), now - 2, false)));
+    BOOST_CHECK(manager.AddQueue(CCoinJoinQueue(2, mn2, uint256(), now - 1, false)));
+    BOOST_CHECK(manager.AddQueue(CCoinJoinQueue(1, mn3, uint256(), now, false)));
+    // at most one unready queue per masternode, no matter the denomination
+    BOOST_CHECK(!manager.AddQueue(CCoinJoinQueue(1, mn1, uint256(), now, false)));
+    BOOST_CHECK(!manager.AddQueue(CCoinJoinQueue(2, mn1, uint256(), now, false)));
+    BOOST_CHECK(manager.AddQueue(CCoinJoinQueue(1, mn1, uint256(), now, true)));
+    BOOST_CHECK_EQUAL(manager.GetQueueSize(), 4);
+    BOOST_CHECK(manager.HasQueue(mn1, true, 1));
+    BOOST_CHECK(!manager.HasQueue(mn1, true, 2));
+    BOOST_CHECK(!manager.HasQueue(mn2, true, 2));
+    BOOST_CHECK(manager.HasQueueFromMasternode(mn2));
+    BOOST_CHECK(!manager.HasQueueFromMasternode(COutPoint{uint256::ONE, 3}));
+
+    // denomination bucket, oldest first
+    CCoinJoinQueue dsq;
+    BOOST_CHECK(manager.GetQueueItemAndTry(dsq, 2));
+    BOOST_CHECK(dsq.masternodeOutpoint == mn2);
+    BOOST_CHECK(!manager.GetQueueItemAndTry(dsq, 2));
+
+    // any denomination, oldest untried first
+    BOOST_CHECK(manager.GetQueueItemAndTry(dsq));
+    BOOST_CHECK(dsq.masternodeOutpoint == mn1 && !dsq.fReady);
+    manager.MarkQueuesTried(1);
+    BOOST_CHECK(!manager.GetQueueItemAndTry(dsq));
+
+    // expiry
+    BOOST_CHECK(manager.AddQueue(CCoinJoinQueue(4, mn2, uint256(), now - COINJOIN_QUEUE_TIMEOUT - 10, true)));
+    BOOST_CHECK_EQUAL(manager.GetQueueSize(), 5);
+    manager.Check();
+    BOOST_CHECK_EQUAL(manager.GetQueueSize(), 4);
+    BOOST_CHECK(!manager.HasQueue(mn2, true, 4));
+
+    // concurrent sessions of a masternode announce their readiness per denomination
+    BOOST_CHECK(manager.AddQueue(CCoinJoinQueue(2, mn1, uint256(), now, true)));
+    BOOST_CHECK(manager.HasQueue(mn1, true, 2));
+    BOOST_CHECK_EQUAL(manager.GetQueueSize(), 5);
+}
+
+BOOST_AUTO_TEST_CASE(coinjoin_queue_sessions_tests)
+{
+    // A masternode running several sessions at once
+    CCoinJoinBaseManagerTest manager;
+    const int64_t now = GetAdjustedTime();
+    const COutPoint mn{uint256::ONE, 0};
+
+    // The first session is announced, a second one can't be announced while that dsq is known
+    BOOST_CHECK(manager.AddQueue(CCoinJoinQueue(1, mn, uint256(), now - COINJOIN_QUEUE_TIMEOUT + 10, false)));
+    BOOST_CHECK(manager.HasQueueFromMasternode(mn));
+    BOOST_CHECK(!manager.AddQueue(CCoinJoinQueue(2, mn, uint256(), now, false)));
+    BOOST_CHECK(manager.HasQueue(mn, false, 1));
+    BOOST_CHECK(manager.HasQueue(mn, false, 2));
+    BOOST_CHECK_EQUAL(manager.GetQueueSize(), 1);
+
+    // The first session gets ready, the masternode is still rate limited by its ready dsq
+    BOOST_CHECK(manager.AddQueue(CCoinJoinQueue(1, mn, uint256(), now - COINJOIN_QUEUE_TIMEOUT + 10, true)));
+    BOOST_CHECK(!manager.AddQueue(CCoinJoinQueue(2, mn, uint256(), now, false)));
+
+    // Once the dsqs of the first session expired the second session is announced
+    SetMockTime(now + 20);
+    manager.Check();
+    BOOST_CHECK_EQUAL(manager.GetQueueSize(), 0);
+    BOOST_CHECK(!manager.HasQueueFromMasternode(mn));
+    BOOST_CHECK(manager.AddQueue(CCoinJoinQueue(2, mn, uint256(), now + 20, false)));
+
+    // Both sessions announce their readiness, each of them only once
+    BOOST_CHECK(manager.AddQueue(CCoinJoinQueue(1, mn, uint256(), now + 20, true)));
+    BOOST_CHECK(manager.AddQueue(CCoinJoinQueue(2, mn, uint256(), now + 20, true)));
+    BOOST_CHECK(!manager.AddQueue(CCoinJoinQueue(2, mn, uint256(), now + 21, true)));
+    BOOST_CHECK(manager.HasQueue(mn, true, 1));
+    BOOST_CHECK(manager.HasQueue(mn, true, 2));
+    BOOST_CHECK(!manager.HasQueue(mn, true, 4));
+    BOOST_CHECK_EQUAL(manager.GetQueueSize(), 3);
+    SetMockTime(0);
+}
+
+BOOST_FIXTURE_TEST_CASE(coinjoin_dstx_expiry_tests, TestingSetup)
+{
+    CDSTXManager dstxman;
+    const llmq::CChainLocksHandler& clhandler = *m_node.llmq_ctx->clhandler;
+    // DSTXes are only checked for expiry once the blockchain is synced
+    BOOST_REQUIRE(m_node.netfulfilledman->LoadCache(/*load_cache=*/false));
+    CMasternodeSync& mn_sync = *m_node.mn_sync;
+
+    std::vector<CCoinJoinBroadcastTx> dstxes;
+    for (uint32_t i = 0; i < 4; ++i) {
+        CMutableTransaction mtx;
+        mtx.vin.emplace_back(COutPoint{uint256::ONE, i});
+        mtx.vout.emplace_back(CoinJoin::GetSmallestDenomination(), CScript() << OP_TRUE);
+        dstxes.emplace_back(MakeTransactionRef(mtx), COutPoint{uint256::TWO, i}, uint256(), GetAdjustedTime());
+        dstxman.AddDSTX(dstxes.back());
+    }
+    auto has_dstx = [&](size_t i) { return static_cast<bool>(dstxman.GetDSTX(dstxes[i].tx->GetHash())); };
+
+    std::vector<std::unique_ptr<CBlockIndex>> indexes;
+    std::list<uint256> hashes;
+    auto make_index = [&](int nHeight) {
+        indexes.push_back(std::make_unique<CBlockIndex>());
+        hashes.push_back(InsecureRand256());
+        indexes.back()->nHeight = nHeight;
+        indexes.back()->phashBlock = &hashes.back();
+        return indexes.back().get();
+    };
+    auto connect = [&](int nHeight, std::vector<size_t> mined) {
+        auto block = std::make_shared<CBlock>();
+        for (const size_t i : mined) block->vtx.push_back(dstxes[i].tx);
+        dstxman.BlockConnected(block, make_index(nHeight));
+        return block;
+    };
+
+    // dstx 0 and 1 are mined at height 100, dstx 2 at height 110, dstx 3 stays in the mempool
+    connect(100, {0, 1});
+    const auto block110 = connect(110, {2});
+    dstxman.TransactionAddedToMempool(dstxes[3].tx);
+
+    // Nothing expires before the blockchain is synced
+    dstxman.UpdatedBlockTip(make_index(200), clhandler, mn_sync);
+    for (size_t i = 0; i < dstxes.size(); ++i) BOOST_CHECK(has_dstx(i));
+
+    mn_sync.SwitchToNextAsset();
+    BOOST_REQUIRE(mn_sync.IsBlockchainSynced());
+
+    // Without chainlocks a DSTX expires once it's buried under more than 24 blocks
+    dstxman.UpdatedBlockTip(make_index(124), clhandler, mn_sync);
+    for (size_t i = 0; i < dstxes.size(); ++i) BOOST_CHECK(has_dstx(i));
+    dstxman.NotifyChainLock(make_index(125), clhandler, mn_sync);
+    BOOST_CHECK(!has_dstx(0));
+    BOOST_CHECK(!has_dstx(1));
+    BOOST_CHECK(has_dstx(2));
+    BOOST_CHECK(has_dstx(3));
+
+    // A disconnected DSTX is unconfirmed again and doesn't expire, mined again it expires at its new height
+    dstxman.BlockDisconnected(block110, nullptr);
+    dstxman.UpdatedBlockTip(make_index(200), clhandler, mn_sync);
+    BOOST_CHECK(has_dstx(2));
+    connect(180, {2});
+    dstxman.UpdatedBlockTip(make_index(204), clhandler, mn_sync);
+    BOOST_CHECK(has_dstx(2));
+    dstxman.UpdatedBlockTip(make_index(205), clhandler, mn_sync);
+    BOOST_CHECK(!has_dstx(2));
+
+    // Unconfirmed DSTXes are never expired
+    dstxman.UpdatedBlockTip(make_index(1000), clhandler, mn_sync);
+    BOOST_CHECK(has_dstx(3));
+}
+
+BOOST_AUTO_TEST_CASE(coinjoin_pending_dstx_tests)
+{
+    CDSTXManager dstxman;
+    CMutableTransaction mtx;
+    mtx.vin.emplace_back(COutPoint{uint256::ONE, 0});
+    CCoinJoinBroadcastTx dstx{MakeTransactionRef(mtx), COutPoint{uint256::TWO, 0}, uint256(), GetAdjustedTime()};
+    dstx.vchSig = {1, 2, 3};
+    CCoinJoinBroadcastTx dstx_other_sig{dstx};
+    dstx_other_sig.vchSig = {4, 5, 6};
+
+    BOOST_CHECK(dstxman.AddPendingDSTX(dstx));
+    BOOST_CHECK(!dstxman.AddPendingDSTX(dstx));
+    // A copy with another (possibly bad) signature doesn't hold back the one that is pending and vice versa
+    BOOST_CHECK(dstxman.AddPendingDSTX(dstx_other_sig));
+    dstxman.RemovePendingDSTX(dstx_other_sig);
+    BOOST_CHECK(!dstxman.AddPendingDSTX(dstx));
+    dstxman.RemovePendingDSTX(dstx);
+    BOOST_CHECK(dstxman.AddPendingDSTX(dstx));
+}
+
 class CTransactionBuilderTestSetup : public TestChain100Setup
 {
 public:
@@ -32,6 +32,8 @@ class DumptxoutsetTest(BitcoinTestFramework):
         assert expected_path.is_file()
 
         assert_equal(out['coins_written'], 100)
+        assert out['evodb_entries_written'] > 0
+        assert_equal(len(out['evodb_hash']), 64)
         assert_equal(out['base_height'], 100)
         assert_equal(out['path'], str(expected_path))
         # Blockhash should be deterministic based on mocked time.